@@ -0,0 +1,406 @@
+// bench.cpp --- Benchmark suite for onigpp (std::regex with USE_STD_FOR_TESTS)
+// Author: katahiromz
+// License: BSD-2-Clause
+//
+// Every case runs one operation (search, match, iterator, token iterator or
+// replace) on a generated subject of a given size, character type, container
+// and syntax. A case is run --warmup times untimed, then --samples times; each
+// sample repeats the operation until it takes at least --min-time, and the
+// per-operation time is reported as min/p50/p90/p99/max. The subjects are
+// generated from a fixed seed, so runs are repeatable.
+//
+// Usage: onigpp_bench [options]
+//   --sizes=LIST      Subject sizes in characters, K and M suffixes allowed
+//                     (default: 64,4K,256K,1M; e.g. --sizes=16M,256M)
+//   --samples=N       Timed samples per case (default: 15)
+//   --warmup=N        Untimed runs per case (default: 3)
+//   --min-time=MS     Minimum duration of one sample in milliseconds (default: 10)
+//   --max-list-size=N Largest subject for std::list and std::deque (default: 1M)
+//   --filter=TEXT     Run only the cases whose name contains TEXT
+//   --format=FORMAT   text (default), csv or json
+//   --list            Print the case names and exit
+//
+// Case names are op/char/container/syntax/size, e.g. search/char16_t/string/oniguruma/4096.
+// std::regex runs only ECMAScript on char and wchar_t, and its match cases
+// are limited to 64K characters because libstdc++ recurses per character.
+#include "tests.h"
+#include <list>
+#include <deque>
+#include <chrono>
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+#include <sstream>
+#include <iomanip>
+
+namespace {
+
+enum op_type { op_search, op_match, op_iterator, op_token, op_replace };
+enum container_type { cont_string, cont_list, cont_deque };
+enum syntax_type { syntax_ecmascript, syntax_oniguruma };
+
+const char* const op_names[] = { "search", "match", "iterator", "token", "replace" };
+const char* const container_names[] = { "string", "list", "deque" };
+const char* const syntax_names[] = { "ecmascript", "oniguruma" };
+
+struct options {
+	std::vector<size_t> sizes;
+	size_t samples;
+	size_t warmup;
+	double min_time; // seconds
+	size_t max_list_size;
+	std::string filter;
+	std::string format;
+	bool list_only;
+
+	options()
+		: samples(15), warmup(3), min_time(0.010), max_list_size(1024 * 1024),
+		  format("text"), list_only(false)
+	{
+		sizes.push_back(64);
+		sizes.push_back(4 * 1024);
+		sizes.push_back(256 * 1024);
+		sizes.push_back(1024 * 1024);
+	}
+};
+
+struct result {
+	std::string name;
+	std::string op, char_name, container, syntax;
+	size_t size, bytes, iterations;
+	double min_ns, p50_ns, p90_ns, p99_ns, max_ns;
+};
+
+// Keeps the operations from being optimized away
+volatile size_t g_sink = 0;
+
+// Parses "64", "4K" or "16M"
+bool parse_size(const std::string& text, size_t& value) {
+	if (text.empty()) return false;
+	char* end = nullptr;
+	unsigned long long n = std::strtoull(text.c_str(), &end, 10);
+	std::string suffix(end);
+	if (suffix == "K" || suffix == "k") n *= 1024;
+	else if (suffix == "M" || suffix == "m") n *= 1024 * 1024;
+	else if (!suffix.empty()) return false;
+	value = static_cast<size_t>(n);
+	return n > 0;
+}
+
+bool parse_options(int argc, char** argv, options& opt) {
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		std::string::size_type eq = arg.find('=');
+		std::string key = arg.substr(0, eq);
+		std::string value = (eq == std::string::npos) ? std::string() : arg.substr(eq + 1);
+		size_t n = 0;
+		if (key == "--sizes") {
+			opt.sizes.clear();
+			std::istringstream list(value);
+			std::string item;
+			while (std::getline(list, item, ',')) {
+				if (!parse_size(item, n)) return false;
+				opt.sizes.push_back(n);
+			}
+			if (opt.sizes.empty()) return false;
+		} else if (key == "--samples" && parse_size(value, n)) {
+			opt.samples = n;
+		} else if (key == "--warmup") {
+			opt.warmup = static_cast<size_t>(std::strtoul(value.c_str(), nullptr, 10));
+		} else if (key == "--min-time" && parse_size(value, n)) {
+			opt.min_time = n / 1000.0;
+		} else if (key == "--max-list-size" && parse_size(value, n)) {
+			opt.max_list_size = n;
+		} else if (key == "--filter") {
+			opt.filter = value;
+		} else if (key == "--format" && (value == "text" || value == "csv" || value == "json")) {
+			opt.format = value;
+		} else if (key == "--list") {
+			opt.list_only = true;
+		} else {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Log-like ASCII text of exactly size characters from a fixed seed. The only
+// '@' is in the address at the very end, which the search and match cases look for.
+std::string make_subject(size_t size) {
+	static const char* const words[] = {
+		"GET", "POST", "/index.html", "/api/v1/items", "status", "user", "session",
+		"timeout", "retry", "cache", "miss", "hit", "latency", "bytes", "ok", "error",
+	};
+	const std::string tail = " admin@example.org";
+	std::string s;
+	s.reserve(size + 32);
+	std::uint32_t seed = 12345;
+	while (s.size() < size) {
+		seed = seed * 1103515245u + 12345u;
+		std::uint32_t r = (seed >> 16) & 0x7fff;
+		if (r % 5 == 0) {
+			s += std::to_string(r % 100000);
+		} else {
+			s += words[r % (sizeof(words) / sizeof(words[0]))];
+		}
+		s += (r % 11 == 0) ? '\n' : ' ';
+	}
+	s.resize(size);
+	if (size >= tail.size())
+		s.replace(size - tail.size(), tail.size(), tail);
+	return s;
+}
+
+template <class CharT>
+std::basic_string<CharT> widen(const std::string& s) {
+	return std::basic_string<CharT>(s.begin(), s.end());
+}
+
+template <class CharT> const char* char_name();
+template <> const char* char_name<char>() { return "char"; }
+template <> const char* char_name<wchar_t>() { return "wchar_t"; }
+#ifndef USE_STD_FOR_TESTS
+template <> const char* char_name<char16_t>() { return "char16_t"; }
+template <> const char* char_name<char32_t>() { return "char32_t"; }
+#endif
+
+const char* pattern_of(op_type op) {
+	switch (op) {
+	case op_search:   return "(\\w+)@example\\.(org|net)";
+	case op_match:    return "[^@]*@[\\s\\S]*";
+	case op_iterator: return "\\d+";
+	case op_token:    return "\\s+";
+	default:          return "\\d+";
+	}
+}
+
+// One run of op over [first, last); returns a value that depends on the result
+template <class It, class CharT>
+size_t run_once(op_type op, It first, It last, const rex::basic_regex<CharT>& re,
+                const std::basic_string<CharT>& fmt)
+{
+	switch (op) {
+	case op_search: {
+		rex::match_results<It> m;
+		return rex::regex_search(first, last, m, re) ? static_cast<size_t>(m.position(0)) : 0;
+	}
+	case op_match: {
+		rex::match_results<It> m;
+		return rex::regex_match(first, last, m, re) ? 1 : 0;
+	}
+	case op_iterator: {
+		size_t n = 0;
+		for (rex::regex_iterator<It> it(first, last, re), end; it != end; ++it) ++n;
+		return n;
+	}
+	case op_token: {
+		size_t n = 0;
+		for (rex::regex_token_iterator<It> it(first, last, re, -1), end; it != end; ++it) ++n;
+		return n;
+	}
+	default: {
+		std::basic_string<CharT> out;
+		rex::regex_replace(std::back_inserter(out), first, last, re, fmt);
+		return out.size();
+	}
+	}
+}
+
+// Nearest-rank percentile of sorted samples
+double percentile(const std::vector<double>& sorted, double p) {
+	size_t rank = static_cast<size_t>(p / 100.0 * sorted.size() + 0.999999);
+	if (rank < 1) rank = 1;
+	if (rank > sorted.size()) rank = sorted.size();
+	return sorted[rank - 1];
+}
+
+template <class It, class CharT>
+void measure(const options& opt, op_type op, It first, It last, const rex::basic_regex<CharT>& re, result& res) {
+	typedef std::chrono::steady_clock clock;
+	const std::basic_string<CharT> fmt = widen<CharT>("<$&>");
+
+	// Warm-up, then calibrate the repetitions of one sample from the last run
+	double single = 0;
+	for (size_t i = 0; i < opt.warmup || i == 0; ++i) {
+		clock::time_point t0 = clock::now();
+		g_sink += run_once(op, first, last, re, fmt);
+		single = std::chrono::duration<double>(clock::now() - t0).count();
+	}
+	size_t iterations = 1;
+	if (single > 0 && single < opt.min_time)
+		iterations = static_cast<size_t>(opt.min_time / single) + 1;
+
+	std::vector<double> per_op;
+	for (size_t s = 0; s < opt.samples; ++s) {
+		clock::time_point t0 = clock::now();
+		for (size_t i = 0; i < iterations; ++i)
+			g_sink += run_once(op, first, last, re, fmt);
+		double ns = std::chrono::duration<double, std::nano>(clock::now() - t0).count();
+		per_op.push_back(ns / iterations);
+	}
+	std::sort(per_op.begin(), per_op.end());
+
+	res.iterations = iterations;
+	res.min_ns = per_op.front();
+	res.p50_ns = percentile(per_op, 50);
+	res.p90_ns = percentile(per_op, 90);
+	res.p99_ns = percentile(per_op, 99);
+	res.max_ns = per_op.back();
+}
+
+// The library is instantiated for std::list and std::deque of char only, so
+// the other character types are measured on strings
+template <class CharT>
+void measure_subject(const options& opt, op_type op, container_type, const std::basic_string<CharT>& subject,
+                     const rex::basic_regex<CharT>& re, result& res)
+{
+	measure(opt, op, subject.cbegin(), subject.cend(), re, res);
+}
+
+void measure_subject(const options& opt, op_type op, container_type cont, const std::string& subject,
+                     const rex::regex& re, result& res)
+{
+	if (cont == cont_string) {
+		measure(opt, op, subject.cbegin(), subject.cend(), re, res);
+	} else if (cont == cont_list) {
+		std::list<char> l(subject.begin(), subject.end());
+		measure(opt, op, l.begin(), l.end(), re, res);
+	} else {
+		std::deque<char> d(subject.begin(), subject.end());
+		measure(opt, op, d.begin(), d.end(), re, res);
+	}
+}
+
+template <class CharT>
+bool run_case(const options& opt, op_type op, container_type cont, syntax_type syntax, size_t size,
+              std::vector<result>& results)
+{
+	result res;
+	res.op = op_names[op];
+	res.char_name = char_name<CharT>();
+	res.container = container_names[cont];
+	res.syntax = syntax_names[syntax];
+	res.size = size;
+	res.bytes = size * sizeof(CharT);
+	res.name = res.op + "/" + res.char_name + "/" + res.container + "/" + res.syntax + "/" + std::to_string(size);
+
+	if (!opt.filter.empty() && res.name.find(opt.filter) == std::string::npos)
+		return false;
+	if (opt.list_only) {
+		std::cout << res.name << std::endl;
+		return false;
+	}
+
+	rex::regex_constants::syntax_option_type flags = rex::regex_constants::ECMAScript;
+#ifndef USE_STD_FOR_TESTS
+	if (syntax == syntax_oniguruma) flags = rex::regex_constants::oniguruma;
+#endif
+	rex::basic_regex<CharT> re(widen<CharT>(pattern_of(op)), flags);
+	std::basic_string<CharT> subject = widen<CharT>(make_subject(size));
+
+	measure_subject(opt, op, cont, subject, re, res);
+	results.push_back(res);
+	return true;
+}
+
+void print_text_row(const result& r) {
+	std::cout << std::left << std::setw(48) << r.name << std::right << std::fixed << std::setprecision(1)
+	          << std::setw(14) << r.p50_ns << std::setw(14) << r.p90_ns << std::setw(14) << r.p99_ns
+	          << std::setw(10) << std::setprecision(1) << (r.bytes / (r.p50_ns / 1e9) / (1024.0 * 1024.0))
+	          << std::setw(10) << r.iterations << std::endl;
+}
+
+void print_csv(const std::vector<result>& results, const std::string& backend) {
+	std::cout << "backend,name,op,char,container,syntax,size,bytes,iterations,min_ns,p50_ns,p90_ns,p99_ns,max_ns" << std::endl;
+	for (const result& r : results) {
+		std::cout << backend << ',' << r.name << ',' << r.op << ',' << r.char_name << ',' << r.container << ','
+		          << r.syntax << ',' << r.size << ',' << r.bytes << ',' << r.iterations << ',' << std::fixed
+		          << std::setprecision(1) << r.min_ns << ',' << r.p50_ns << ',' << r.p90_ns << ','
+		          << r.p99_ns << ',' << r.max_ns << std::endl;
+	}
+}
+
+void print_json(const std::vector<result>& results, const std::string& backend, const options& opt) {
+	std::cout << "{\"backend\":\"" << backend << "\",\"samples\":" << opt.samples
+	          << ",\"warmup\":" << opt.warmup << ",\"cases\":[" << std::endl;
+	for (size_t i = 0; i < results.size(); ++i) {
+		const result& r = results[i];
+		std::cout << "{\"name\":\"" << r.name << "\",\"op\":\"" << r.op << "\",\"char\":\"" << r.char_name
+		          << "\",\"container\":\"" << r.container << "\",\"syntax\":\"" << r.syntax
+		          << "\",\"size\":" << r.size << ",\"bytes\":" << r.bytes << ",\"iterations\":" << r.iterations
+		          << std::fixed << std::setprecision(1) << ",\"min_ns\":" << r.min_ns << ",\"p50_ns\":" << r.p50_ns
+		          << ",\"p90_ns\":" << r.p90_ns << ",\"p99_ns\":" << r.p99_ns << ",\"max_ns\":" << r.max_ns << "}"
+		          << (i + 1 < results.size() ? "," : "") << std::endl;
+	}
+	std::cout << "]}" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	TESTS_OUTPUT_INIT();
+
+	// Oniguruma initialization (no-op for std::regex)
+	ONIGPP_TEST_INIT;
+
+	options opt;
+	if (!parse_options(argc, argv, opt)) {
+		std::cerr << "Usage: onigpp_bench [--sizes=LIST] [--samples=N] [--warmup=N] [--min-time=MS]" << std::endl
+		          << "             [--max-list-size=N] [--filter=TEXT] [--format=text|csv|json] [--list]" << std::endl;
+		return 1;
+	}
+
+#ifdef USE_STD_FOR_TESTS
+	const std::string backend = "std";
+	const bool std_backend = true;
+#else
+	const std::string backend = std::string("onigpp/") + rex::version();
+	const bool std_backend = false;
+#endif
+
+	bool text = (opt.format == "text") && !opt.list_only;
+	if (text) {
+		std::cout << "backend: " << backend << ", samples: " << opt.samples << ", warmup: " << opt.warmup << std::endl;
+		std::cout << std::left << std::setw(48) << "case" << std::right << std::setw(14) << "p50 ns"
+		          << std::setw(14) << "p90 ns" << std::setw(14) << "p99 ns" << std::setw(10) << "MB/s"
+		          << std::setw(10) << "iters" << std::endl;
+	}
+
+	std::vector<result> results;
+	for (size_t size : opt.sizes) {
+		for (int op = op_search; op <= op_replace; ++op) {
+			for (int syntax = syntax_ecmascript; syntax <= syntax_oniguruma; ++syntax) {
+				if (std_backend && syntax == syntax_oniguruma) continue;
+				if (std_backend && op == op_match && size > 64 * 1024) continue;
+
+				for (int cont = cont_string; cont <= cont_deque; ++cont) {
+					// The library is instantiated for std::list and std::deque of char only
+					if (cont != cont_string && size > opt.max_list_size) continue;
+
+					size_t before = results.size();
+					run_case<char>(opt, op_type(op), container_type(cont), syntax_type(syntax), size, results);
+					if (cont == cont_string) {
+						run_case<wchar_t>(opt, op_type(op), container_type(cont), syntax_type(syntax), size, results);
+#ifndef USE_STD_FOR_TESTS
+						// std::regex does not support char16_t and char32_t
+						run_case<char16_t>(opt, op_type(op), container_type(cont), syntax_type(syntax), size, results);
+						run_case<char32_t>(opt, op_type(op), container_type(cont), syntax_type(syntax), size, results);
+#endif
+					}
+					if (text) {
+						for (size_t i = before; i < results.size(); ++i)
+							print_text_row(results[i]);
+					}
+				}
+			}
+		}
+	}
+
+	if (opt.format == "csv" && !opt.list_only)
+		print_csv(results, backend);
+	else if (opt.format == "json" && !opt.list_only)
+		print_json(results, backend, opt);
+
+	return (g_sink == static_cast<size_t>(-1)) ? 1 : 0;
+}
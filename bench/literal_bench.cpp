@@ -0,0 +1,213 @@
+// literal_bench.cpp --- Benchmark of regex_literal_union against the flat alternation
+// Author: katahiromz
+// License: BSD-2-Clause
+//
+// Builds a dictionary of generated words and compares two patterns for it:
+// the flat alternation \b(?:w1|w2|...)\b of the escaped words, sorted
+// longest first, and the factored \b...\b of make_literal_regex. For each,
+// the compile time and the time to count the matches in a generated text
+// are reported (the best of --samples runs), and the two match counts are
+// checked to be equal.
+//
+// Usage: literal_bench [options]
+//   --words=LIST  Dictionary sizes, K suffix allowed (default: 100,1K,10K,50K)
+//   --size=N      Text size in characters, K and M suffixes allowed (default: 1M)
+//   --samples=N   Runs per measurement (default: 5)
+//   --icase       Compile both patterns with regex_constants::icase
+#include "../onigpp.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace rex = onigpp;
+
+namespace {
+
+struct options {
+	std::vector<size_t> words;
+	size_t size;
+	size_t samples;
+	bool icase;
+
+	options() : size(1024 * 1024), samples(5), icase(false) {
+		words.push_back(100);
+		words.push_back(1000);
+		words.push_back(10000);
+		words.push_back(50000);
+	}
+};
+
+// Keeps the operations from being optimized away
+volatile size_t g_sink = 0;
+
+// Parses "64", "4K" or "16M"
+bool parse_size(const std::string& text, size_t& value) {
+	if (text.empty()) return false;
+	char* end = nullptr;
+	unsigned long long n = std::strtoull(text.c_str(), &end, 10);
+	std::string suffix(end);
+	if (suffix == "K" || suffix == "k") n *= 1024;
+	else if (suffix == "M" || suffix == "m") n *= 1024 * 1024;
+	else if (!suffix.empty()) return false;
+	value = static_cast<size_t>(n);
+	return n > 0;
+}
+
+bool parse_options(int argc, char** argv, options& opt) {
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		std::string::size_type eq = arg.find('=');
+		std::string key = arg.substr(0, eq);
+		std::string value = (eq == std::string::npos) ? std::string() : arg.substr(eq + 1);
+		size_t n = 0;
+		if (key == "--words") {
+			opt.words.clear();
+			std::istringstream list(value);
+			std::string item;
+			while (std::getline(list, item, ',')) {
+				if (!parse_size(item, n)) return false;
+				opt.words.push_back(n);
+			}
+			if (opt.words.empty()) return false;
+		} else if (key == "--size" && parse_size(value, n)) {
+			opt.size = n;
+		} else if (key == "--samples" && parse_size(value, n)) {
+			opt.samples = n;
+		} else if (key == "--icase") {
+			opt.icase = true;
+		} else {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Pseudo-words of 3 to 10 letters from a fixed seed, with many shared
+// prefixes and suffixes as in natural language
+struct word_source {
+	std::uint32_t seed;
+	word_source() : seed(12345) { }
+
+	std::uint32_t next() {
+		seed = seed * 1103515245u + 12345u;
+		return (seed >> 16) & 0x7fff;
+	}
+	std::string word() {
+		static const char* const parts[] = {
+			"con", "pre", "re", "in", "de", "ex", "trans", "sub", "form", "port", "struct", "tract",
+			"spect", "duct", "ject", "mit", "ing", "ed", "er", "ion", "able", "ment", "s", "ly",
+		};
+		const size_t count = sizeof(parts) / sizeof(parts[0]);
+		std::string w;
+		const size_t n = 1 + next() % 3;
+		for (size_t i = 0; i < n; ++i) w += parts[next() % count];
+		w += static_cast<char>('a' + next() % 26);
+		return w;
+	}
+};
+
+std::vector<std::string> make_words(size_t count) {
+	word_source source;
+	std::vector<std::string> words;
+	words.reserve(count);
+	for (size_t i = 0; i < count; ++i) words.push_back(source.word());
+	return words;
+}
+
+// Words separated by spaces, some of them dictionary words
+std::string make_text(size_t size) {
+	word_source source;
+	source.seed = 54321;
+	std::string s;
+	s.reserve(size + 32);
+	while (s.size() < size) {
+		s += source.word();
+		s += ' ';
+	}
+	s.resize(size);
+	return s;
+}
+
+std::string flat_pattern(std::vector<std::string> words) {
+	std::stable_sort(words.begin(), words.end(),
+		[](const std::string& a, const std::string& b) { return a.size() > b.size(); });
+	std::string pattern = "\\b(?:";
+	for (size_t i = 0; i < words.size(); ++i) {
+		if (i) pattern += '|';
+		pattern += rex::regex_escape(words[i]);
+	}
+	return pattern + ")\\b";
+}
+
+template <class F>
+double best_of(size_t samples, F f) {
+	typedef std::chrono::steady_clock clock;
+	double best = 0;
+	for (size_t i = 0; i < samples; ++i) {
+		clock::time_point t0 = clock::now();
+		f();
+		double seconds = std::chrono::duration<double>(clock::now() - t0).count();
+		if (i == 0 || seconds < best) best = seconds;
+	}
+	return best;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	rex::auto_init init;
+
+	options opt;
+	if (!parse_options(argc, argv, opt)) {
+		std::cerr << "Usage: literal_bench [--words=LIST] [--size=N] [--samples=N] [--icase]" << std::endl;
+		return 1;
+	}
+
+	rex::regex_constants::syntax_option_type flags = rex::regex_constants::ECMAScript;
+	if (opt.icase) flags |= rex::regex_constants::icase;
+	const std::string text = make_text(opt.size);
+
+	std::cout << "backend: onigpp/" << rex::version() << ", text: " << text.size() << " chars, samples: "
+	          << opt.samples << (opt.icase ? ", icase" : "") << std::endl;
+	std::cout << std::left << std::setw(10) << "words" << std::setw(8) << "kind" << std::right
+	          << std::setw(12) << "pattern" << std::setw(14) << "compile ms" << std::setw(14) << "search ms"
+	          << std::setw(10) << "MB/s" << std::setw(10) << "matches" << std::endl;
+
+	bool same = true;
+	for (size_t count : opt.words) {
+		const std::vector<std::string> words = make_words(count);
+		const std::string patterns[] = { flat_pattern(words), "\\b" + rex::regex_literal_union(words, opt.icase) + "\\b" };
+		const char* const kinds[] = { "flat", "trie" };
+
+		size_t found[2] = { 0, 0 };
+		for (int k = 0; k < 2; ++k) {
+			const double compile = best_of(opt.samples, [&] {
+				rex::regex re(patterns[k], flags);
+				g_sink += re.mark_count();
+			});
+			rex::regex re(patterns[k], flags);
+			const double search = best_of(opt.samples, [&] {
+				found[k] = rex::regex_count(text, re);
+				g_sink += found[k];
+			});
+
+			std::cout << std::left << std::setw(10) << count << std::setw(8) << kinds[k] << std::right
+			          << std::setw(12) << patterns[k].size() << std::fixed << std::setprecision(2)
+			          << std::setw(14) << compile * 1e3 << std::setw(14) << search * 1e3 << std::setprecision(1)
+			          << std::setw(10) << (text.size() / search / (1024.0 * 1024.0)) << std::setw(10) << found[k]
+			          << std::endl;
+		}
+		if (found[0] != found[1]) {
+			std::cerr << "match counts differ for " << count << " words" << std::endl;
+			same = false;
+		}
+	}
+
+	return (same && g_sink != static_cast<size_t>(-1)) ? 0 : 1;
+}
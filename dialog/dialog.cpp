@@ -5,6 +5,14 @@
 #include <windowsx.h>
 #include <commctrl.h>
 #include <string>
+#include <sstream>
+#include <iomanip>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <cassert>
 #include <tchar.h>
 #include "onigpp.h"
@@ -240,6 +248,216 @@ size_type count_matches(const string_type& input, regex_type& re) {
 	return count;
 }
 
+// regex_error::what() (UTF-8) を表示用の文字列にする
+string_type from_error_message(const char* message) {
+#ifdef UNICODE
+	int length = ::MultiByteToWideChar(CP_UTF8, 0, message, -1, nullptr, 0);
+	if (length <= 0) return string_type();
+	string_type text(length, L'\0');
+	::MultiByteToWideChar(CP_UTF8, 0, message, -1, &text[0], length);
+	text.resize(length - 1);
+	return text;
+#else
+	return string_type(message);
+#endif
+}
+
+// ライブ評価: 編集のたびにタイマーを張り直し (デバウンス)、タイマーが
+// 発火したらワーカースレッドでパターンのコンパイルと全マッチの列挙を行う。
+// 結果は WM_APP_EVALUATED でダイアログに送られる。新しい評価を要求すると
+// 実行中の評価はマッチの間で打ち切られ、古い世代の結果は捨てられる。
+// Oniguruma の検索自体は中断できないため、一回の検索は EVALUATE_TIMEOUT で
+// 打ち切る。
+const UINT_PTR TIMER_EVALUATE = 1;
+const UINT EVALUATE_DELAY = 300; // ms
+const UINT WM_APP_EVALUATED = WM_APP + 1;
+const std::chrono::seconds EVALUATE_TIMEOUT(2);
+
+struct evaluation_job {
+	unsigned generation;
+	string_type input;
+	string_type pattern;
+	int flags;
+};
+
+struct evaluation_result {
+	unsigned generation;
+	bool compiled;
+	bool cancelled;
+	bool timed_out;
+	string_type error;
+	size_type chars;
+	size_type matches;
+	std::chrono::nanoseconds compile_time;
+	std::chrono::nanoseconds search_time;
+	rex::regex_stats stats; // 検索回数と最長の一回 (regex_stats)
+
+	evaluation_result()
+		: generation(0), compiled(false), cancelled(false), timed_out(false), chars(0), matches(0),
+		  compile_time(0), search_time(0) { }
+};
+
+class evaluator {
+public:
+	evaluator() : m_hwnd(nullptr), m_pending(false), m_quit(false), m_generation(0) { }
+	~evaluator() { stop(); }
+
+	void start(HWND hwnd) {
+		m_hwnd = hwnd;
+		m_thread = std::thread([this] { run(); });
+	}
+
+	// 実行中の評価を打ち切り、最終結果を持たずにスレッドを終える
+	void stop() {
+		if (!m_thread.joinable()) return;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_quit = true;
+			++m_generation;
+		}
+		m_cond.notify_one();
+		m_thread.join();
+	}
+
+	// 評価を要求する (未着手の要求は置き換える)。世代番号を返す
+	unsigned request(const string_type& input, const string_type& pattern, int flags) {
+		unsigned generation;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			generation = ++m_generation;
+			m_job.generation = generation;
+			m_job.input = input;
+			m_job.pattern = pattern;
+			m_job.flags = flags;
+			m_pending = true;
+		}
+		m_cond.notify_one();
+		return generation;
+	}
+
+	bool is_current(unsigned generation) const { return m_generation == generation; }
+
+private:
+	HWND m_hwnd;
+	std::thread m_thread;
+	std::mutex m_mutex;
+	std::condition_variable m_cond;
+	evaluation_job m_job;
+	bool m_pending;
+	bool m_quit;
+	std::atomic<unsigned> m_generation;
+
+	void run() {
+		for (;;) {
+			evaluation_job job;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_cond.wait(lock, [this] { return m_pending || m_quit; });
+				if (m_quit) return;
+				job = std::move(m_job);
+				m_pending = false;
+			}
+
+			std::unique_ptr<evaluation_result> result(evaluate(job));
+			if (!is_current(job.generation)) continue;
+			if (::PostMessage(m_hwnd, WM_APP_EVALUATED, 0, reinterpret_cast<LPARAM>(result.get())))
+				result.release(); // ダイアログ側で delete する
+		}
+	}
+
+	evaluation_result* evaluate(const evaluation_job& job) {
+		using clock = std::chrono::steady_clock;
+		std::unique_ptr<evaluation_result> result(new evaluation_result());
+		result->generation = job.generation;
+		result->chars = job.input.size();
+
+		clock::time_point t0 = clock::now();
+		try {
+			regex_type re(job.pattern, job.flags);
+			result->compile_time = clock::now() - t0;
+			result->compiled = true;
+
+			rex::match_limits limits;
+			limits.timeout = EVALUATE_TIMEOUT;
+			re.set_limits(limits);
+
+			// 全マッチを列挙する (regex_iterator と同じゼロ幅の進め方)
+			typedef rex::regex_offset_iterator<const char_type*> offset_iterator;
+			const char_type* first = job.input.c_str();
+			const char_type* last = first + job.input.size();
+			clock::time_point t1 = clock::now();
+			for (offset_iterator it(first, last, re), end; it != end; ++it) {
+				++result->matches;
+				if (!is_current(job.generation)) {
+					result->cancelled = true;
+					break;
+				}
+			}
+			result->search_time = clock::now() - t1;
+			result->stats = re.stats();
+		} catch (const rex::regex_error& e) {
+			if (!result->compiled) {
+				result->compile_time = clock::now() - t0;
+			} else {
+				result->timed_out = (e.code() == rex::regex_constants::error_deadline ||
+				                     e.code() == rex::regex_constants::error_retry_limit);
+			}
+			result->error = from_error_message(e.what());
+		}
+		return result.release();
+	}
+};
+
+evaluator g_evaluator;
+
+// 時間をミリ秒で書く
+void put_milliseconds(std::basic_ostringstream<char_type>& out, std::chrono::nanoseconds ns) {
+	out << std::fixed << std::setprecision(3) << (ns.count() / 1e6) << TEXT(" ms");
+}
+
+// ライブ評価の結果を stc1 (時間と件数) と stc2 (詳細) に表示する
+void show_evaluation(HWND hwnd, const evaluation_result& result) {
+	std::basic_ostringstream<char_type> line1, line2;
+	line1 << TEXT("Compile: ");
+	put_milliseconds(line1, result.compile_time);
+	if (!result.compiled) {
+		line2 << TEXT("Error: ") << result.error;
+	} else {
+		line1 << TEXT("  Search: ");
+		put_milliseconds(line1, result.search_time);
+		line1 << TEXT("  Matches: ") << result.matches;
+		const double seconds = result.search_time.count() / 1e9;
+		if (seconds > 0) {
+			const double megabytes = result.chars * sizeof(char_type) / 1e6;
+			line1 << TEXT("  ") << std::fixed << std::setprecision(1) << (megabytes / seconds) << TEXT(" MB/s");
+		}
+
+		line2 << TEXT("Searches: ") << result.stats.searches << TEXT("  Longest: ");
+		put_milliseconds(line2, result.stats.max_time);
+		if (result.timed_out)
+			line2 << TEXT("  Stopped: ") << result.error;
+		else if (result.cancelled)
+			line2 << TEXT("  (cancelled)");
+	}
+	SetDlgItemText(hwnd, stc1, line1.str().c_str());
+	SetDlgItemText(hwnd, stc2, line2.str().c_str());
+}
+
+// 検索・置換の結果を stc3 に表示する (メッセージボックスの代わり)
+void show_status(HWND hwnd, const string_type& text) {
+	SetDlgItemText(hwnd, stc3, text.c_str());
+}
+
+// ダイアログのオプションから構文フラグを得る
+int get_regex_flags(HWND hwnd) {
+	int flags = 0;
+	if (IsDlgButtonChecked(hwnd, chx1) == BST_CHECKED) flags |= rex::regex::ECMAScript;
+	if (IsDlgButtonChecked(hwnd, chx2) == BST_CHECKED) flags |= rex::regex::oniguruma;
+	if (IsDlgButtonChecked(hwnd, chx3) == BST_CHECKED) flags |= rex::regex::icase;
+	if (IsDlgButtonChecked(hwnd, chx4) == BST_CHECKED) flags |= rex::regex::multiline;
+	return flags;
+}
+
 } // namespace
 
 // do_find は find_next_match を利用して実装
@@ -258,26 +476,16 @@ bool do_find(const string_type& input, DWORD& iStart, DWORD& iEnd, regex_type& r
 }
 
 void OnFindReplace(HWND hwnd, int action) {
-	BOOL ecma = IsDlgButtonChecked(hwnd, chx1) == BST_CHECKED;
-	BOOL oniguruma = IsDlgButtonChecked(hwnd, chx2) == BST_CHECKED;
-	BOOL icase = IsDlgButtonChecked(hwnd, chx3) == BST_CHECKED;
-	BOOL multiline = IsDlgButtonChecked(hwnd, chx4) == BST_CHECKED;
-
 	string_type input = get_dialog_item_text(hwnd, edt1);
 	string_type pattern = get_dialog_item_text(hwnd, edt3);
 	string_type replacement = get_dialog_item_text(hwnd, edt4);
-
-	int flags = 0;
-	if (ecma) flags |= rex::regex::ECMAScript;
-	if (oniguruma) flags |= rex::regex::oniguruma;
-	if (icase) flags |= rex::regex::icase;
-	if (multiline) flags |= rex::regex::multiline;
+	int flags = get_regex_flags(hwnd);
 
 	regex_type re;
 	try {
 		re = regex_type(pattern, flags);
-	} catch (const rex::regex_error&) {
-		MessageBox(hwnd, TEXT("Failure!"), NULL, MB_ICONERROR);
+	} catch (const rex::regex_error& e) {
+		show_status(hwnd, TEXT("Failure: ") + from_error_message(e.what()));
 		return;
 	}
 
@@ -292,9 +500,10 @@ void OnFindReplace(HWND hwnd, int action) {
 	case 0: // find
 		{
 			if (!do_find(input, iStart, iEnd, re)) {
-				MessageBox(hwnd, TEXT("No more match"), TEXT("dialog"), MB_ICONINFORMATION);
+				show_status(hwnd, TEXT("No more match"));
 				return;
 			}
+			show_status(hwnd, string_type());
 		}
 		break;
 	case 1: // replace (Windows 標準 UX に従う)
@@ -319,7 +528,7 @@ void OnFindReplace(HWND hwnd, int action) {
 				}
 
 				if (!found) {
-					MessageBox(hwnd, TEXT("No more match"), TEXT("dialog"), MB_ICONINFORMATION);
+					show_status(hwnd, TEXT("No more match"));
 					return;
 				}
 
@@ -336,8 +545,8 @@ void OnFindReplace(HWND hwnd, int action) {
 
 				// 編集コントロール内のテキスト変化を反映するため、input を更新しても良いが
 				// 現在は SetDlgItemText で置換済み。EM_SETSEL は後で呼ばれる。
-			} catch (const rex::regex_error&) {
-				MessageBox(hwnd, TEXT("Failure!"), NULL, MB_ICONERROR);
+			} catch (const rex::regex_error& e) {
+				show_status(hwnd, TEXT("Failure: ") + from_error_message(e.what()));
 				return;
 			}
 		}
@@ -348,7 +557,7 @@ void OnFindReplace(HWND hwnd, int action) {
 				// 置換対象件数を数える
 				const size_type cnt = count_matches(input, re);
 				if (cnt == 0) {
-					MessageBox(hwnd, TEXT("No more match"), TEXT("dialog"), MB_ICONINFORMATION);
+					show_status(hwnd, TEXT("No more match"));
 					return;
 				}
 
@@ -358,16 +567,14 @@ void OnFindReplace(HWND hwnd, int action) {
 
 				// 件数をユーザーに通知
 #ifdef UNICODE
-				std::wstring msg = std::to_wstring(cnt) + L" occurrences replaced.";
-				MessageBox(hwnd, msg.c_str(), TEXT("dialog"), MB_OK | MB_ICONINFORMATION);
+				show_status(hwnd, std::to_wstring(cnt) + L" occurrences replaced.");
 #else
-				std::string msg = std::to_string(cnt) + " occurrences replaced.";
-				MessageBox(hwnd, msg.c_str(), TEXT("dialog"), MB_OK | MB_ICONINFORMATION);
+				show_status(hwnd, std::to_string(cnt) + " occurrences replaced.");
 #endif
 				// 選択解除
 				iStart = iEnd = 0;
-			} catch (const rex::regex_error&) {
-				MessageBox(hwnd, TEXT("Failure!"), NULL, MB_ICONERROR);
+			} catch (const rex::regex_error& e) {
+				show_status(hwnd, TEXT("Failure: ") + from_error_message(e.what()));
 				return;
 			}
 		}
@@ -389,9 +596,39 @@ BOOL OnInitDialog(HWND hwnd, HWND hwndFocus, LPARAM lParam) {
 	SendDlgItemMessage(hwnd, edt4, EM_LIMITTEXT, 0, 0);
 	CheckDlgButton(hwnd, chx1, BST_CHECKED); // ECMAScript
 	SetDlgItemText(hwnd, edt1, TEXT("This is a test.\r\n\r\nThis is a test.\r\n"));
+
+	// ライブ評価 (検索回数と最長時間は regex_stats から得る)
+	rex::set_regex_stats_enabled(true);
+	g_evaluator.start(hwnd);
+	SetTimer(hwnd, TIMER_EVALUATE, EVALUATE_DELAY, NULL);
 	return TRUE;
 }
 
+// WM_TIMER: 編集が落ち着いたので評価を要求する
+void OnTimer(HWND hwnd, UINT id) {
+	if (id != TIMER_EVALUATE) return;
+	KillTimer(hwnd, TIMER_EVALUATE);
+	g_evaluator.request(get_dialog_item_text(hwnd, edt1), get_dialog_item_text(hwnd, edt3), get_regex_flags(hwnd));
+}
+
+// WM_APP_EVALUATED: ワーカーからの結果 (lParam は evaluation_result*)
+void OnEvaluated(HWND hwnd, LPARAM lParam) {
+	std::unique_ptr<evaluation_result> result(reinterpret_cast<evaluation_result*>(lParam));
+	if (g_evaluator.is_current(result->generation))
+		show_evaluation(hwnd, *result);
+}
+
+// WM_DESTROY
+void OnDestroy(HWND hwnd) {
+	KillTimer(hwnd, TIMER_EVALUATE);
+	g_evaluator.stop();
+
+	// 投函済みで未処理の結果を捨てる
+	MSG msg;
+	while (PeekMessage(&msg, hwnd, WM_APP_EVALUATED, WM_APP_EVALUATED, PM_REMOVE))
+		delete reinterpret_cast<evaluation_result*>(msg.lParam);
+}
+
 // WM_COMMAND
 void OnCommand(HWND hwnd, int id, HWND hwndCtl, UINT codeNotify) {
 	switch (id) {
@@ -399,6 +636,16 @@ void OnCommand(HWND hwnd, int id, HWND hwndCtl, UINT codeNotify) {
 	case IDCANCEL:
 		EndDialog(hwnd, id);
 		break;
+	case edt1: // Input
+	case edt3: // Pattern
+		if (codeNotify == EN_CHANGE) SetTimer(hwnd, TIMER_EVALUATE, EVALUATE_DELAY, NULL);
+		break;
+	case chx1:
+	case chx2:
+	case chx3:
+	case chx4:
+		if (codeNotify == BN_CLICKED) SetTimer(hwnd, TIMER_EVALUATE, EVALUATE_DELAY, NULL);
+		break;
 	case psh1: // Replace
 		OnFindReplace(hwnd, 1);
 		break;
@@ -416,6 +663,11 @@ DialogProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam) {
 	switch (uMsg) {
 		HANDLE_MSG(hwnd, WM_INITDIALOG, OnInitDialog);
 		HANDLE_MSG(hwnd, WM_COMMAND, OnCommand);
+		HANDLE_MSG(hwnd, WM_TIMER, OnTimer);
+		HANDLE_MSG(hwnd, WM_DESTROY, OnDestroy);
+	case WM_APP_EVALUATED:
+		OnEvaluated(hwnd, lParam);
+		return TRUE;
 	}
 	return 0;
 }
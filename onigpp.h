@@ -8,11 +8,28 @@
 #include <exception>
 #include <stdexcept>
 #include <algorithm>
+#include <iterator>
 #include <cstring>
 #include <cassert>
 #include <locale>
 #include <limits>
 #include <ostream>
+#include <memory>
+#include <mutex>
+#include <list>
+#include <unordered_map>
+#include <initializer_list>
+#include <functional>
+#include <chrono>
+#include <atomic>
+#include <cstdio>
+#include <cstddef>
+#include <type_traits>
+
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+	#include <string_view>
+	#define ONIGPP_HAS_STRING_VIEW
+#endif
 
 // Oniguruma
 #define ONIG_ESCAPE_UCHAR_COLLISION // Use UnigUChar instead of UChar
@@ -54,6 +71,140 @@ using wstring = basic_string<wchar_t>;
 using u16string = basic_string<char16_t>;
 using u32string = basic_string<char32_t>;
 
+////////////////////////////////////////////
+// onigpp::memory_resource
+
+// Source of the temporary memory onigpp uses within a call: the copies of
+// subjects given by non-contiguous iterators and the pattern preprocessing
+// of the basic_regex constructors. The resource installed on a thread (see memory_resource_scope)
+// serves these allocations on that thread. Storage that outlives the call,
+// such as compiled programs and iterator buffers, always comes from
+// new_delete_resource(); match_results use a resource only when they are
+// given a resource_allocator.
+//
+// Oniguruma's own allocations (onig_new, growing an OnigRegion) are made
+// with malloc inside the library and are not routed to the resource.
+class memory_resource {
+public:
+	virtual ~memory_resource() { }
+
+	void* allocate(size_type bytes, size_type alignment = alignof(std::max_align_t)) {
+		return do_allocate(bytes, alignment);
+	}
+	void deallocate(void* p, size_type bytes, size_type alignment = alignof(std::max_align_t)) {
+		do_deallocate(p, bytes, alignment);
+	}
+	bool is_equal(const memory_resource& other) const noexcept {
+		return this == &other || do_is_equal(other);
+	}
+
+protected:
+	virtual void* do_allocate(size_type bytes, size_type alignment) = 0;
+	virtual void do_deallocate(void* p, size_type bytes, size_type alignment) = 0;
+	virtual bool do_is_equal(const memory_resource&) const noexcept { return false; }
+};
+
+// The resource using operator new and operator delete
+memory_resource* new_delete_resource() noexcept;
+
+// The resource of the calling thread (new_delete_resource() until one is set)
+memory_resource* get_thread_memory_resource() noexcept;
+
+// Installs r (new_delete_resource() for nullptr) on the calling thread and
+// returns the previous resource
+memory_resource* set_thread_memory_resource(memory_resource* r) noexcept;
+
+// Installs a resource on the calling thread for the lifetime of the scope.
+// The resource must outlive every allocation made from it in the scope.
+class memory_resource_scope {
+public:
+	explicit memory_resource_scope(memory_resource* r) : m_previous(set_thread_memory_resource(r)) { }
+	~memory_resource_scope() { set_thread_memory_resource(m_previous); }
+
+private:
+	memory_resource* m_previous;
+
+	memory_resource_scope(const memory_resource_scope&) = delete;
+	memory_resource_scope& operator=(const memory_resource_scope&) = delete;
+};
+
+// Monotonic arena: allocations advance through blocks taken from the
+// upstream resource, deallocate does nothing, and release() makes all the
+// memory available again at once. Not thread-safe; use one arena per thread.
+class arena_resource : public memory_resource {
+public:
+	explicit arena_resource(size_type block_size = 4096, memory_resource* upstream = new_delete_resource());
+	~arena_resource();
+
+	// Frees every allocation at once. The largest block is kept for reuse,
+	// so a steady workload stops taking memory from upstream.
+	void release() noexcept;
+
+	size_type bytes_allocated() const noexcept { return m_allocated; } // Since the last release()
+	size_type capacity() const noexcept;                               // Held from upstream
+	memory_resource* upstream_resource() const noexcept { return m_upstream; }
+
+protected:
+	void* do_allocate(size_type bytes, size_type alignment) override;
+	void do_deallocate(void*, size_type, size_type) override { }
+
+private:
+	struct _block {
+		_block* next;
+		size_type size; // Including this header
+	};
+
+	memory_resource* m_upstream;
+	size_type m_block_size; // Size of the next block
+	_block* m_blocks;       // Current block first
+	char* m_cur;
+	char* m_end;
+	size_type m_allocated;
+
+	arena_resource(const arena_resource&) = delete;
+	arena_resource& operator=(const arena_resource&) = delete;
+};
+
+// Allocator drawing from a memory_resource. Default construction takes the
+// resource of the calling thread at that time.
+template <class T>
+class resource_allocator {
+public:
+	using value_type = T;
+
+	resource_allocator() noexcept : m_resource(get_thread_memory_resource()) { }
+	resource_allocator(memory_resource* r) noexcept : m_resource(r ? r : new_delete_resource()) { }
+	template <class U>
+	resource_allocator(const resource_allocator<U>& other) noexcept : m_resource(other.resource()) { }
+
+	T* allocate(std::size_t n) {
+		if (n > std::numeric_limits<std::size_t>::max() / sizeof(T)) throw std::bad_alloc();
+		return static_cast<T*>(m_resource->allocate(n * sizeof(T), alignof(T)));
+	}
+	void deallocate(T* p, std::size_t n) noexcept {
+		m_resource->deallocate(p, n * sizeof(T), alignof(T));
+	}
+
+	memory_resource* resource() const noexcept { return m_resource; }
+
+private:
+	memory_resource* m_resource;
+};
+
+template <class T, class U>
+inline bool operator==(const resource_allocator<T>& a, const resource_allocator<U>& b) noexcept {
+	return a.resource()->is_equal(*b.resource());
+}
+
+template <class T, class U>
+inline bool operator!=(const resource_allocator<T>& a, const resource_allocator<U>& b) noexcept {
+	return !(a == b);
+}
+
+// String drawing from the thread's resource, for temporaries within a call
+template <class CharT>
+using _scratch_string = std::basic_string<CharT, std::char_traits<CharT>, resource_allocator<CharT>>;
+
 ////////////////////////////////////////////
 // onigpp::regex_constants
 
@@ -73,7 +224,11 @@ namespace regex_constants {
 		error_space      = 9,   // Same as std::regex_constants::error_space
 		error_badrepeat  = 10,  // Same as std::regex_constants::error_badrepeat
 		error_complexity = 11,  // Same as std::regex_constants::error_complexity
-		error_stack      = 12   // Same as std::regex_constants::error_stack
+		error_stack      = 12,  // Same as std::regex_constants::error_stack
+
+		// onigpp extensions (see match_limits)
+		error_retry_limit = 13, // A retry (backtracking) limit was exceeded
+		error_deadline    = 14  // The wall-clock deadline of a search passed
 	};
 
 	// Map Oniguruma error codes to onigpp error_type
@@ -93,6 +248,7 @@ namespace regex_constants {
 
 		// Resource/complexity errors
 		if (onig_error == -5) return error_space;                               // MEMORY
+		if (onig_error == -17 || onig_error == -18) return error_retry_limit;  // RETRY_LIMIT_IN_MATCH/SEARCH_OVER
 		if (onig_error >= -20 && onig_error <= -15) return error_complexity;   // STACK/LIMIT errors
 		if (onig_error >= -12 && onig_error <= -11) return error_stack;        // BUG errors
 
@@ -113,12 +269,27 @@ namespace regex_constants {
 
 	// std::regex compatible flags (bits 3-5, avoiding collision with existing bits 0-2 and 11-15)
 	static constexpr syntax_option_type nosubs = (1 << 3);   // std::nosubs - don't store submatches in match_results
-	static constexpr syntax_option_type optimize = (1 << 4); // std::optimize - currently no-op (reserved for future optimization)
+	static constexpr syntax_option_type optimize = (1 << 4); // std::optimize - enables the literal prefilter (see basic_regex::prefilter_active)
 	static constexpr syntax_option_type collate = (1 << 5);  // std::collate - enable locale-dependent collation
 
 	// oniguruma: Enable Oniguruma's native syntax and behavior
 	static constexpr syntax_option_type oniguruma = (1 << 6);
 
+	// Line terminators recognized by ^ and $ under ECMAScript multiline (bits 7-9).
+	// When none is set, all ECMAScript line terminators are used (LF, CR, U+2028, U+2029).
+	// line_terminator_lf alone maps $ directly onto Oniguruma's native line anchor and ^
+	// onto the native one plus the end of the subject after a final LF, which is the
+	// fastest choice; other terminators add a lookaround per anchor.
+	static constexpr syntax_option_type line_terminator_lf = (1 << 7);
+	static constexpr syntax_option_type line_terminator_cr = (1 << 8);
+	static constexpr syntax_option_type line_terminator_unicode = (1 << 9); // U+2028 and U+2029
+	static constexpr syntax_option_type line_terminators =
+		line_terminator_lf | line_terminator_cr | line_terminator_unicode;
+
+	// deferred: The constructor only records the pattern; it is compiled on first use
+	// (or by basic_regex::compile()), and pattern errors are reported from there
+	static constexpr syntax_option_type deferred = (1 << 10);
+
 	static constexpr syntax_option_type basic = (1 << 11);
 	static constexpr syntax_option_type awk = (1 << 12);
 	static constexpr syntax_option_type grep = (1 << 13);
@@ -180,17 +351,87 @@ public:
 		m_message.assign(reinterpret_cast<char*>(err_buf));
 	}
 
+	// Construct with error code and message (errors detected by onigpp itself)
+	regex_error(regex_constants::error_type ecode, const char* message) : m_err_code(ecode), m_err_info(), m_message(message) { }
+
+	// Construct from an Oniguruma error code. The message is formatted from onig_error
+	// and err_info (e.g. the offending group name), so err_info's pattern must still be alive.
+	regex_error(regex_constants::error_type ecode, int onig_error, const OnigErrorInfo& err_info)
+		: m_err_code(ecode), m_err_info(err_info), m_onig_error(onig_error)
+	{
+		OnigUChar err_buf[ONIG_MAX_ERROR_MESSAGE_LEN];
+		onig_error_code_to_str(err_buf, onig_error, &m_err_info);
+		m_message.assign(reinterpret_cast<char*>(err_buf));
+	}
+
 	virtual ~regex_error() = default;
 
 	regex_constants::error_type code() const { return m_err_code; }
+	// The Oniguruma error code (ONIGERR_*), or 0 if not known
+	int onig_error_code() const { return m_onig_error; }
 	const char* what() const noexcept override { return m_message.c_str(); }
 
 protected:
 	regex_constants::error_type m_err_code;
 	OnigErrorInfo m_err_info;
+	int m_onig_error = 0;
 	std::string m_message; // holds the formatted error message to ensure stable lifetime
 };
 
+////////////////////////////////////////////
+// Contiguous iterators
+
+// Helper trait to detect contiguous iterators (for optimization)
+// Pointers are always contiguous. The iterators of std::basic_string and
+// std::vector are recognized by comparing against the containers' own
+// iterator types, which stays portable across standard library
+// implementations. std::array iterators are plain pointers on the common
+// implementations; C++20 builds also accept any std::contiguous_iterator.
+
+// Character types that may appear as a subject's value_type
+template <typename T>
+struct _is_subject_char : std::integral_constant<bool,
+	std::is_same<T, char>::value || std::is_same<T, wchar_t>::value ||
+	std::is_same<T, char16_t>::value || std::is_same<T, char32_t>::value> {};
+
+// Iterators of std::basic_string<Value> and std::vector<Value>
+template <typename Iter, typename Value, bool IsChar = _is_subject_char<Value>::value>
+struct _is_std_contiguous_iterator : std::false_type {};
+
+template <typename Iter, typename Value>
+struct _is_std_contiguous_iterator<Iter, Value, true> : std::integral_constant<bool,
+	std::is_same<Iter, typename std::basic_string<Value>::iterator>::value ||
+	std::is_same<Iter, typename std::basic_string<Value>::const_iterator>::value ||
+	std::is_same<Iter, typename std::vector<Value>::iterator>::value ||
+	std::is_same<Iter, typename std::vector<Value>::const_iterator>::value> {};
+
+// Primary template - contiguous if it is a known standard container iterator
+template <typename Iter>
+struct _is_contiguous_iterator : std::integral_constant<bool,
+#if defined(__cpp_lib_concepts) && __cplusplus >= 202002L
+	std::contiguous_iterator<Iter> ||
+#endif
+	_is_std_contiguous_iterator<Iter,
+		typename std::remove_cv<typename std::iterator_traits<Iter>::value_type>::type>::value> {};
+
+// Specialization for pointer types (always contiguous)
+template <typename T>
+struct _is_contiguous_iterator<T*> : std::true_type {};
+
+template <typename T>
+struct _is_contiguous_iterator<const T*> : std::true_type {};
+
+// Helper function to get pointer from contiguous iterator.
+// The iterator must be dereferenceable (callers check for empty ranges).
+template <typename Iter>
+typename std::enable_if<
+	_is_contiguous_iterator<Iter>::value,
+	const typename std::iterator_traits<Iter>::value_type*
+>::type
+_get_contiguous_pointer(Iter it) {
+	return std::addressof(*it);
+}
+
 ////////////////////////////////////////////
 // onigpp::sub_match<BidirIt>
 
@@ -232,21 +473,86 @@ public:
 		return matched ? std::distance(this->first, this->second) : 0;
 	}
 
+	// Returns a pointer to the matched characters, or nullptr if unmatched or empty
+	// Only available for contiguous iterators; the pointer refers into the subject
+	template <class It = BidirIt, typename std::enable_if<_is_contiguous_iterator<It>::value, int>::type = 0>
+	const value_type* data() const {
+		return (matched && this->first != this->second) ? _get_contiguous_pointer(this->first) : nullptr;
+	}
+
+#ifdef ONIGPP_HAS_STRING_VIEW
+	// Returns a view of the matched characters without copying them (C++17)
+	template <class It = BidirIt, typename std::enable_if<_is_contiguous_iterator<It>::value, int>::type = 0>
+	std::basic_string_view<value_type> view() const {
+		return std::basic_string_view<value_type>(data(), length());
+	}
+#endif
+
 	// Compare the matched substring with another sub_match
 	// Returns negative if this < other, positive if this > other, 0 if equal
 	// Uses str() semantics: unmatched sub_match compares as empty string
+	// The comparisons work on the subject directly and never allocate
 	int compare(const sub_match& other) const {
-		return str().compare(other.str());
+		if (!other.matched)
+			return matched && this->first != this->second ? 1 : 0;
+		return _compare(other.first, other.second, _is_contiguous_iterator<BidirIt>());
 	}
 
 	// Compare the matched substring with a string_type
 	int compare(const string_type& s) const {
-		return str().compare(s);
+		return _compare_chars(s.data(), s.size(), _is_contiguous_iterator<BidirIt>());
 	}
 
 	// Compare the matched substring with a null-terminated C-string
 	int compare(const value_type* s) const {
-		return str().compare(s);
+		return _compare_chars(s, std::char_traits<value_type>::length(s), _is_contiguous_iterator<BidirIt>());
+	}
+
+#ifdef ONIGPP_HAS_STRING_VIEW
+	// Compare the matched substring with a string view (C++17)
+	int compare(std::basic_string_view<value_type> s) const {
+		return _compare_chars(s.data(), s.size(), _is_contiguous_iterator<BidirIt>());
+	}
+#endif
+
+private:
+	// Lexicographical comparison of two ranges with std::char_traits, like basic_string::compare
+	template <class It1, class It2>
+	static int _compare_ranges(It1 first1, It1 last1, It2 first2, It2 last2) {
+		typedef std::char_traits<value_type> traits;
+		for (; first1 != last1 && first2 != last2; ++first1, ++first2) {
+			if (traits::lt(*first1, *first2)) return -1;
+			if (traits::lt(*first2, *first1)) return 1;
+		}
+		return (first1 != last1) ? 1 : (first2 != last2) ? -1 : 0;
+	}
+
+	static int _compare_pointers(const value_type* s1, size_t n1, const value_type* s2, size_t n2) {
+		int ret = std::char_traits<value_type>::compare(s1, s2, (std::min)(n1, n2));
+		if (ret != 0) return ret;
+		return (n1 < n2) ? -1 : (n1 > n2) ? 1 : 0;
+	}
+
+	// Contiguous subjects: compare the characters in place
+	int _compare_chars(const value_type* s, size_t n, std::true_type) const {
+		size_t len = matched ? size_t(this->second - this->first) : 0;
+		if (len == 0 || n == 0) return (len < n) ? -1 : (len > n) ? 1 : 0;
+		return _compare_pointers(_get_contiguous_pointer(this->first), len, s, n);
+	}
+
+	int _compare_chars(const value_type* s, size_t n, std::false_type) const {
+		if (!matched) return n ? -1 : 0;
+		return _compare_ranges(this->first, this->second, s, s + n);
+	}
+
+	int _compare(BidirIt first2, BidirIt last2, std::true_type) const {
+		size_t n = size_t(last2 - first2);
+		return _compare_chars(n ? _get_contiguous_pointer(first2) : nullptr, n, std::true_type());
+	}
+
+	int _compare(BidirIt first2, BidirIt last2, std::false_type) const {
+		if (!matched) return (first2 != last2) ? -1 : 0;
+		return _compare_ranges(this->first, this->second, first2, last2);
 	}
 };
 
@@ -933,6 +1239,9 @@ private:
 	}
 };
 
+template <class CharT, class Traits = regex_traits<CharT>>
+class basic_regex_format;
+
 ////////////////////////////////////////////
 // onigpp::match_results<BidirIt, Allocator>
 
@@ -1072,6 +1381,17 @@ public:
 		return format(out, fmt.data(), fmt.data() + fmt.size(), flags);
 	}
 
+	// Formats with a precompiled format (see basic_regex_format)
+	template <class OutputIt, class Traits>
+	OutputIt format(OutputIt out, const basic_regex_format<char_type, Traits>& fmt) const;
+
+	template <class Traits>
+	string_type format(const basic_regex_format<char_type, Traits>& fmt) const {
+		string_type result;
+		format(std::back_inserter(result), fmt);
+		return result;
+	}
+
 	string_type format(const char_type* fmt_first, const char_type* fmt_last,
 	                   regex_constants::match_flag_type flags = regex_constants::format_default) const {
 		string_type result;
@@ -1154,11 +1474,393 @@ bool operator!=(const match_results<BidirIt, Alloc>& lhs, const match_results<Bi
 	return !(lhs == rhs);
 }
 
+////////////////////////////////////////////
+// onigpp::small_match_results<BidirIt, N>
+
+// Inline storage for the sub_matches of small_match_results. It is a base
+// class so that it is constructed before the match_results that uses it.
+template <class BidirIt, size_type N>
+class _small_match_storage {
+protected:
+	class _resource : public memory_resource {
+	public:
+		_resource() : m_used(false) { }
+
+	protected:
+		void* do_allocate(size_type bytes, size_type alignment) override {
+			if (!m_used && bytes <= sizeof(m_buffer) && alignment <= alignof(sub_match<BidirIt>)) {
+				m_used = true;
+				return &m_buffer;
+			}
+			return new_delete_resource()->allocate(bytes, alignment);
+		}
+		void do_deallocate(void* p, size_type bytes, size_type alignment) override {
+			if (p == static_cast<void*>(&m_buffer))
+				m_used = false;
+			else
+				new_delete_resource()->deallocate(p, bytes, alignment);
+		}
+
+	private:
+		typename std::aligned_storage<sizeof(sub_match<BidirIt>) * N, alignof(sub_match<BidirIt>)>::type m_buffer;
+		bool m_used;
+
+		_resource(const _resource&) = delete;
+		_resource& operator=(const _resource&) = delete;
+	};
+
+	_small_match_storage() { }
+	_small_match_storage(const _small_match_storage&) { } // Never shares the buffer
+
+	_resource m_inline;
+};
+
+// match_results holding up to N sub_matches (the whole match and N - 1
+// groups) inside the object, so a search with a fresh small_match_results
+// allocates nothing; a pattern with more groups moves them to the heap. It
+// is a match_results<BidirIt, resource_allocator<sub_match<BidirIt>>> and
+// works with every function taking one. Copying and moving copy the
+// sub_matches. Swap small_match_results with their own swap, not through
+// references to the match_results base.
+template <class BidirIt, size_type N = 8>
+class small_match_results
+	: private _small_match_storage<BidirIt, N>,
+	  public match_results<BidirIt, resource_allocator<sub_match<BidirIt>>>
+{
+	static_assert(N > 0, "small_match_results needs room for the whole match");
+
+public:
+	using base_type = match_results<BidirIt, resource_allocator<sub_match<BidirIt>>>;
+	using allocator_type = typename base_type::allocator_type;
+
+	static constexpr size_type inline_capacity = N;
+
+	small_match_results() : base_type(allocator_type(&this->m_inline)) {
+		this->reserve(N);
+	}
+	small_match_results(const small_match_results& other)
+		: _small_match_storage<BidirIt, N>(), base_type(allocator_type(&this->m_inline))
+	{
+		this->reserve(N);
+		base_type::operator=(other);
+	}
+	small_match_results(const base_type& other) : base_type(allocator_type(&this->m_inline)) {
+		this->reserve(N);
+		base_type::operator=(other);
+	}
+
+	small_match_results& operator=(const small_match_results& other) {
+		base_type::operator=(other);
+		return *this;
+	}
+	small_match_results& operator=(const base_type& other) {
+		base_type::operator=(other);
+		return *this;
+	}
+
+	// Whether the sub_matches are in the inline storage
+	bool is_inline() const noexcept {
+		return this->capacity() <= N;
+	}
+
+	void swap(small_match_results& other) {
+		small_match_results tmp(other);
+		other = *this;
+		*this = tmp;
+	}
+};
+
+template <class BidirIt, size_type N>
+constexpr size_type small_match_results<BidirIt, N>::inline_capacity;
+
+template <class BidirIt, size_type N>
+void swap(small_match_results<BidirIt, N>& lhs, small_match_results<BidirIt, N>& rhs) {
+	lhs.swap(rhs);
+}
+
+using small_cmatch = small_match_results<const char*>;
+using small_wcmatch = small_match_results<const wchar_t*>;
+using small_u16cmatch = small_match_results<const char16_t*>;
+using small_u32cmatch = small_match_results<const char32_t*>;
+using small_smatch = small_match_results<string::const_iterator>;
+using small_wsmatch = small_match_results<wstring::const_iterator>;
+using small_u16smatch = small_match_results<u16string::const_iterator>;
+using small_u32smatch = small_match_results<u32string::const_iterator>;
+
 ////////////////////////////////////////////
 // Forward declarations
 
 template <class CharT, class Traits> class basic_regex;
 
+////////////////////////////////////////////
+// onigpp::regex_stats
+
+// Counters of one compiled pattern, collected while set_regex_stats_enabled(true)
+// is in effect. Copies of a basic_regex share them; see basic_regex::stats().
+struct regex_stats {
+	unsigned long long compiles;       // Compilations (imbue() with collate recompiles)
+	unsigned long long searches;       // regex_search calls, including iterator steps
+	unsigned long long matches;        // regex_match calls
+	unsigned long long bytes_scanned;  // Subject bytes from each search start to the end
+	std::chrono::nanoseconds total_time; // Time spent in searches and matches
+	std::chrono::nanoseconds max_time;   // Longest single search or match
+	unsigned long long prefilter_rejections; // Searches the literal prefilter ended without Oniguruma
+
+	regex_stats()
+		: compiles(0), searches(0), matches(0), bytes_scanned(0),
+		  total_time(std::chrono::nanoseconds::zero()), max_time(std::chrono::nanoseconds::zero()),
+		  prefilter_rejections(0) { }
+};
+
+// Reported to the slow search hook for every search or match that takes at
+// least the hook's threshold. The pattern is given as raw code units because
+// the hook is shared by all character types.
+struct slow_search_event {
+	const void* regex;           // Address of the basic_regex searched with
+	const void* pattern;         // Pattern code units (char_size bytes each)
+	size_type pattern_length;    // Pattern length in code units
+	size_type char_size;         // sizeof(CharT)
+	OnigEncoding encoding;       // Encoding of the pattern and subject
+	size_type bytes_scanned;     // Subject bytes from the search start to the end
+	bool match;                  // true for regex_match, false for regex_search
+	std::chrono::nanoseconds elapsed;
+};
+
+using slow_search_hook = std::function<void(const slow_search_event&)>;
+
+// Turns the collection of regex_stats on or off for all regexes (off by default).
+// While off, a search pays one relaxed atomic load for instrumentation.
+void set_regex_stats_enabled(bool enabled);
+bool regex_stats_enabled();
+
+// Installs (or, with an empty hook, removes) the process-wide hook for slow
+// searches. It is called on the searching thread, independently of
+// regex_stats_enabled(), and must not throw.
+void set_slow_search_hook(std::chrono::nanoseconds threshold, slow_search_hook hook);
+
+// Oniguruma's own statistics, available when it is built with
+// ONIG_DEBUG_STATISTICS (engine_statistics_available() returns false and
+// the other two functions do nothing otherwise).
+bool engine_statistics_available();
+void reset_engine_statistics();
+void print_engine_statistics(FILE* fp);
+
+////////////////////////////////////////////
+// onigpp::match_limits
+
+// Limits on the work done by a single search or match. A zero field sets no
+// limit of its own: per-call limits replace the regex's default limits field
+// by field, and fields that are zero in both leave Oniguruma's process-wide
+// defaults in effect (a retry limit in match of 10000000, no limit in search).
+//
+// Exceeding a retry limit throws regex_error with error_retry_limit, and
+// missing the deadline throws regex_error with error_deadline. Oniguruma
+// can not be interrupted, so a deadline is enforced with a growing retry
+// budget in search: a search whose budget runs out is restarted with a
+// larger one, which costs up to about twice the retries of an unlimited
+// search, and a search that can not finish in the remaining time at the
+// measured rate stops early. regex_set searches ignore limits.
+struct match_limits {
+	using clock = std::chrono::steady_clock;
+
+	unsigned long retry_limit_in_match;  // Retries at one start position
+	unsigned long retry_limit_in_search; // Retries over all start positions
+	clock::duration timeout;             // Time allowed per call, from its start
+	clock::time_point deadline;          // Absolute deadline (time_point() for none)
+
+	match_limits()
+		: retry_limit_in_match(0), retry_limit_in_search(0), timeout(clock::duration::zero()), deadline() { }
+
+	bool empty() const {
+		return retry_limit_in_match == 0 && retry_limit_in_search == 0 &&
+		       timeout == clock::duration::zero() && deadline == clock::time_point();
+	}
+
+	// Fields of *this, with the zero ones taken from defaults
+	match_limits merged(const match_limits& defaults) const {
+		match_limits r(*this);
+		if (!r.retry_limit_in_match) r.retry_limit_in_match = defaults.retry_limit_in_match;
+		if (!r.retry_limit_in_search) r.retry_limit_in_search = defaults.retry_limit_in_search;
+		if (r.timeout == clock::duration::zero() && r.deadline == clock::time_point()) {
+			r.timeout = defaults.timeout;
+			r.deadline = defaults.deadline;
+		}
+		return r;
+	}
+};
+
+////////////////////////////////////////////
+// onigpp::capture_mask
+
+// The capture groups a search or match stores in match_results. The groups
+// left out are reported as unmatched, and their positions are never
+// converted, so a pattern with many groups costs less per match when only a
+// few of them are read. match_results keeps one sub_match per group, so the
+// group numbers do not change. Group 0 is always stored, and so are the
+// groups past max_group. The default mask stores every group.
+//
+// A regex has a default mask (see basic_regex::set_captures), which
+// regex_iterator, match_offsets results and regex_batch use too; the
+// overloads of regex_search and regex_match taking a mask use theirs
+// instead. regex_replace and regex_split always see every group, as their
+// format or fields may refer to any. basic_regex::named_captures builds a
+// mask from group names.
+//
+// The group list constructor is explicit: write capture_mask{ 1, 4 }, as a
+// bare { 2 } passed to regex_search would be taken as match_flag_type.
+struct capture_mask {
+	static const int max_group = 63;
+
+	unsigned long long bits; // Bit n: group n is stored
+
+	// Every group
+	capture_mask() : bits(~0ULL) { }
+	// Group 0 and the listed groups
+	explicit capture_mask(std::initializer_list<int> groups) : bits(1) {
+		for (int group : groups) add(group);
+	}
+
+	// Only group 0
+	static capture_mask none() {
+		capture_mask mask;
+		mask.bits = 1;
+		return mask;
+	}
+
+	capture_mask& add(int group) {
+		if (group >= 0 && group <= max_group) bits |= 1ULL << group;
+		return *this;
+	}
+	bool contains(int group) const {
+		return group < 0 || group > max_group || ((bits >> group) & 1) != 0;
+	}
+	bool is_all() const { return bits == ~0ULL; }
+};
+
+////////////////////////////////////////////
+// onigpp::_regex_program<CharT>
+
+// Counters behind regex_stats (times in nanoseconds)
+struct _regex_counters {
+	std::atomic<unsigned long long> compiles, searches, matches, bytes_scanned, total_time, max_time;
+	std::atomic<unsigned long long> prefilter_rejections;
+
+	_regex_counters() { reset(); }
+	void reset() {
+		compiles = 0; searches = 0; matches = 0; bytes_scanned = 0; total_time = 0; max_time = 0;
+		prefilter_rejections = 0;
+	}
+	void assign(const _regex_counters& other) {
+		compiles = other.compiles.load(); searches = other.searches.load(); matches = other.matches.load();
+		bytes_scanned = other.bytes_scanned.load(); total_time = other.total_time.load(); max_time = other.max_time.load();
+		prefilter_rejections = other.prefilter_rejections.load();
+	}
+};
+
+// Literal prefilter (regex_constants::optimize). When every match of a
+// pattern has to begin with one of a set of literals, as in an alternation
+// of escaped keywords, the start positions where such a literal may begin
+// are found with a scan over the code units before Oniguruma runs: a memchr
+// style search when all literals begin with the same code unit, otherwise
+// a bitmap of the first two code units. A search with no candidate never
+// reaches Oniguruma; otherwise Oniguruma starts at the first candidate.
+template <class CharT>
+struct _literal_prefilter {
+	static constexpr size_type npos = static_cast<size_type>(-1);
+
+	std::vector<std::basic_string<CharT>> literals; // Required prefixes, merged by regex sets
+	size_type min_length;        // Code units of the shortest literal
+	bool single_lead;            // All literals begin with lead
+	CharT lead;
+	unsigned long long firsts[4]; // Bitmap of the first code units (low 8 bits)
+	std::vector<unsigned long long> pairs; // Bitmap of the first two code units, when min_length >= 2
+	_regex_counters* counters;   // Counts rejections (nullptr for regex sets)
+
+	explicit _literal_prefilter(std::vector<std::basic_string<CharT>> prefixes);
+
+	// The first position at or after from in [0, len) where a literal may
+	// begin, or npos
+	size_type next(const CharT* s, size_type from, size_type len) const;
+};
+
+// Immutable compiled program shared by copies of basic_regex.
+// A program is never modified after it has been compiled, so copies may
+// search with it concurrently from any number of threads. Only the
+// instrumentation counters change, atomically.
+template <class CharT, class Traits>
+struct _regex_program {
+	using string_type = typename Traits::string_type;
+
+	OnigRegex regex;
+	OnigEncoding encoding;
+	string_type pattern;
+	mutable _regex_counters counters;
+
+	// Deferred compilation (regex_constants::deferred): the flags and locale are
+	// kept until the first use runs compiler, which fills in regex or throws
+	regex_constants::syntax_option_type flags;
+	std::locale locale;
+	void (*compiler)(_regex_program&);
+	mutable std::atomic<bool> compiled;
+	mutable std::mutex compile_lock;
+
+	// match_not_bow / match_not_eow: word_boundary tells whether the pattern
+	// may test word boundaries at all. When it does, variant_compiler builds
+	// (on first use) a variant of the program for the flags, in which \b and
+	// \B treat the string edges as required from the preprocessed pattern
+	// kept in compiled_pattern; see _regex_for_flags
+	bool word_boundary;
+	string_type compiled_pattern;
+	OnigSyntaxType* syntax;
+	OnigOptionType options;
+	OnigRegex (*variant_compiler)(const _regex_program&, unsigned edges);
+	mutable OnigRegex variants[3];
+	mutable std::atomic<unsigned> variants_built;
+
+	// regex_constants::optimize: the literal prefilter, when the pattern has one
+	std::shared_ptr<const _literal_prefilter<CharT>> prefilter;
+
+	_regex_program(const string_type& pat, OnigEncoding enc)
+		: regex(nullptr), encoding(enc), pattern(pat), flags(0), compiler(nullptr), compiled(false),
+		  word_boundary(true), syntax(nullptr), options(0), variant_compiler(nullptr), variants(), variants_built(0) { }
+	~_regex_program() {
+		if (regex) onig_free(regex);
+		for (OnigRegex variant : variants) {
+			if (variant) onig_free(variant);
+		}
+	}
+
+	// The compiled regex. A deferred program is compiled by the first caller;
+	// concurrent callers wait for it. After a compile error the program stays
+	// uncompiled, so every use reports the same regex_error.
+	OnigRegex get() const {
+		if (compiled.load(std::memory_order_acquire)) return regex;
+		std::lock_guard<std::mutex> lock(compile_lock);
+		if (!compiled.load(std::memory_order_relaxed)) {
+			compiler(const_cast<_regex_program&>(*this));
+			compiled.store(true, std::memory_order_release);
+		}
+		return regex;
+	}
+
+	// The variant for edges 1 (match_not_bow), 2 (match_not_eow) or 3 (both),
+	// or nullptr when the pattern can not be rewritten for them
+	OnigRegex variant(unsigned edges) const {
+		const unsigned bit = 1u << edges;
+		if (variants_built.load(std::memory_order_acquire) & bit) return variants[edges - 1];
+		std::lock_guard<std::mutex> lock(compile_lock);
+		if (!(variants_built.load(std::memory_order_relaxed) & bit)) {
+			if (variant_compiler) variants[edges - 1] = variant_compiler(*this, edges);
+			variants_built.fetch_or(bit, std::memory_order_release);
+		}
+		return variants[edges - 1];
+	}
+
+private:
+	_regex_program(const _regex_program&) = delete;
+	_regex_program& operator=(const _regex_program&) = delete;
+};
+
 ////////////////////////////////////////////
 // onigpp::basic_regex<CharT>
 
@@ -1184,11 +1886,12 @@ public:
 		icase      = regex_constants::icase,
 		multiline  = regex_constants::multiline,
 		collate    = regex_constants::collate,
+		optimize   = regex_constants::optimize,
 		oniguruma  = regex_constants::oniguruma,
 		normal     = regex_constants::normal
 	};
 
-	basic_regex() : m_regex(nullptr), m_encoding(nullptr), m_flags(regex_constants::normal), m_locale(std::locale()) { }
+	basic_regex() : m_program(), m_flags(regex_constants::normal), m_locale(std::locale()), m_limits(), m_captures() { }
 	explicit basic_regex(const CharT* s, flag_type f = regex_constants::normal, OnigEncoding enc = nullptr)
 		: basic_regex(s, Traits::length(s), f, enc) { }
 	basic_regex(const CharT* s, size_type count, flag_type f = regex_constants::normal, OnigEncoding enc = nullptr);
@@ -1197,7 +1900,7 @@ public:
 	// Iterator-range constructor
 	template <class BidiIterator>
 	basic_regex(BidiIterator first, BidiIterator last, flag_type f = regex_constants::normal, OnigEncoding enc = nullptr)
-		: m_regex(nullptr), m_encoding(enc), m_flags(f), m_pattern(), m_locale(std::locale())
+		: m_program(), m_flags(f), m_locale(std::locale()), m_limits(), m_captures()
 	{
 		// Build a string_type from iterator range and delegate to existing ctor logic
 		string_type s(first, last);
@@ -1227,13 +1930,13 @@ public:
 		return *this;
 	}
 	self_type& assign(const CharT* ptr, flag_type f = regex_constants::normal, OnigEncoding enc = nullptr) {
-		if (!enc) enc = m_encoding;
+		if (!enc) enc = _encoding();
 		self_type tmp(ptr, f, enc);
 		swap(tmp);
 		return *this;
 	}
 	self_type& assign(const string_type& str, flag_type f = regex_constants::normal, OnigEncoding enc = nullptr) {
-		if (!enc) enc = m_encoding;
+		if (!enc) enc = _encoding();
 		self_type tmp(str.c_str(), str.length(), f, enc);
 		swap(tmp);
 		return *this;
@@ -1242,7 +1945,7 @@ public:
 	// Iterator-range assign
 	template <class BidiIterator>
 	self_type& assign(BidiIterator first, BidiIterator last, flag_type f = regex_constants::normal, OnigEncoding enc = nullptr) {
-		if (!enc) enc = m_encoding;
+		if (!enc) enc = _encoding();
 		string_type s(first, last);
 		self_type tmp(s.c_str(), s.length(), f, enc);
 		swap(tmp);
@@ -1251,33 +1954,80 @@ public:
 
 	unsigned mark_count() const;
 	flag_type flags() const { return m_flags; }
-	const string_type& pattern() const noexcept { return m_pattern; }
+	const string_type& pattern() const noexcept {
+		static const string_type empty_pattern;
+		return m_program ? m_program->pattern : empty_pattern;
+	}
 
 	void swap(self_type& other) noexcept {
-		std::swap(m_regex, other.m_regex);
-		std::swap(m_encoding, other.m_encoding);
+		m_program.swap(other.m_program);
 		std::swap(m_flags, other.m_flags);
-		std::swap(m_pattern, other.m_pattern);
 		std::swap(m_locale, other.m_locale);
+		std::swap(m_limits, other.m_limits);
+		std::swap(m_captures, other.m_captures);
+	}
+
+	// Default limits for every search and match with this regex, including
+	// those made by iterators and regex_replace. Copies keep the limits;
+	// assigning a new pattern resets them.
+	const match_limits& limits() const noexcept { return m_limits; }
+	void set_limits(const match_limits& limits) { m_limits = limits; }
+
+	// Default capture groups stored by every search and match with this
+	// regex (see capture_mask). Copies keep the mask; assigning a new pattern
+	// resets it.
+	const capture_mask& captures() const noexcept { return m_captures; }
+	void set_captures(const capture_mask& captures) { m_captures = captures; }
+	// Group 0 and every group with one of the names; throws regex_error with
+	// error_backref for a name the pattern does not have
+	capture_mask named_captures(std::initializer_list<string_type> names) const;
+
+	// Compiles a regex constructed with regex_constants::deferred now, throwing
+	// regex_error if the pattern is invalid. Other regexes are already compiled.
+	void compile() const { _regex(); }
+	// False only for a deferred regex that has not been compiled yet
+	bool is_compiled() const noexcept {
+		return !m_program || m_program->compiled.load(std::memory_order_acquire);
+	}
+
+	// Whether searches use a literal prefilter: the regex was constructed
+	// with regex_constants::optimize, and every match of its pattern begins
+	// with one of a set of literals (without icase). Compiles a deferred regex.
+	bool prefilter_active() const {
+		_regex();
+		return m_program && m_program->prefilter;
 	}
 
+	// Snapshot and reset of the counters of the compiled pattern, which
+	// copies share (see regex_stats)
+	regex_stats stats() const;
+	void reset_stats() const;
+
 	template <class, class> friend struct regex_access;
 
 	locale_type getloc() const { return m_locale; }
 	locale_type imbue(locale_type loc);
 
 protected:
-	OnigRegex m_regex;
-	OnigEncoding m_encoding;
+	using program_type = _regex_program<CharT, Traits>;
+
+	std::shared_ptr<const program_type> m_program; // Shared between copies
 	flag_type m_flags;
-	string_type m_pattern;
 	locale_type m_locale;
+	match_limits m_limits;
+	capture_mask m_captures;
+
+	OnigRegex _regex() const { return m_program ? m_program->get() : nullptr; }
+	OnigEncoding _encoding() const { return m_program ? m_program->encoding : nullptr; }
+	void _compile(const string_type& pattern, OnigEncoding enc);
+	void _compile_program(program_type& program) const;
+	static void _compile_deferred(program_type& program);
 
 	static OnigOptionType _options_from_flags(flag_type f);
 	static OnigSyntaxType* _syntax_from_flags(flag_type f);
-	string_type _preprocess_pattern_for_locale(const string_type& pattern) const;
-	string_type _preprocess_pattern_for_ecmascript(const string_type& pattern) const;
-	string_type _emulate_ecmascript_multiline(const string_type& pattern) const;
+	_scratch_string<CharT> _preprocess_pattern_for_locale(const _scratch_string<CharT>& pattern) const;
+	_scratch_string<CharT> _preprocess_pattern_for_ecmascript(const _scratch_string<CharT>& pattern) const;
+	_scratch_string<CharT> _emulate_ecmascript_multiline(const _scratch_string<CharT>& pattern) const;
 };
 
 ////////////////////////////////////////////
@@ -1296,6 +2046,182 @@ void swap(basic_regex<CharT, Traits>& lhs, basic_regex<CharT, Traits>& rhs) noex
 	lhs.swap(rhs);
 }
 
+////////////////////////////////////////////
+// onigpp::regex_cache_stats
+
+struct regex_cache_stats {
+	size_type hits;      // Lookups answered from the cache
+	size_type misses;    // Lookups that compiled a new regex
+	size_type evictions; // Entries dropped to stay within capacity
+	size_type size;      // Entries currently cached
+	size_type capacity;  // Maximum number of entries
+};
+
+////////////////////////////////////////////
+// onigpp::basic_regex_cache<CharT>
+//
+// Bounded LRU cache of compiled regular expressions. Entries are keyed on
+// (pattern, syntax_option_type, OnigEncoding, locale) and handed out as
+// shared, immutable basic_regex objects. All member functions are
+// thread-safe; compilation happens outside the lock.
+//
+// The locale is part of the key only when collate is set, since it does
+// not affect compilation otherwise. Locales without a name cannot be told
+// apart, so collate lookups with such a locale bypass the cache.
+
+template <class CharT, class Traits = regex_traits<CharT>>
+class basic_regex_cache {
+public:
+	using regex_type = basic_regex<CharT, Traits>;
+	using string_type = typename Traits::string_type;
+	using flag_type = regex_constants::syntax_option_type;
+	using pointer = std::shared_ptr<const regex_type>;
+
+	explicit basic_regex_cache(size_type capacity = 256);
+
+	// Returns the cached regex, compiling and inserting it on a miss.
+	// Throws regex_error if the pattern is invalid (nothing is cached then).
+	pointer get(const string_type& pattern, flag_type f = regex_constants::normal,
+	            OnigEncoding enc = nullptr, const std::locale& loc = std::locale());
+
+	size_type capacity() const;
+	void set_capacity(size_type capacity); // Evicts least recently used entries as needed
+	void clear();
+
+	regex_cache_stats stats() const;
+	void reset_stats();
+
+	// Process-wide instance
+	static basic_regex_cache& global();
+
+private:
+	struct key_type {
+		string_type pattern;
+		flag_type flags;
+		OnigEncoding encoding;
+		std::string locale_name;
+		bool operator==(const key_type& other) const {
+			return flags == other.flags && encoding == other.encoding &&
+			       pattern == other.pattern && locale_name == other.locale_name;
+		}
+	};
+	struct key_hash {
+		size_type operator()(const key_type& key) const;
+	};
+	using entry_type = std::pair<key_type, pointer>;
+	using list_type = std::list<entry_type>;
+
+	mutable std::mutex m_mutex;
+	list_type m_entries; // Most recently used first
+	std::unordered_map<key_type, typename list_type::iterator, key_hash> m_index;
+	size_type m_capacity;
+	size_type m_hits;
+	size_type m_misses;
+	size_type m_evictions;
+
+	void _evict_to(size_type count);
+
+	basic_regex_cache(const basic_regex_cache&) = delete;
+	basic_regex_cache& operator=(const basic_regex_cache&) = delete;
+};
+
+using regex_cache = basic_regex_cache<char>;
+using wregex_cache = basic_regex_cache<wchar_t>;
+using u16regex_cache = basic_regex_cache<char16_t>;
+using u32regex_cache = basic_regex_cache<char32_t>;
+
+////////////////////////////////////////////
+// onigpp::match_offsets
+//
+// The result of a search as plain offsets from the start of the subject,
+// without sub_match iterators. Positions and lengths are in characters;
+// byte_position() and byte_length() give the offsets Oniguruma reported.
+// sub() and to_match_results() build iterators only when asked.
+
+class match_offsets {
+public:
+	static const size_type npos = static_cast<size_type>(-1);
+
+	match_offsets() : m_char_size(1), m_ready(false) { }
+
+	bool ready() const { return m_ready; }
+	size_type size() const { return m_bytes.size(); }
+	bool empty() const { return m_bytes.empty(); }
+	void clear() { m_bytes.clear(); }
+
+	bool matched(size_type n = 0) const { return n < size() && m_bytes[n].first != npos; }
+	// npos if group n did not match
+	size_type position(size_type n = 0) const { return matched(n) ? m_bytes[n].first / m_char_size : npos; }
+	size_type length(size_type n = 0) const { return matched(n) ? (m_bytes[n].second - m_bytes[n].first) / m_char_size : 0; }
+	size_type byte_position(size_type n = 0) const { return matched(n) ? m_bytes[n].first : npos; }
+	size_type byte_length(size_type n = 0) const { return matched(n) ? m_bytes[n].second - m_bytes[n].first : 0; }
+
+	// Group n as iterators into the subject [first, last)
+	template <class BidirIt>
+	sub_match<BidirIt> sub(size_type n, BidirIt first, BidirIt last) const {
+		if (!matched(n)) return sub_match<BidirIt>(last, last, false);
+		BidirIt sub_first = std::next(first, static_cast<std::ptrdiff_t>(position(n)));
+		return sub_match<BidirIt>(sub_first, std::next(sub_first, static_cast<std::ptrdiff_t>(length(n))), true);
+	}
+
+	// Fills m as regex_search would for the subject [first, last). The
+	// iterator is advanced through the group offsets in order, once.
+	template <class BidirIt, class Alloc>
+	void to_match_results(BidirIt first, BidirIt last, match_results<BidirIt, Alloc>& m) const {
+		BidirIt anchor = first;
+		size_type anchor_offset = 0;
+		to_match_results(first, last, m, anchor, anchor_offset);
+	}
+
+	// Same, starting the walk from anchor, an iterator at offset
+	// anchor_offset of the subject, which is moved to the end of the match
+	template <class BidirIt, class Alloc>
+	void to_match_results(BidirIt first, BidirIt last, match_results<BidirIt, Alloc>& m,
+	                      BidirIt& anchor, size_type& anchor_offset) const {
+		m.clear();
+		m.m_str_begin = first;
+		m.m_str_end = last;
+		m.m_ready = m_ready;
+		m.resize(size());
+
+		std::vector<std::pair<size_type, size_type>> ends; // (offset, 2 * group + is_end)
+		ends.reserve(2 * size());
+		for (size_type i = 0; i < size(); ++i) {
+			if (matched(i)) {
+				ends.push_back(std::make_pair(position(i), 2 * i));
+				ends.push_back(std::make_pair(position(i) + length(i), 2 * i + 1));
+			} else {
+				m[i] = sub_match<BidirIt>(last, last, false);
+			}
+		}
+		std::sort(ends.begin(), ends.end());
+
+		// Offsets before the anchor (from lookbehind) are reached backwards
+		BidirIt it = anchor;
+		size_type at = anchor_offset;
+		for (const auto& end : ends) {
+			std::advance(it, static_cast<std::ptrdiff_t>(end.first) - static_cast<std::ptrdiff_t>(at));
+			at = end.first;
+			sub_match<BidirIt>& sub = m[end.second / 2];
+			if (end.second % 2) {
+				sub.second = it;
+			} else {
+				sub.first = it;
+				sub.matched = true;
+			}
+		}
+		if (matched(0)) {
+			anchor = m[0].second;
+			anchor_offset = position(0) + length(0);
+		}
+	}
+
+public:
+	std::vector<std::pair<size_type, size_type>> m_bytes; // (begin, end) in bytes; npos if unmatched
+	size_type m_char_size;
+	bool m_ready;
+};
+
 ////////////////////////////////////////////
 // onigpp::regex_iterator
 
@@ -1322,12 +2248,20 @@ protected:
 	// This preserves previous-character context used by \b, \B, etc.
 	BidirIt m_begin;
 
+	// Non-contiguous ranges only: a copy of [m_begin, m_end) made by the first
+	// search (shared by copies of the iterator), and the end of the last
+	// match with its offset, so that each step only walks from there
+	std::shared_ptr<const basic_string<CharT>> m_buffer;
+	BidirIt m_cursor;
+	size_type m_cursor_offset;
+
 	// Helper function: search for the next match
 	void do_search(BidirIt first, BidirIt last);
+	bool _search_buffer(BidirIt first);
 
 public:
 	// 1. End-of-Sequence constructor
-	regex_iterator() : m_regex(nullptr) {}
+	regex_iterator() : m_regex(nullptr), m_cursor_offset(0) {}
 
 	// 2. Value constructor (starts search)
 	regex_iterator(BidirIt first, BidirIt last,
@@ -1359,33 +2293,88 @@ using u16sregex_iterator = regex_iterator<u16string::const_iterator, char16_t>;
 using u32sregex_iterator = regex_iterator<u32string::const_iterator, char32_t>;
 
 ////////////////////////////////////////////
-// onigpp::regex_token_iterator
+// onigpp::regex_offset_iterator
+//
+// Iterates over the matches in [first, last) like regex_iterator, but
+// yields match_offsets relative to first. Non-contiguous ranges are copied
+// once when the iterator is constructed, and copies of the iterator share
+// that copy; iterating never touches the original iterators again.
 
 template <class BidirIt, class CharT = typename std::iterator_traits<BidirIt>::value_type, class Traits = regex_traits<CharT>>
-class regex_token_iterator {
+class regex_offset_iterator {
 public:
 	using iterator_category = std::forward_iterator_tag;
-	using value_type = sub_match<BidirIt>;
+	using value_type = match_offsets;
 	using difference_type = std::ptrdiff_t;
 	using pointer = const value_type*;
 	using reference = const value_type&;
-
 	using regex_type = basic_regex<CharT, Traits>;
 	using match_flag_type = regex_constants::match_flag_type;
-	using regex_iterator_type = regex_iterator<BidirIt, CharT, Traits>;
-	using match_results_type = match_results<BidirIt>;
 
-protected:
-	regex_iterator_type m_itor;
-	regex_iterator_type m_end;
-	std::vector<int> m_subs;
-	size_type m_subs_idx;
+	regex_offset_iterator() : m_data(nullptr), m_size(0), m_regex(nullptr), m_flags(regex_constants::match_default) { }
+	regex_offset_iterator(BidirIt first, BidirIt last, const regex_type& re,
+	                      match_flag_type flags = regex_constants::match_default);
 
-	// Added member to hold the end iterator of the string
-	BidirIt m_last;
+	reference operator*() const { return m_results; }
+	pointer operator->() const { return &m_results; }
 
-	// Current token value
-	sub_match<BidirIt> m_sub_match;
+	bool operator==(const regex_offset_iterator& other) const;
+	bool operator!=(const regex_offset_iterator& other) const {
+		return !(*this == other);
+	}
+
+	regex_offset_iterator& operator++();
+	regex_offset_iterator operator++(int);
+
+private:
+	value_type m_results;
+	const CharT* m_data;
+	size_type m_size;
+	std::shared_ptr<const basic_string<CharT>> m_buffer; // copy of a non-contiguous range
+	const regex_type* m_regex;
+	match_flag_type m_flags;
+
+	void do_search(size_type offset);
+};
+
+using cregex_offset_iterator = regex_offset_iterator<const char*>;
+using wcregex_offset_iterator = regex_offset_iterator<const wchar_t*>;
+using u16cregex_offset_iterator = regex_offset_iterator<const char16_t*>;
+using u32cregex_offset_iterator = regex_offset_iterator<const char32_t*>;
+
+using sregex_offset_iterator = regex_offset_iterator<string::const_iterator, char>;
+using wsregex_offset_iterator = regex_offset_iterator<wstring::const_iterator, wchar_t>;
+using u16sregex_offset_iterator = regex_offset_iterator<u16string::const_iterator, char16_t>;
+using u32sregex_offset_iterator = regex_offset_iterator<u32string::const_iterator, char32_t>;
+
+////////////////////////////////////////////
+// onigpp::regex_token_iterator
+
+template <class BidirIt, class CharT = typename std::iterator_traits<BidirIt>::value_type, class Traits = regex_traits<CharT>>
+class regex_token_iterator {
+public:
+	using iterator_category = std::forward_iterator_tag;
+	using value_type = sub_match<BidirIt>;
+	using difference_type = std::ptrdiff_t;
+	using pointer = const value_type*;
+	using reference = const value_type&;
+
+	using regex_type = basic_regex<CharT, Traits>;
+	using match_flag_type = regex_constants::match_flag_type;
+	using regex_iterator_type = regex_iterator<BidirIt, CharT, Traits>;
+	using match_results_type = match_results<BidirIt>;
+
+protected:
+	regex_iterator_type m_itor;
+	regex_iterator_type m_end;
+	std::vector<int> m_subs;
+	size_type m_subs_idx;
+
+	// Added member to hold the end iterator of the string
+	BidirIt m_last;
+
+	// Current token value
+	sub_match<BidirIt> m_sub_match;
 
 	// Helper function: set the next token value
 	void _do_increment();
@@ -1933,6 +2922,189 @@ inline bool regex_match(
 	return regex_match(first, last, m, e, flags);
 }
 
+// Overloads with per-call limits (see match_limits)
+template <class BidirIt, class Alloc, class CharT, class Traits>
+inline bool regex_match(
+	BidirIt first, BidirIt last,
+	match_results<BidirIt, Alloc>& m,
+	const basic_regex<CharT, Traits>& e,
+	const match_limits& limits,
+	regex_constants::match_flag_type flags = regex_constants::match_default)
+{
+	basic_regex<CharT, Traits> limited(e); // Shares the compiled program
+	limited.set_limits(limits.merged(e.limits()));
+	return regex_match(first, last, m, limited, flags);
+}
+
+template <class Alloc, class CharT, class Traits>
+inline bool regex_match(
+	const basic_string<CharT>& s,
+	match_results<typename basic_string<CharT>::const_iterator, Alloc>& m,
+	const basic_regex<CharT, Traits>& e,
+	const match_limits& limits,
+	regex_constants::match_flag_type flags = regex_constants::match_default)
+{
+	return regex_match(s.begin(), s.end(), m, e, limits, flags);
+}
+
+// Overloads with per-call capture groups (see capture_mask)
+template <class BidirIt, class Alloc, class CharT, class Traits>
+inline bool regex_match(
+	BidirIt first, BidirIt last,
+	match_results<BidirIt, Alloc>& m,
+	const basic_regex<CharT, Traits>& e,
+	const capture_mask& captures,
+	regex_constants::match_flag_type flags = regex_constants::match_default)
+{
+	basic_regex<CharT, Traits> masked(e); // Shares the compiled program
+	masked.set_captures(captures);
+	return regex_match(first, last, m, masked, flags);
+}
+
+template <class Alloc, class CharT, class Traits>
+inline bool regex_match(
+	const basic_string<CharT>& s,
+	match_results<typename basic_string<CharT>::const_iterator, Alloc>& m,
+	const basic_regex<CharT, Traits>& e,
+	const capture_mask& captures,
+	regex_constants::match_flag_type flags = regex_constants::match_default)
+{
+	return regex_match(s.begin(), s.end(), m, e, captures, flags);
+}
+
+////////////////////////////////////////////
+// onigpp::basic_regex_format<CharT>
+//
+// A replacement format parsed once into literal runs and group references,
+// for repeated use with regex_replace or match_results::format. It accepts
+// the same syntax as regex_replace. When a regex is given, named groups
+// (${name}, and \k<name> in oniguruma mode) are resolved against it when
+// the format is built; without one, the syntax is that of
+// match_results::format.
+
+template <class CharT, class Traits>
+class basic_regex_format {
+public:
+	using char_type = CharT;
+	using string_type = basic_string<CharT>;
+	using regex_type = basic_regex<CharT, Traits>;
+
+	basic_regex_format() { }
+	explicit basic_regex_format(const string_type& fmt,
+	                            regex_constants::match_flag_type flags = regex_constants::format_default);
+	basic_regex_format(const string_type& fmt, const regex_type& e,
+	                   regex_constants::match_flag_type flags = regex_constants::format_default);
+
+	// Writes the replacement for m
+	template <class OutputIt, class BidirIt, class Alloc>
+	OutputIt apply(OutputIt out, const match_results<BidirIt, Alloc>& m) const {
+		for (const _item& item : m_items) {
+			if (item.kind == _literal) {
+				const CharT* lit = m_literals.data() + item.offset;
+				out = std::copy(lit, lit + item.length, out);
+			} else if (item.kind == _group) {
+				if (item.group < m.size() && m[item.group].matched) {
+					out = std::copy(m[item.group].first, m[item.group].second, out);
+				}
+			} else {
+				auto part = (item.kind == _prefix) ? m.prefix() : m.suffix();
+				out = std::copy(part.first, part.second, out);
+			}
+		}
+		return out;
+	}
+
+	// Writes the replacement for m, a match in the subject [first, last)
+	template <class OutputIt>
+	OutputIt apply(OutputIt out, const match_offsets& m, const CharT* first, const CharT* last) const {
+		for (const _item& item : m_items) {
+			if (item.kind == _literal) {
+				const CharT* lit = m_literals.data() + item.offset;
+				out = std::copy(lit, lit + item.length, out);
+			} else if (item.kind == _group) {
+				if (m.matched(item.group)) {
+					const CharT* group = first + m.position(item.group);
+					out = std::copy(group, group + m.length(item.group), out);
+				}
+			} else if (!m.empty()) {
+				if (item.kind == _prefix)
+					out = std::copy(first, first + m.position(0), out);
+				else
+					out = std::copy(first + m.position(0) + m.length(0), last, out);
+			}
+		}
+		return out;
+	}
+
+	// Appends the replacement for m to dest
+	template <class BidirIt, class Alloc>
+	void append_to(string_type& dest, const match_results<BidirIt, Alloc>& m) const {
+		for (const _item& item : m_items) {
+			if (item.kind == _literal) {
+				dest.append(m_literals, item.offset, item.length);
+			} else if (item.kind == _group) {
+				if (item.group < m.size() && m[item.group].matched) {
+					dest.append(m[item.group].first, m[item.group].second);
+				}
+			} else {
+				auto part = (item.kind == _prefix) ? m.prefix() : m.suffix();
+				dest.append(part.first, part.second);
+			}
+		}
+	}
+
+	void append_to(string_type& dest, const match_offsets& m, const CharT* first, const CharT* last) const {
+		for (const _item& item : m_items) {
+			if (item.kind == _literal) {
+				dest.append(m_literals, item.offset, item.length);
+			} else if (item.kind == _group) {
+				if (m.matched(item.group)) {
+					dest.append(first + m.position(item.group), m.length(item.group));
+				}
+			} else if (!m.empty()) {
+				if (item.kind == _prefix)
+					dest.append(first, m.position(0));
+				else
+					dest.append(first + m.position(0) + m.length(0), last);
+			}
+		}
+	}
+
+	// True if the replacement never refers to the match
+	bool is_literal() const {
+		return m_items.empty() || (m_items.size() == 1 && m_items[0].kind == _literal);
+	}
+
+private:
+	enum _kind { _literal, _group, _prefix, _suffix };
+	struct _item {
+		_kind kind;
+		size_type group;
+		size_type offset; // literal run in m_literals
+		size_type length;
+	};
+	std::vector<_item> m_items;
+	string_type m_literals;
+
+	void _parse(const string_type& fmt, const regex_type* e,
+	            regex_constants::match_flag_type flags);
+	void _add_literal(CharT ch);
+	void _add_reference(_kind kind, size_type group = 0);
+};
+
+using regex_format = basic_regex_format<char>;
+using wregex_format = basic_regex_format<wchar_t>;
+using u16regex_format = basic_regex_format<char16_t>;
+using u32regex_format = basic_regex_format<char32_t>;
+
+template <class BidirIt, class Alloc>
+template <class OutputIt, class Traits>
+OutputIt match_results<BidirIt, Alloc>::format(
+	OutputIt out, const basic_regex_format<char_type, Traits>& fmt) const
+{
+	return fmt.apply(out, *this);
+}
+
 ////////////////////////////////////////////
 // regex_replace
 
@@ -1952,6 +3124,86 @@ OutputIt regex_replace(
 	const CharT* fmt,
 	regex_constants::match_flag_type flags = regex_constants::match_default);
 
+// Overload taking a precompiled format
+template <class OutputIt, class BidirIt, class CharT, class Traits>
+OutputIt regex_replace(
+	OutputIt out,
+	BidirIt first, BidirIt last,
+	const basic_regex<CharT, Traits>& e,
+	const basic_regex_format<CharT, Traits>& fmt,
+	regex_constants::match_flag_type flags = regex_constants::match_default);
+
+// regex_replace_append
+//
+// Appends the result of regex_replace over [first, last) to dest and returns
+// the number of replacements made. Space is reserved up front and the text
+// between matches is appended in bulk, so a destination reused across calls
+// (cleared, not shrunk) normally needs no allocation at all.
+template <class CharT, class Traits>
+size_type regex_replace_append(
+	basic_string<CharT>& dest,
+	const CharT* first, const CharT* last,
+	const basic_regex<CharT, Traits>& e,
+	const basic_regex_format<CharT, Traits>& fmt,
+	regex_constants::match_flag_type flags = regex_constants::match_default);
+
+template <class CharT, class Traits>
+inline size_type regex_replace_append(
+	basic_string<CharT>& dest,
+	const CharT* first, const CharT* last,
+	const basic_regex<CharT, Traits>& e,
+	const basic_string<CharT>& fmt,
+	regex_constants::match_flag_type flags = regex_constants::match_default)
+{
+	return regex_replace_append(dest, first, last, e, basic_regex_format<CharT, Traits>(fmt, e, flags), flags);
+}
+
+template <class CharT, class Traits>
+inline size_type regex_replace_append(
+	basic_string<CharT>& dest,
+	const basic_string<CharT>& s,
+	const basic_regex<CharT, Traits>& e,
+	const basic_regex_format<CharT, Traits>& fmt,
+	regex_constants::match_flag_type flags = regex_constants::match_default)
+{
+	return regex_replace_append(dest, s.data(), s.data() + s.size(), e, fmt, flags);
+}
+
+template <class CharT, class Traits>
+inline size_type regex_replace_append(
+	basic_string<CharT>& dest,
+	const basic_string<CharT>& s,
+	const basic_regex<CharT, Traits>& e,
+	const basic_string<CharT>& fmt,
+	regex_constants::match_flag_type flags = regex_constants::match_default)
+{
+	return regex_replace_append(dest, s.data(), s.data() + s.size(), e, fmt, flags);
+}
+
+template <class CharT, class Traits>
+inline size_type regex_replace_append(
+	basic_string<CharT>& dest,
+	const basic_string<CharT>& s,
+	const basic_regex<CharT, Traits>& e,
+	const CharT* fmt,
+	regex_constants::match_flag_type flags = regex_constants::match_default)
+{
+	return regex_replace_append(dest, s.data(), s.data() + s.size(), e, basic_string<CharT>(fmt), flags);
+}
+
+// Overload taking std::string and a precompiled format
+template <class CharT, class Traits>
+inline basic_string<CharT> regex_replace(
+	const basic_string<CharT>& s,
+	const basic_regex<CharT, Traits>& e,
+	const basic_regex_format<CharT, Traits>& fmt,
+	regex_constants::match_flag_type flags = regex_constants::match_default)
+{
+	basic_string<CharT> result;
+	regex_replace_append(result, s, e, fmt, flags);
+	return result;
+}
+
 // Overload taking std::string
 template <class CharT, class Traits>
 inline basic_string<CharT> regex_replace(
@@ -1961,7 +3213,7 @@ inline basic_string<CharT> regex_replace(
 	regex_constants::match_flag_type flags = regex_constants::match_default)
 {
 	basic_string<CharT> result;
-	regex_replace(std::back_inserter(result), s.begin(), s.end(), e, fmt, flags);
+	regex_replace_append(result, s, e, fmt, flags);
 	return result;
 }
 
@@ -1974,7 +3226,7 @@ inline basic_string<CharT> regex_replace(
 	regex_constants::match_flag_type flags = regex_constants::match_default)
 {
 	basic_string<CharT> result;
-	regex_replace(std::back_inserter(result), s.begin(), s.end(), e, fmt, flags);
+	regex_replace_append(result, s, e, fmt, flags);
 	return result;
 }
 
@@ -2033,6 +3285,24 @@ inline bool regex_search(
 	return regex_search(s.begin(), s.end(), m, e, flags);
 }
 
+// Overload reporting offsets only (see match_offsets)
+template <class BidirIt, class CharT, class Traits>
+bool regex_search(
+	BidirIt first, BidirIt last,
+	match_offsets& m,
+	const basic_regex<CharT, Traits>& e,
+	regex_constants::match_flag_type flags = regex_constants::match_default);
+
+template <class CharT, class Traits>
+inline bool regex_search(
+	const basic_string<CharT>& s,
+	match_offsets& m,
+	const basic_regex<CharT, Traits>& e,
+	regex_constants::match_flag_type flags = regex_constants::match_default)
+{
+	return regex_search(s.begin(), s.end(), m, e, flags);
+}
+
 // Version without match_results (simply checks for a match)
 template <class BidirIt, class CharT, class Traits>
 inline bool regex_search(
@@ -2044,25 +3314,1501 @@ inline bool regex_search(
 	return regex_search(first, last, m, e, flags);
 }
 
+// Overloads with per-call limits (see match_limits)
+template <class BidirIt, class Alloc, class CharT, class Traits>
+inline bool regex_search(
+	BidirIt first, BidirIt last,
+	match_results<BidirIt, Alloc>& m,
+	const basic_regex<CharT, Traits>& e,
+	const match_limits& limits,
+	regex_constants::match_flag_type flags = regex_constants::match_default)
+{
+	basic_regex<CharT, Traits> limited(e); // Shares the compiled program
+	limited.set_limits(limits.merged(e.limits()));
+	return regex_search(first, last, m, limited, flags);
+}
+
+template <class Alloc, class CharT, class Traits>
+inline bool regex_search(
+	const basic_string<CharT>& s,
+	match_results<typename basic_string<CharT>::const_iterator, Alloc>& m,
+	const basic_regex<CharT, Traits>& e,
+	const match_limits& limits,
+	regex_constants::match_flag_type flags = regex_constants::match_default)
+{
+	return regex_search(s.begin(), s.end(), m, e, limits, flags);
+}
+
+// Overloads with per-call capture groups (see capture_mask)
+template <class BidirIt, class Alloc, class CharT, class Traits>
+inline bool regex_search(
+	BidirIt first, BidirIt last,
+	match_results<BidirIt, Alloc>& m,
+	const basic_regex<CharT, Traits>& e,
+	const capture_mask& captures,
+	regex_constants::match_flag_type flags = regex_constants::match_default)
+{
+	basic_regex<CharT, Traits> masked(e); // Shares the compiled program
+	masked.set_captures(captures);
+	return regex_search(first, last, m, masked, flags);
+}
+
+template <class Alloc, class CharT, class Traits>
+inline bool regex_search(
+	const basic_string<CharT>& s,
+	match_results<typename basic_string<CharT>::const_iterator, Alloc>& m,
+	const basic_regex<CharT, Traits>& e,
+	const capture_mask& captures,
+	regex_constants::match_flag_type flags = regex_constants::match_default)
+{
+	return regex_search(s.begin(), s.end(), m, e, captures, flags);
+}
+
 ////////////////////////////////////////////
-// onigpp::regex_escape
+// regex_search_range
 //
-// Escapes regular expression special/meta-characters in a given string.
-// This function takes a string and returns a new string where all regex
-// meta-characters (. ^ $ * + ? ( ) [ ] { } \ |) are escaped with a backslash.
-// The resulting string can be safely used as a literal pattern in a regex.
-//
-// Example:
-//   Input:  "a+b*c.d?e^f$g|h(i)j[k]{l}\\m"
-//   Output: "a\\+b\\*c\\.d\\?e\\^f\\$g\\|h\\(i\\)j\\[k\\]\\{l\\}\\\\m"
-//
-// Supported character types: char, wchar_t, char16_t, char32_t
+// Searches a window of a larger subject, as onig_search does with separate
+// str/end/start/range: the match starts at or after start and lies within
+// [start, range], while [first, last) stays the context. ^, $, \A, \z, \b
+// and look-behind see the characters outside the window, so a record inside
+// a page, or a search resumed at a cursor, behaves as part of the whole
+// subject, and \G matches at start. Nothing past range is consumed, and
+// look-ahead does not see past it either; the search costs time in the size
+// of the window, not of the subject. m is filled as by regex_search, with
+// positions relative to first. With match_continuous, the match must start
+// at start. Requires first <= start <= range <= last. Instantiated for
+// string iterators and const CharT*.
 
-template <class CharT>
-basic_string<CharT> regex_escape(const basic_string<CharT>& str);
+template <class BidirIt, class Alloc, class CharT, class Traits>
+bool regex_search_range(
+	BidirIt first, BidirIt start, BidirIt range, BidirIt last,
+	match_results<BidirIt, Alloc>& m,
+	const basic_regex<CharT, Traits>& e,
+	regex_constants::match_flag_type flags = regex_constants::match_default);
 
-// Convenience overload for C-string
-template <class CharT>
-basic_string<CharT> regex_escape(const CharT* str);
+// std::string overload; start and range are positions in s
+template <class Alloc, class CharT, class Traits>
+inline bool regex_search_range(
+	const basic_string<CharT>& s, size_type start, size_type range,
+	match_results<typename basic_string<CharT>::const_iterator, Alloc>& m,
+	const basic_regex<CharT, Traits>& e,
+	regex_constants::match_flag_type flags = regex_constants::match_default)
+{
+	start = std::min(start, s.size());
+	range = std::max(start, std::min(range, s.size()));
+	return regex_search_range(s.begin(), s.begin() + start, s.begin() + range, s.end(), m, e, flags);
+}
 
-} // namespace onigpp
+// The iterators of m would point into a destroyed temporary
+template <class Alloc, class CharT, class Traits>
+bool regex_search_range(
+	const basic_string<CharT>&& s, size_type start, size_type range,
+	match_results<typename basic_string<CharT>::const_iterator, Alloc>& m,
+	const basic_regex<CharT, Traits>& e,
+	regex_constants::match_flag_type flags = regex_constants::match_default) = delete;
+
+////////////////////////////////////////////
+// regex_search_backward
+//
+// Finds the match that starts last in [first, last), for a find-previous:
+// Oniguruma tries the start positions from the end backward (onig_search
+// with range < start) and stops at the first one where the pattern
+// matches, instead of the whole subject being searched forward. With
+// before, the match must also end at or before it, while [first, last)
+// stays the context: look-behind, look-ahead and \b see the characters
+// around the match as in regex_search. A match running past before, or an
+// empty one with match_not_null, is skipped, and the search goes on at the
+// positions before its start. The match at a position is the one
+// regex_search finds there, so where matches can start inside each other
+// (a+ in "aaa") the last start wins. m is filled as by regex_search;
+// match_continuous is ignored. Instantiated for string iterators and
+// const CharT*.
+
+// from: the greatest start position tried
+template <class BidirIt, class Alloc, class CharT, class Traits>
+bool _regex_search_backward(
+	BidirIt first, BidirIt from, BidirIt before, BidirIt last,
+	match_results<BidirIt, Alloc>& m,
+	const basic_regex<CharT, Traits>& e,
+	regex_constants::match_flag_type flags);
+
+template <class BidirIt, class Alloc, class CharT, class Traits>
+inline bool regex_search_backward(
+	BidirIt first, BidirIt before, BidirIt last,
+	match_results<BidirIt, Alloc>& m,
+	const basic_regex<CharT, Traits>& e,
+	regex_constants::match_flag_type flags = regex_constants::match_default)
+{
+	return _regex_search_backward(first, before, before, last, m, e, flags);
+}
+
+template <class BidirIt, class Alloc, class CharT, class Traits>
+inline bool regex_search_backward(
+	BidirIt first, BidirIt last,
+	match_results<BidirIt, Alloc>& m,
+	const basic_regex<CharT, Traits>& e,
+	regex_constants::match_flag_type flags = regex_constants::match_default)
+{
+	return _regex_search_backward(first, last, last, last, m, e, flags);
+}
+
+// std::string overloads; before is a position in s
+template <class Alloc, class CharT, class Traits>
+inline bool regex_search_backward(
+	const basic_string<CharT>& s,
+	match_results<typename basic_string<CharT>::const_iterator, Alloc>& m,
+	const basic_regex<CharT, Traits>& e,
+	regex_constants::match_flag_type flags = regex_constants::match_default)
+{
+	return regex_search_backward(s.begin(), s.end(), m, e, flags);
+}
+
+template <class Alloc, class CharT, class Traits>
+inline bool regex_search_backward(
+	const basic_string<CharT>& s, size_type before,
+	match_results<typename basic_string<CharT>::const_iterator, Alloc>& m,
+	const basic_regex<CharT, Traits>& e,
+	regex_constants::match_flag_type flags = regex_constants::match_default)
+{
+	return regex_search_backward(s.begin(), s.begin() + std::min(before, s.size()), s.end(), m, e, flags);
+}
+
+// The iterators of m would point into a destroyed temporary
+template <class Alloc, class CharT, class Traits>
+bool regex_search_backward(
+	const basic_string<CharT>&& s,
+	match_results<typename basic_string<CharT>::const_iterator, Alloc>& m,
+	const basic_regex<CharT, Traits>& e,
+	regex_constants::match_flag_type flags = regex_constants::match_default) = delete;
+
+////////////////////////////////////////////
+// onigpp::regex_reverse_iterator
+//
+// Iterates over the matches in [first, last) from the end, with
+// regex_search_backward: each match ends at or before the start of the
+// previous one, and after an empty match the search starts one character
+// earlier. All searches see [first, last) as context. Instantiated for
+// string iterators and const CharT*.
+
+template <class BidirIt, class CharT = typename std::iterator_traits<BidirIt>::value_type, class Traits = regex_traits<CharT>>
+class regex_reverse_iterator {
+public:
+	using iterator_category = std::forward_iterator_tag;
+	using value_type = match_results<BidirIt>;
+	using difference_type = std::ptrdiff_t;
+	using pointer = const value_type*;
+	using reference = const value_type&;
+	using regex_type = basic_regex<CharT, Traits>;
+	using match_flag_type = regex_constants::match_flag_type;
+	using self_type = regex_reverse_iterator<BidirIt, CharT, Traits>;
+
+	// End-of-sequence iterator
+	regex_reverse_iterator() : m_regex(nullptr), m_flags(regex_constants::match_default) { }
+
+	regex_reverse_iterator(BidirIt first, BidirIt last, const regex_type& re,
+	                       match_flag_type flags = regex_constants::match_default)
+		: m_begin(first), m_end(last), m_regex(&re), m_flags(flags)
+	{
+		_search(last, last);
+	}
+
+	reference operator*() const { return m_results; }
+	pointer operator->() const { return &m_results; }
+
+	bool operator==(const self_type& other) const {
+		if (!m_regex || !other.m_regex) return m_regex == other.m_regex;
+		return m_regex == other.m_regex && m_begin == other.m_begin && m_end == other.m_end &&
+		       m_flags == other.m_flags && m_results[0].first == other.m_results[0].first &&
+		       m_results[0].second == other.m_results[0].second;
+	}
+	bool operator!=(const self_type& other) const { return !(*this == other); }
+
+	self_type& operator++() {
+		const BidirIt start = m_results[0].first;
+		if (start != m_results[0].second)
+			_search(start, start);
+		else if (start == m_begin)
+			_finish();
+		else
+			_search(std::prev(start), start);
+		return *this;
+	}
+	self_type operator++(int) {
+		self_type tmp(*this);
+		++(*this);
+		return tmp;
+	}
+
+protected:
+	value_type m_results;
+	BidirIt m_begin;
+	BidirIt m_end;
+	const regex_type* m_regex;
+	match_flag_type m_flags;
+
+	void _search(BidirIt from, BidirIt before) {
+		if (!_regex_search_backward(m_begin, from, before, m_end, m_results, *m_regex, m_flags))
+			_finish();
+	}
+	void _finish() {
+		m_regex = nullptr;
+		m_results = value_type();
+	}
+};
+
+using cregex_reverse_iterator = regex_reverse_iterator<const char*>;
+using wcregex_reverse_iterator = regex_reverse_iterator<const wchar_t*>;
+using u16cregex_reverse_iterator = regex_reverse_iterator<const char16_t*>;
+using u32cregex_reverse_iterator = regex_reverse_iterator<const char32_t*>;
+
+using sregex_reverse_iterator = regex_reverse_iterator<string::const_iterator, char>;
+using wsregex_reverse_iterator = regex_reverse_iterator<wstring::const_iterator, wchar_t>;
+using u16sregex_reverse_iterator = regex_reverse_iterator<u16string::const_iterator, char16_t>;
+using u32sregex_reverse_iterator = regex_reverse_iterator<u32string::const_iterator, char32_t>;
+
+////////////////////////////////////////////
+// regex_test, regex_count
+//
+// regex_test(first, last, e) tells whether regex_search would find a match
+// in the contiguous subject [first, last), without an OnigRegion (unless
+// match_not_null or a word boundary flag needs the match extent) and
+// without building match_results. regex_count returns the number of matches
+// regex_iterator would enumerate, with the same zero-width advancement,
+// using one reused region and no iterators or sub_matches.
+
+template <class CharT, class Traits>
+bool regex_test(
+	const CharT* first, const CharT* last,
+	const basic_regex<CharT, Traits>& e,
+	regex_constants::match_flag_type flags = regex_constants::match_default);
+
+template <class CharT, class Traits>
+inline bool regex_test(
+	const basic_string<CharT>& s,
+	const basic_regex<CharT, Traits>& e,
+	regex_constants::match_flag_type flags = regex_constants::match_default)
+{
+	return regex_test(s.data(), s.data() + s.size(), e, flags);
+}
+
+template <class CharT, class Traits>
+inline bool regex_test(
+	const CharT* str,
+	const basic_regex<CharT, Traits>& e,
+	regex_constants::match_flag_type flags = regex_constants::match_default)
+{
+	return regex_test(str, str + Traits::length(str), e, flags);
+}
+
+template <class CharT, class Traits>
+size_type regex_count(
+	const CharT* first, const CharT* last,
+	const basic_regex<CharT, Traits>& e,
+	regex_constants::match_flag_type flags = regex_constants::match_default);
+
+template <class CharT, class Traits>
+inline size_type regex_count(
+	const basic_string<CharT>& s,
+	const basic_regex<CharT, Traits>& e,
+	regex_constants::match_flag_type flags = regex_constants::match_default)
+{
+	return regex_count(s.data(), s.data() + s.size(), e, flags);
+}
+
+template <class CharT, class Traits>
+inline size_type regex_count(
+	const CharT* str,
+	const basic_regex<CharT, Traits>& e,
+	regex_constants::match_flag_type flags = regex_constants::match_default)
+{
+	return regex_count(str, str + Traits::length(str), e, flags);
+}
+
+////////////////////////////////////////////
+// regex_for_each
+//
+// Calls visitor(view) for each match regex_iterator would enumerate in the
+// contiguous subject [first, last), with the same zero-width advancement,
+// and returns the number of matches visited. view is a basic_match_view
+// over the engine's match registers, reused for every match: nothing is
+// allocated or copied per match, and the view is only valid during the
+// call. A visitor returning bool stops the enumeration by returning false
+// (the match is still counted).
+
+template <class CharT>
+class basic_match_view {
+public:
+	static const size_type npos = static_cast<size_type>(-1);
+
+	// Used by regex_for_each: beg and end are the byte offsets of the
+	// groups from subject, ONIG_REGION_NOTPOS if a group did not match
+	basic_match_view(const CharT* subject, const int* beg, const int* end, size_type size)
+		: m_subject(subject), m_beg(beg), m_end(end), m_size(size) { }
+
+	size_type size() const { return m_size; }
+	bool matched(size_type n = 0) const { return n < m_size && m_beg[n] != ONIG_REGION_NOTPOS; }
+	// Positions and lengths in characters from first; npos if group n did not match
+	size_type position(size_type n = 0) const { return matched(n) ? m_beg[n] / sizeof(CharT) : npos; }
+	size_type length(size_type n = 0) const { return matched(n) ? (m_end[n] - m_beg[n]) / sizeof(CharT) : 0; }
+	// The characters of group n in the subject, nullptr if it did not match
+	const CharT* data(size_type n = 0) const { return matched(n) ? m_subject + position(n) : nullptr; }
+	basic_string<CharT> str(size_type n = 0) const {
+		return matched(n) ? basic_string<CharT>(data(n), length(n)) : basic_string<CharT>();
+	}
+
+private:
+	const CharT* m_subject;
+	const int* m_beg;
+	const int* m_end;
+	size_type m_size;
+};
+
+using match_view = basic_match_view<char>;
+using wmatch_view = basic_match_view<wchar_t>;
+using u16match_view = basic_match_view<char16_t>;
+using u32match_view = basic_match_view<char32_t>;
+
+// The engine behind regex_for_each: visit(context, view) returns false to stop
+template <class CharT, class Traits>
+size_type _regex_for_each(
+	const CharT* first, const CharT* last,
+	const basic_regex<CharT, Traits>& e,
+	bool (*visit)(void* context, const basic_match_view<CharT>& view), void* context,
+	regex_constants::match_flag_type flags);
+
+template <class Visitor, class View>
+inline bool _call_visitor(Visitor& visitor, const View& view, std::true_type /* returns void */) {
+	visitor(view);
+	return true;
+}
+
+template <class Visitor, class View>
+inline bool _call_visitor(Visitor& visitor, const View& view, std::false_type /* returns bool */) {
+	return static_cast<bool>(visitor(view));
+}
+
+template <class Visitor, class CharT>
+bool _visit_match(void* context, const basic_match_view<CharT>& view) {
+	Visitor& visitor = *static_cast<Visitor*>(context);
+	return _call_visitor(visitor, view, std::is_void<decltype(visitor(view))>());
+}
+
+template <class CharT, class Traits, class Visitor>
+inline size_type regex_for_each(
+	const CharT* first, const CharT* last,
+	const basic_regex<CharT, Traits>& e,
+	Visitor&& visitor,
+	regex_constants::match_flag_type flags = regex_constants::match_default)
+{
+	using visitor_type = typename std::remove_reference<Visitor>::type;
+	return _regex_for_each(first, last, e, &_visit_match<visitor_type, CharT>,
+		const_cast<void*>(static_cast<const void*>(std::addressof(visitor))), flags);
+}
+
+template <class CharT, class Traits, class Visitor>
+inline size_type regex_for_each(
+	const basic_string<CharT>& s,
+	const basic_regex<CharT, Traits>& e,
+	Visitor&& visitor,
+	regex_constants::match_flag_type flags = regex_constants::match_default)
+{
+	return regex_for_each(s.data(), s.data() + s.size(), e, std::forward<Visitor>(visitor), flags);
+}
+
+////////////////////////////////////////////
+// regex_split
+//
+// Splits the contiguous subject [first, last) at the matches of e and
+// appends one span per token to dest, either (offset, length) pairs in
+// characters or (begin, end) pointer pairs. subs selects the tokens of each
+// match as for regex_token_iterator: -1 is the field before the match and
+// n >= 0 is group n (empty when the group did not match). With -1, the
+// field after the last match is a token too. dest is appended to, not
+// cleared, so a container that is cleared and reused keeps its capacity
+// and the split makes no allocation per token. Return the number of spans
+// appended.
+
+struct split_options {
+	// At most this many fields (0: no limit): at most max_fields - 1
+	// matches are used, and the last field holds the rest of the subject
+	size_type max_fields;
+	// Empty tokens (e.g. between adjacent separators) are appended too
+	bool keep_empty;
+
+	split_options() : max_fields(0), keep_empty(true) { }
+};
+
+template <class CharT, class Traits>
+size_type regex_split(
+	std::vector<std::pair<size_type, size_type>>& dest,
+	const CharT* first, const CharT* last,
+	const basic_regex<CharT, Traits>& e,
+	const int* subs, size_type sub_count,
+	const split_options& options = split_options(),
+	regex_constants::match_flag_type flags = regex_constants::match_default);
+
+template <class CharT, class Traits>
+size_type regex_split(
+	std::vector<std::pair<const CharT*, const CharT*>>& dest,
+	const CharT* first, const CharT* last,
+	const basic_regex<CharT, Traits>& e,
+	const int* subs, size_type sub_count,
+	const split_options& options = split_options(),
+	regex_constants::match_flag_type flags = regex_constants::match_default);
+
+// The fields between the matches (subs { -1 })
+template <class Span, class CharT, class Traits>
+inline size_type regex_split(
+	std::vector<Span>& dest,
+	const CharT* first, const CharT* last,
+	const basic_regex<CharT, Traits>& e,
+	const split_options& options = split_options(),
+	regex_constants::match_flag_type flags = regex_constants::match_default)
+{
+	static const int fields = -1;
+	return regex_split(dest, first, last, e, &fields, 1, options, flags);
+}
+
+template <class Span, class CharT, class Traits>
+inline size_type regex_split(
+	std::vector<Span>& dest,
+	const CharT* first, const CharT* last,
+	const basic_regex<CharT, Traits>& e,
+	const std::vector<int>& subs,
+	const split_options& options = split_options(),
+	regex_constants::match_flag_type flags = regex_constants::match_default)
+{
+	return regex_split(dest, first, last, e, subs.data(), subs.size(), options, flags);
+}
+
+// std::string overloads
+template <class Span, class CharT, class Traits>
+inline size_type regex_split(
+	std::vector<Span>& dest,
+	const basic_string<CharT>& s,
+	const basic_regex<CharT, Traits>& e,
+	const split_options& options = split_options(),
+	regex_constants::match_flag_type flags = regex_constants::match_default)
+{
+	return regex_split(dest, s.data(), s.data() + s.size(), e, options, flags);
+}
+
+template <class Span, class CharT, class Traits>
+inline size_type regex_split(
+	std::vector<Span>& dest,
+	const basic_string<CharT>& s,
+	const basic_regex<CharT, Traits>& e,
+	const std::vector<int>& subs,
+	const split_options& options = split_options(),
+	regex_constants::match_flag_type flags = regex_constants::match_default)
+{
+	return regex_split(dest, s.data(), s.data() + s.size(), e, subs, options, flags);
+}
+
+// The pointer spans would point into a destroyed temporary
+template <class CharT, class Traits>
+size_type regex_split(
+	std::vector<std::pair<const CharT*, const CharT*>>& dest,
+	const basic_string<CharT>&& s,
+	const basic_regex<CharT, Traits>& e,
+	const split_options& options = split_options(),
+	regex_constants::match_flag_type flags = regex_constants::match_default) = delete;
+
+template <class CharT, class Traits>
+size_type regex_split(
+	std::vector<std::pair<const CharT*, const CharT*>>& dest,
+	const basic_string<CharT>&& s,
+	const basic_regex<CharT, Traits>& e,
+	const std::vector<int>& subs,
+	const split_options& options = split_options(),
+	regex_constants::match_flag_type flags = regex_constants::match_default) = delete;
+
+////////////////////////////////////////////
+// regex_grep
+//
+// Line-oriented search over the contiguous buffer [first, last), such as a
+// file read into memory or a memory-mapped view, as grep does it. The
+// buffer is split at '\n' (found with char_traits::find, i.e. memchr for
+// char) and each line is searched in place as a subject of its own, without
+// its newline: ^, $, \A and \z anchor to the line, and no match spans two
+// lines. '\r' is not removed. A last line without '\n' is a line too; an
+// empty buffer has no lines. The selected lines, with their context lines,
+// are appended to dest, so a reused container keeps its capacity.
+// regex_grep_count only counts them. Return the number of selected lines.
+
+struct grep_line {
+	size_type number; // Line number, from 1
+	size_type offset; // Position of the line in the buffer, in characters
+	size_type length; // Characters, without the newline
+	bool selected;    // false for a context line
+};
+
+struct grep_stats {
+	size_type lines;    // Lines read
+	size_type bytes;    // Bytes of those lines, newlines included
+	size_type selected; // Selected lines
+	std::chrono::nanoseconds elapsed;
+
+	grep_stats() : lines(0), bytes(0), selected(0), elapsed(0) { }
+
+	double lines_per_second() const { return _per_second(lines); }
+	double bytes_per_second() const { return _per_second(bytes); }
+
+private:
+	double _per_second(size_type n) const {
+		return elapsed.count() > 0 ? static_cast<double>(n) * 1e9 / static_cast<double>(elapsed.count()) : 0.0;
+	}
+};
+
+struct grep_options {
+	bool invert;              // Select the lines without a match (grep -v)
+	size_type max_count;      // Stop after this many selected lines (0: no limit) (grep -m)
+	size_type before_context; // Context lines before each selected line (grep -B)
+	size_type after_context;  // Context lines after each selected line (grep -A)
+	grep_stats* stats;        // Throughput of the call, when not nullptr
+
+	grep_options() : invert(false), max_count(0), before_context(0), after_context(0), stats(nullptr) { }
+};
+
+template <class CharT, class Traits>
+size_type regex_grep(
+	std::vector<grep_line>& dest,
+	const CharT* first, const CharT* last,
+	const basic_regex<CharT, Traits>& e,
+	const grep_options& options = grep_options(),
+	regex_constants::match_flag_type flags = regex_constants::match_default);
+
+template <class CharT, class Traits>
+inline size_type regex_grep(
+	std::vector<grep_line>& dest,
+	const basic_string<CharT>& s,
+	const basic_regex<CharT, Traits>& e,
+	const grep_options& options = grep_options(),
+	regex_constants::match_flag_type flags = regex_constants::match_default)
+{
+	return regex_grep(dest, s.data(), s.data() + s.size(), e, options, flags);
+}
+
+// Context lines are not read
+template <class CharT, class Traits>
+size_type regex_grep_count(
+	const CharT* first, const CharT* last,
+	const basic_regex<CharT, Traits>& e,
+	const grep_options& options = grep_options(),
+	regex_constants::match_flag_type flags = regex_constants::match_default);
+
+template <class CharT, class Traits>
+inline size_type regex_grep_count(
+	const basic_string<CharT>& s,
+	const basic_regex<CharT, Traits>& e,
+	const grep_options& options = grep_options(),
+	regex_constants::match_flag_type flags = regex_constants::match_default)
+{
+	return regex_grep_count(s.data(), s.data() + s.size(), e, options, flags);
+}
+
+////////////////////////////////////////////
+// regex_search_all_parallel
+//
+// Finds all matches in the contiguous buffer [first, last) using several
+// threads and returns the same sequence of matches that regex_iterator
+// produces for [first, last). The buffer is split into chunks of start
+// positions that are searched concurrently. Each chunk sees the whole
+// buffer before it; after it, a chunk sees 'overlap' more characters (by
+// default as many as the chunk has), so no chunk scans the rest of the
+// buffer. Matches found near the end of that window are re-checked against
+// the whole buffer and may extend past it, so the result is exact as long
+// as no match needs to look further than 'overlap' characters past the
+// end of its chunk to be found. Patterns using \G and searches with
+// match_continuous or match_not_null are run serially.
+
+template <class CharT>
+struct parallel_search_options {
+	// Number of characters per chunk (0: derived from the buffer size)
+	size_type chunk_size;
+	// Number of worker threads (0: std::thread::hardware_concurrency())
+	unsigned threads;
+	// Characters after a chunk visible to its search (npos: the chunk length)
+	size_type overlap;
+	// Move each chunk boundary to just after the next 'boundary' character
+	bool split_at_boundary;
+	CharT boundary;
+
+	static const size_type npos = static_cast<size_type>(-1);
+
+	parallel_search_options()
+		: chunk_size(0), threads(0), overlap(npos), split_at_boundary(false), boundary(CharT('\n')) { }
+};
+
+template <class CharT, class Traits>
+std::vector<match_results<const CharT*>> regex_search_all_parallel(
+	const CharT* first, const CharT* last,
+	const basic_regex<CharT, Traits>& e,
+	const parallel_search_options<CharT>& options = parallel_search_options<CharT>(),
+	regex_constants::match_flag_type flags = regex_constants::match_default);
+
+// std::string overload
+template <class CharT, class Traits>
+inline std::vector<match_results<const CharT*>> regex_search_all_parallel(
+	const basic_string<CharT>& s,
+	const basic_regex<CharT, Traits>& e,
+	const parallel_search_options<CharT>& options = parallel_search_options<CharT>(),
+	regex_constants::match_flag_type flags = regex_constants::match_default)
+{
+	return regex_search_all_parallel(s.data(), s.data() + s.size(), e, options, flags);
+}
+
+// The matches would point into a destroyed temporary
+template <class CharT, class Traits>
+std::vector<match_results<const CharT*>> regex_search_all_parallel(
+	const basic_string<CharT>&& s,
+	const basic_regex<CharT, Traits>& e,
+	const parallel_search_options<CharT>& options = parallel_search_options<CharT>(),
+	regex_constants::match_flag_type flags = regex_constants::match_default) = delete;
+
+////////////////////////////////////////////
+// regex_compile_batch
+//
+// Compile many patterns on a pool of worker threads. Each entry gets its own
+// result, either the compiled regex or the error it raised, so a bad pattern
+// does not stop the rest of the batch. The encodings of the batch are
+// initialized before the workers start, and onigpp::init() and uninit() wait
+// for the batch to finish, so the batch is safe to run alongside them.
+// Entries with regex_constants::deferred are compiled too.
+
+template <class CharT>
+struct regex_compile_entry {
+	basic_string<CharT> pattern;
+	regex_constants::syntax_option_type flags;
+	OnigEncoding encoding; // nullptr: the default encoding for CharT
+
+	regex_compile_entry(const basic_string<CharT>& pattern_,
+	                    regex_constants::syntax_option_type flags_ = regex_constants::normal,
+	                    OnigEncoding encoding_ = nullptr)
+		: pattern(pattern_), flags(flags_), encoding(encoding_) { }
+};
+
+template <class CharT, class Traits = regex_traits<CharT>>
+struct regex_compile_result {
+	basic_regex<CharT, Traits> regex; // Empty when the pattern failed to compile
+	bool ok;
+	// When !ok: the regex_error code, the Oniguruma error code and Oniguruma's
+	// message, which includes the OnigErrorInfo details (e.g. a group name)
+	regex_constants::error_type code;
+	int onig_code;
+	std::string message;
+
+	regex_compile_result() : regex(), ok(false), code(regex_constants::error_escape), onig_code(0) { }
+};
+
+struct compile_batch_options {
+	unsigned threads; // Worker threads (0: hardware concurrency)
+	size_type grain;  // Patterns handed to a worker at a time
+
+	compile_batch_options() : threads(0), grain(16) { }
+};
+
+// Compile entries [0, count) into results [0, count); return the number compiled
+template <class CharT, class Traits>
+size_type regex_compile_batch(
+	const regex_compile_entry<CharT>* entries, size_type count,
+	regex_compile_result<CharT, Traits>* results,
+	const compile_batch_options& options = compile_batch_options());
+
+template <class CharT, class Traits = regex_traits<CharT>>
+inline std::vector<regex_compile_result<CharT, Traits>> regex_compile_batch(
+	const std::vector<regex_compile_entry<CharT>>& entries,
+	const compile_batch_options& options = compile_batch_options())
+{
+	std::vector<regex_compile_result<CharT, Traits>> results(entries.size());
+	regex_compile_batch<CharT, Traits>(entries.data(), entries.size(), results.data(), options);
+	return results;
+}
+
+////////////////////////////////////////////
+// regex_search_batch, regex_match_batch, regex_count_batch
+//
+// Run regex_search (or regex_match) on every subject of [first, last), a
+// range of basic_string<CharT> or const CharT* strings, and store one
+// result per subject: a bool, match_offsets, or match_results pointing into
+// the subjects. regex_count_batch stores the regex_count of each subject,
+// and bool search results are found as by regex_test. The regex lookup,
+// the option setup and the OnigRegion are done once per worker rather than
+// once per subject, and the result vectors are reused (their elements keep
+// their capacity across calls). Return the number of subjects that matched.
+
+struct batch_options {
+	unsigned threads; // Worker threads (0: hardware concurrency)
+	size_type grain;  // Subjects handed to a worker at a time
+
+	batch_options() : threads(1), grain(1024) { }
+};
+
+template <class CharT, class Traits>
+size_type _regex_batch(
+	const std::pair<const CharT*, size_type>* subjects, size_type count,
+	const basic_regex<CharT, Traits>& e,
+	regex_constants::match_flag_type flags,
+	bool match_mode,
+	const batch_options& options,
+	char* matched,
+	match_offsets* offsets,
+	match_results<const CharT*>* results,
+	size_type* counts = nullptr);
+
+template <class CharT>
+inline std::pair<const CharT*, size_type> _batch_subject(const basic_string<CharT>& s) {
+	return std::make_pair(s.data(), s.size());
+}
+
+template <class CharT>
+inline std::pair<const CharT*, size_type> _batch_subject(const CharT* s) {
+	return std::make_pair(s, std::char_traits<CharT>::length(s));
+}
+
+template <class CharT, class ForwardIt>
+inline std::vector<std::pair<const CharT*, size_type>> _batch_subjects(ForwardIt first, ForwardIt last) {
+	std::vector<std::pair<const CharT*, size_type>> subjects;
+	for (; first != last; ++first) {
+		subjects.push_back(_batch_subject<CharT>(*first));
+	}
+	return subjects;
+}
+
+template <class CharT, class ForwardIt, class Traits>
+inline size_type _regex_batch_bool(
+	ForwardIt first, ForwardIt last, std::vector<bool>& matched,
+	const basic_regex<CharT, Traits>& e, regex_constants::match_flag_type flags,
+	bool match_mode, const batch_options& options)
+{
+	auto subjects = _batch_subjects<CharT>(first, last);
+	std::vector<char> flags_out(subjects.size());
+	size_type n = _regex_batch<CharT, Traits>(subjects.data(), subjects.size(), e, flags, match_mode, options,
+	                           flags_out.data(), nullptr, nullptr);
+	matched.assign(flags_out.begin(), flags_out.end());
+	return n;
+}
+
+template <class ForwardIt, class CharT, class Traits>
+inline size_type regex_search_batch(
+	ForwardIt first, ForwardIt last,
+	std::vector<bool>& matched,
+	const basic_regex<CharT, Traits>& e,
+	regex_constants::match_flag_type flags = regex_constants::match_default,
+	const batch_options& options = batch_options())
+{
+	return _regex_batch_bool<CharT>(first, last, matched, e, flags, false, options);
+}
+
+template <class ForwardIt, class CharT, class Traits>
+inline size_type regex_search_batch(
+	ForwardIt first, ForwardIt last,
+	std::vector<match_offsets>& results,
+	const basic_regex<CharT, Traits>& e,
+	regex_constants::match_flag_type flags = regex_constants::match_default,
+	const batch_options& options = batch_options())
+{
+	auto subjects = _batch_subjects<CharT>(first, last);
+	results.resize(subjects.size());
+	return _regex_batch<CharT, Traits>(subjects.data(), subjects.size(), e, flags, false, options,
+	                    nullptr, results.data(), nullptr);
+}
+
+template <class ForwardIt, class CharT, class Traits>
+inline size_type regex_search_batch(
+	ForwardIt first, ForwardIt last,
+	std::vector<match_results<const CharT*>>& results,
+	const basic_regex<CharT, Traits>& e,
+	regex_constants::match_flag_type flags = regex_constants::match_default,
+	const batch_options& options = batch_options())
+{
+	auto subjects = _batch_subjects<CharT>(first, last);
+	results.resize(subjects.size());
+	return _regex_batch<CharT, Traits>(subjects.data(), subjects.size(), e, flags, false, options,
+	                    nullptr, nullptr, results.data());
+}
+
+template <class ForwardIt, class CharT, class Traits>
+inline size_type regex_match_batch(
+	ForwardIt first, ForwardIt last,
+	std::vector<bool>& matched,
+	const basic_regex<CharT, Traits>& e,
+	regex_constants::match_flag_type flags = regex_constants::match_default,
+	const batch_options& options = batch_options())
+{
+	return _regex_batch_bool<CharT>(first, last, matched, e, flags, true, options);
+}
+
+template <class ForwardIt, class CharT, class Traits>
+inline size_type regex_match_batch(
+	ForwardIt first, ForwardIt last,
+	std::vector<match_offsets>& results,
+	const basic_regex<CharT, Traits>& e,
+	regex_constants::match_flag_type flags = regex_constants::match_default,
+	const batch_options& options = batch_options())
+{
+	auto subjects = _batch_subjects<CharT>(first, last);
+	results.resize(subjects.size());
+	return _regex_batch<CharT, Traits>(subjects.data(), subjects.size(), e, flags, true, options,
+	                    nullptr, results.data(), nullptr);
+}
+
+template <class ForwardIt, class CharT, class Traits>
+inline size_type regex_match_batch(
+	ForwardIt first, ForwardIt last,
+	std::vector<match_results<const CharT*>>& results,
+	const basic_regex<CharT, Traits>& e,
+	regex_constants::match_flag_type flags = regex_constants::match_default,
+	const batch_options& options = batch_options())
+{
+	auto subjects = _batch_subjects<CharT>(first, last);
+	results.resize(subjects.size());
+	return _regex_batch<CharT, Traits>(subjects.data(), subjects.size(), e, flags, true, options,
+	                    nullptr, nullptr, results.data());
+}
+
+template <class ForwardIt, class CharT, class Traits>
+inline size_type regex_count_batch(
+	ForwardIt first, ForwardIt last,
+	std::vector<size_type>& counts,
+	const basic_regex<CharT, Traits>& e,
+	regex_constants::match_flag_type flags = regex_constants::match_default,
+	const batch_options& options = batch_options())
+{
+	auto subjects = _batch_subjects<CharT>(first, last);
+	counts.resize(subjects.size());
+	return _regex_batch<CharT, Traits>(subjects.data(), subjects.size(), e, flags, false, options,
+	                    nullptr, nullptr, nullptr, counts.data());
+}
+
+////////////////////////////////////////////
+// onigpp::basic_regex_stream<CharT>
+//
+// Incremental matcher for input that arrives in chunks (sockets, pipes).
+// feed() appends a chunk and reports every match whose result can no
+// longer change; finish() marks the end of the input and reports the rest.
+// The reported matches are those regex_iterator would produce over the
+// concatenation of all chunks, provided that no match (including its
+// lookahead) needs more than window() characters from where it starts.
+// At most window() characters before the current search position are kept
+// for lookbehind and \b, so memory stays bounded by a few windows.
+//
+// match_continuous, match_not_bol and match_not_eol apply to the start and
+// end of the whole stream; chunk edges are never treated as line or
+// string boundaries.
+
+template <class CharT, class Traits = regex_traits<CharT>>
+class basic_regex_stream {
+public:
+	using char_type = CharT;
+	using traits_type = Traits;
+	using string_type = basic_string<CharT>;
+	using regex_type = basic_regex<CharT, Traits>;
+	using match_type = match_results<const CharT*>;
+	using match_flag_type = regex_constants::match_flag_type;
+	// Receives each match. The iterators in m are valid only during the call;
+	// offset is the stream position of m.prefix().first, so the match starts
+	// at offset + m.position(0).
+	using callback_type = std::function<void(const match_type& m, size_type offset)>;
+
+	static const size_type default_window = 4096;
+
+	basic_regex_stream(const regex_type& e, callback_type callback,
+	                   match_flag_type flags = regex_constants::match_default,
+	                   size_type window = default_window);
+
+	void feed(const CharT* data, size_type len);
+	void feed(const string_type& data) { feed(data.data(), data.size()); }
+	void finish();
+
+	// Starts a new stream with the same regex, callback and flags
+	void reset();
+
+	size_type window() const { return m_window; }
+	// Number of characters fed so far
+	size_type position() const { return m_base + m_buffer.size(); }
+	// Number of matches reported so far
+	size_type count() const { return m_count; }
+	bool finished() const { return m_finished; }
+
+private:
+	regex_type m_regex;
+	callback_type m_callback;
+	match_flag_type m_flags;
+	size_type m_window;
+	string_type m_buffer;  // retained tail of the stream
+	size_type m_base;      // stream position of m_buffer[0]
+	size_type m_pos;       // next search position in m_buffer
+	size_type m_count;
+	bool m_done;           // no further match is possible
+	bool m_finished;
+
+	void _search(bool at_end);
+};
+
+using regex_stream = basic_regex_stream<char>;
+using wregex_stream = basic_regex_stream<wchar_t>;
+using u16regex_stream = basic_regex_stream<char16_t>;
+using u32regex_stream = basic_regex_stream<char32_t>;
+
+////////////////////////////////////////////
+// onigpp::mapped_file
+//
+// Read-only view of a whole file for searching without copying it into a
+// std::string. The file is memory-mapped where possible (POSIX mmap,
+// Windows file mappings); otherwise, and for files that cannot be mapped
+// such as pipes, it is read into an internal buffer. Throws
+// std::runtime_error if the file cannot be opened or read.
+
+class mapped_file {
+public:
+	mapped_file() noexcept;
+	explicit mapped_file(const std::string& path);
+	mapped_file(mapped_file&& other) noexcept;
+	mapped_file& operator=(mapped_file&& other) noexcept;
+	~mapped_file();
+
+	void open(const std::string& path);
+	void close() noexcept;
+
+	bool is_open() const noexcept { return m_open; }
+	// True if the contents are mapped rather than read into a buffer
+	bool is_mapped() const noexcept { return m_mapped; }
+
+	const char* data() const noexcept { return m_data; }
+	size_type size() const noexcept { return m_size; }
+	const char* begin() const noexcept { return m_data; }
+	const char* end() const noexcept { return m_data + m_size; }
+
+	void swap(mapped_file& other) noexcept;
+
+private:
+	const char* m_data;
+	size_type m_size;
+	bool m_open;
+	bool m_mapped;
+	std::vector<char> m_buffer; // buffered-read fallback
+	void* m_mapping;            // Windows file mapping handle
+
+	mapped_file(const mapped_file&) = delete;
+	mapped_file& operator=(const mapped_file&) = delete;
+};
+
+// Searches the whole file. Files larger than the int byte offsets used by
+// Oniguruma are searched in overlapping windows; the match positions are
+// still relative to file.begin().
+bool regex_search(
+	const mapped_file& file,
+	cmatch& m,
+	const regex& e,
+	regex_constants::match_flag_type flags = regex_constants::match_default);
+
+// Iterates over the matches in a mapped file like cregex_iterator, using
+// the same windowed search for very large files.
+class mapped_regex_iterator {
+public:
+	using iterator_category = std::forward_iterator_tag;
+	using value_type = cmatch;
+	using difference_type = std::ptrdiff_t;
+	using pointer = const value_type*;
+	using reference = const value_type&;
+	using match_flag_type = regex_constants::match_flag_type;
+
+	mapped_regex_iterator() : m_begin(), m_end(), m_regex(nullptr), m_flags(regex_constants::match_default) {}
+	mapped_regex_iterator(const mapped_file& file, const regex& re,
+	                      match_flag_type flags = regex_constants::match_default);
+
+	reference operator*() const { return m_results; }
+	pointer operator->() const { return &m_results; }
+
+	bool operator==(const mapped_regex_iterator& other) const;
+	bool operator!=(const mapped_regex_iterator& other) const {
+		return !(*this == other);
+	}
+
+	mapped_regex_iterator& operator++();
+	mapped_regex_iterator operator++(int);
+
+private:
+	value_type m_results;
+	const char* m_begin;
+	const char* m_end;
+	const regex* m_regex;
+	match_flag_type m_flags;
+
+	void do_search(const char* first);
+};
+
+// Writes the file with every match replaced by fmt (regex_replace rules) to
+// out and returns the number of replacements.
+size_type regex_replace_file(
+	std::ostream& out,
+	const mapped_file& file,
+	const regex& e,
+	const string& fmt,
+	regex_constants::match_flag_type flags = regex_constants::match_default);
+
+// Same, reading in_path and writing out_path (which must be a different
+// file). Throws std::runtime_error if out_path cannot be written.
+size_type regex_replace_file(
+	const std::string& in_path,
+	const std::string& out_path,
+	const regex& e,
+	const string& fmt,
+	regex_constants::match_flag_type flags = regex_constants::match_default);
+
+////////////////////////////////////////////
+// onigpp::basic_segmented_text<CharT>
+//
+// A subject made of several non-contiguous spans (rope nodes, iovecs, deque
+// blocks), searched without flattening it. The spans are not copied and
+// must stay valid while the text is used. Positions are offsets into the
+// concatenation of the spans; locate() maps them back to a span.
+
+template <class CharT>
+class basic_segmented_text {
+public:
+	using char_type = CharT;
+	using string_type = basic_string<CharT>;
+
+	// A position within one span
+	struct position {
+		size_type segment;
+		size_type offset;
+	};
+
+	basic_segmented_text() : m_size(0) { }
+
+	// Adds a span at the end; empty spans are ignored
+	void append(const CharT* data, size_type length);
+	void clear();
+
+	// Adds the elements of [first, last) (e.g. of a std::deque) as spans,
+	// one per run of elements that are contiguous in memory
+	template <class ForwardIt>
+	void append_range(ForwardIt first, ForwardIt last) {
+		while (first != last) {
+			const CharT* run = &*first;
+			size_type length = 1;
+			for (++first; first != last && &*first == run + length; ++first) {
+				++length;
+			}
+			append(run, length);
+		}
+	}
+
+	size_type size() const { return m_size; }
+	bool empty() const { return m_size == 0; }
+	size_type segment_count() const { return m_segments.size(); }
+	const CharT* segment_data(size_type i) const { return m_segments[i].data; }
+	size_type segment_size(size_type i) const { return m_segments[i].size; }
+
+	// Maps an offset (0 <= offset <= size()) to a span; size() maps to the
+	// end of the last span
+	position locate(size_type offset) const;
+
+	// Copies [first, last) to out
+	void copy(size_type first, size_type last, string_type& out) const;
+	string_type str(size_type first, size_type last) const {
+		string_type result;
+		copy(first, last, result);
+		return result;
+	}
+
+private:
+	struct _segment {
+		const CharT* data;
+		size_type size;
+		size_type start; // offset of data[0]
+	};
+	std::vector<_segment> m_segments;
+	size_type m_size;
+
+	size_type _find(size_type offset) const;
+
+	template <class C, class T> friend struct _segmented_search;
+};
+
+using segmented_text = basic_segmented_text<char>;
+using wsegmented_text = basic_segmented_text<wchar_t>;
+using u16segmented_text = basic_segmented_text<char16_t>;
+using u32segmented_text = basic_segmented_text<char32_t>;
+
+// The result of a search over a basic_segmented_text, as offsets into the
+// text. Unmatched groups have position npos.
+template <class CharT>
+class basic_segmented_match {
+public:
+	using text_type = basic_segmented_text<CharT>;
+	using string_type = basic_string<CharT>;
+	using position_type = typename text_type::position;
+	static const size_type npos = static_cast<size_type>(-1);
+
+	basic_segmented_match() : m_text(nullptr) { }
+
+	size_type size() const { return m_groups.size(); }
+	bool empty() const { return m_groups.empty(); }
+	bool matched(size_type n = 0) const { return n < size() && m_groups[n].first != npos; }
+	size_type position(size_type n = 0) const { return n < size() ? m_groups[n].first : npos; }
+	size_type length(size_type n = 0) const { return matched(n) ? m_groups[n].second : 0; }
+
+	// Start and end of group n mapped to spans (group n must have matched)
+	position_type begin(size_type n = 0) const { return m_text->locate(m_groups[n].first); }
+	position_type end(size_type n = 0) const { return m_text->locate(m_groups[n].first + m_groups[n].second); }
+
+	string_type str(size_type n = 0) const {
+		return matched(n) ? m_text->str(m_groups[n].first, m_groups[n].first + m_groups[n].second) : string_type();
+	}
+
+	void clear() { m_groups.clear(); }
+
+private:
+	const text_type* m_text;
+	std::vector<std::pair<size_type, size_type>> m_groups; // (position, length)
+
+	template <class C, class T> friend struct _segmented_search;
+};
+
+using segmented_match = basic_segmented_match<char>;
+using wsegmented_match = basic_segmented_match<wchar_t>;
+using u16segmented_match = basic_segmented_match<char16_t>;
+using u32segmented_match = basic_segmented_match<char32_t>;
+
+// Default number of characters of context kept on each side of a span
+// boundary when a search has to look across it
+const size_type segmented_search_margin = 1024;
+
+// Searches text for e, starting at offset start. The search runs in place
+// inside each span; only around a span boundary are about 4 * margin
+// characters copied into a scratch buffer (more for a match that runs on
+// across the copy). Lookbehind and \b see at least margin characters
+// before each position tried. Near a span boundary, each attempt sees at
+// least margin characters after its start. A match running on past the
+// copy is extended as long as part of it already matched there (as with
+// a+); other matches or lookahead needing more may be missed.
+template <class CharT, class Traits>
+bool regex_search(
+	const basic_segmented_text<CharT>& text,
+	basic_segmented_match<CharT>& m,
+	const basic_regex<CharT, Traits>& e,
+	regex_constants::match_flag_type flags = regex_constants::match_default,
+	size_type start = 0,
+	size_type margin = segmented_search_margin);
+
+// Iterates over the matches in a basic_segmented_text like regex_iterator
+template <class CharT, class Traits = regex_traits<CharT>>
+class basic_segmented_regex_iterator {
+public:
+	using iterator_category = std::forward_iterator_tag;
+	using value_type = basic_segmented_match<CharT>;
+	using difference_type = std::ptrdiff_t;
+	using pointer = const value_type*;
+	using reference = const value_type&;
+	using text_type = basic_segmented_text<CharT>;
+	using regex_type = basic_regex<CharT, Traits>;
+	using match_flag_type = regex_constants::match_flag_type;
+
+	basic_segmented_regex_iterator()
+		: m_text(nullptr), m_regex(nullptr), m_flags(regex_constants::match_default), m_margin(0) { }
+	basic_segmented_regex_iterator(const text_type& text, const regex_type& re,
+	                               match_flag_type flags = regex_constants::match_default,
+	                               size_type margin = segmented_search_margin);
+
+	reference operator*() const { return m_results; }
+	pointer operator->() const { return &m_results; }
+
+	bool operator==(const basic_segmented_regex_iterator& other) const;
+	bool operator!=(const basic_segmented_regex_iterator& other) const {
+		return !(*this == other);
+	}
+
+	basic_segmented_regex_iterator& operator++();
+	basic_segmented_regex_iterator operator++(int);
+
+private:
+	value_type m_results;
+	const text_type* m_text;
+	const regex_type* m_regex;
+	match_flag_type m_flags;
+	size_type m_margin;
+	basic_string<CharT> m_scratch;
+
+	void do_search(size_type start);
+};
+
+using segmented_regex_iterator = basic_segmented_regex_iterator<char>;
+using wsegmented_regex_iterator = basic_segmented_regex_iterator<wchar_t>;
+using u16segmented_regex_iterator = basic_segmented_regex_iterator<char16_t>;
+using u32segmented_regex_iterator = basic_segmented_regex_iterator<char32_t>;
+
+////////////////////////////////////////////
+// onigpp::basic_regex_set<CharT>
+//
+// A set of regular expressions searched in one pass over the subject
+// (wraps Oniguruma's OnigRegSet). All regexes in the set must use the same
+// encoding. The compiled programs are shared with the added basic_regex
+// objects; the set itself keeps per-regex match storage, so a single set
+// must not be searched from several threads at once (copy it instead).
+
+template <class CharT, class Traits = regex_traits<CharT>>
+class basic_regex_set {
+public:
+	using regex_type = basic_regex<CharT, Traits>;
+	using string_type = typename Traits::string_type;
+	using flag_type = regex_constants::syntax_option_type;
+	using self_type = basic_regex_set<CharT, Traits>;
+
+	// Which match wins when several regexes match
+	enum lead_type {
+		position_lead = ONIG_REGSET_POSITION_LEAD, // Leftmost match; ties go to the earlier regex
+		regex_lead = ONIG_REGSET_REGEX_LEAD,       // Same result, scanning regex by regex
+		priority_lead = ONIG_REGSET_PRIORITY_TO_REGEX_ORDER // First regex (in order) that matches anywhere
+	};
+
+	explicit basic_regex_set(lead_type lead = position_lead);
+	basic_regex_set(std::initializer_list<regex_type> list, lead_type lead = position_lead);
+	template <class InputIt>
+	basic_regex_set(InputIt first, InputIt last, lead_type lead = position_lead)
+		: m_set(nullptr), m_lead(lead), m_prefiltered(true)
+	{
+		for (; first != last; ++first)
+			add(*first);
+	}
+	basic_regex_set(const self_type& other);
+	basic_regex_set(self_type&& other) noexcept;
+	~basic_regex_set();
+
+	self_type& operator=(const self_type& other) {
+		self_type tmp(other);
+		swap(tmp);
+		return *this;
+	}
+	self_type& operator=(self_type&& other) noexcept {
+		swap(other);
+		return *this;
+	}
+
+	// Adds a regex and returns its index. Throws regex_error on failure.
+	size_type add(const regex_type& re);
+	size_type add(const string_type& pattern, flag_type f = regex_constants::normal, OnigEncoding enc = nullptr) {
+		return add(regex_type(pattern, f, enc));
+	}
+
+	size_type size() const { return m_regexes.size(); }
+	bool empty() const { return m_regexes.empty(); }
+	const regex_type& operator[](size_type index) const { return m_regexes[index]; }
+	void clear();
+
+	lead_type lead() const { return m_lead; }
+	void set_lead(lead_type lead) { m_lead = lead; }
+
+	void swap(self_type& other) noexcept {
+		m_regexes.swap(other.m_regexes);
+		std::swap(m_set, other.m_set);
+		std::swap(m_lead, other.m_lead);
+		std::swap(m_prefiltered, other.m_prefiltered);
+		m_prefilter.swap(other.m_prefilter);
+	}
+
+	OnigRegSet* native_handle() const { return m_set; }
+
+	// Whether searches use a literal prefilter, which they do when every
+	// regex of the set has one (see basic_regex::prefilter_active)
+	bool prefilter_active() const noexcept { return m_prefiltered && !m_regexes.empty(); }
+
+protected:
+	std::vector<regex_type> m_regexes;
+	OnigRegSet* m_set;
+	lead_type m_lead;
+	bool m_prefiltered; // Every regex has a prefilter
+	// Literals of all regexes, merged at the first search after an add
+	mutable std::shared_ptr<const _literal_prefilter<CharT>> m_prefilter;
+
+	void _release();
+	const _literal_prefilter<CharT>* _prefilter() const;
+};
+
+using regex_set = basic_regex_set<char>;
+using wregex_set = basic_regex_set<wchar_t>;
+using u16regex_set = basic_regex_set<char16_t>;
+using u32regex_set = basic_regex_set<char32_t>;
+
+////////////////////////////////////////////
+// regex_set_search
+//
+// Searches [first, last) with every regex of the set at once. Returns the
+// index of the regex that matched (and fills m with its groups), or -1 when
+// no regex matched. The match flags mean what they do for regex_search,
+// except that match_not_null skips empty matches rather than failing on
+// them. With match_not_bow or match_not_eow, a set holding a regex that
+// tests word boundaries is searched regex by regex.
+
+template <class BidirIt, class Alloc, class CharT, class Traits>
+int regex_set_search(
+	BidirIt first, BidirIt last,
+	match_results<BidirIt, Alloc>& m,
+	const basic_regex_set<CharT, Traits>& s,
+	regex_constants::match_flag_type flags = regex_constants::match_default);
+
+// std::string overload
+template <class Alloc, class CharT, class Traits>
+inline int regex_set_search(
+	const basic_string<CharT>& str,
+	match_results<typename basic_string<CharT>::const_iterator, Alloc>& m,
+	const basic_regex_set<CharT, Traits>& s,
+	regex_constants::match_flag_type flags = regex_constants::match_default)
+{
+	return regex_set_search(str.begin(), str.end(), m, s, flags);
+}
+
+// C-string overload
+template <class CharT, class Alloc, class Traits>
+inline int regex_set_search(
+	const CharT* str,
+	match_results<const CharT*, Alloc>& m,
+	const basic_regex_set<CharT, Traits>& s,
+	regex_constants::match_flag_type flags = regex_constants::match_default)
+{
+	return regex_set_search(str, str + Traits::length(str), m, s, flags);
+}
+
+////////////////////////////////////////////
+// onigpp::regex_set_iterator
+//
+// Iterates over successive matches of a basic_regex_set. regex_index()
+// tells which regex of the set produced the current match.
+
+template <class BidirIt, class CharT = typename std::iterator_traits<BidirIt>::value_type, class Traits = regex_traits<CharT>>
+class regex_set_iterator {
+public:
+	using iterator_category = std::forward_iterator_tag;
+	using value_type = match_results<BidirIt>;
+	using difference_type = std::ptrdiff_t;
+	using pointer = const value_type*;
+	using reference = const value_type&;
+	using regex_set_type = basic_regex_set<CharT, Traits>;
+	using match_flag_type = regex_constants::match_flag_type;
+	using self_type = regex_set_iterator<BidirIt, CharT, Traits>;
+
+protected:
+	value_type m_results;
+	BidirIt m_begin;
+	BidirIt m_end;
+	const regex_set_type* m_set;
+	match_flag_type m_flags;
+	int m_index;
+
+	void do_search(BidirIt first, BidirIt last);
+
+public:
+	regex_set_iterator() : m_set(nullptr), m_flags(regex_constants::match_default), m_index(-1) {}
+	regex_set_iterator(BidirIt first, BidirIt last,
+	                   const regex_set_type& s,
+	                   match_flag_type flags = regex_constants::match_default);
+
+	reference operator*() const { return m_results; }
+	pointer operator->() const { return &m_results; }
+	int regex_index() const { return m_index; }
+
+	bool operator==(const regex_set_iterator& other) const;
+	bool operator!=(const regex_set_iterator& other) const {
+		return !(*this == other);
+	}
+
+	self_type& operator++();
+	self_type operator++(int);
+};
+
+using cregex_set_iterator = regex_set_iterator<const char*>;
+using wcregex_set_iterator = regex_set_iterator<const wchar_t*>;
+using u16cregex_set_iterator = regex_set_iterator<const char16_t*>;
+using u32cregex_set_iterator = regex_set_iterator<const char32_t*>;
+
+using sregex_set_iterator = regex_set_iterator<string::const_iterator, char>;
+using wsregex_set_iterator = regex_set_iterator<wstring::const_iterator, wchar_t>;
+using u16sregex_set_iterator = regex_set_iterator<u16string::const_iterator, char16_t>;
+using u32sregex_set_iterator = regex_set_iterator<u32string::const_iterator, char32_t>;
+
+////////////////////////////////////////////
+// onigpp::regex_escape
+//
+// Escapes regular expression special/meta-characters in a given string.
+// This function takes a string and returns a new string where all regex
+// meta-characters (. ^ $ * + ? ( ) [ ] { } \ |) are escaped with a backslash.
+// The resulting string can be safely used as a literal pattern in a regex.
+//
+// Example:
+//   Input:  "a+b*c.d?e^f$g|h(i)j[k]{l}\\m"
+//   Output: "a\\+b\\*c\\.d\\?e\\^f\\$g\\|h\\(i\\)j\\[k\\]\\{l\\}\\\\m"
+//
+// Supported character types: char, wchar_t, char16_t, char32_t
+
+template <class CharT>
+basic_string<CharT> regex_escape(const basic_string<CharT>& str);
+
+// Convenience overload for C-string
+template <class CharT>
+basic_string<CharT> regex_escape(const CharT* str);
+
+////////////////////////////////////////////
+// onigpp::regex_literal_union, onigpp::make_literal_regex
+//
+// Builds a pattern that matches any one of a list of literal strings, much
+// smaller and faster than the flat alternation of their regex_escape'd
+// forms. The literals are put into a trie whose identical subtries are
+// merged, so common prefixes become nested groups, common suffixes are
+// written once, and alternatives of one character become a character
+// class:
+//
+//   { "walk", "walked", "talked", "talks" }  ->  (?:talk(?:ed|s)|walk(?:ed)?)
+//   { "cat", "bat", "rat" }                  ->  [bcr]at
+//
+// At a given position the longest matching literal is preferred, and the
+// shorter ones are tried on backtracking, exactly as in the flat
+// alternation of the literals sorted longest first. With icase, ASCII
+// letters are folded before the literals are merged (for a regex compiled
+// with regex_constants::icase); other characters are kept apart with their
+// combining marks and never put into a class, and literals containing ss,
+// st, ff, fi or fl are not merged at all, so case folds that change the
+// length (U+00DF to ss, U+FB01 to fi, U+01F0 to j + U+030C) still apply.
+// char literals are UTF-8 and char16_t literals UTF-16, as are wchar_t
+// literals where wchar_t has 16 bits. The result can be concatenated with
+// other pattern text without a group; an empty list gives (?!), which never
+// matches.
+//
+// Supported character types: char, wchar_t, char16_t, char32_t
+
+template <class CharT>
+basic_string<CharT> regex_literal_union(const std::vector<basic_string<CharT>>& literals, bool icase = false);
+
+// The regex of regex_literal_union(literals) with flags f; icase is taken
+// from f. whole_words puts the union between \b anchors.
+template <class CharT, class Traits = regex_traits<CharT>>
+inline basic_regex<CharT, Traits> make_literal_regex(
+	const std::vector<basic_string<CharT>>& literals,
+	regex_constants::syntax_option_type f = regex_constants::normal,
+	bool whole_words = false,
+	OnigEncoding enc = nullptr)
+{
+	basic_string<CharT> pattern = regex_literal_union(literals, (f & regex_constants::icase) != 0);
+	if (whole_words) {
+		static const CharT boundary[] = { CharT('\\'), CharT('b'), CharT(0) };
+		pattern = boundary + pattern + boundary;
+	}
+	return basic_regex<CharT, Traits>(pattern, f, enc);
+}
+
+} // namespace onigpp
+
+////////////////////////////////////////////
+// Header-only mode
+//
+// With ONIGPP_HEADER_ONLY defined, the implementation is included here:
+// any iterator, allocator or traits type can then be used, and the wrapper
+// layer can be inlined into the callers. The instantiations for the common
+// types are extern template declarations, defined in the one translation
+// unit that also defines ONIGPP_IMPLEMENTATION (the onigpp_header_only
+// library in CMake builds).
+#ifdef ONIGPP_HEADER_ONLY
+	#include "src/onigpp.cpp"
+#endif
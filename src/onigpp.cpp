@@ -2,38 +2,75 @@
 // Author: katahiromz
 // License: BSD-2-Clause
 
+#ifndef ONIGPP_CPP_
+#define ONIGPP_CPP_
+
 #include "../onigpp.h"
 #include <iterator>
 #include <memory>
 #include <cctype>
 #include <type_traits>
+#include <thread>
+#include <atomic>
+#include <fstream>
+#include <cerrno>
+#include <map>
+#include <cstdint>
+
+#if defined(_WIN32)
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+	#define ONIGPP_HAVE_MMAP
+#endif
+
+// In the header-only mode, onigpp.h includes this file: the non-template
+// functions are inline, and the explicit instantiations for the common types
+// are extern template declarations except in the one translation unit that
+// defines ONIGPP_IMPLEMENTATION.
+#ifdef ONIGPP_HEADER_ONLY
+	#define ONIGPP_INLINE inline
+	#ifdef ONIGPP_IMPLEMENTATION
+		#define ONIGPP_INSTANTIATE template
+	#else
+		#define ONIGPP_INSTANTIATE extern template
+	#endif
+#else
+	#define ONIGPP_INLINE
+	#define ONIGPP_INSTANTIATE template
+#endif
 
 namespace onigpp {
 
 ////////////////////////////////////////////
 // Implementation helpers
 
-// Helper templates for POSIX class expansion with SFINAE
-// Only enabled for char and wchar_t where std::ctype is available
+// Code point ranges of the POSIX classes ([:digit:], [:alpha:], ...) under one locale.
+// Tables are built once per process and locale, then shared by every collate regex.
+struct _posix_class_table {
+	enum { class_count = 11 };
+	typedef std::pair<char32_t, char32_t> range;
+	std::vector<range> ranges[class_count];
 
-// Primary template - returns pattern unchanged for unsupported types
-template <class CharT, class Enable = void>
-struct _posix_class_expander {
-	typedef std::basic_string<CharT> string_type;
-	static string_type expand(const std::locale& loc, const string_type& pattern) {
-		// For char16_t, char32_t, etc. - no locale support, return unchanged
-		return pattern;
-	}
+	// Narrow tables classify the bytes 0-255 with std::ctype<char>; wide tables
+	// classify U+0000-U+FFFF (surrogates excluded) with std::ctype<wchar_t>
+	static std::shared_ptr<const _posix_class_table> get(const std::locale& loc, bool narrow);
 };
 
-// Specialization for char and wchar_t where std::ctype is available
+// Expands POSIX classes in bracket expressions using the imbued locale.
+// char uses the narrow table; wchar_t, char16_t and char32_t use the wide one.
 template <class CharT>
-struct _posix_class_expander<CharT,
-	typename std::enable_if<
-		std::is_same<CharT, char>::value || std::is_same<CharT, wchar_t>::value
-	>::type>
-{
-	typedef std::basic_string<CharT> string_type;
+struct _posix_class_expander {
+	typedef _scratch_string<CharT> string_type;
 	static string_type expand(const std::locale& loc, const string_type& pattern);
 };
 
@@ -41,39 +78,61 @@ struct _posix_class_expander<CharT,
 template <class CharT, class Traits>
 struct _regex_access : public basic_regex<CharT, Traits> {
 	static OnigRegex get(const basic_regex<CharT, Traits>& re) {
-		return static_cast<const _regex_access<CharT, Traits>&>(re).m_regex;
+		return static_cast<const _regex_access<CharT, Traits>&>(re)._regex();
+	}
+	static const _regex_program<CharT, Traits>* get_program(const basic_regex<CharT, Traits>& re) {
+		return static_cast<const _regex_access<CharT, Traits>&>(re).m_program.get();
 	}
 	static OnigEncoding get_encoding(const basic_regex<CharT, Traits>& re) {
-		return static_cast<const _regex_access<CharT, Traits>&>(re).m_encoding;
+		return static_cast<const _regex_access<CharT, Traits>&>(re)._encoding();
 	}
 	static regex_constants::syntax_option_type get_flags(const basic_regex<CharT, Traits>& re) {
 		return static_cast<const _regex_access<CharT, Traits>&>(re).m_flags;
 	}
+	// Compile a regex with the given locale already in place (single compilation)
+	static basic_regex<CharT, Traits> compile(const typename Traits::string_type& pattern,
+	                                          regex_constants::syntax_option_type f,
+	                                          OnigEncoding enc, const std::locale& loc) {
+		_regex_access re;
+		re.m_flags = f;
+		re.m_locale = loc;
+		re._compile(pattern, enc);
+		return re;
+	}
 };
 
-// Helper trait to detect contiguous iterators (for optimization)
-// In C++11, we conservatively detect only pointer types as contiguous
-// This avoids complexity while still optimizing the most common case
-
-// Primary template - assume non-contiguous
-template <typename Iter>
-struct _is_contiguous_iterator : std::false_type {};
-
-// Specialization for pointer types (always contiguous)
-template <typename T>
-struct _is_contiguous_iterator<T*> : std::true_type {};
+// Accessor for basic_regex_set internals
+template <class CharT, class Traits>
+struct _regex_set_access : public basic_regex_set<CharT, Traits> {
+	static const _literal_prefilter<CharT>* get_prefilter(const basic_regex_set<CharT, Traits>& s) {
+		return static_cast<const _regex_set_access<CharT, Traits>&>(s)._prefilter();
+	}
+};
 
-template <typename T>
-struct _is_contiguous_iterator<const T*> : std::true_type {};
+// Returns a pointer to the characters of [first, last), copying them into buf
+// when the iterators are not contiguous. Never returns nullptr. With
+// prev_avail (match_prev_avail), the character before first is readable at
+// the pointer minus one.
+template <class CharT, class BidirIt, class Buffer>
+typename std::enable_if<_is_contiguous_iterator<BidirIt>::value, const CharT*>::type
+_contiguous_subject(BidirIt first, BidirIt, size_type len, Buffer&,
+                    bool prev_avail = false) {
+	static thread_local CharT empty_char = CharT();
+	if (prev_avail) return _get_contiguous_pointer(std::prev(first)) + 1;
+	return (len > 0) ? _get_contiguous_pointer(first) : &empty_char;
+}
 
-// Helper function to get pointer from contiguous iterator (enabled only for pointer types)
-template <typename Iter>
-typename std::enable_if<
-	_is_contiguous_iterator<Iter>::value,
-	Iter
->::type
-_get_contiguous_pointer(Iter it) {
-	return it;  // For pointers, just return the pointer itself
+template <class CharT, class BidirIt, class Buffer>
+typename std::enable_if<!_is_contiguous_iterator<BidirIt>::value, const CharT*>::type
+_contiguous_subject(BidirIt first, BidirIt last, size_type, Buffer& buf,
+                    bool prev_avail = false) {
+	if (prev_avail) {
+		buf.assign(1, *std::prev(first));
+		buf.append(first, last);
+		return buf.c_str() + 1;
+	}
+	buf.assign(first, last);
+	return buf.c_str();
 }
 
 // Helper template function specializations for C++11 compatibility
@@ -85,12 +144,12 @@ OnigEncoding _get_default_encoding_from_char_type_impl();
 // and char32_t should be used.
 
 template <>
-OnigEncoding _get_default_encoding_from_char_type_impl<char>() {
+ONIGPP_INLINE OnigEncoding _get_default_encoding_from_char_type_impl<char>() {
 	return ONIG_ENCODING_UTF8; // Default is UTF-8
 }
 
 template <>
-OnigEncoding _get_default_encoding_from_char_type_impl<wchar_t>() {
+ONIGPP_INLINE OnigEncoding _get_default_encoding_from_char_type_impl<wchar_t>() {
 	// Use UTF-16 or UTF-32 depending on wchar_t size and endianness
 	if (sizeof(wchar_t) == 2) {
 		#if defined(_WIN32) || defined(__LITTLE_ENDIAN__) || \
@@ -111,7 +170,7 @@ OnigEncoding _get_default_encoding_from_char_type_impl<wchar_t>() {
 }
 
 template <>
-OnigEncoding _get_default_encoding_from_char_type_impl<char16_t>() {
+ONIGPP_INLINE OnigEncoding _get_default_encoding_from_char_type_impl<char16_t>() {
 	#if defined(_WIN32) || defined(__LITTLE_ENDIAN__) || \
 		(defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
 	return ONIG_ENCODING_UTF16_LE;
@@ -121,7 +180,7 @@ OnigEncoding _get_default_encoding_from_char_type_impl<char16_t>() {
 }
 
 template <>
-OnigEncoding _get_default_encoding_from_char_type_impl<char32_t>() {
+ONIGPP_INLINE OnigEncoding _get_default_encoding_from_char_type_impl<char32_t>() {
 	#if defined(_WIN32) || defined(__LITTLE_ENDIAN__) || \
 		(defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
 	return ONIG_ENCODING_UTF32_LE;
@@ -161,17 +220,244 @@ inline void _adjust_region_offsets_prefix(OnigRegion* region, size_type prefix_l
 	}
 }
 
+// Per-thread OnigRegion scratch storage.
+// onig_search() and onig_match() resize the region to the number of groups
+// and keep the allocation when it is reused, so borrowing one region per
+// thread removes the allocate/free pair from every search. A nested borrow
+// on the same thread (the scratch is already taken) gets a fresh region.
+class _region_scratch {
+public:
+	_region_scratch() {
+		_pool& pool = _get_pool();
+		if (!pool.in_use) {
+			pool.in_use = true;
+			m_region = &pool.region;
+			m_pooled = true;
+		} else {
+			m_region = onig_region_new();
+			if (!m_region) throw std::bad_alloc();
+			m_pooled = false;
+		}
+	}
+	~_region_scratch() {
+		if (m_pooled)
+			_get_pool().in_use = false;
+		else
+			onig_region_free(m_region, 1);
+	}
+	OnigRegion* get() const { return m_region; }
+
+private:
+	struct _pool {
+		OnigRegion region;
+		bool in_use;
+		_pool() : in_use(false) { onig_region_init(&region); }
+		~_pool() { onig_region_free(&region, 0); }
+	};
+	static _pool& _get_pool() {
+		static thread_local _pool pool;
+		return pool;
+	}
+
+	OnigRegion* m_region;
+	bool m_pooled;
+
+	_region_scratch(const _region_scratch&) = delete;
+	_region_scratch& operator=(const _region_scratch&) = delete;
+};
+
+// Per-thread OnigMatchParam for searches with match_limits.
+// It is reinitialized before every use.
+inline OnigMatchParam* _match_param_scratch() {
+	struct _holder {
+		OnigMatchParam* param;
+		_holder() : param(onig_new_match_param()) { }
+		~_holder() { if (param) onig_free_match_param(param); }
+	};
+	static thread_local _holder holder;
+	if (!holder.param) throw std::bad_alloc();
+	return holder.param;
+}
+
+// Runs one Oniguruma search or match, run(mp), under the given limits.
+// run(nullptr) must call the plain function (no limits); otherwise run must
+// pass mp to the *_with_param function. Throws regex_error with
+// error_deadline when the deadline passes or can no longer be met.
+template <class Run>
+int _run_with_limits(const match_limits& limits, Run run) {
+	if (limits.empty()) return run(static_cast<OnigMatchParam*>(nullptr));
+
+	using clock = match_limits::clock;
+	clock::time_point deadline = limits.deadline;
+	if (limits.timeout != clock::duration::zero()) {
+		clock::time_point t = clock::now() + limits.timeout;
+		if (deadline == clock::time_point() || t < deadline) deadline = t;
+	}
+
+	OnigMatchParam* mp = _match_param_scratch();
+	onig_initialize_match_param(mp);
+	if (limits.retry_limit_in_match)
+		onig_set_retry_limit_in_match_of_match_param(mp, limits.retry_limit_in_match);
+
+	if (deadline == clock::time_point()) {
+		if (limits.retry_limit_in_search)
+			onig_set_retry_limit_in_search_of_match_param(mp, limits.retry_limit_in_search);
+		return run(mp);
+	}
+
+	// Oniguruma can not be interrupted, so the search runs with a retry
+	// budget in search and is restarted with a larger budget each time the
+	// budget runs out before the deadline. The budget grows no further than
+	// the remaining time allows at the rate measured so far.
+	const unsigned long max_slice = std::numeric_limits<unsigned long>::max() / 2;
+	unsigned long slice = 1UL << 16;
+	for (;;) {
+		clock::time_point before = clock::now();
+		if (before >= deadline)
+			throw regex_error(regex_constants::error_deadline, "search deadline exceeded");
+
+		bool user_limit = limits.retry_limit_in_search && limits.retry_limit_in_search <= slice;
+		unsigned long budget = user_limit ? limits.retry_limit_in_search : slice;
+		onig_set_retry_limit_in_search_of_match_param(mp, budget);
+		int r = run(mp);
+		if (r != ONIGERR_RETRY_LIMIT_IN_SEARCH_OVER || user_limit) return r;
+
+		clock::time_point after = clock::now();
+		if (after >= deadline)
+			throw regex_error(regex_constants::error_deadline, "search deadline exceeded");
+
+		unsigned long next = (budget < max_slice) ? budget * 2 : budget;
+		clock::duration spent = after - before;
+		if (spent > clock::duration::zero()) {
+			double affordable = static_cast<double>(budget) *
+				static_cast<double>((deadline - after).count()) / static_cast<double>(spent.count());
+			// The restarted search needs more than budget retries
+			if (affordable <= static_cast<double>(budget))
+				throw regex_error(regex_constants::error_deadline, "search deadline exceeded");
+			if (affordable < static_cast<double>(next)) next = static_cast<unsigned long>(affordable);
+		}
+		slice = next;
+	}
+}
+
+// Raises Oniguruma's retry limit errors as error_retry_limit
+inline int _check_retry_limit(int r) {
+	if (r == ONIGERR_RETRY_LIMIT_IN_MATCH_OVER)
+		throw regex_error(regex_constants::error_retry_limit, "retry-limit-in-match over");
+	if (r == ONIGERR_RETRY_LIMIT_IN_SEARCH_OVER)
+		throw regex_error(regex_constants::error_retry_limit, "retry-limit-in-search over");
+	return r;
+}
+
+inline int _onig_search_limited(
+	OnigRegex reg, const OnigUChar* str, const OnigUChar* end, const OnigUChar* start, const OnigUChar* range,
+	OnigRegion* region, OnigOptionType options, const match_limits& limits)
+{
+	return _check_retry_limit(_run_with_limits(limits, [&](OnigMatchParam* mp) {
+		return mp ? onig_search_with_param(reg, str, end, start, range, region, options, mp)
+		          : onig_search(reg, str, end, start, range, region, options);
+	}));
+}
+
+inline int _onig_match_limited(
+	OnigRegex reg, const OnigUChar* str, const OnigUChar* end, const OnigUChar* at,
+	OnigRegion* region, OnigOptionType options, const match_limits& limits)
+{
+	return _check_retry_limit(_run_with_limits(limits, [&](OnigMatchParam* mp) {
+		return mp ? onig_match_with_param(reg, str, end, at, region, options, mp)
+		          : onig_match(reg, str, end, at, region, options);
+	}));
+}
+
+// Process-wide instrumentation state (regex_stats and the slow search hook)
+struct _instrumentation {
+	enum { stats_bit = 1, hook_bit = 2 };
+
+	std::atomic<unsigned> active;  // stats_bit | hook_bit
+	std::atomic<long long> threshold; // Slow search threshold in nanoseconds
+	std::mutex mutex; // Guards hook
+	std::shared_ptr<const slow_search_hook> hook;
+
+	_instrumentation() : active(0), threshold(0) { }
+
+	static _instrumentation& get() {
+		static _instrumentation instance;
+		return instance;
+	}
+};
+
+// Measures one search or match for regex_stats and the slow search hook.
+// While instrumentation is off it only loads the active bits.
+template <class CharT, class Traits>
+class _search_probe {
+public:
+	_search_probe(const basic_regex<CharT, Traits>& e, bool match, size_type bytes_scanned)
+		: m_active(_instrumentation::get().active.load(std::memory_order_relaxed)),
+		  m_regex(e), m_match(match), m_bytes(bytes_scanned)
+	{
+		if (m_active) m_start = std::chrono::steady_clock::now();
+	}
+
+	// Records the search or match (not called when it throws)
+	void finish() {
+		if (!m_active) return;
+		unsigned long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - m_start).count();
+		const _regex_program<CharT, Traits>* program = _regex_access<CharT, Traits>::get_program(m_regex);
+		if (!program) return;
+
+		if (m_active & _instrumentation::stats_bit) {
+			_regex_counters& c = program->counters;
+			(m_match ? c.matches : c.searches).fetch_add(1, std::memory_order_relaxed);
+			c.bytes_scanned.fetch_add(m_bytes, std::memory_order_relaxed);
+			c.total_time.fetch_add(ns, std::memory_order_relaxed);
+			unsigned long long prev = c.max_time.load(std::memory_order_relaxed);
+			while (prev < ns && !c.max_time.compare_exchange_weak(prev, ns, std::memory_order_relaxed)) { }
+		}
+
+		_instrumentation& inst = _instrumentation::get();
+		if ((m_active & _instrumentation::hook_bit) &&
+		    static_cast<long long>(ns) >= inst.threshold.load(std::memory_order_relaxed)) {
+			std::shared_ptr<const slow_search_hook> hook;
+			{
+				std::lock_guard<std::mutex> lock(inst.mutex);
+				hook = inst.hook;
+			}
+			if (hook) {
+				slow_search_event event;
+				event.regex = &m_regex;
+				event.pattern = program->pattern.data();
+				event.pattern_length = program->pattern.size();
+				event.char_size = sizeof(CharT);
+				event.encoding = program->encoding;
+				event.bytes_scanned = m_bytes;
+				event.match = m_match;
+				event.elapsed = std::chrono::nanoseconds(ns);
+				(*hook)(event);
+			}
+		}
+	}
+
+private:
+	unsigned m_active;
+	const basic_regex<CharT, Traits>& m_regex;
+	bool m_match;
+	size_type m_bytes;
+	std::chrono::steady_clock::time_point m_start;
+};
+
 // Helper function to process OnigRegion result and populate match_results.
 // This consolidates the duplicated OnigRegion post-processing logic from
 // contiguous and non-contiguous iterator implementations.
 // Parameters:
 //   r: Oniguruma result code (>= 0 for match, ONIG_MISMATCH for no match, < 0 for error)
-//   region: OnigRegion containing match positions (will be freed by this function)
+//   region: OnigRegion containing match positions (owned by the caller)
 //   whole_first: iterator pointing to the beginning of the entire subject string
 //   last: iterator pointing past the end of the subject string
 //   m: match_results to populate
 //   regex_flags: flags from the regex object
 //   flags: match-time flags
+//   captures: the groups to store; the others are reported as unmatched
 // Returns: true if matched, false if no match, throws regex_error on error
 template <class BidirIt, class Alloc, class CharT, class Traits>
 bool _process_onig_region_result(
@@ -181,13 +467,13 @@ bool _process_onig_region_result(
 	BidirIt last,
 	match_results<BidirIt, Alloc>& m,
 	regex_constants::syntax_option_type regex_flags,
-	regex_constants::match_flag_type flags)
+	regex_constants::match_flag_type flags,
+	const capture_mask& captures = capture_mask())
 {
 	if (r >= 0) {
 		if (flags & regex_constants::match_not_null) {
 			// If match length is zero, treat it as a match failure
 			if (region->beg[0] == region->end[0]) {
-				onig_region_free(region, 1);
 				m.m_ready = true; // Mark as ready even on failure
 				return false; // Equivalent to ONIG_MISMATCH
 			}
@@ -227,7 +513,6 @@ bool _process_onig_region_result(
 				m[0].matched = false;
 			}
 
-			onig_region_free(region, 1);
 			return true;
 		}
 
@@ -237,7 +522,7 @@ bool _process_onig_region_result(
 			int beg = region->beg[i];
 			int end = region->end[i];
 
-			if (beg != ONIG_REGION_NOTPOS) {
+			if (beg != ONIG_REGION_NOTPOS && captures.contains(i)) {
 				int beg_chars = beg / sizeof(CharT);
 				int end_chars = end / sizeof(CharT);
 
@@ -257,17 +542,14 @@ bool _process_onig_region_result(
 			}
 		}
 
-		onig_region_free(region, 1);
 		return true;
 	}
 	else if (r == ONIG_MISMATCH) {
-		onig_region_free(region, 1);
 		m.m_ready = true; // Mark as ready even when no match found
 		return false;
 	}
 	else {
 		// On error
-		onig_region_free(region, 1);
 		OnigErrorInfo einfo;
 		std::memset(&einfo, 0, sizeof(einfo));
 		throw regex_error(regex_constants::map_oniguruma_error(r), einfo);
@@ -280,13 +562,14 @@ bool _process_onig_region_result(
 // the match must cover the entire input string (from first to last).
 // Parameters:
 //   r: Oniguruma result code (>= 0 for match, ONIG_MISMATCH for no match, < 0 for error)
-//   region: OnigRegion containing match positions (will be freed by this function)
+//   region: OnigRegion containing match positions (owned by the caller)
 //   first: iterator pointing to the beginning of the subject string
 //   last: iterator pointing past the end of the subject string
 //   m: match_results to populate
 //   regex_flags: flags from the regex object
 //   flags: match-time flags
 //   len: length of the subject string (in characters)
+//   captures: the groups to store; the others are reported as unmatched
 // Returns: true if full match, false if no match or partial match, throws regex_error on error
 template <class BidirIt, class Alloc, class CharT, class Traits>
 bool _onig_region_to_match_results(
@@ -297,14 +580,14 @@ bool _onig_region_to_match_results(
 	match_results<BidirIt, Alloc>& m,
 	regex_constants::syntax_option_type regex_flags,
 	regex_constants::match_flag_type flags,
-	size_type len)
+	size_type len,
+	const capture_mask& captures = capture_mask())
 {
 	if (r >= 0) {
 		// regex_match requires full match with the entire string
 		// Check if the match end position matches the string end
 		// region->end[0] is in bytes, so convert to characters for comparison
 		if (region->end[0] != (int)(len * sizeof(CharT))) {
-			onig_region_free(region, 1);
 			m.m_ready = true; // Mark as ready even on partial match failure
 			return false;
 		}
@@ -312,7 +595,6 @@ bool _onig_region_to_match_results(
 		if (flags & regex_constants::match_not_null) {
 			// If match length is zero, treat it as a match failure
 			if (region->beg[0] == region->end[0]) {
-				onig_region_free(region, 1);
 				m.m_ready = true; // Mark as ready even on failure
 				return false;
 			}
@@ -352,7 +634,6 @@ bool _onig_region_to_match_results(
 				m[0].matched = false;
 			}
 
-			onig_region_free(region, 1);
 			return true;
 		}
 
@@ -362,7 +643,7 @@ bool _onig_region_to_match_results(
 			int beg = region->beg[i];
 			int end = region->end[i];
 
-			if (beg != ONIG_REGION_NOTPOS) {
+			if (beg != ONIG_REGION_NOTPOS && captures.contains(i)) {
 				// Oniguruma returns byte offsets, convert to character offsets
 				int beg_chars = beg / sizeof(CharT);
 				int end_chars = end / sizeof(CharT);
@@ -383,114 +664,580 @@ bool _onig_region_to_match_results(
 			}
 		}
 
-		onig_region_free(region, 1);
 		return true;
 	}
 	else if (r == ONIG_MISMATCH) {
-		onig_region_free(region, 1);
 		m.m_ready = true; // Mark as ready even when no match found
 		return false;
 	}
 	else {
 		// On error
-		onig_region_free(region, 1);
 		OnigErrorInfo einfo;
 		std::memset(&einfo, 0, sizeof(einfo));
 		throw regex_error(regex_constants::map_oniguruma_error(r), einfo);
 	}
 }
 
-// Internal implementation for non-contiguous iterators (uses buffer copy)
-template <class BidirIt, class Alloc, class CharT, class Traits>
-typename std::enable_if<
-	!_is_contiguous_iterator<BidirIt>::value,
-	bool
->::type
-_regex_search_with_context_impl(
-	BidirIt whole_first, BidirIt search_start, BidirIt last,
-	match_results<BidirIt, Alloc>& m,
-	const basic_regex<CharT, Traits>& e,
-	regex_constants::match_flag_type flags,
-	OnigRegex reg,
-	OnigOptionType onig_options,
-	size_type total_len,
-	size_type search_offset)
+////////////////////////////////////////////
+// onigpp::_literal_prefilter<CharT>
+
+// Low 8 bits of a code unit for the bitmaps (wider units are folded)
+template <class CharT>
+inline unsigned _prefilter_byte(CharT c) {
+	const unsigned long u = static_cast<unsigned long>(static_cast<typename std::make_unsigned<CharT>::type>(c));
+	return static_cast<unsigned>((sizeof(CharT) == 1) ? u : (u ^ (u >> 8) ^ (u >> 16))) & 0xFF;
+}
+
+template <class CharT>
+inline unsigned _prefilter_pair(CharT a, CharT b) {
+	return (_prefilter_byte(a) << 8) | _prefilter_byte(b);
+}
+
+template <class CharT>
+_literal_prefilter<CharT>::_literal_prefilter(std::vector<std::basic_string<CharT>> prefixes)
+	: literals(std::move(prefixes)), min_length(npos), single_lead(true), lead(), firsts(), counters(nullptr)
 {
-	// Handle match_not_bow and match_not_eow by prepending/appending word characters
-	// to affect word boundary detection. A word character (like 'a') before the string
-	// prevents \b from matching as beginning-of-word at position 0.
-	// Similarly, a word character after the string prevents \b from matching as end-of-word.
-	bool needs_bow_prefix = (flags & regex_constants::match_not_bow) && (search_offset == 0);
-	bool needs_eow_suffix = (flags & regex_constants::match_not_eow);
-	bool use_match_instead = (flags & regex_constants::match_continuous);
+	for (const std::basic_string<CharT>& literal : literals)
+		min_length = std::min(min_length, literal.size());
+
+	lead = literals.front()[0];
+	for (const std::basic_string<CharT>& literal : literals) {
+		const unsigned first = _prefilter_byte(literal[0]);
+		firsts[first >> 6] |= 1ULL << (first & 63);
+		if (literal[0] != lead) single_lead = false;
+	}
+	if (min_length >= 2) {
+		pairs.assign(65536 / 64, 0);
+		for (const std::basic_string<CharT>& literal : literals) {
+			const unsigned pair = _prefilter_pair(literal[0], literal[1]);
+			pairs[pair >> 6] |= 1ULL << (pair & 63);
+		}
+	}
+}
 
-	// Copy the subject range into a temporary contiguous buffer to support
-	// non-contiguous BidirectionalIterators (e.g., std::list, std::deque)
-	std::basic_string<CharT> subject_buf;
-	size_type prefix_len = 0;
+template <class CharT>
+size_type _literal_prefilter<CharT>::next(const CharT* s, size_type from, size_type len) const {
+	if (len < min_length) return npos;
+	const size_type last = len - min_length; // The last position a literal fits at
+
+	if (single_lead) {
+		// memchr for the common first code unit, then the pair bitmap
+		for (size_type i = from; i <= last; ++i) {
+			const CharT* hit = std::char_traits<CharT>::find(s + i, last - i + 1, lead);
+			if (!hit) return npos;
+			i = static_cast<size_type>(hit - s);
+			if (pairs.empty()) return i;
+			const unsigned pair = _prefilter_pair(s[i], s[i + 1]);
+			if (pairs[pair >> 6] & (1ULL << (pair & 63))) return i;
+		}
+		return npos;
+	}
+
+	for (size_type i = from; i <= last; ++i) {
+		const unsigned first = _prefilter_byte(s[i]);
+		if (!(firsts[first >> 6] & (1ULL << (first & 63)))) continue;
+		if (pairs.empty()) return i;
+		const unsigned pair = _prefilter_pair(s[i], s[i + 1]);
+		if (pairs[pair >> 6] & (1ULL << (pair & 63))) return i;
+	}
+	return npos;
+}
+
+// Finds the literals one of which every match of a pattern in Oniguruma
+// syntax begins with: the literal prefix of each top-level branch, looking
+// into a leading group. Conservative: a branch that may begin with anything
+// else (a class, an escape other than a quoted character, an optional group,
+// an option group) makes parse() fail, and the pattern gets no prefilter.
+template <class CharT>
+class _literal_prefix_parser {
+public:
+	typedef std::basic_string<CharT> literal_type;
+
+	_literal_prefix_parser(const CharT* p, size_type len) : m_p(p), m_len(len), m_pos(0) { }
 
-	if (needs_bow_prefix) {
-		// Prepend a word character to prevent BOW matching at position 0
-		subject_buf += CharT('a');
-		prefix_len = 1;
+	bool parse(std::vector<literal_type>& literals) {
+		return alternation(literals, 0) && m_pos == m_len;
 	}
-	subject_buf.append(whole_first, last);
-	if (needs_eow_suffix) {
-		// Append a word character to prevent EOW matching at end
-		subject_buf += CharT('a');
+
+private:
+	const CharT* m_p;
+	size_type m_len;
+	size_type m_pos;
+
+	CharT peek(size_type k = 0) const { return (m_pos + k < m_len) ? m_p[m_pos + k] : CharT(0); }
+	bool at(char c) const { return m_pos < m_len && m_p[m_pos] == CharT(c); }
+
+	static unsigned long unit_value(CharT c) {
+		return static_cast<unsigned long>(static_cast<typename std::make_unsigned<CharT>::type>(c));
 	}
 
-	// Adjust total length and offsets for the modified buffer
-	size_type buf_total_len = subject_buf.size();
-	size_type buf_search_offset = search_offset + prefix_len;
+	static bool ascii_alnum(CharT c) {
+		return (c >= CharT('0') && c <= CharT('9')) || (c >= CharT('a') && c <= CharT('z')) ||
+		       (c >= CharT('A') && c <= CharT('Z'));
+	}
 
-	// Use stable static buffer for empty ranges to avoid passing nullptr to C API
-	static thread_local CharT empty_char = CharT();
-	const CharT* whole_begin_ptr = (buf_total_len > 0) ? subject_buf.c_str() : &empty_char;
-	const CharT* end_ptr = whole_begin_ptr + (total_len + prefix_len); // Original end + prefix (exclude suffix for matching)
-	const CharT* start_ptr = whole_begin_ptr + buf_search_offset;
+	// Removes the last character (all of its code units) of a prefix
+	static void drop_last_char(literal_type& prefix) {
+		while (!prefix.empty()) {
+			const unsigned long u = unit_value(prefix.back());
+			prefix.pop_back();
+			const bool trail = (sizeof(CharT) == 1) ? ((u & 0xC0) == 0x80)
+			                 : (sizeof(CharT) == 2) ? (u >= 0xDC00 && u <= 0xDFFF) : false;
+			if (!trail) break;
+		}
+	}
 
-	// For match_not_eow, we still need to pass the extended end for context,
-	// but the actual match should not extend beyond the original string end
-	const CharT* context_end_ptr = whole_begin_ptr + buf_total_len;
+	// Branches separated by '|', up to ')' or the end of the pattern
+	bool alternation(std::vector<literal_type>& literals, unsigned depth) {
+		if (depth > 16) return false;
+		for (;;) {
+			if (!branch(literals, depth)) return false;
+			if (!at('|')) return true;
+			++m_pos;
+		}
+	}
 
-	const OnigUChar* u_start = reinterpret_cast<const OnigUChar*>(whole_begin_ptr);
-	const OnigUChar* u_end   = reinterpret_cast<const OnigUChar*>(needs_eow_suffix ? context_end_ptr : end_ptr);
-	const OnigUChar* u_search_start = reinterpret_cast<const OnigUChar*>(start_ptr);
-	const OnigUChar* u_range = u_end;
+	bool branch(std::vector<literal_type>& literals, unsigned depth) {
+		literal_type prefix;
+		bool collecting = true; // Still in the literal prefix
+		bool grouped = false;   // The literals came from a leading group
+		while (m_pos < m_len && !at('|') && !at(')')) {
+			if (!collecting) {
+				if (!skip_atom()) return false;
+				continue;
+			}
+
+			const CharT c = peek();
+			CharT unit;
+			if (c == CharT('\\')) {
+				if (m_pos + 1 >= m_len) return false;
+				const CharT n = peek(1);
+				if ((n == CharT('b') || n == CharT('B') || n == CharT('A')) && prefix.empty()) {
+					m_pos += 2; // Zero-width
+					continue;
+				}
+				if (n == CharT('t')) unit = CharT('\t');
+				else if (n == CharT('n')) unit = CharT('\n');
+				else if (n == CharT('r')) unit = CharT('\r');
+				else if (n == CharT('f')) unit = CharT('\f');
+				else if (n == CharT('v')) unit = CharT('\v');
+				else if (unit_value(n) < 0x80 && unit_value(n) > 0x20 && !ascii_alnum(n) &&
+				         n != CharT('<') && n != CharT('>')) unit = n;
+				else {
+					collecting = false;
+					continue;
+				}
+				m_pos += 2;
+			} else if (c == CharT('^') && prefix.empty()) {
+				++m_pos;
+				continue;
+			} else if (c == CharT('(')) {
+				if (peek(1) == CharT('?') && peek(2) == CharT('#')) {
+					if (!skip_atom()) return false; // Comment
+					continue;
+				}
+				if (!prefix.empty()) {
+					collecting = false;
+					continue;
+				}
+				if (!group(literals, depth)) return false;
+				grouped = true;
+				collecting = false;
+				continue;
+			} else if (c == CharT('.') || c == CharT('[') || c == CharT('$') || c == CharT('?') ||
+			           c == CharT('*') || c == CharT('+') || c == CharT('{') || c == CharT('}') ||
+			           c == CharT(']')) {
+				collecting = false;
+				continue;
+			} else {
+				unit = c;
+				++m_pos;
+			}
+
+			prefix += unit;
+			// A quantifier makes the character optional or ends the prefix
+			if (optional_quantifier()) {
+				drop_last_char(prefix);
+				collecting = false;
+			} else if (at('+')) {
+				collecting = false;
+			}
+		}
+		if (grouped) return true;
+		if (prefix.empty()) return false;
+		literals.push_back(prefix);
+		return true;
+	}
+
+	// A leading (...), (?:...) or (?<name>...) group that must occur once
+	bool group(std::vector<literal_type>& literals, unsigned depth) {
+		++m_pos;
+		if (at('?')) {
+			if (peek(1) == CharT(':')) {
+				m_pos += 2;
+			} else if (peek(1) == CharT('<') && peek(2) != CharT('=') && peek(2) != CharT('!')) {
+				while (m_pos < m_len && !at('>')) ++m_pos;
+				if (m_pos == m_len) return false;
+				++m_pos;
+			} else {
+				return false;
+			}
+		}
+		if (!alternation(literals, depth + 1) || !at(')')) return false;
+		++m_pos;
+		return !optional_quantifier();
+	}
+
+	static bool quantifier(CharT c) {
+		return c == CharT('?') || c == CharT('*') || c == CharT('+') || c == CharT('{');
+	}
+
+	// Whether the quantifiers at the current position let the preceding atom
+	// occur zero times. Oniguruma accepts stacked quantifiers (x+*, c+??,
+	// (?:ab)+*): after a + and its lazy or possessive modifier, any further
+	// quantifier makes the atom optional too.
+	bool optional_quantifier() const {
+		if (m_pos >= m_len) return false;
+		if (!at('+')) return quantifier(peek());
+		size_type k = 1;
+		if (peek(k) == CharT('?') || peek(k) == CharT('+')) ++k;
+		return m_pos + k < m_len && quantifier(peek(k));
+	}
+
+	// Skips one element after the literal prefix
+	bool skip_atom() {
+		const CharT c = peek();
+		if (c == CharT('\\')) {
+			if (m_pos + 1 >= m_len) return false;
+			m_pos += 2;
+			return true;
+		}
+		if (c == CharT('[')) return skip_bracket();
+		if (c == CharT('(')) {
+			if (peek(1) == CharT('?')) {
+				const CharT k = peek(2);
+				if (k == CharT('#')) {
+					while (m_pos < m_len && !at(')')) ++m_pos;
+					if (m_pos == m_len) return false;
+					++m_pos;
+					return true;
+				}
+				// Option groups may change the syntax (x) of what follows
+				if ((k >= CharT('a') && k <= CharT('z')) || (k >= CharT('A') && k <= CharT('Z')) ||
+				    k == CharT('-') || k == CharT('^'))
+					return false;
+			}
+			++m_pos;
+			while (!at(')')) {
+				if (m_pos >= m_len) return false;
+				if (at('|')) ++m_pos;
+				else if (!skip_atom()) return false;
+			}
+			++m_pos;
+			return true;
+		}
+		++m_pos;
+		return true;
+	}
+
+	bool skip_bracket() {
+		++m_pos;
+		if (at('^')) ++m_pos;
+		if (at(']')) ++m_pos;
+		while (m_pos < m_len) {
+			const CharT c = peek();
+			if (c == CharT('\\')) {
+				m_pos += 2;
+			} else if (c == CharT('[')) {
+				if (peek(1) == CharT(':')) {
+					m_pos += 2;
+					while (m_pos + 1 < m_len && !(at(':') && peek(1) == CharT(']'))) ++m_pos;
+					m_pos += 2;
+				} else if (!skip_bracket()) {
+					return false;
+				}
+			} else if (c == CharT(']')) {
+				++m_pos;
+				return true;
+			} else {
+				++m_pos;
+			}
+		}
+		return false;
+	}
+};
+
+// The prefilter of a preprocessed pattern, or nullptr when it has none. The
+// code units must be the encoding's units: UTF-8 or ASCII for char, and
+// UTF-16 or UTF-32 of the same width for the wider types.
+template <class CharT>
+std::shared_ptr<_literal_prefilter<CharT>> _build_literal_prefilter(const _scratch_string<CharT>& pattern,
+                                                                    OnigEncoding encoding)
+{
+	if (sizeof(CharT) == 1 ? (encoding != ONIG_ENCODING_UTF8 && encoding != ONIG_ENCODING_ASCII)
+	                       : (ONIGENC_MBC_MINLEN(encoding) != static_cast<int>(sizeof(CharT))))
+		return nullptr;
+
+	std::vector<std::basic_string<CharT>> literals;
+	_literal_prefix_parser<CharT> parser(pattern.data(), pattern.size());
+	if (!parser.parse(literals) || literals.empty()) return nullptr;
+	return std::make_shared<_literal_prefilter<CharT>>(std::move(literals));
+}
+
+// The prefilter of e's program, or nullptr
+template <class CharT, class Traits>
+inline const _literal_prefilter<CharT>* _prefilter_of(const basic_regex<CharT, Traits>& e) {
+	const _regex_program<CharT, Traits>* program = _regex_access<CharT, Traits>::get_program(e);
+	return program ? program->prefilter.get() : nullptr;
+}
+
+// The compiled regex to run for a search with flags. match_prev_avail makes
+// match_not_bow meaningless; match_not_bow and match_not_eow are cleared from
+// flags when the pattern tests no word boundaries, or when the program has a
+// variant for them, which is returned instead. Whatever remains is left to
+// the sentinel characters of _onig_search_at.
+template <class CharT, class Traits>
+OnigRegex _regex_for_flags(const basic_regex<CharT, Traits>& e, regex_constants::match_flag_type& flags) {
+	OnigRegex reg = _regex_access<CharT, Traits>::get(e);
+	if (flags & regex_constants::match_prev_avail) flags &= ~regex_constants::match_not_bow;
+	const regex_constants::match_flag_type edges = flags & (regex_constants::match_not_bow | regex_constants::match_not_eow);
+	if (!reg || !edges) return reg;
+
+	const _regex_program<CharT, Traits>* program = _regex_access<CharT, Traits>::get_program(e);
+	if (program->word_boundary) {
+		OnigRegex variant = program->variant(((flags & regex_constants::match_not_bow) ? 1u : 0u) |
+		                                     ((flags & regex_constants::match_not_eow) ? 2u : 0u));
+		if (!variant) return reg;
+		reg = variant;
+	}
+	flags &= ~edges;
+	return reg;
+}
+
+// The subject Oniguruma sees for [whole, whole + total_len): with
+// match_prev_avail, it starts at whole[-1]; a match_not_bow or
+// match_not_eow left by _regex_for_flags repeats the edge character in a
+// copy, so that the edge is no word boundary. whole[0] is at start +
+// prefix_len.
+template <class CharT>
+struct _search_subject {
+	_scratch_string<CharT> buffer;
+	const CharT* start;
+	const CharT* end;
+	size_type prefix_len;
+
+	_search_subject(const CharT* whole, size_type total_len, regex_constants::match_flag_type flags) {
+		const bool prev_avail = (flags & regex_constants::match_prev_avail) != 0;
+		const bool needs_bow_prefix = !prev_avail && (flags & regex_constants::match_not_bow) && total_len > 0;
+		const bool needs_eow_suffix = (flags & regex_constants::match_not_eow) && total_len > 0;
+
+		start = prev_avail ? whole - 1 : whole;
+		prefix_len = prev_avail ? 1 : 0;
+		size_type context_len = total_len;
+		if (needs_bow_prefix || needs_eow_suffix) {
+			// We can't modify the original memory, so use a buffer
+			buffer.assign(start, whole + total_len);
+			if (needs_bow_prefix) {
+				buffer.insert(buffer.begin(), whole[0]);
+				prefix_len = 1;
+			}
+			if (needs_eow_suffix) {
+				buffer += whole[total_len - 1];
+				context_len = total_len + 1;
+			}
+			start = buffer.c_str();
+		}
+		end = start + prefix_len + context_len;
+	}
+
+	_search_subject(const _search_subject&) = delete;
+	_search_subject& operator=(const _search_subject&) = delete;
+};
+
+// Runs onig_search (or onig_match with match_continuous) on the contiguous
+// subject [whole, whole + total_len) from search_offset; the region offsets
+// are relative to whole. With match_prev_avail, whole[-1] is read as the
+// character before the subject. Any match_not_bow or match_not_eow left by
+// _regex_for_flags is handled by repeating the edge character in a copy of
+// the subject, so that the edge is no word boundary; matches reaching into
+// the repeated end character are rejected. With a prefilter, a search fails
+// without Oniguruma when no literal occurs, and otherwise starts at the
+// first candidate position.
+template <class CharT>
+int _onig_search_at(
+	OnigRegex reg,
+	const CharT* whole, size_type total_len, size_type search_offset,
+	regex_constants::match_flag_type flags,
+	OnigOptionType onig_options,
+	OnigRegion* region,
+	const match_limits& limits,
+	const _literal_prefilter<CharT>* prefilter = nullptr)
+{
+	const bool use_match_instead = (flags & regex_constants::match_continuous) != 0;
 
-	// Allocate OnigRegion
-	OnigRegion* region = onig_region_new();
-	if (!region) throw std::bad_alloc();
+	const _search_subject<CharT> subject_view(whole, total_len, flags);
+	const CharT* start = subject_view.start;
+	const size_type prefix_len = subject_view.prefix_len;
+
+	const OnigUChar* u_start = reinterpret_cast<const OnigUChar*>(start);
+	const OnigUChar* u_end   = reinterpret_cast<const OnigUChar*>(subject_view.end);
+	const OnigUChar* u_search_start = reinterpret_cast<const OnigUChar*>(start + prefix_len + search_offset);
+	const OnigUChar* u_range = u_end;
 
 	// Execute search or match depending on match_continuous flag
 	int r;
 	if (use_match_instead) {
 		// match_continuous: use onig_match to only match at the search start position
-		r = onig_match(reg, u_start, u_end, u_search_start, region, onig_options);
+		r = _onig_match_limited(reg, u_start, u_end, u_search_start, region, onig_options, limits);
+	} else if (prefilter) {
+		// Every match begins with a literal: skip to the candidate positions
+		const CharT* subject = start + prefix_len;
+		size_type candidate = prefilter->next(subject, search_offset, total_len);
+		if (candidate == _literal_prefilter<CharT>::npos) {
+			if (prefilter->counters &&
+			    (_instrumentation::get().active.load(std::memory_order_relaxed) & _instrumentation::stats_bit))
+				prefilter->counters->prefilter_rejections.fetch_add(1, std::memory_order_relaxed);
+			return ONIG_MISMATCH;
+		}
+
+		// Try onig_match at the first few candidates; when they keep failing,
+		// leave the rest of the subject to onig_search
+		r = ONIG_MISMATCH;
+		if (limits.empty()) {
+			for (int failures = 0; candidate != _literal_prefilter<CharT>::npos && failures < 16; ++failures) {
+				const OnigUChar* u_at = reinterpret_cast<const OnigUChar*>(subject + candidate);
+				r = onig_match(reg, u_start, u_end, u_at, region, onig_options);
+				if (r >= 0) {
+					r = static_cast<int>((prefix_len + candidate) * sizeof(CharT));
+					break;
+				}
+				if (r != ONIG_MISMATCH) return r;
+				candidate = prefilter->next(subject, candidate + 1, total_len);
+			}
+		}
+		if (r == ONIG_MISMATCH && candidate != _literal_prefilter<CharT>::npos) {
+			u_search_start = reinterpret_cast<const OnigUChar*>(subject + candidate);
+			r = _onig_search_limited(reg, u_start, u_end, u_search_start, u_range, region, onig_options, limits);
+		}
 	} else {
 		// Normal search: can match at any position from start to range
-		r = onig_search(reg, u_start, u_end, u_search_start, u_range, region, onig_options);
+		r = _onig_search_limited(reg, u_start, u_end, u_search_start, u_range, region, onig_options, limits);
 	}
 
-	// Adjust region offsets to account for prefix
-	if (r >= 0) {
+	if (r >= 0 && region) {
+		// Adjust region offsets to account for prefix
 		_adjust_region_offsets_prefix<CharT>(region, prefix_len);
+		if (region->end[0] > static_cast<int>(total_len * sizeof(CharT))) return ONIG_MISMATCH;
 	}
+	return r;
+}
 
-	// Use common helper to process region and populate match_results
-	return _process_onig_region_result<BidirIt, Alloc, CharT, Traits>(
-		r, region, whole_first, last, m, e.flags(), flags);
+// Throws the regex_error of an Oniguruma search result below ONIG_MISMATCH
+inline void _check_search_result(int r) {
+	if (r < ONIG_MISMATCH) {
+		OnigErrorInfo einfo;
+		std::memset(&einfo, 0, sizeof(einfo));
+		throw regex_error(regex_constants::map_oniguruma_error(r), einfo);
+	}
+}
+
+// regex_test on [p, p + len) with reg and flags from _regex_for_flags. No
+// OnigRegion is passed unless the result depends on the extent of the
+// match: match_not_null, or a sentinel left to _onig_search_at. Then region
+// is used, or the per-thread scratch when region is nullptr.
+template <class CharT, class Traits>
+bool _regex_test_at(
+	OnigRegex reg, const CharT* p, size_type len,
+	const basic_regex<CharT, Traits>& e,
+	regex_constants::match_flag_type flags,
+	OnigOptionType onig_options,
+	OnigRegion* region = nullptr)
+{
+	const regex_constants::match_flag_type extent_flags =
+		regex_constants::match_not_null | regex_constants::match_not_bow | regex_constants::match_not_eow;
+
+	_search_probe<CharT, Traits> probe(e, false, len * sizeof(CharT));
+	int r;
+	if (flags & extent_flags) {
+		auto search = [&](OnigRegion* rgn) {
+			int ret = _onig_search_at(reg, p, len, 0, flags, onig_options, rgn, e.limits(), _prefilter_of(e));
+			if (ret >= 0 && (flags & regex_constants::match_not_null) && rgn->beg[0] == rgn->end[0])
+				ret = ONIG_MISMATCH;
+			return ret;
+		};
+		if (region) {
+			r = search(region);
+		} else {
+			// Borrow the per-thread OnigRegion scratch
+			_region_scratch scratch;
+			r = search(scratch.get());
+		}
+	} else {
+		r = _onig_search_at<CharT>(reg, p, len, 0, flags, onig_options, nullptr, e.limits(), _prefilter_of(e));
+	}
+	_check_search_result(r);
+	probe.finish();
+	return r >= 0;
+}
+
+// The matches regex_iterator would enumerate on [p, p + len), found with
+// the given region and nothing else. visit(region) is called for each match
+// and returns false to stop there. Returns the number of matches visited.
+template <class CharT, class Traits, class Visit>
+size_type _regex_enumerate_at(
+	OnigRegex reg, const CharT* p, size_type len,
+	const basic_regex<CharT, Traits>& e,
+	regex_constants::match_flag_type flags,
+	OnigOptionType onig_options,
+	OnigRegion* region,
+	Visit visit)
+{
+	size_type count = 0;
+	size_type offset = 0;
+	for (;;) {
+		_search_probe<CharT, Traits> probe(e, false, (len - offset) * sizeof(CharT));
+		int r = _onig_search_at(reg, p, len, offset, flags, onig_options, region, e.limits(), _prefilter_of(e));
+		_check_search_result(r);
+		probe.finish();
+		if (r < 0) break;
+
+		// match_not_null: a zero-length match ends the enumeration
+		const bool empty = (region->beg[0] == region->end[0]);
+		if (empty && (flags & regex_constants::match_not_null)) break;
+		++count;
+		if (!visit(region)) break;
+
+		// Zero-width match handling (as regex_iterator)
+		offset = static_cast<size_type>(region->end[0]) / sizeof(CharT);
+		if (empty) {
+			if (offset == len) break;
+			++offset;
+		}
+	}
+	return count;
+}
+
+// regex_count on [p, p + len)
+template <class CharT, class Traits>
+size_type _regex_count_at(
+	OnigRegex reg, const CharT* p, size_type len,
+	const basic_regex<CharT, Traits>& e,
+	regex_constants::match_flag_type flags,
+	OnigOptionType onig_options,
+	OnigRegion* region)
+{
+	return _regex_enumerate_at(reg, p, len, e, flags, onig_options, region,
+	                           [](const OnigRegion*) { return true; });
 }
 
-// Internal implementation for contiguous iterators (optimized, no buffer copy)
+// Internal implementation for non-contiguous iterators (uses buffer copy)
 template <class BidirIt, class Alloc, class CharT, class Traits>
 typename std::enable_if<
-	_is_contiguous_iterator<BidirIt>::value,
+	!_is_contiguous_iterator<BidirIt>::value,
 	bool
 >::type
 _regex_search_with_context_impl(
-	BidirIt whole_first, BidirIt search_start, BidirIt last,
+	BidirIt whole_first, BidirIt, BidirIt last,
 	match_results<BidirIt, Alloc>& m,
 	const basic_regex<CharT, Traits>& e,
 	regex_constants::match_flag_type flags,
@@ -499,92 +1246,55 @@ _regex_search_with_context_impl(
 	size_type total_len,
 	size_type search_offset)
 {
-	// Handle match_not_bow and match_not_eow by prepending/appending word characters
-	// to affect word boundary detection. For contiguous iterators, we need to copy
-	// to a buffer when these flags are set since we can't modify the original memory.
-	bool needs_bow_prefix = (flags & regex_constants::match_not_bow) && (search_offset == 0);
-	bool needs_eow_suffix = (flags & regex_constants::match_not_eow);
-	bool use_match_instead = (flags & regex_constants::match_continuous);
-
-	// If we need BOW/EOW modifications, use buffer-based approach
-	if (needs_bow_prefix || needs_eow_suffix) {
-		std::basic_string<CharT> subject_buf;
-		size_type prefix_len = 0;
-
-		if (needs_bow_prefix) {
-			// Prepend a word character to prevent BOW matching at position 0
-			subject_buf += CharT('a');
-			prefix_len = 1;
-		}
-		subject_buf.append(whole_first, last);
-		if (needs_eow_suffix) {
-			// Append a word character to prevent EOW matching at end
-			subject_buf += CharT('a');
-		}
-
-		// Adjust lengths and offsets for the modified buffer
-		size_type buf_total_len = subject_buf.size();
-		size_type buf_search_offset = search_offset + prefix_len;
-
-		const CharT* whole_begin_ptr = subject_buf.c_str();
-		const CharT* end_ptr = whole_begin_ptr + (total_len + prefix_len); // Original end + prefix
-		const CharT* start_ptr = whole_begin_ptr + buf_search_offset;
-		const CharT* context_end_ptr = whole_begin_ptr + buf_total_len;
-
-		const OnigUChar* u_start = reinterpret_cast<const OnigUChar*>(whole_begin_ptr);
-		const OnigUChar* u_end   = reinterpret_cast<const OnigUChar*>(needs_eow_suffix ? context_end_ptr : end_ptr);
-		const OnigUChar* u_search_start = reinterpret_cast<const OnigUChar*>(start_ptr);
-		const OnigUChar* u_range = u_end;
-
-		OnigRegion* region = onig_region_new();
-		if (!region) throw std::bad_alloc();
-
-		int r;
-		if (use_match_instead) {
-			r = onig_match(reg, u_start, u_end, u_search_start, region, onig_options);
-		} else {
-			r = onig_search(reg, u_start, u_end, u_search_start, u_range, region, onig_options);
-		}
-
-		// Adjust region offsets to account for prefix
-		if (r >= 0) {
-			_adjust_region_offsets_prefix<CharT>(region, prefix_len);
-		}
+	// Copy the subject range into a temporary contiguous buffer to support
+	// non-contiguous BidirectionalIterators (e.g., std::list, std::deque)
+	_scratch_string<CharT> subject_buf;
+	const CharT* whole = _contiguous_subject<CharT>(whole_first, last, total_len, subject_buf,
+	                                                (flags & regex_constants::match_prev_avail) != 0);
 
-		// Use common helper to process region and populate match_results
-		return _process_onig_region_result<BidirIt, Alloc, CharT, Traits>(
-			r, region, whole_first, last, m, e.flags(), flags);
-	}
+	// Borrow the per-thread OnigRegion scratch
+	_region_scratch scratch;
+	OnigRegion* region = scratch.get();
 
-	// Fast path: use direct pointer access for contiguous iterators (no BOW/EOW modification needed)
-	// Use stable static buffer for empty ranges to avoid passing nullptr to C API
-	static thread_local CharT empty_char = CharT();
-	const CharT* whole_begin_ptr = (total_len > 0) ? _get_contiguous_pointer(whole_first) : &empty_char;
-	const CharT* end_ptr = whole_begin_ptr + total_len;
-	const CharT* start_ptr = whole_begin_ptr + search_offset;
+	int r = _onig_search_at(reg, whole, total_len, search_offset, flags, onig_options, region, e.limits(),
+	                        _prefilter_of(e));
 
-	const OnigUChar* u_start = reinterpret_cast<const OnigUChar*>(whole_begin_ptr);
-	const OnigUChar* u_end   = reinterpret_cast<const OnigUChar*>(end_ptr);
-	const OnigUChar* u_search_start = reinterpret_cast<const OnigUChar*>(start_ptr);
-	const OnigUChar* u_range = u_end;
+	// Use common helper to process region and populate match_results
+	return _process_onig_region_result<BidirIt, Alloc, CharT, Traits>(
+		r, region, whole_first, last, m, e.flags(), flags, e.captures());
+}
+
+// Internal implementation for contiguous iterators (optimized, no buffer copy
+// unless match_not_bow or match_not_eow is set)
+template <class BidirIt, class Alloc, class CharT, class Traits>
+typename std::enable_if<
+	_is_contiguous_iterator<BidirIt>::value,
+	bool
+>::type
+_regex_search_with_context_impl(
+	BidirIt whole_first, BidirIt, BidirIt last,
+	match_results<BidirIt, Alloc>& m,
+	const basic_regex<CharT, Traits>& e,
+	regex_constants::match_flag_type flags,
+	OnigRegex reg,
+	OnigOptionType onig_options,
+	size_type total_len,
+	size_type search_offset)
+{
+	std::basic_string<CharT> unused;
+	const CharT* whole = _contiguous_subject<CharT>(whole_first, last, total_len, unused,
+	                                                (flags & regex_constants::match_prev_avail) != 0);
 
-	// Allocate OnigRegion
-	OnigRegion* region = onig_region_new();
-	if (!region) throw std::bad_alloc();
+	// Borrow the per-thread OnigRegion scratch
+	_region_scratch scratch;
+	OnigRegion* region = scratch.get();
 
-	// Execute search or match depending on match_continuous flag
-	int r;
-	if (use_match_instead) {
-		// match_continuous: use onig_match to only match at the search start position
-		r = onig_match(reg, u_start, u_end, u_search_start, region, onig_options);
-	} else {
-		// Normal search: can match at any position from start to range
-		r = onig_search(reg, u_start, u_end, u_search_start, u_range, region, onig_options);
-	}
+	int r = _onig_search_at(reg, whole, total_len, search_offset, flags, onig_options, region, e.limits(),
+	                        _prefilter_of(e));
 
 	// Use common helper to process region and populate match_results
 	return _process_onig_region_result<BidirIt, Alloc, CharT, Traits>(
-		r, region, whole_first, last, m, e.flags(), flags);
+		r, region, whole_first, last, m, e.flags(), flags, e.captures());
 }
 
 // Public wrapper that dispatches to the appropriate implementation
@@ -597,14 +1307,16 @@ bool _regex_search_with_context(
 	BidirIt whole_first, BidirIt search_start, BidirIt last,
 	match_results<BidirIt, Alloc>& m,
 	const basic_regex<CharT, Traits>& e,
-	regex_constants::match_flag_type flags)
+	regex_constants::match_flag_type flags,
+	OnigOptionType extra_options = ONIG_OPTION_NONE)
 {
 	// Get Oniguruma regex object (using accessor hack)
-	OnigRegex reg = _regex_access<CharT, Traits>::get(e);
+	OnigRegex reg = _regex_for_flags(e, flags);
 	if (!reg) return false;
 
-	// Options before search execution
-	OnigOptionType onig_options = 0;
+	// Options before search execution (extra_options: Oniguruma-only search
+	// options such as ONIG_OPTION_NOT_END_STRING)
+	OnigOptionType onig_options = extra_options;
 	if (flags & regex_constants::match_not_bol) onig_options |= ONIG_OPTION_NOTBOL;
 	if (flags & regex_constants::match_not_eol) onig_options |= ONIG_OPTION_NOTEOL;
 
@@ -613,8 +1325,215 @@ bool _regex_search_with_context(
 	size_type search_offset = std::distance(whole_first, search_start);
 
 	// Dispatch to the appropriate implementation based on iterator type
-	return _regex_search_with_context_impl(whole_first, search_start, last, m, e, flags,
-	                                       reg, onig_options, total_len, search_offset);
+	_search_probe<CharT, Traits> probe(e, false, (total_len - search_offset) * sizeof(CharT));
+	bool found = _regex_search_with_context_impl(whole_first, search_start, last, m, e, flags,
+	                                             reg, onig_options, total_len, search_offset);
+	probe.finish();
+	return found;
+}
+
+// Runs a backward onig_search (range < start) on the contiguous subject
+// [whole, whole + total_len): the greatest start position at or before
+// from_offset where the pattern matches, with the match ending at or before
+// end_limit (and not empty with match_not_null), is taken. The region
+// offsets are relative to whole, and the subject is prepared as in
+// _onig_search_at. Oniguruma's optimized backward search only reports a
+// start whose literal part ends before the search start, so it can skip
+// the matches just before from_offset: its result is used as a lower
+// bound, and the positions after it are tried by matching forward.
+template <class CharT>
+int _onig_search_backward_at(
+	OnigRegex reg,
+	const CharT* whole, size_type total_len, size_type from_offset, size_type end_limit,
+	regex_constants::match_flag_type flags,
+	OnigOptionType onig_options,
+	OnigRegion* region,
+	const match_limits& limits)
+{
+	// Gaps up to this many positions are tried one by one with onig_match
+	const size_type max_probes = 64;
+
+	const _search_subject<CharT> subject_view(whole, total_len, flags);
+	const CharT* start = subject_view.start;
+	const CharT* subject = start + subject_view.prefix_len;
+	const bool not_null = (flags & regex_constants::match_not_null) != 0;
+
+	const OnigUChar* u_start = reinterpret_cast<const OnigUChar*>(start);
+	const OnigUChar* u_end   = reinterpret_cast<const OnigUChar*>(subject_view.end);
+	const OnigUChar* u_lowest = reinterpret_cast<const OnigUChar*>(subject);
+	auto at = [&](size_type pos) { return reinterpret_cast<const OnigUChar*>(subject + pos); };
+
+	// Whether the match in region (at pos) is acceptable
+	auto acceptable = [&](size_type pos) {
+		const size_type end = region->end[0] / sizeof(CharT) - subject_view.prefix_len;
+		return end <= end_limit && !(not_null && end == pos);
+	};
+	auto found = [&](size_type pos) {
+		_adjust_region_offsets_prefix<CharT>(region, subject_view.prefix_len);
+		return static_cast<int>(pos * sizeof(CharT));
+	};
+
+	for (;;) {
+		int r = _onig_search_limited(reg, u_start, u_end, at(from_offset), u_lowest, region, onig_options, limits);
+		if (r < ONIG_MISMATCH) return r;
+		const bool has_hint = (r >= 0);
+		const size_type hint = has_hint ? (r / sizeof(CharT) - subject_view.prefix_len) : 0;
+		const size_type low = has_hint ? hint + 1 : 0;
+
+		if (low <= from_offset && from_offset - low < max_probes) {
+			for (size_type pos = from_offset + 1; pos-- > low; ) {
+				r = _onig_match_limited(reg, u_start, u_end, at(pos), region, onig_options, limits);
+				if (r < ONIG_MISMATCH) return r;
+				if (r >= 0 && acceptable(pos)) return found(pos);
+			}
+		} else if (low <= from_offset) {
+			// A long gap: search forward through it, keeping the last start
+			size_type last = 0;
+			bool any = false;
+			for (size_type pos = low; pos <= from_offset; ) {
+				r = _onig_search_limited(reg, u_start, u_end, at(pos), u_end, region, onig_options, limits);
+				if (r < ONIG_MISMATCH) return r;
+				if (r < 0) break;
+				const size_type beg = r / sizeof(CharT) - subject_view.prefix_len;
+				if (beg > from_offset) break;
+				if (acceptable(beg)) {
+					last = beg;
+					any = true;
+				}
+				pos = beg + 1;
+			}
+			if (any) {
+				r = _onig_match_limited(reg, u_start, u_end, at(last), region, onig_options, limits);
+				if (r < ONIG_MISMATCH) return r;
+				return found(last);
+			}
+		}
+
+		if (!has_hint) return ONIG_MISMATCH;
+		r = _onig_match_limited(reg, u_start, u_end, at(hint), region, onig_options, limits);
+		if (r < ONIG_MISMATCH) return r;
+		if (r >= 0 && acceptable(hint)) return found(hint);
+		if (hint == 0) return ONIG_MISMATCH;
+		from_offset = hint - 1;
+	}
+}
+
+template <class BidirIt, class Alloc, class CharT, class Traits>
+bool _regex_search_backward(
+	BidirIt first, BidirIt from, BidirIt before, BidirIt last,
+	match_results<BidirIt, Alloc>& m,
+	const basic_regex<CharT, Traits>& e,
+	regex_constants::match_flag_type flags)
+{
+	// Each start position is tried by onig_search itself
+	flags &= ~regex_constants::match_continuous;
+	OnigRegex reg = _regex_for_flags(e, flags);
+	if (!reg) return false;
+
+	OnigOptionType onig_options = ONIG_OPTION_NONE;
+	if (flags & regex_constants::match_not_bol) onig_options |= ONIG_OPTION_NOTBOL;
+	if (flags & regex_constants::match_not_eol) onig_options |= ONIG_OPTION_NOTEOL;
+
+	const size_type total_len = std::distance(first, last);
+	const size_type end_limit = std::distance(first, before);
+	const size_type from_offset = std::min<size_type>(std::distance(first, from), end_limit);
+
+	_scratch_string<CharT> subject_buf;
+	const CharT* whole = _contiguous_subject<CharT>(first, last, total_len, subject_buf,
+	                                                (flags & regex_constants::match_prev_avail) != 0);
+
+	// Borrow the per-thread OnigRegion scratch
+	_region_scratch scratch;
+	OnigRegion* region = scratch.get();
+
+	_search_probe<CharT, Traits> probe(e, false, end_limit * sizeof(CharT));
+	int r = _onig_search_backward_at(reg, whole, total_len, from_offset, end_limit, flags, onig_options,
+	                                 region, e.limits());
+	// The extent of the match has been checked above
+	bool found = _process_onig_region_result<BidirIt, Alloc, CharT, Traits>(
+		r, region, first, last, m, e.flags(), flags & ~regex_constants::match_not_null, e.captures());
+	probe.finish();
+	return found;
+}
+
+// Runs onig_search on the contiguous subject [whole, whole + total_len)
+// for a match starting in [start_offset, range_offset] and ending at or
+// before range_offset, which Oniguruma takes as the end of the data it may
+// read; the region offsets are relative to whole, and the subject is
+// prepared as in _onig_search_at. With an empty range, Oniguruma matches at
+// start_offset without that limit, so a match running past it is rejected
+// here. With a prefilter, the search starts at the first literal that fits
+// in the range.
+template <class CharT>
+int _onig_search_range_at(
+	OnigRegex reg,
+	const CharT* whole, size_type total_len, size_type start_offset, size_type range_offset,
+	regex_constants::match_flag_type flags,
+	OnigOptionType onig_options,
+	OnigRegion* region,
+	const match_limits& limits,
+	const _literal_prefilter<CharT>* prefilter)
+{
+	const bool continuous = (flags & regex_constants::match_continuous) != 0;
+
+	const _search_subject<CharT> subject_view(whole, total_len, flags);
+	const CharT* subject = subject_view.start + subject_view.prefix_len;
+	const OnigUChar* u_start = reinterpret_cast<const OnigUChar*>(subject_view.start);
+	const OnigUChar* u_end   = reinterpret_cast<const OnigUChar*>(subject_view.end);
+
+	size_type search_offset = start_offset;
+	if (prefilter) {
+		size_type candidate = prefilter->next(subject, start_offset, range_offset);
+		if (candidate == _literal_prefilter<CharT>::npos || (continuous && candidate != start_offset))
+			return ONIG_MISMATCH;
+		search_offset = candidate;
+	}
+
+	int r = _onig_search_limited(reg, u_start, u_end,
+	                             reinterpret_cast<const OnigUChar*>(subject + search_offset),
+	                             reinterpret_cast<const OnigUChar*>(subject + range_offset),
+	                             region, onig_options, limits);
+	if (r < 0) return r;
+
+	_adjust_region_offsets_prefix<CharT>(region, subject_view.prefix_len);
+	if (region->end[0] > static_cast<int>(range_offset * sizeof(CharT))) return ONIG_MISMATCH;
+	if (continuous && region->beg[0] != static_cast<int>(start_offset * sizeof(CharT))) return ONIG_MISMATCH;
+	return r;
+}
+
+template <class BidirIt, class Alloc, class CharT, class Traits>
+bool regex_search_range(
+	BidirIt first, BidirIt start, BidirIt range, BidirIt last,
+	match_results<BidirIt, Alloc>& m,
+	const basic_regex<CharT, Traits>& e,
+	regex_constants::match_flag_type flags)
+{
+	OnigRegex reg = _regex_for_flags(e, flags);
+	if (!reg) return false;
+
+	OnigOptionType onig_options = ONIG_OPTION_NONE;
+	if (flags & regex_constants::match_not_bol) onig_options |= ONIG_OPTION_NOTBOL;
+	if (flags & regex_constants::match_not_eol) onig_options |= ONIG_OPTION_NOTEOL;
+
+	const size_type total_len = std::distance(first, last);
+	const size_type start_offset = std::distance(first, start);
+	const size_type range_offset = std::distance(first, range);
+
+	_scratch_string<CharT> subject_buf;
+	const CharT* whole = _contiguous_subject<CharT>(first, last, total_len, subject_buf,
+	                                                (flags & regex_constants::match_prev_avail) != 0);
+
+	// Borrow the per-thread OnigRegion scratch
+	_region_scratch scratch;
+	OnigRegion* region = scratch.get();
+
+	_search_probe<CharT, Traits> probe(e, false, (range_offset - start_offset) * sizeof(CharT));
+	int r = _onig_search_range_at(reg, whole, total_len, start_offset, range_offset, flags, onig_options,
+	                              region, e.limits(), _prefilter_of(e));
+	bool found = _process_onig_region_result<BidirIt, Alloc, CharT, Traits>(
+		r, region, first, last, m, e.flags(), flags, e.captures());
+	probe.finish();
+	return found;
 }
 
 ////////////////////////////////////////////
@@ -630,7 +1549,7 @@ OnigOptionType basic_regex<CharT, Traits>::_options_from_flags(flag_type f) {
 
 	// Note: New std::regex compatible flags are handled as follows:
 	// - nosubs: handled at match/search time by not populating match_results
-	// - optimize: currently a no-op (reserved for future optimization)
+	// - optimize: handled by _compile_program, which builds the literal prefilter
 	// - collate: handled by _preprocess_pattern_for_locale in constructors
 	// These flags don't map directly to Oniguruma options
 
@@ -645,14 +1564,14 @@ OnigOptionType basic_regex<CharT, Traits>::_options_from_flags(flag_type f) {
 	} else if (ecmascript) {
 		// ECMAScript mode: handle dot and anchor behavior separately
 		// In ECMAScript:
-		// - By default, dot does NOT match newline (use SINGLELINE option)
-		// - When multiline flag is set, we use pattern transformation to emulate
-		//   ECMAScript semantics (^ and $ match at line boundaries) without enabling
-		//   Oniguruma's MULTILINE option (which would also change dot behavior)
-		// - Pattern transformation is handled in _emulate_ecmascript_multiline()
-		options |= ONIG_OPTION_SINGLELINE; // dot doesn't match newline
-		// Note: multiline anchor behavior is implemented via pattern rewriting,
-		// so we do NOT set ONIG_OPTION_MULTILINE here
+		// - By default, dot does NOT match newline, so Oniguruma's MULTILINE option
+		//   (which would make dot match newline) is never set
+		// - Without the multiline flag, ^ and $ only match at the ends of the subject
+		//   (SINGLELINE option)
+		// - With the multiline flag, ^ and $ are Oniguruma's native line anchors (LF);
+		//   other line terminators are added by _emulate_ecmascript_multiline()
+		if (!multiline)
+			options |= ONIG_OPTION_SINGLELINE;
 	} else {
 		// Non-ECMAScript modes: use original behavior
 		options |= (multiline ? (ONIG_OPTION_MULTILINE | ONIG_OPTION_NEGATE_SINGLELINE) : ONIG_OPTION_SINGLELINE);
@@ -692,47 +1611,118 @@ basic_regex<CharT, Traits>::basic_regex(const string_type& s, flag_type f, OnigE
 
 template <class CharT, class Traits>
 basic_regex<CharT, Traits>::basic_regex(const CharT* s, size_type count, flag_type f, OnigEncoding enc)
-	: m_regex(nullptr), m_encoding(nullptr), m_flags(f), m_pattern(s, count), m_locale(std::locale())
+	: m_program(), m_flags(f), m_locale(std::locale()), m_limits(), m_captures()
 {
-	OnigSyntaxType* syntax = _syntax_from_flags(f);
-	OnigOptionType options = _options_from_flags(f);
-	OnigErrorInfo err_info;
 	if (!enc) enc = _get_default_encoding_from_char_type<CharT>();
-	m_encoding = enc;
+	_compile(string_type(s, count), enc);
+}
 
-	// Preprocess pattern for ECMAScript compatibility if needed
-	// Skip preprocessing when oniguruma flag is set - use native Oniguruma syntax
-	string_type compiled_pattern = m_pattern;
-	if ((f & regex_constants::ECMAScript) && !(f & regex_constants::oniguruma)) {
-		compiled_pattern = _preprocess_pattern_for_ecmascript(compiled_pattern);
+// Compile pattern into a new program and install it.
+// m_flags and m_locale must already be set; on error the current program is kept.
+// With regex_constants::deferred, the program is installed uncompiled.
+template <class CharT, class Traits>
+void basic_regex<CharT, Traits>::_compile(const string_type& pattern, OnigEncoding enc) {
+	std::shared_ptr<program_type> program = std::make_shared<program_type>(pattern, enc);
+
+	if (m_flags & regex_constants::deferred) {
+		program->flags = m_flags;
+		program->locale = m_locale;
+		program->compiler = &_compile_deferred;
+	} else {
+		_compile_program(*program);
 	}
 
-	// Preprocess pattern for locale support (when collate flag is set)
-	if (f & regex_constants::collate) {
-		compiled_pattern = _preprocess_pattern_for_locale(compiled_pattern);
+	if (_instrumentation::get().active.load(std::memory_order_relaxed) & _instrumentation::stats_bit) {
+		// Recompiling in place (imbue) keeps the counters of the pattern
+		if (m_program) program->counters.assign(m_program->counters);
 	}
-	const CharT* pattern_ptr = compiled_pattern.c_str();
-	size_type pattern_len = compiled_pattern.length();
 
-	int err = onig_new(&m_regex, reinterpret_cast<const OnigUChar*>(pattern_ptr),
-	                   reinterpret_cast<const OnigUChar*>(pattern_ptr + pattern_len),
-	                   options, enc, syntax, &err_info);
-	if (err != ONIG_NORMAL) throw regex_error(regex_constants::map_oniguruma_error(err), err_info);
+	m_program = program;
+}
+
+// Whether a preprocessed pattern may test word boundaries (\b, \B, \< or \>).
+// Conservative: escapes inside bracket expressions count too.
+template <class String>
+bool _has_word_boundary_escape(const String& pattern) {
+	typedef typename String::value_type CharT;
+	for (size_type i = 0; i + 1 < pattern.size(); ++i) {
+		if (pattern[i] != CharT('\\')) continue;
+		const CharT c = pattern[++i];
+		if (c == CharT('b') || c == CharT('B') || c == CharT('<') || c == CharT('>')) return true;
+	}
+	return false;
+}
+
+// Rewrites \b and \B of an Oniguruma syntax pattern (outside bracket
+// expressions and comments) so that the beginning (edges & 1) and/or the end
+// (edges & 2) of the string is no word boundary, as std::regex does for
+// match_not_bow and match_not_eow
+template <class CharT>
+_scratch_string<CharT> _word_boundary_variant_pattern(const std::basic_string<CharT>& pattern, unsigned edges) {
+	const std::string anchors = (edges == 1) ? "\\A" : (edges == 2) ? "\\z" : "\\A|\\z";
+	const std::string boundary = "(?:(?!" + anchors + ")\\b)";
+	const std::string non_boundary = "(?:" + anchors + "|\\B)";
+
+	_scratch_string<CharT> result;
+	result.reserve(pattern.size() + 16);
+	size_type depth = 0; // Bracket expression nesting
+	for (size_type i = 0; i < pattern.size(); ++i) {
+		const CharT c = pattern[i];
+		if (c == CharT('\\') && i + 1 < pattern.size()) {
+			const CharT next = pattern[++i];
+			if (depth == 0 && (next == CharT('b') || next == CharT('B'))) {
+				const std::string& replacement = (next == CharT('b')) ? boundary : non_boundary;
+				result.append(replacement.begin(), replacement.end());
+			} else {
+				result += c;
+				result += next;
+			}
+			continue;
+		}
+		result += c;
+		if (c == CharT('[')) {
+			// A ']' first in the expression (after any '^') is literal
+			++depth;
+			if (i + 1 < pattern.size() && pattern[i + 1] == CharT('^')) result += pattern[++i];
+			if (i + 1 < pattern.size() && pattern[i + 1] == CharT(']')) result += pattern[++i];
+		} else if (c == CharT(']') && depth > 0) {
+			--depth;
+		} else if (depth == 0 && c == CharT('(') && i + 2 < pattern.size() &&
+		           pattern[i + 1] == CharT('?') && pattern[i + 2] == CharT('#')) {
+			// (?#...) comment: copied as is
+			while (++i < pattern.size()) {
+				result += pattern[i];
+				if (pattern[i] == CharT(')')) break;
+			}
+		}
+	}
+	return result;
 }
 
+// variant_compiler of _regex_program: nullptr when Oniguruma rejects the
+// rewritten pattern (as for \b in a look-behind), which leaves the flags to
+// _onig_search_at
 template <class CharT, class Traits>
-basic_regex<CharT, Traits>::basic_regex(const self_type& other)
-	: m_regex(nullptr), m_encoding(other.m_encoding), m_flags(other.m_flags), m_pattern(other.m_pattern), m_locale(other.m_locale)
-{
-	if (!other.m_regex) return; // If the original object is invalid
+OnigRegex _compile_word_boundary_variant(const _regex_program<CharT, Traits>& program, unsigned edges) {
+	const _scratch_string<CharT> pattern = _word_boundary_variant_pattern(program.compiled_pattern, edges);
+	OnigRegex reg = nullptr;
+	OnigErrorInfo err_info;
+	int err = onig_new(&reg, reinterpret_cast<const OnigUChar*>(pattern.c_str()),
+	                   reinterpret_cast<const OnigUChar*>(pattern.c_str() + pattern.length()),
+	                   program.options, program.encoding, program.syntax, &err_info);
+	return (err == ONIG_NORMAL) ? reg : nullptr;
+}
 
+// Preprocess the program's pattern and compile it with onig_new
+template <class CharT, class Traits>
+void basic_regex<CharT, Traits>::_compile_program(program_type& program) const {
 	OnigSyntaxType* syntax = _syntax_from_flags(m_flags);
 	OnigOptionType options = _options_from_flags(m_flags);
 	OnigErrorInfo err_info;
 
 	// Preprocess pattern for ECMAScript compatibility if needed
 	// Skip preprocessing when oniguruma flag is set - use native Oniguruma syntax
-	string_type compiled_pattern = m_pattern;
+	_scratch_string<CharT> compiled_pattern(program.pattern.begin(), program.pattern.end());
 	if ((m_flags & regex_constants::ECMAScript) && !(m_flags & regex_constants::oniguruma)) {
 		compiled_pattern = _preprocess_pattern_for_ecmascript(compiled_pattern);
 	}
@@ -741,25 +1731,64 @@ basic_regex<CharT, Traits>::basic_regex(const self_type& other)
 	if (m_flags & regex_constants::collate) {
 		compiled_pattern = _preprocess_pattern_for_locale(compiled_pattern);
 	}
-	const CharT* s = compiled_pattern.c_str();
-	size_type count = compiled_pattern.length();
+	const CharT* pattern_ptr = compiled_pattern.c_str();
+	size_type pattern_len = compiled_pattern.length();
+
+	int err = onig_new(&program.regex, reinterpret_cast<const OnigUChar*>(pattern_ptr),
+	                   reinterpret_cast<const OnigUChar*>(pattern_ptr + pattern_len),
+	                   options, program.encoding, syntax, &err_info);
+	if (err != ONIG_NORMAL) {
+		program.regex = nullptr;
+		throw regex_error(regex_constants::map_oniguruma_error(err), err, err_info);
+	}
+	program.word_boundary = _has_word_boundary_escape(compiled_pattern);
+	if (program.word_boundary && syntax == ONIG_SYNTAX_ONIGURUMA) {
+		program.compiled_pattern.assign(compiled_pattern.begin(), compiled_pattern.end());
+		program.syntax = syntax;
+		program.options = options;
+		program.variant_compiler = &_compile_word_boundary_variant<CharT, Traits>;
+	}
+	// Case folding could match other literals than those of the pattern
+	if ((m_flags & regex_constants::optimize) && syntax == ONIG_SYNTAX_ONIGURUMA &&
+	    !(options & (ONIG_OPTION_IGNORECASE | ONIG_OPTION_EXTEND))) {
+		std::shared_ptr<_literal_prefilter<CharT>> prefilter = _build_literal_prefilter(compiled_pattern, program.encoding);
+		if (prefilter) prefilter->counters = &program.counters;
+		program.prefilter = prefilter;
+	}
+	program.compiled.store(true, std::memory_order_release);
+
+	if (_instrumentation::get().active.load(std::memory_order_relaxed) & _instrumentation::stats_bit)
+		program.counters.compiles.fetch_add(1, std::memory_order_relaxed);
+}
+
+// First use of a deferred program: compile it with the recorded flags and locale
+template <class CharT, class Traits>
+void basic_regex<CharT, Traits>::_compile_deferred(program_type& program) {
+	self_type shell;
+	shell.m_flags = program.flags;
+	shell.m_locale = program.locale;
+	shell._compile_program(program);
+}
 
-	int err = onig_new(&m_regex, reinterpret_cast<const OnigUChar*>(s), reinterpret_cast<const OnigUChar*>(s + count),
-					   options, m_encoding, syntax, &err_info);
-	if (err != ONIG_NORMAL) throw regex_error(regex_constants::map_oniguruma_error(err), err_info);
+// Copies share the compiled program; no recompilation takes place
+template <class CharT, class Traits>
+basic_regex<CharT, Traits>::basic_regex(const self_type& other)
+	: m_program(other.m_program), m_flags(other.m_flags), m_locale(other.m_locale), m_limits(other.m_limits),
+	  m_captures(other.m_captures)
+{
 }
 
 template <class CharT, class Traits>
 basic_regex<CharT, Traits>::basic_regex(self_type&& other) noexcept
-	: m_regex(other.m_regex), m_encoding(other.m_encoding), m_flags(other.m_flags),
-	  m_pattern(std::move(other.m_pattern)), m_locale(std::move(other.m_locale))
+	: m_program(std::move(other.m_program)), m_flags(other.m_flags), m_locale(std::move(other.m_locale)),
+	  m_limits(other.m_limits), m_captures(other.m_captures)
 {
 	// leave other in safe state
-	other.m_regex = nullptr;
-	other.m_encoding = nullptr;
+	other.m_program.reset();
 	other.m_flags = regex_constants::normal;
-	other.m_pattern.clear();
 	other.m_locale = std::locale();
+	other.m_limits = match_limits();
+	other.m_captures = capture_mask();
 }
 
 // move assignment
@@ -767,49 +1796,71 @@ template <class CharT, class Traits>
 basic_regex<CharT, Traits>& basic_regex<CharT, Traits>::operator=(self_type&& other) noexcept {
 	if (this == &other) return *this;
 
-	// free current resource if any (check nullptr)
-	if (m_regex) {
-		// Use the appropriate Oniguruma API to free compiled regex.
-		// If onig_free accepts nullptr safely then check is optional,
-		// but checking avoids relying on that guarantee.
-		onig_free(m_regex);
-		m_regex = nullptr;
-	}
-
-	// steal resources
-	m_regex = other.m_regex;
-	m_encoding = other.m_encoding;
+	// steal resources (the previous program is released when its last owner goes away)
+	m_program = std::move(other.m_program);
 	m_flags = other.m_flags;
-	m_pattern = std::move(other.m_pattern);
 	m_locale = std::move(other.m_locale);
+	m_limits = other.m_limits;
+	m_captures = other.m_captures;
 
 	// reset other to safe state
-	other.m_regex = nullptr;
-	other.m_encoding = nullptr;
+	other.m_program.reset();
 	other.m_flags = regex_constants::normal;
-	other.m_pattern.clear();
 	other.m_locale = std::locale();
+	other.m_limits = match_limits();
+	other.m_captures = capture_mask();
 
 	return *this;
 }
 
 template <class CharT, class Traits>
 basic_regex<CharT, Traits>::~basic_regex() {
-	if (m_regex) {
-		onig_free(m_regex);
-		m_regex = nullptr;
-	}
 }
 
 template <class CharT, class Traits>
 unsigned basic_regex<CharT, Traits>::mark_count() const {
-	if (!m_regex) return 0;
-	return onig_number_of_captures(m_regex);
+	OnigRegex reg = _regex();
+	if (!reg) return 0;
+	return onig_number_of_captures(reg);
+}
+
+template <class CharT, class Traits>
+capture_mask basic_regex<CharT, Traits>::named_captures(std::initializer_list<string_type> names) const {
+	OnigRegex reg = _regex();
+	capture_mask mask = capture_mask::none();
+	for (const string_type& name : names) {
+		const OnigUChar* u_name = reinterpret_cast<const OnigUChar*>(name.data());
+		int* groups = nullptr;
+		int n = reg ? onig_name_to_group_numbers(reg, u_name, u_name + name.size() * sizeof(CharT), &groups) : 0;
+		if (n <= 0) throw regex_error(regex_constants::error_backref, "undefined group name");
+		for (int i = 0; i < n; ++i) mask.add(groups[i]);
+	}
+	return mask;
+}
+
+template <class CharT, class Traits>
+regex_stats basic_regex<CharT, Traits>::stats() const {
+	regex_stats st;
+	if (!m_program) return st;
+	const _regex_counters& c = m_program->counters;
+	st.compiles = c.compiles.load(std::memory_order_relaxed);
+	st.searches = c.searches.load(std::memory_order_relaxed);
+	st.matches = c.matches.load(std::memory_order_relaxed);
+	st.bytes_scanned = c.bytes_scanned.load(std::memory_order_relaxed);
+	st.prefilter_rejections = c.prefilter_rejections.load(std::memory_order_relaxed);
+	st.total_time = std::chrono::nanoseconds(c.total_time.load(std::memory_order_relaxed));
+	st.max_time = std::chrono::nanoseconds(c.max_time.load(std::memory_order_relaxed));
+	return st;
 }
 
 template <class CharT, class Traits>
-typename basic_regex<CharT, Traits>::string_type
-basic_regex<CharT, Traits>::_preprocess_pattern_for_locale(const string_type& pattern) const {
+void basic_regex<CharT, Traits>::reset_stats() const {
+	if (m_program) m_program->counters.reset();
+}
+
+template <class CharT, class Traits>
+_scratch_string<CharT>
+basic_regex<CharT, Traits>::_preprocess_pattern_for_locale(const _scratch_string<CharT>& pattern) const {
 	// Conservative POSIX character class expander for locale support
 	// Expands [:digit:], [:alpha:], [:alnum:], [:space:], [:upper:], [:lower:],
 	// [:punct:], [:xdigit:], [:cntrl:], [:print:], [:graph:] inside bracket expressions
@@ -818,11 +1869,11 @@ basic_regex<CharT, Traits>::_preprocess_pattern_for_locale(const string_type& pa
 	// We only need to preprocess for other syntaxes (like Oniguruma default or ECMAScript).
 	//
 	// Limitations:
-	// - Only implemented for char and wchar_t (not char16_t/char32_t)
-	// - For char: enumerates all 256 values (0-255)
-	// - For wchar_t: enumerates up to U+0800 (~2K characters) to avoid very large expansions
-	//   Covers Basic Latin, Latin-1 Supplement, Latin Extended A/B, and other common blocks
-	// - Performance: Expansion happens once during pattern compilation; fast for typical use cases
+	// - For char: classifies all 256 values (0-255) with std::ctype<char>
+	// - For wchar_t, char16_t and char32_t: classifies the Basic Multilingual Plane
+	//   (U+0000-U+FFFF) with std::ctype<wchar_t>; supplementary planes are not included
+	// - Performance: the classification is computed once per process and locale and
+	//   emitted as compact X-Y ranges, so compiling another collate regex is cheap
 	//
 	// Check if we're using a POSIX syntax that already supports these classes.
 	OnigSyntaxType* syntax = _syntax_from_flags(m_flags);
@@ -832,44 +1883,161 @@ basic_regex<CharT, Traits>::_preprocess_pattern_for_locale(const string_type& pa
 		return pattern;
 	}
 
-	// Use SFINAE helper to only compile locale-based expansion for char and wchar_t
 	return _posix_class_expander<CharT>::expand(m_locale, pattern);
 }
 
-// Implementation of POSIX class expansion for char and wchar_t
+// Names of the POSIX classes, in the order of _posix_class_table::ranges
+static const struct {
+	const char* name;
+	std::ctype_base::mask mask;
+} s_posix_classes[_posix_class_table::class_count] = {
+	{ "digit", std::ctype_base::digit },
+	{ "alpha", std::ctype_base::alpha },
+	{ "alnum", std::ctype_base::alnum },
+	{ "space", std::ctype_base::space },
+	{ "upper", std::ctype_base::upper },
+	{ "lower", std::ctype_base::lower },
+	{ "punct", std::ctype_base::punct },
+	{ "xdigit", std::ctype_base::xdigit },
+	{ "cntrl", std::ctype_base::cntrl },
+	{ "print", std::ctype_base::print },
+	{ "graph", std::ctype_base::graph },
+};
+
+// Index of a POSIX class name in s_posix_classes, or -1 if not recognized
+template <class CharT>
+static int _posix_class_index(const CharT* name, size_t length) {
+	for (int k = 0; k < _posix_class_table::class_count; ++k) {
+		const char* literal = s_posix_classes[k].name;
+		size_t j = 0;
+		while (j < length && literal[j] && name[j] == CharT(static_cast<unsigned char>(literal[j])))
+			++j;
+		if (j == length && !literal[j])
+			return k;
+	}
+	return -1;
+}
+
+// Classify code points [0, limit) with one bulk ctype::is call per chunk
+template <class C>
+static void _classify_code_points(const std::locale& loc, char32_t limit, _posix_class_table& table) {
+	const std::ctype<C>& ct = std::use_facet<std::ctype<C>>(loc);
+	const char32_t chunk = 4096;
+	C chars[chunk];
+	std::ctype_base::mask masks[chunk];
+	for (char32_t lo = 0; lo < limit; lo += chunk) {
+		char32_t n = std::min<char32_t>(chunk, limit - lo);
+		for (char32_t j = 0; j < n; ++j)
+			chars[j] = static_cast<C>(lo + j);
+		ct.is(chars, chars + n, masks);
+		for (char32_t j = 0; j < n; ++j) {
+			char32_t cp = lo + j;
+			if (cp >= 0xD800 && cp <= 0xDFFF)
+				continue; // Surrogates are not characters
+			for (int k = 0; k < _posix_class_table::class_count; ++k) {
+				if (!(masks[j] & s_posix_classes[k].mask)) continue;
+				std::vector<_posix_class_table::range>& r = table.ranges[k];
+				if (!r.empty() && r.back().second + 1 == cp)
+					r.back().second = cp;
+				else
+					r.push_back(_posix_class_table::range(cp, cp));
+			}
+		}
+	}
+}
+
+ONIGPP_INLINE std::shared_ptr<const _posix_class_table>
+_posix_class_table::get(const std::locale& loc, bool narrow) {
+	// Tables are keyed by locale name; an unnamed locale ("*") may carry
+	// arbitrary facets, so its table is built for the caller only
+	const std::string name = loc.name();
+	std::string key = (narrow ? "c:" : "w:") + name;
+
+	static std::mutex s_lock;
+	static std::map<std::string, std::shared_ptr<const _posix_class_table>> s_tables;
+	if (name != "*") {
+		std::lock_guard<std::mutex> lock(s_lock);
+		auto it = s_tables.find(key);
+		if (it != s_tables.end()) return it->second;
+	}
+
+	std::shared_ptr<_posix_class_table> table = std::make_shared<_posix_class_table>();
+	if (narrow)
+		_classify_code_points<char>(loc, 0x100, *table);
+	else
+		_classify_code_points<wchar_t>(loc, 0x10000, *table);
+
+	if (name != "*") {
+		std::lock_guard<std::mutex> lock(s_lock);
+		// Another thread may have won the race; keep a single shared table
+		return s_tables.insert(std::make_pair(key, table)).first->second;
+	}
+	return table;
+}
+
+// Append one bracket-expression member for a code point.
+// ASCII alphanumerics are kept as-is for readability; everything else is a hex
+// escape so no character can be taken for bracket syntax: \xHH for bytes
+// (preserving byte semantics) and \x{H} for wide code points.
+template <class CharT>
+static void _append_class_char(_scratch_string<CharT>& out, char32_t cp) {
+	if ((cp >= '0' && cp <= '9') || (cp >= 'A' && cp <= 'Z') || (cp >= 'a' && cp <= 'z')) {
+		out += CharT(cp);
+		return;
+	}
+	static const char hex[] = "0123456789ABCDEF";
+	out += CharT('\\');
+	out += CharT('x');
+	if (sizeof(CharT) == 1) {
+		out += CharT(hex[(cp >> 4) & 0xF]);
+		out += CharT(hex[cp & 0xF]);
+		return;
+	}
+	out += CharT('{');
+	int shift = 28;
+	while (shift > 0 && !((cp >> shift) & 0xF)) shift -= 4;
+	for (; shift >= 0; shift -= 4)
+		out += CharT(hex[(cp >> shift) & 0xF]);
+	out += CharT('}');
+}
+
+// Append a POSIX class as bracket-expression members, using X-Y ranges for runs
+template <class CharT>
+static void _append_posix_class(_scratch_string<CharT>& out,
+                                const std::vector<_posix_class_table::range>& ranges) {
+	if (ranges.empty()) {
+		// No character matches the class. Keep the bracket expression non-empty to avoid
+		// "empty range in char class" errors, using a non-printing character unlikely to
+		// appear in normal text.
+		out += CharT('\x7F'); // DEL character (ASCII 127)
+		return;
+	}
+	for (const _posix_class_table::range& r : ranges) {
+		_append_class_char(out, r.first);
+		if (r.second == r.first) continue;
+		if (r.second > r.first + 1) out += CharT('-');
+		_append_class_char(out, r.second);
+	}
+}
+
+// Implementation of POSIX class expansion
 // This function expands POSIX character classes (e.g., [:lower:], [:digit:]) inside bracket
-// expressions into explicit character lists based on the imbued locale's ctype facet.
+// expressions into explicit character ranges based on the imbued locale's ctype facet.
 // The expansion is locale-aware and respects the character classification of the given locale.
 template <class CharT>
-typename _posix_class_expander<CharT,
-	typename std::enable_if<
-		std::is_same<CharT, char>::value || std::is_same<CharT, wchar_t>::value
-	>::type>::string_type
-_posix_class_expander<CharT,
-	typename std::enable_if<
-		std::is_same<CharT, char>::value || std::is_same<CharT, wchar_t>::value
-	>::type>::expand(const std::locale& loc, const string_type& pattern) {
-	typedef std::basic_string<CharT> string_type;
+typename _posix_class_expander<CharT>::string_type
+_posix_class_expander<CharT>::expand(const std::locale& loc, const string_type& pattern) {
 	typedef typename string_type::size_type size_type;
 
 	string_type result;
 	result.reserve(pattern.size());
 
-	const std::ctype<CharT>& ct = std::use_facet<std::ctype<CharT>>(loc);
+	// The class table is looked up lazily: most patterns have no POSIX class at all
+	std::shared_ptr<const _posix_class_table> table;
 
 	size_type i = 0;
 	const size_type len = pattern.size();
 
-	// Helper lambda to compare strings
-	auto str_equals = [](const string_type& s, const char* literal) -> bool {
-		size_t lit_len = std::strlen(literal);
-		if (s.size() != lit_len) return false;
-		for (size_t j = 0; j < lit_len; ++j) {
-			if (s[j] != CharT(literal[j])) return false;
-		}
-		return true;
-	};
-
 	while (i < len) {
 		if (pattern[i] == CharT('[')) {
 			// Start of bracket expression
@@ -895,114 +2063,12 @@ _posix_class_expander<CharT,
 
 					if (i + 1 < len && pattern[i] == CharT(':') && pattern[i+1] == CharT(']')) {
 						// Found complete POSIX class
-						string_type class_name = pattern.substr(name_start, i - name_start);
+						int index = _posix_class_index(pattern.data() + name_start, i - name_start);
 						i += 2; // skip ':]'
 
-						// Expand the POSIX class based on locale
-						string_type expansion;
-
-						// Test characters in a reasonable range.
-						// For char: all 256 possible values (0-255)
-						// For wchar_t: enumerate up to U+0800 (2048 characters) to avoid very large expansions
-						// This covers Basic Latin, Latin-1 Supplement, Latin Extended A/B, and other common
-						// character blocks sufficient for most locale-aware character classification.
-						// Performance: ~2K iterations for wchar_t; fast and practical for typical use cases.
-						const int max_char = (sizeof(CharT) == 1) ? 256 : 0x800;
-
-						// Determine which class we're dealing with
-						std::ctype_base::mask mask = 0;
-						bool recognized = false;
-
-						if (str_equals(class_name, "digit")) {
-							mask = std::ctype_base::digit;
-							recognized = true;
-						} else if (str_equals(class_name, "alpha")) {
-							mask = std::ctype_base::alpha;
-							recognized = true;
-						} else if (str_equals(class_name, "alnum")) {
-							mask = std::ctype_base::alnum;
-							recognized = true;
-						} else if (str_equals(class_name, "space")) {
-							mask = std::ctype_base::space;
-							recognized = true;
-						} else if (str_equals(class_name, "upper")) {
-							mask = std::ctype_base::upper;
-							recognized = true;
-						} else if (str_equals(class_name, "lower")) {
-							mask = std::ctype_base::lower;
-							recognized = true;
-						} else if (str_equals(class_name, "punct")) {
-							mask = std::ctype_base::punct;
-							recognized = true;
-						} else if (str_equals(class_name, "xdigit")) {
-							mask = std::ctype_base::xdigit;
-							recognized = true;
-						} else if (str_equals(class_name, "cntrl")) {
-							mask = std::ctype_base::cntrl;
-							recognized = true;
-						} else if (str_equals(class_name, "print")) {
-							mask = std::ctype_base::print;
-							recognized = true;
-						} else if (str_equals(class_name, "graph")) {
-							mask = std::ctype_base::graph;
-							recognized = true;
-						}
-
-						if (recognized) {
-							bool first_char = true;
-							for (int c = 0; c < max_char; ++c) {
-								CharT ch = static_cast<CharT>(c);
-								if (ct.is(mask, ch)) {
-									// Need to escape special regex characters inside bracket expressions
-									// Backslash, closing bracket always need escaping
-									if (ch == CharT('\\') || ch == CharT(']')) {
-										expansion += CharT('\\');
-										expansion += ch;
-									}
-									// Opening bracket needs escaping
-									else if (ch == CharT('[')) {
-										expansion += CharT('\\');
-										expansion += ch;
-									}
-									// Braces need escaping in extended mode (for repetition syntax)
-									else if (ch == CharT('{') || ch == CharT('}')) {
-										expansion += CharT('\\');
-										expansion += ch;
-									}
-									// Caret only needs escaping at the beginning
-									else if (ch == CharT('^') && first_char) {
-										expansion += CharT('\\');
-										expansion += ch;
-									}
-									// Hyphen: place it at the end to avoid range issues
-									// We'll collect hyphens separately
-									else if (ch != CharT('-')) {
-										expansion += ch;
-									}
-									first_char = false;
-								}
-							}
-
-							// Add hyphen at the end if it was in the character class
-							// At the end of a bracket expression, hyphen doesn't need escaping
-							for (int c = 0; c < max_char; ++c) {
-								CharT ch = static_cast<CharT>(c);
-								if (ch == CharT('-') && ct.is(mask, ch)) {
-									expansion += ch;
-									break;  // Only add one hyphen
-								}
-							}
-
-							// If expansion is empty (no characters match the class),
-							// we need to ensure the bracket expression isn't empty to avoid
-							// "empty range in char class" errors.
-							// Use a non-printing character unlikely to appear in normal text.
-							static const CharT UNMATCHABLE_CHAR = CharT('\x7F'); // DEL character (ASCII 127)
-							if (expansion.empty()) {
-								expansion += UNMATCHABLE_CHAR;
-							}
-
-							result += expansion;
+						if (index >= 0) {
+							if (!table) table = _posix_class_table::get(loc, sizeof(CharT) == 1);
+							_append_posix_class(result, table->ranges[index]);
 						} else {
 							// Not a recognized POSIX class, restore original
 							result += pattern.substr(class_start, i - class_start);
@@ -1031,20 +2097,20 @@ _posix_class_expander<CharT,
 }
 
 template <class CharT, class Traits>
-typename basic_regex<CharT, Traits>::string_type
-basic_regex<CharT, Traits>::_preprocess_pattern_for_ecmascript(const string_type& pattern) const {
+_scratch_string<CharT>
+basic_regex<CharT, Traits>::_preprocess_pattern_for_ecmascript(const _scratch_string<CharT>& pattern) const {
 	// ECMAScript pattern preprocessing for compatibility with std::regex ECMAScript mode
 	// Handles: \xHH, \uHHHH, \0, named capture normalization, and multiline emulation
 
-	typedef typename string_type::size_type size_type;
+	typedef typename _scratch_string<CharT>::size_type size_type;
 
 	// First, apply multiline emulation if the multiline flag is set
-	string_type working_pattern = pattern;
+	_scratch_string<CharT> working_pattern = pattern;
 	if (m_flags & regex_constants::multiline) {
 		working_pattern = _emulate_ecmascript_multiline(working_pattern);
 	}
 
-	string_type result;
+	_scratch_string<CharT> result;
 	result.reserve(working_pattern.size());
 
 	size_type i = 0;
@@ -1139,26 +2205,47 @@ basic_regex<CharT, Traits>::_preprocess_pattern_for_ecmascript(const string_type
 }
 
 template <class CharT, class Traits>
-typename basic_regex<CharT, Traits>::string_type
-basic_regex<CharT, Traits>::_emulate_ecmascript_multiline(const string_type& pattern) const {
-	// ECMAScript multiline emulation: Rewrite ^ and $ anchors to match at line boundaries
-	// without enabling Oniguruma's MULTILINE option (which also changes dot behavior).
+_scratch_string<CharT>
+basic_regex<CharT, Traits>::_emulate_ecmascript_multiline(const _scratch_string<CharT>& pattern) const {
+	// ECMAScript multiline: Make ^ and $ match at the configured line terminators.
+	// The regex is compiled without SINGLELINE, so ^ and $ are Oniguruma's native
+	// line anchors, which recognize LF and keep Oniguruma's anchor optimizations.
 	//
 	// In ECMAScript, the multiline flag affects only ^ and $ anchors:
 	// - ^ matches at start of string OR after any line terminator
 	// - $ matches at end of string OR before any line terminator
 	// - Dot (.) behavior is NOT affected by multiline (controlled separately by dotall/s)
 	//
-	// This function rewrites:
-	// - ^ to: (?:\A|(?:(?<=\n)|(?<=\r\n)|(?<=\r)|(?<=\u2028)|(?<=\u2029)))
-	// - $ to: (?:\z|(?=(?:\r\n|\r|\n|\u2028|\u2029)))
+	// Line terminators are chosen by the line_terminator_* flags (all of LF, CR,
+	// U+2028 and U+2029 when none is set). Terminators other than LF are added
+	// with a single lookaround per anchor; for example, with the default set:
+	// - ^ becomes: (?:^|(?<=\n)\z|(?<=[\r\u2028\u2029]))
+	// - $ becomes: (?:$|(?=[\r\u2028\u2029]))
+	// The native ^ does not match at the end of the subject after a final LF,
+	// where ECMAScript's does, hence (?<=\n)\z (also with LF alone). Without
+	// LF, \A and \z stand in for the native anchors.
 	//
 	// Note: The rewrite must only affect unescaped ^ and $ that are outside character classes.
-	// Performance: Pattern rewriting adds CPU cost at regex compile time.
 	// Limitations: Complex patterns with nested groups or unusual contexts may have edge cases.
 
-	typedef typename string_type::size_type size_type;
-	string_type result;
+	flag_type terminators = m_flags & regex_constants::line_terminators;
+	if (!terminators) terminators = regex_constants::line_terminators;
+
+	std::string others;
+	if (terminators & regex_constants::line_terminator_cr) others += "\\r";
+	if (terminators & regex_constants::line_terminator_unicode) others += "\\u2028\\u2029";
+
+	const bool lf = !!(terminators & regex_constants::line_terminator_lf);
+	std::string caret = lf ? "(?:^|(?<=\\n)\\z" : "(?:\\A";
+	std::string dollar = lf ? "$" : "\\z";
+	if (!others.empty()) {
+		caret += "|(?<=[" + others + "])";
+		dollar = "(?:" + dollar + "|(?=[" + others + "]))";
+	}
+	caret += ")";
+
+	typedef typename _scratch_string<CharT>::size_type size_type;
+	_scratch_string<CharT> result;
 	result.reserve(pattern.size() * 2); // Reserve extra space for expansions
 
 	size_type i = 0;
@@ -1166,26 +2253,17 @@ basic_regex<CharT, Traits>::_emulate_ecmascript_multiline(const string_type& pat
 	bool in_char_class = false;
 	int bracket_depth = 0; // Track nesting level for character classes
 
-	// Replacement strings as constants for maintainability
-	// In ECMAScript multiline: ^ matches at start OR after line terminators
-	// Line terminators: LF (\n), CR (\r), CRLF (\r\n), U+2028 (line separator), U+2029 (paragraph separator)
-	// Note: (?<=\r\n) is a fixed-length lookbehind (2 bytes) and is supported by Oniguruma
-	static constexpr const char* CARET_REPLACEMENT = "(?:\\A|(?:(?<=\\n)|(?<=\\r\\n)|(?<=\\r)|(?<=\\u2028)|(?<=\\u2029)))";
-
-	// In ECMAScript multiline: $ matches at end OR before line terminators
-	static constexpr const char* DOLLAR_REPLACEMENT = "(?:\\z|(?=(?:\\r\\n|\\r|\\n|\\u2028|\\u2029)))";
-
 	// Helper to append the replacement for ^ (start of line)
-	auto append_caret_replacement = [&result]() {
-		for (const char* p = CARET_REPLACEMENT; *p; ++p) {
-			result += CharT(*p);
+	auto append_caret_replacement = [&result, &caret]() {
+		for (char c : caret) {
+			result += CharT(c);
 		}
 	};
 
 	// Helper to append the replacement for $ (end of line)
-	auto append_dollar_replacement = [&result]() {
-		for (const char* p = DOLLAR_REPLACEMENT; *p; ++p) {
-			result += CharT(*p);
+	auto append_dollar_replacement = [&result, &dollar]() {
+		for (char c : dollar) {
+			result += CharT(c);
 		}
 	};
 
@@ -1250,38 +2328,16 @@ basic_regex<CharT, Traits>::imbue(locale_type loc) {
 	locale_type old_locale = m_locale;
 	m_locale = loc;
 
-	// Recompile the regex if we have a pattern
-	if (!m_pattern.empty()) {
-		// Free existing regex
-		if (m_regex) {
-			onig_free(m_regex);
-			m_regex = nullptr;
-		}
-
-		// Preprocess pattern for ECMAScript compatibility if needed
-		// Skip preprocessing when oniguruma flag is set - use native Oniguruma syntax
-		string_type compiled_pattern = m_pattern;
-		if ((m_flags & regex_constants::ECMAScript) && !(m_flags & regex_constants::oniguruma)) {
-			compiled_pattern = _preprocess_pattern_for_ecmascript(compiled_pattern);
-		}
-
-		// Preprocess pattern with new locale (when collate flag is set)
-		if (m_flags & regex_constants::collate) {
-			compiled_pattern = _preprocess_pattern_for_locale(compiled_pattern);
+	// Recompile the regex if we have a pattern. The compiled program only
+	// depends on the locale when collate is set, so otherwise the shared
+	// program is kept as is. Other copies keep their own program.
+	if (m_program && !m_program->pattern.empty() && (m_flags & regex_constants::collate)) {
+		try {
+			_compile(m_program->pattern, m_program->encoding);
+		} catch (...) {
+			m_locale = old_locale;
+			throw;
 		}
-
-		// Compile with the preprocessed pattern
-		OnigSyntaxType* syntax = _syntax_from_flags(m_flags);
-		OnigOptionType options = _options_from_flags(m_flags);
-		OnigErrorInfo err_info;
-
-		const CharT* s = compiled_pattern.c_str();
-		size_type count = compiled_pattern.length();
-
-		int err = onig_new(&m_regex, reinterpret_cast<const OnigUChar*>(s),
-		                   reinterpret_cast<const OnigUChar*>(s + count),
-		                   options, m_encoding, syntax, &err_info);
-		if (err != ONIG_NORMAL) throw regex_error(regex_constants::map_oniguruma_error(err), err_info);
 	}
 
 	return old_locale;
@@ -1304,153 +2360,191 @@ bool regex_search(
 	return _regex_search_with_context(first, first, last, m, e, flags);
 }
 
-////////////////////////////////////////////
-// regex_match implementation
-
-// Internal implementation for non-contiguous iterators (uses buffer copy)
-template <class BidirIt, class Alloc, class CharT, class Traits>
-typename std::enable_if<
-	!_is_contiguous_iterator<BidirIt>::value,
-	bool
->::type
-_regex_match_impl(
-	BidirIt first, BidirIt last,
-	match_results<BidirIt, Alloc>& m,
-	const basic_regex<CharT, Traits>& e,
+// Like _process_onig_region_result, but only records the byte offsets
+template <class CharT>
+bool _process_onig_region_offsets(
+	int r,
+	OnigRegion* region,
+	match_offsets& m,
+	regex_constants::syntax_option_type regex_flags,
 	regex_constants::match_flag_type flags,
-	OnigRegex reg,
-	OnigOptionType onig_options,
-	size_type len)
+	const capture_mask& captures = capture_mask())
 {
-	// Handle match_not_bow and match_not_eow by prepending/appending word characters
-	bool needs_bow_prefix = (flags & regex_constants::match_not_bow);
-	bool needs_eow_suffix = (flags & regex_constants::match_not_eow);
+	m.m_ready = true;
+	m.m_char_size = sizeof(CharT);
+	m.clear();
 
-	// Copy the subject range into a temporary contiguous buffer to support
-	// non-contiguous BidirectionalIterators (e.g., std::list, std::deque)
-	std::basic_string<CharT> subject_buf;
-	size_type prefix_len = 0;
+	if (r >= 0) {
+		// match_not_null: a zero-length match counts as a failure
+		if ((flags & regex_constants::match_not_null) && region->beg[0] == region->end[0])
+			return false;
 
-	if (needs_bow_prefix) {
-		subject_buf += CharT('a');
-		prefix_len = 1;
+		// nosubs: only the full match
+		int count = _is_nosubs_active(regex_flags, flags) ? 1 : region->num_regs;
+		m.m_bytes.resize(count);
+		for (int i = 0; i < count; ++i) {
+			if (region->beg[i] != ONIG_REGION_NOTPOS && captures.contains(i)) {
+				m.m_bytes[i].first = static_cast<size_type>(region->beg[i]);
+				m.m_bytes[i].second = static_cast<size_type>(region->end[i]);
+			} else {
+				m.m_bytes[i].first = m.m_bytes[i].second = match_offsets::npos;
+			}
+		}
+		return true;
 	}
-	subject_buf.append(first, last);
-	if (needs_eow_suffix) {
-		subject_buf += CharT('a');
+	else if (r == ONIG_MISMATCH) {
+		return false;
 	}
+	else {
+		OnigErrorInfo einfo;
+		std::memset(&einfo, 0, sizeof(einfo));
+		throw regex_error(regex_constants::map_oniguruma_error(r), einfo);
+	}
+}
 
-	size_type buf_len = subject_buf.size();
-
-	// Use stable static buffer for empty ranges to avoid passing nullptr to C API
-	static thread_local CharT empty_char = CharT();
-	const CharT* start_ptr = (buf_len > 0) ? subject_buf.c_str() : &empty_char;
-	const CharT* end_ptr = start_ptr + (len + prefix_len); // End of original content
-	const CharT* context_end_ptr = start_ptr + buf_len; // End including suffix
-
-	// Cast to Oniguruma pointers
-	const OnigUChar* u_start = reinterpret_cast<const OnigUChar*>(start_ptr);
-	const OnigUChar* u_end   = reinterpret_cast<const OnigUChar*>(needs_eow_suffix ? context_end_ptr : end_ptr);
-	const OnigUChar* u_match_at = reinterpret_cast<const OnigUChar*>(start_ptr + prefix_len);
-
-	// Allocate OnigRegion
-	OnigRegion* region = onig_region_new();
-	if (!region) {
-		throw std::bad_alloc();
+// Searches the contiguous subject [whole, whole + total_len) from
+// search_offset and stores offsets relative to whole in m
+template <class CharT, class Traits>
+bool _regex_search_offsets(
+	const CharT* whole, size_type total_len, size_type search_offset,
+	match_offsets& m,
+	const basic_regex<CharT, Traits>& e,
+	regex_constants::match_flag_type flags)
+{
+	OnigRegex reg = _regex_for_flags(e, flags);
+	if (!reg) {
+		m.clear();
+		return false;
 	}
 
-	// Execute match at the adjusted position
-	int r = onig_match(reg, u_start, u_end, u_match_at, region, onig_options);
+	OnigOptionType onig_options = ONIG_OPTION_NONE;
+	if (flags & regex_constants::match_not_bol) onig_options |= ONIG_OPTION_NOTBOL;
+	if (flags & regex_constants::match_not_eol) onig_options |= ONIG_OPTION_NOTEOL;
 
-	// Adjust region offsets to account for prefix
-	if (r >= 0) {
-		_adjust_region_offsets_prefix<CharT>(region, prefix_len);
-	}
+	// Borrow the per-thread OnigRegion scratch
+	_region_scratch scratch;
+	OnigRegion* region = scratch.get();
 
-	// Use common helper to process region and populate match_results
-	return _onig_region_to_match_results<BidirIt, Alloc, CharT, Traits>(
-		r, region, first, last, m, e.flags(), flags, len);
+	_search_probe<CharT, Traits> probe(e, false, (total_len - search_offset) * sizeof(CharT));
+	int r = _onig_search_at(reg, whole, total_len, search_offset, flags, onig_options, region, e.limits(),
+	                        _prefilter_of(e));
+	bool found = _process_onig_region_offsets<CharT>(r, region, m, e.flags(), flags, e.captures());
+	probe.finish();
+	return found;
 }
 
-// Internal implementation for contiguous iterators (optimized, no buffer copy)
-template <class BidirIt, class Alloc, class CharT, class Traits>
-typename std::enable_if<
-	_is_contiguous_iterator<BidirIt>::value,
-	bool
->::type
-_regex_match_impl(
+template <class BidirIt, class CharT, class Traits>
+bool regex_search(
 	BidirIt first, BidirIt last,
-	match_results<BidirIt, Alloc>& m,
+	match_offsets& m,
 	const basic_regex<CharT, Traits>& e,
-	regex_constants::match_flag_type flags,
-	OnigRegex reg,
-	OnigOptionType onig_options,
-	size_type len)
+	regex_constants::match_flag_type flags)
 {
-	// Handle match_not_bow and match_not_eow by prepending/appending word characters
-	bool needs_bow_prefix = (flags & regex_constants::match_not_bow);
-	bool needs_eow_suffix = (flags & regex_constants::match_not_eow);
+	size_type len = std::distance(first, last);
+	_scratch_string<CharT> subject_buf;
+	const CharT* whole = _contiguous_subject<CharT>(first, last, len, subject_buf,
+	                                                (flags & regex_constants::match_prev_avail) != 0);
+	return _regex_search_offsets(whole, len, 0, m, e, flags);
+}
 
-	// If we need BOW/EOW modifications, use buffer-based approach
-	if (needs_bow_prefix || needs_eow_suffix) {
-		std::basic_string<CharT> subject_buf;
-		size_type prefix_len = 0;
+////////////////////////////////////////////
+// Implementation of regex_offset_iterator
 
-		if (needs_bow_prefix) {
-			subject_buf += CharT('a');
-			prefix_len = 1;
-		}
-		subject_buf.append(first, last);
-		if (needs_eow_suffix) {
-			subject_buf += CharT('a');
-		}
+template <class BidirIt, class CharT, class Traits>
+regex_offset_iterator<BidirIt, CharT, Traits>::regex_offset_iterator(
+	BidirIt first, BidirIt last, const regex_type& re, match_flag_type flags)
+	: m_data(nullptr), m_size(std::distance(first, last)), m_regex(&re), m_flags(flags)
+{
+	std::basic_string<CharT> buf;
+	const bool prev_avail = (flags & regex_constants::match_prev_avail) != 0;
+	m_data = _contiguous_subject<CharT>(first, last, m_size, buf, prev_avail);
+	if (!_is_contiguous_iterator<BidirIt>::value) {
+		// Keep the copy of a non-contiguous range alive for all copies of
+		// the iterator
+		auto shared = std::make_shared<const basic_string<CharT>>(std::move(buf));
+		m_data = shared->c_str() + (prev_avail ? 1 : 0);
+		m_buffer = shared;
+	}
+	do_search(0);
+}
+
+template <class BidirIt, class CharT, class Traits>
+void regex_offset_iterator<BidirIt, CharT, Traits>::do_search(size_type offset) {
+	if (!_regex_search_offsets(m_data, m_size, offset, m_results, *m_regex, m_flags)) {
+		// Invalidate as end iterator
+		m_regex = nullptr;
+		m_results.clear();
+	}
+}
 
-		size_type buf_len = subject_buf.size();
-		const CharT* start_ptr = subject_buf.c_str();
-		const CharT* end_ptr = start_ptr + (len + prefix_len);
-		const CharT* context_end_ptr = start_ptr + buf_len;
+template <class BidirIt, class CharT, class Traits>
+bool regex_offset_iterator<BidirIt, CharT, Traits>::operator==(const regex_offset_iterator& other) const {
+	if (m_regex == nullptr && other.m_regex == nullptr) return true;
+	if (m_regex == nullptr || other.m_regex == nullptr) return false;
+	if (m_results.empty() || other.m_results.empty()) return false;
 
-		const OnigUChar* u_start = reinterpret_cast<const OnigUChar*>(start_ptr);
-		const OnigUChar* u_end   = reinterpret_cast<const OnigUChar*>(needs_eow_suffix ? context_end_ptr : end_ptr);
-		const OnigUChar* u_match_at = reinterpret_cast<const OnigUChar*>(start_ptr + prefix_len);
+	return m_data == other.m_data &&
+		   m_results.position(0) == other.m_results.position(0) &&
+		   m_results.length(0) == other.m_results.length(0);
+}
 
-		OnigRegion* region = onig_region_new();
-		if (!region) throw std::bad_alloc();
+template <class BidirIt, class CharT, class Traits>
+regex_offset_iterator<BidirIt, CharT, Traits>& regex_offset_iterator<BidirIt, CharT, Traits>::operator++() {
+	if (m_regex == nullptr || m_results.empty()) {
+		return *this;
+	}
 
-		int r = onig_match(reg, u_start, u_end, u_match_at, region, onig_options);
+	size_type current_match_end = m_results.position(0) + m_results.length(0);
 
-		// Adjust region offsets to account for prefix
-		if (r >= 0) {
-			_adjust_region_offsets_prefix<CharT>(region, prefix_len);
+	// Zero-width match handling (as regex_iterator)
+	if (m_results.length(0) == 0) {
+		if (current_match_end == m_size) {
+			m_regex = nullptr;
+			m_results.clear();
+			return *this;
 		}
-
-		// Use common helper to process region and populate match_results
-		return _onig_region_to_match_results<BidirIt, Alloc, CharT, Traits>(
-			r, region, first, last, m, e.flags(), flags, len);
+		++current_match_end;
 	}
 
-	// Fast path: use direct pointer access for contiguous iterators
-	// Use stable static buffer for empty ranges to avoid passing nullptr to C API
-	static thread_local CharT empty_char = CharT();
-	const CharT* start_ptr = (len > 0) ? _get_contiguous_pointer(first) : &empty_char;
-	const CharT* end_ptr = start_ptr + len;
+	do_search(current_match_end);
+	return *this;
+}
 
-	// Cast to Oniguruma pointers
-	const OnigUChar* u_start = reinterpret_cast<const OnigUChar*>(start_ptr);
-	const OnigUChar* u_end   = reinterpret_cast<const OnigUChar*>(end_ptr);
+template <class BidirIt, class CharT, class Traits>
+regex_offset_iterator<BidirIt, CharT, Traits> regex_offset_iterator<BidirIt, CharT, Traits>::operator++(int) {
+	regex_offset_iterator tmp = *this;
+	++(*this);
+	return tmp;
+}
 
-	// Allocate OnigRegion
-	OnigRegion* region = onig_region_new();
-	if (!region) {
-		throw std::bad_alloc();
-	}
+////////////////////////////////////////////
+// regex_match implementation
+
+// Matches at the beginning of the subject (no buffer copy for contiguous iterators)
+template <class BidirIt, class Alloc, class CharT, class Traits>
+bool _regex_match_impl(
+	BidirIt first, BidirIt last,
+	match_results<BidirIt, Alloc>& m,
+	const basic_regex<CharT, Traits>& e,
+	regex_constants::match_flag_type flags,
+	OnigRegex reg,
+	OnigOptionType onig_options,
+	size_type len)
+{
+	_scratch_string<CharT> subject_buf;
+	const CharT* whole = _contiguous_subject<CharT>(first, last, len, subject_buf,
+	                                                (flags & regex_constants::match_prev_avail) != 0);
+
+	// Borrow the per-thread OnigRegion scratch
+	_region_scratch scratch;
+	OnigRegion* region = scratch.get();
 
-	// Execute match
-	int r = onig_match(reg, u_start, u_end, u_start, region, onig_options);
+	int r = _onig_search_at(reg, whole, len, 0, flags | regex_constants::match_continuous,
+	                        onig_options, region, e.limits());
 
 	// Use common helper to process region and populate match_results
 	return _onig_region_to_match_results<BidirIt, Alloc, CharT, Traits>(
-		r, region, first, last, m, e.flags(), flags, len);
+		r, region, first, last, m, e.flags(), flags, len, e.captures());
 }
 
 // Public wrapper that dispatches to the appropriate implementation
@@ -1462,7 +2556,7 @@ bool regex_match(
 	regex_constants::match_flag_type flags)
 {
 	// Get Oniguruma regex object (using accessor hack)
-	OnigRegex reg = _regex_access<CharT, Traits>::get(e);
+	OnigRegex reg = _regex_for_flags(e, flags);
 	if (!reg) return false;
 
 	// Options before search execution
@@ -1475,7 +2569,10 @@ bool regex_match(
 	size_type len = std::distance(first, last);
 
 	// Dispatch to the appropriate implementation based on iterator type
-	return _regex_match_impl(first, last, m, e, flags, reg, onig_options, len);
+	_search_probe<CharT, Traits> probe(e, true, len * sizeof(CharT));
+	bool found = _regex_match_impl(first, last, m, e, flags, reg, onig_options, len);
+	probe.finish();
+	return found;
 }
 
 ////////////////////////////////////////////
@@ -1514,6 +2611,200 @@ struct _name_resolver {
 	}
 };
 
+////////////////////////////////////////////
+// Implementation of basic_regex_format
+
+template <class CharT, class Traits>
+basic_regex_format<CharT, Traits>::basic_regex_format(
+	const string_type& fmt, regex_constants::match_flag_type flags)
+{
+	_parse(fmt, nullptr, flags);
+}
+
+template <class CharT, class Traits>
+basic_regex_format<CharT, Traits>::basic_regex_format(
+	const string_type& fmt, const regex_type& e, regex_constants::match_flag_type flags)
+{
+	_parse(fmt, &e, flags);
+}
+
+template <class CharT, class Traits>
+void basic_regex_format<CharT, Traits>::_add_literal(CharT ch) {
+	if (m_items.empty() || m_items.back().kind != _literal) {
+		_item item = { _literal, 0, m_literals.size(), 0 };
+		m_items.push_back(item);
+	}
+	m_literals += ch;
+	++m_items.back().length;
+}
+
+template <class CharT, class Traits>
+void basic_regex_format<CharT, Traits>::_add_reference(_kind kind, size_type group) {
+	_item item = { kind, group, 0, 0 };
+	m_items.push_back(item);
+}
+
+// Parses fmt with the rules of match_results::format (the extended overload
+// when e is given). References that can never match, such as unknown names,
+// produce no item.
+template <class CharT, class Traits>
+void basic_regex_format<CharT, Traits>::_parse(
+	const string_type& fmt, const regex_type* e, regex_constants::match_flag_type flags)
+{
+	m_items.clear();
+	m_literals.clear();
+
+	const CharT* p = fmt.data();
+	const CharT* fmt_last = p + fmt.size();
+
+	if (flags & regex_constants::format_literal) {
+		// format_literal: the replacement string is copied as-is
+		for (; p != fmt_last; ++p) _add_literal(*p);
+		return;
+	}
+
+	bool oniguruma_mode = e && (_regex_access<CharT, Traits>::get_flags(*e) & regex_constants::oniguruma) != 0;
+	auto resolve = [e](const CharT* name_begin, const CharT* name_end) {
+		return e ? _get_named_group_number(*e, name_begin, name_end) : -1;
+	};
+	auto add_group = [this](int num) {
+		if (num >= 0) _add_reference(_group, static_cast<size_type>(num));
+	};
+
+	while (p != fmt_last) {
+		// Handle '$' placeholders
+		if (*p == CharT('$') && p + 1 != fmt_last) {
+			CharT next = *(p + 1);
+
+			if (next == CharT('$')) { // $$ -> literal '$'
+				_add_literal(CharT('$'));
+				p += 2;
+				continue;
+			}
+			if (next == CharT('&')) { // $& -> full match
+				_add_reference(_group, 0);
+				p += 2;
+				continue;
+			}
+			if (next == CharT('`')) { // $` -> prefix
+				_add_reference(_prefix);
+				p += 2;
+				continue;
+			}
+			if (next == CharT('\'')) { // $' -> suffix
+				_add_reference(_suffix);
+				p += 2;
+				continue;
+			}
+
+			// ${n} or ${name}
+			if (next == CharT('{')) {
+				const CharT* name_start = p + 2;
+				const CharT* name_end = name_start;
+				while (name_end != fmt_last && *name_end != CharT('}')) {
+					++name_end;
+				}
+				if (name_end != fmt_last && name_end > name_start) {
+					const CharT* parse_end = name_start;
+					int num = _format_parse_numeric<CharT>::parse_bounded(name_start, name_end, parse_end);
+					add_group(num >= 0 ? num : resolve(name_start, name_end));
+					p = name_end + 1;
+				} else {
+					// Empty or unclosed ${...}: literal '$'
+					_add_literal(*p++);
+				}
+				continue;
+			}
+
+			// $n, $nn
+			if (next >= CharT('0') && next <= CharT('9')) {
+				const CharT* q;
+				add_group(_format_parse_numeric<CharT>::parse_greedy(p + 1, fmt_last, q));
+				p = q;
+				continue;
+			}
+
+			// Unknown $ sequence - output as-is
+			_add_literal(*p++);
+			continue;
+		}
+
+		// Handle '\' sequences
+		if (*p == CharT('\\') && p + 1 != fmt_last) {
+			CharT next = *(p + 1);
+
+			if (next == CharT('\\')) {
+				_add_literal(CharT('\\'));
+				p += 2;
+				continue;
+			}
+
+			if (oniguruma_mode) {
+				// \k<name> or \k'name'
+				if (next == CharT('k')) {
+					CharT close_delim = CharT('\0');
+					if (p + 2 != fmt_last) {
+						if (*(p + 2) == CharT('<')) close_delim = CharT('>');
+						else if (*(p + 2) == CharT('\'')) close_delim = CharT('\'');
+					}
+					if (close_delim != CharT('\0')) {
+						const CharT* name_start = p + 3;
+						const CharT* name_end = name_start;
+						while (name_end != fmt_last && *name_end != close_delim) {
+							++name_end;
+						}
+						if (name_end != fmt_last && name_end > name_start) {
+							add_group(resolve(name_start, name_end));
+							p = name_end + 1;
+							continue;
+						}
+					}
+					// Invalid reference: literal '\k'
+					_add_literal(CharT('\\'));
+					_add_literal(CharT('k'));
+					p += 2;
+					continue;
+				}
+
+				// \n - numeric backreference
+				if (next >= CharT('0') && next <= CharT('9')) {
+					const CharT* q;
+					add_group(_format_parse_numeric<CharT>::parse_greedy(p + 1, fmt_last, q));
+					p = q;
+					continue;
+				}
+
+				// Other escapes: literal backslash
+				_add_literal(*p++);
+				continue;
+			}
+
+			if (next == CharT('n')) {
+				_add_literal(CharT('\n'));
+				p += 2;
+				continue;
+			}
+			if (next == CharT('t')) {
+				_add_literal(CharT('\t'));
+				p += 2;
+				continue;
+			}
+			if (next == CharT('r')) {
+				_add_literal(CharT('\r'));
+				p += 2;
+				continue;
+			}
+
+			// Unknown escape - output as-is
+			_add_literal(*p++);
+			continue;
+		}
+
+		// Regular character
+		_add_literal(*p++);
+	}
+}
+
 template <class OutputIt, class BidirIt, class CharT, class Traits>
 OutputIt regex_replace(
 	OutputIt out,
@@ -1521,20 +2812,42 @@ OutputIt regex_replace(
 	const basic_regex<CharT, Traits>& e,
 	const basic_string<CharT>& fmt,
 	regex_constants::match_flag_type flags)
+{
+	// Parse the format once rather than for every match
+	return regex_replace(out, first, last, e, basic_regex_format<CharT, Traits>(fmt, e, flags), flags);
+}
+
+// e, or a copy of e storing every group when e has a capture mask. The
+// format of regex_replace and the fields of regex_split may refer to any
+// group, so the mask is not applied there.
+template <class CharT, class Traits>
+const basic_regex<CharT, Traits>& _unmasked_regex(const basic_regex<CharT, Traits>& e, basic_regex<CharT, Traits>& copy) {
+	if (e.captures().is_all())
+		return e;
+	copy = e; // Shares the compiled program
+	copy.set_captures(capture_mask());
+	return copy;
+}
+
+template <class OutputIt, class BidirIt, class CharT, class Traits>
+OutputIt regex_replace(
+	OutputIt out,
+	BidirIt first, BidirIt last,
+	const basic_regex<CharT, Traits>& e,
+	const basic_regex_format<CharT, Traits>& fmt,
+	regex_constants::match_flag_type flags)
 {
 	using iterator_t = regex_iterator<BidirIt, CharT, Traits>;
 
 	BidirIt cur = first;
 	bool first_only = (flags & regex_constants::format_first_only) != 0;
 	bool no_copy = (flags & regex_constants::format_no_copy) != 0;
-	bool literal_mode = (flags & regex_constants::format_literal) != 0;
-	bool oniguruma_mode = (_regex_access<CharT, Traits>::get_flags(e) & regex_constants::oniguruma) != 0;
 
-	// Create name resolver functor for named group support
-	_name_resolver<CharT, Traits> resolver(e);
+	basic_regex<CharT, Traits> unmasked;
+	const basic_regex<CharT, Traits>& re = _unmasked_regex(e, unmasked);
 
 	// Use regex_iterator to enumerate matches (it already handles zero-width advancement)
-	for (iterator_t it(first, last, e, flags), end; it != end; ++it) {
+	for (iterator_t it(first, last, re, flags), end; it != end; ++it) {
 		const auto& m = *it; // match_results<BidirIt>
 		// copy text from cur to match start
 		if (!no_copy) {
@@ -1542,13 +2855,7 @@ OutputIt regex_replace(
 		}
 
 		// produce replacement for this match
-		if (literal_mode) {
-			// format_literal: copy replacement string as-is without any escape processing
-			out = std::copy(fmt.begin(), fmt.end(), out);
-		} else {
-			// Use match_results::format with name resolver and oniguruma_mode
-			out = m.format(out, fmt.data(), fmt.data() + fmt.size(), flags, resolver, oniguruma_mode);
-		}
+		out = fmt.apply(out, m);
 
 		// move cur to end of matched region
 		cur = m[0].second;
@@ -1569,6 +2876,65 @@ OutputIt regex_replace(
 	return out;
 }
 
+template <class CharT, class Traits>
+size_type regex_replace_append(
+	basic_string<CharT>& dest,
+	const CharT* first, const CharT* last,
+	const basic_regex<CharT, Traits>& e,
+	const basic_regex_format<CharT, Traits>& fmt,
+	regex_constants::match_flag_type flags)
+{
+	// Offsets are enough here: no sub_match vector is built per match
+	using iterator_t = regex_offset_iterator<const CharT*, CharT, Traits>;
+
+	bool first_only = (flags & regex_constants::format_first_only) != 0;
+	bool no_copy = (flags & regex_constants::format_no_copy) != 0;
+	const size_type base = dest.size();
+	const size_type len = static_cast<size_type>(last - first);
+
+	// Assume the output is about as long as the input until the first
+	// replacement shows otherwise
+	if (!no_copy) dest.reserve(base + len);
+
+	basic_regex<CharT, Traits> unmasked;
+	const basic_regex<CharT, Traits>& re = _unmasked_regex(e, unmasked);
+
+	size_type count = 0;
+	const CharT* cur = first;
+	for (iterator_t it(first, last, re, flags), end; it != end; ++it) {
+		const match_offsets& m = *it;
+		if (!no_copy) {
+			dest.append(cur, first + m.position(0));
+		}
+		fmt.append_to(dest, m, first, last);
+		cur = first + m.position(0) + m.length(0);
+		++count;
+
+		if (first_only) break;
+
+		if (count == 1 && !no_copy && cur != first) {
+			// Extrapolate the growth seen so far over the rest of the input
+			size_type consumed = static_cast<size_type>(cur - first);
+			size_type produced = dest.size() - base;
+			if (produced > consumed) {
+				// One match says little about the rest of the input, so
+				// reserve at most twice the current size; append grows the
+				// string further if needed
+				const size_type rest = len - consumed;
+				const size_type growth = produced - consumed;
+				const size_type cap = dest.size();
+				const size_type extra = (rest / consumed < cap / growth) ? rest / consumed * growth + growth : cap;
+				dest.reserve(dest.size() + rest + std::min(extra, cap));
+			}
+		}
+	}
+
+	if (!no_copy) {
+		dest.append(cur, last);
+	}
+	return count;
+}
+
 template <class OutputIt, class BidirIt, class CharT, class Traits>
 OutputIt regex_replace(
 	OutputIt out,
@@ -1582,68 +2948,366 @@ OutputIt regex_replace(
 }
 
 ////////////////////////////////////////////
-// Implementation of regex_iterator
+// regex_test, regex_count implementation
 
-template <class BidirIt, class CharT, class Traits>
-void regex_iterator<BidirIt, CharT, Traits>::do_search(BidirIt first, BidirIt last) {
-	// Try to search - we allow first == last for zero-width patterns which can match at end position
-	if (!_regex_search_with_context(m_begin, first, last, m_results, *m_regex, m_flags)) {
-		// Invalidate as end iterator
-		m_regex = nullptr;
-		m_results.clear();
-	}
+template <class CharT, class Traits>
+bool regex_test(
+	const CharT* first, const CharT* last,
+	const basic_regex<CharT, Traits>& e,
+	regex_constants::match_flag_type flags)
+{
+	OnigRegex reg = _regex_for_flags(e, flags);
+	if (!reg) return false;
+
+	OnigOptionType onig_options = ONIG_OPTION_NONE;
+	if (flags & regex_constants::match_not_bol) onig_options |= ONIG_OPTION_NOTBOL;
+	if (flags & regex_constants::match_not_eol) onig_options |= ONIG_OPTION_NOTEOL;
+
+	const size_type len = static_cast<size_type>(last - first);
+	std::basic_string<CharT> unused;
+	const CharT* p = _contiguous_subject<CharT>(first, last, len, unused,
+	                                            (flags & regex_constants::match_prev_avail) != 0);
+	return _regex_test_at(reg, p, len, e, flags, onig_options);
 }
 
-template <class BidirIt, class CharT, class Traits>
-regex_iterator<BidirIt, CharT, Traits>::regex_iterator(
-	BidirIt first, BidirIt last,
-	const regex_type& re,
-	match_flag_type flags)
-	: m_begin(first), m_end(last), m_regex(&re), m_flags(flags)
+template <class CharT, class Traits>
+size_type regex_count(
+	const CharT* first, const CharT* last,
+	const basic_regex<CharT, Traits>& e,
+	regex_constants::match_flag_type flags)
 {
-	// Execute the first search
-	do_search(first, last);
+	OnigRegex reg = _regex_for_flags(e, flags);
+	if (!reg) return 0;
+
+	OnigOptionType onig_options = ONIG_OPTION_NONE;
+	if (flags & regex_constants::match_not_bol) onig_options |= ONIG_OPTION_NOTBOL;
+	if (flags & regex_constants::match_not_eol) onig_options |= ONIG_OPTION_NOTEOL;
+
+	const size_type len = static_cast<size_type>(last - first);
+	std::basic_string<CharT> unused;
+	const CharT* p = _contiguous_subject<CharT>(first, last, len, unused,
+	                                            (flags & regex_constants::match_prev_avail) != 0);
+
+	// Borrow the per-thread OnigRegion scratch
+	_region_scratch scratch;
+	return _regex_count_at(reg, p, len, e, flags, onig_options, scratch.get());
 }
 
-template <class BidirIt, class CharT, class Traits>
-bool regex_iterator<BidirIt, CharT, Traits>::operator==(const regex_iterator& other) const {
-	// Check for end iterator
-	if (m_regex == nullptr && other.m_regex == nullptr) return true;
-	if (m_regex == nullptr || other.m_regex == nullptr) return false;
+////////////////////////////////////////////
+// regex_for_each implementation
 
-	// Normal iterator comparison
-	if (m_results.empty() || other.m_results.empty()) return false;
+template <class CharT, class Traits>
+size_type _regex_for_each(
+	const CharT* first, const CharT* last,
+	const basic_regex<CharT, Traits>& e,
+	bool (*visit)(void* context, const basic_match_view<CharT>& view), void* context,
+	regex_constants::match_flag_type flags)
+{
+	OnigRegex reg = _regex_for_flags(e, flags);
+	if (!reg) return 0;
 
-	return m_results[0].first == other.m_results[0].first &&
-		   m_results[0].second == other.m_results[0].second;
+	OnigOptionType onig_options = ONIG_OPTION_NONE;
+	if (flags & regex_constants::match_not_bol) onig_options |= ONIG_OPTION_NOTBOL;
+	if (flags & regex_constants::match_not_eol) onig_options |= ONIG_OPTION_NOTEOL;
+
+	const size_type len = static_cast<size_type>(last - first);
+	std::basic_string<CharT> unused;
+	const CharT* p = _contiguous_subject<CharT>(first, last, len, unused,
+	                                            (flags & regex_constants::match_prev_avail) != 0);
+	const bool nosubs = _is_nosubs_active(e.flags(), flags);
+
+	// Borrow the per-thread OnigRegion scratch; the view reads its registers
+	_region_scratch scratch;
+	return _regex_enumerate_at(reg, p, len, e, flags, onig_options, scratch.get(),
+		[&](const OnigRegion* region) {
+			const basic_match_view<CharT> view(p, region->beg, region->end,
+			                                   nosubs ? 1 : static_cast<size_type>(region->num_regs));
+			return visit(context, view);
+		});
 }
 
-template <class BidirIt, class CharT, class Traits>
-regex_iterator<BidirIt, CharT, Traits>& regex_iterator<BidirIt, CharT, Traits>::operator++() {
-	if (m_regex == nullptr || m_results.empty()) {
-		return *this;
-	}
+////////////////////////////////////////////
+// regex_split implementation
 
-	// Get the end of the current search result
-	BidirIt current_match_end = m_results[0].second;
+// Common part of the regex_split overloads; push(position, length) appends
+// a span to the destination
+template <class CharT, class Traits, class Push>
+size_type _regex_split(
+	const CharT* first, const CharT* last,
+	const basic_regex<CharT, Traits>& e,
+	const int* subs, size_type sub_count,
+	const split_options& options,
+	regex_constants::match_flag_type flags,
+	Push push)
+{
+	// Offsets are enough here: no sub_match vector is built per match
+	using iterator_t = regex_offset_iterator<const CharT*, CharT, Traits>;
 
-	// Zero-width match handling
-	if (m_results[0].first == current_match_end) {
-		if (current_match_end != m_end) {
-			// Advance by 1 character for zero-width match, then search from there
-			std::advance(current_match_end, 1);
-		} else {
-			// Zero-width match at end of string - no more matches possible
-			m_regex = nullptr;
-			m_results.clear();
-			return *this;
+	const size_type len = static_cast<size_type>(last - first);
+	const bool fields = std::find(subs, subs + sub_count, -1) != subs + sub_count;
+
+	size_type count = 0;
+	auto token = [&](size_type position, size_type length) {
+		if (length == 0 && !options.keep_empty) return;
+		push(position, length);
+		++count;
+	};
+
+	basic_regex<CharT, Traits> unmasked;
+	const basic_regex<CharT, Traits>& re = _unmasked_regex(e, unmasked);
+
+	size_type field = 0; // Start of the field before the next match
+	size_type splits = 0;
+	for (iterator_t it(first, last, re, flags), end; it != end; ++it) {
+		if (options.max_fields && splits + 1 >= options.max_fields) break;
+
+		const match_offsets& m = *it;
+		const size_type position = m.position(0);
+		for (size_type i = 0; i < sub_count; ++i) {
+			const int sub = subs[i];
+			if (sub == -1)
+				token(field, position - field);
+			else if (sub >= 0 && m.matched(static_cast<size_type>(sub)))
+				token(m.position(sub), m.length(sub));
+			else
+				token(position, 0);
 		}
+		field = position + m.length(0);
+		++splits;
 	}
 
-	// Execute the next search
-	do_search(current_match_end, m_end);
+	if (fields) token(field, len - field);
+	return count;
+}
 
-	return *this;
+template <class CharT, class Traits>
+size_type regex_split(
+	std::vector<std::pair<size_type, size_type>>& dest,
+	const CharT* first, const CharT* last,
+	const basic_regex<CharT, Traits>& e,
+	const int* subs, size_type sub_count,
+	const split_options& options,
+	regex_constants::match_flag_type flags)
+{
+	return _regex_split(first, last, e, subs, sub_count, options, flags,
+		[&dest](size_type position, size_type length) {
+			dest.push_back(std::make_pair(position, length));
+		});
+}
+
+template <class CharT, class Traits>
+size_type regex_split(
+	std::vector<std::pair<const CharT*, const CharT*>>& dest,
+	const CharT* first, const CharT* last,
+	const basic_regex<CharT, Traits>& e,
+	const int* subs, size_type sub_count,
+	const split_options& options,
+	regex_constants::match_flag_type flags)
+{
+	return _regex_split(first, last, e, subs, sub_count, options, flags,
+		[&dest, first](size_type position, size_type length) {
+			dest.push_back(std::make_pair(first + position, first + position + length));
+		});
+}
+
+////////////////////////////////////////////
+// regex_grep implementation
+
+// Common part of regex_grep and regex_grep_count; push(line) receives the
+// selected lines and their context lines in order
+template <class CharT, class Traits, class Push>
+size_type _regex_grep(
+	const CharT* first, const CharT* last,
+	const basic_regex<CharT, Traits>& e,
+	const grep_options& options,
+	regex_constants::match_flag_type flags,
+	Push push)
+{
+	typedef std::chrono::steady_clock clock;
+	const clock::time_point started = options.stats ? clock::now() : clock::time_point();
+
+	OnigRegex reg = _regex_for_flags(e, flags);
+	OnigOptionType onig_options = ONIG_OPTION_NONE;
+	if (flags & regex_constants::match_not_bol) onig_options |= ONIG_OPTION_NOTBOL;
+	if (flags & regex_constants::match_not_eol) onig_options |= ONIG_OPTION_NOTEOL;
+
+	// Borrow the per-thread OnigRegion scratch for all lines
+	_region_scratch scratch;
+
+	// The last before_context lines, indexed by line number
+	const size_type before = options.before_context;
+	std::vector<grep_line> recent(before);
+
+	size_type selected = 0;
+	size_type number = 0;      // Lines read
+	size_type last_pushed = 0; // Number of the last line pushed (0: none)
+	size_type after_left = 0;  // Context lines still due after a selected line
+	const CharT* p = first;
+	while (p < last) {
+		const bool done = options.max_count && selected >= options.max_count;
+		if (done && !after_left) break;
+
+		const CharT* newline = std::char_traits<CharT>::find(p, static_cast<size_type>(last - p), CharT('\n'));
+		const CharT* end = newline ? newline : last;
+		grep_line line;
+		line.number = ++number;
+		line.offset = static_cast<size_type>(p - first);
+		line.length = static_cast<size_type>(end - p);
+		line.selected = false;
+
+		bool match = false;
+		if (!done) {
+			match = reg && _regex_test_at(reg, p, line.length, e, flags, onig_options, scratch.get());
+			if (options.invert) match = !match;
+		}
+		p = newline ? newline + 1 : last;
+
+		if (match) {
+			++selected;
+			size_type from = (number > before) ? number - before : 1;
+			if (from <= last_pushed) from = last_pushed + 1;
+			for (size_type n = from; n < number; ++n)
+				push(recent[n % before]);
+			line.selected = true;
+			push(line);
+			last_pushed = number;
+			after_left = options.after_context;
+		} else if (after_left) {
+			--after_left;
+			push(line);
+			last_pushed = number;
+		}
+		if (before) recent[number % before] = line;
+	}
+
+	if (options.stats) {
+		options.stats->lines = number;
+		options.stats->bytes = static_cast<size_type>(p - first) * sizeof(CharT);
+		options.stats->selected = selected;
+		options.stats->elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - started);
+	}
+	return selected;
+}
+
+template <class CharT, class Traits>
+size_type regex_grep(
+	std::vector<grep_line>& dest,
+	const CharT* first, const CharT* last,
+	const basic_regex<CharT, Traits>& e,
+	const grep_options& options,
+	regex_constants::match_flag_type flags)
+{
+	return _regex_grep(first, last, e, options, flags,
+		[&dest](const grep_line& line) { dest.push_back(line); });
+}
+
+template <class CharT, class Traits>
+size_type regex_grep_count(
+	const CharT* first, const CharT* last,
+	const basic_regex<CharT, Traits>& e,
+	const grep_options& options,
+	regex_constants::match_flag_type flags)
+{
+	grep_options count_options(options);
+	count_options.before_context = count_options.after_context = 0;
+	return _regex_grep(first, last, e, count_options, flags, [](const grep_line&) { });
+}
+
+////////////////////////////////////////////
+// Implementation of regex_iterator
+
+template <class BidirIt, class CharT, class Traits>
+void regex_iterator<BidirIt, CharT, Traits>::do_search(BidirIt first, BidirIt last) {
+	// Try to search - we allow first == last for zero-width patterns which can match at end position
+	bool found;
+	if (_is_contiguous_iterator<BidirIt>::value)
+		found = _regex_search_with_context(m_begin, first, last, m_results, *m_regex, m_flags);
+	else
+		found = _search_buffer(first);
+
+	if (!found) {
+		// Invalidate as end iterator
+		m_regex = nullptr;
+		m_results.clear();
+	}
+}
+
+// Searches the copy of a non-contiguous range from first, which is at or
+// just after the cursor, so a whole enumeration is linear in the subject
+// length instead of copying and walking [m_begin, m_end) at every step.
+template <class BidirIt, class CharT, class Traits>
+bool regex_iterator<BidirIt, CharT, Traits>::_search_buffer(BidirIt first) {
+	// With match_prev_avail, the copy starts with the character before m_begin
+	const size_type prev = (m_flags & regex_constants::match_prev_avail) ? 1 : 0;
+	if (!m_buffer) {
+		basic_string<CharT> buf;
+		_contiguous_subject<CharT>(m_begin, m_end, 0, buf, prev != 0);
+		m_buffer = std::make_shared<const basic_string<CharT>>(std::move(buf));
+		m_cursor = m_begin;
+		m_cursor_offset = 0;
+	}
+	size_type offset = m_cursor_offset + std::distance(m_cursor, first);
+
+	match_offsets found;
+	if (!_regex_search_offsets(m_buffer->c_str() + prev, m_buffer->size() - prev, offset, found, *m_regex, m_flags))
+		return false;
+
+	m_cursor = first;
+	m_cursor_offset = offset;
+	found.to_match_results(m_begin, m_end, m_results, m_cursor, m_cursor_offset);
+	return true;
+}
+
+template <class BidirIt, class CharT, class Traits>
+regex_iterator<BidirIt, CharT, Traits>::regex_iterator(
+	BidirIt first, BidirIt last,
+	const regex_type& re,
+	match_flag_type flags)
+	: m_end(last), m_regex(&re), m_flags(flags), m_begin(first), m_cursor_offset(0)
+{
+	// Execute the first search
+	do_search(first, last);
+}
+
+template <class BidirIt, class CharT, class Traits>
+bool regex_iterator<BidirIt, CharT, Traits>::operator==(const regex_iterator& other) const {
+	// Check for end iterator
+	if (m_regex == nullptr && other.m_regex == nullptr) return true;
+	if (m_regex == nullptr || other.m_regex == nullptr) return false;
+
+	// Normal iterator comparison
+	if (m_results.empty() || other.m_results.empty()) return false;
+
+	return m_results[0].first == other.m_results[0].first &&
+		   m_results[0].second == other.m_results[0].second;
+}
+
+template <class BidirIt, class CharT, class Traits>
+regex_iterator<BidirIt, CharT, Traits>& regex_iterator<BidirIt, CharT, Traits>::operator++() {
+	if (m_regex == nullptr || m_results.empty()) {
+		return *this;
+	}
+
+	// Get the end of the current search result
+	BidirIt current_match_end = m_results[0].second;
+
+	// Zero-width match handling
+	if (m_results[0].first == current_match_end) {
+		if (current_match_end != m_end) {
+			// Advance by 1 character for zero-width match, then search from there
+			std::advance(current_match_end, 1);
+		} else {
+			// Zero-width match at end of string - no more matches possible
+			m_regex = nullptr;
+			m_results.clear();
+			return *this;
+		}
+	}
+
+	// Execute the next search
+	do_search(current_match_end, m_end);
+
+	return *this;
 }
 
 template <class BidirIt, class CharT, class Traits>
@@ -1727,88 +3391,1585 @@ void regex_token_iterator<BidirIt, CharT, Traits>::_do_increment() {
 				m_sub_match = sub_match<BidirIt>();
 				m_sub_match.matched = false;
 			}
-		}
-	}
-}
+		}
+	}
+}
+
+template <class BidirIt, class CharT, class Traits>
+regex_token_iterator<BidirIt, CharT, Traits>::regex_token_iterator(
+	BidirIt first, BidirIt last,
+	const regex_type& re,
+	const std::vector<int>& subs,
+	match_flag_type flags)
+	: m_itor(first, last, re, flags), m_end(), m_subs(subs), m_subs_idx(0), m_last(last)
+{
+	if (m_itor == m_end) {
+		// No matches
+		if (std::find(m_subs.begin(), m_subs.end(), -1) != m_subs.end()) {
+			// Entire string as single token
+			m_sub_match = sub_match<BidirIt>(first, last, first != last);
+			m_subs.clear(); // Will terminate on next increment
+		} else {
+			m_subs.clear();
+		}
+	} else {
+		// Match found
+		int sub_idx = m_subs[m_subs_idx];
+
+		if (sub_idx == -1) {
+			// Output prefix (text before first match)
+			m_sub_match = sub_match<BidirIt>(first, (*m_itor)[0].first, first != (*m_itor)[0].first);
+		} else if (sub_idx >= 0 && sub_idx < (int)(*m_itor).size()) {
+			m_sub_match = (*m_itor)[sub_idx];
+		} else {
+			m_sub_match = sub_match<BidirIt>();
+			m_sub_match.matched = false;
+		}
+	}
+}
+
+// Convenience constructor with std::initializer_list
+template <class BidirIt, class CharT, class Traits>
+regex_token_iterator<BidirIt, CharT, Traits>::regex_token_iterator(
+	BidirIt first, BidirIt last,
+	const regex_type& re,
+	std::initializer_list<int> subs,
+	match_flag_type flags)
+	: regex_token_iterator(first, last, re, std::vector<int>(subs), flags)
+{
+	// Delegate to vector constructor
+}
+
+// Convenience constructor with single int
+template <class BidirIt, class CharT, class Traits>
+regex_token_iterator<BidirIt, CharT, Traits>::regex_token_iterator(
+	BidirIt first, BidirIt last,
+	const regex_type& re,
+	int sub,
+	match_flag_type flags)
+	: regex_token_iterator(first, last, re, std::vector<int>{sub}, flags)
+{
+	// Delegate to vector constructor
+}
+
+template <class BidirIt, class CharT, class Traits>
+bool regex_token_iterator<BidirIt, CharT, Traits>::operator==(const regex_token_iterator& other) const {
+	// Check for termination
+	if (m_subs.empty() && other.m_subs.empty()) return true;
+	if (m_subs.empty() || other.m_subs.empty()) return false;
+
+	// Normal comparison
+	return m_itor == other.m_itor &&
+		   m_sub_match.first == other.m_sub_match.first &&
+		   m_sub_match.second == other.m_sub_match.second;
+}
+
+template <class BidirIt, class CharT, class Traits>
+regex_token_iterator<BidirIt, CharT, Traits>& regex_token_iterator<BidirIt, CharT, Traits>::operator++() {
+	_do_increment();
+	return *this;
+}
+
+template <class BidirIt, class CharT, class Traits>
+regex_token_iterator<BidirIt, CharT, Traits> regex_token_iterator<BidirIt, CharT, Traits>::operator++(int) {
+	regex_token_iterator tmp = *this;
+	++(*this);
+	return tmp;
+}
+
+////////////////////////////////////////////
+// Implementation of basic_regex_cache
+
+template <class CharT, class Traits>
+size_type basic_regex_cache<CharT, Traits>::key_hash::operator()(const key_type& key) const {
+	size_type h = std::hash<string_type>()(key.pattern);
+	h ^= std::hash<flag_type>()(key.flags) + 0x9e3779b9 + (h << 6) + (h >> 2);
+	h ^= std::hash<const void*>()(key.encoding) + 0x9e3779b9 + (h << 6) + (h >> 2);
+	h ^= std::hash<std::string>()(key.locale_name) + 0x9e3779b9 + (h << 6) + (h >> 2);
+	return h;
+}
+
+template <class CharT, class Traits>
+basic_regex_cache<CharT, Traits>::basic_regex_cache(size_type capacity)
+	: m_capacity(capacity), m_hits(0), m_misses(0), m_evictions(0)
+{
+}
+
+template <class CharT, class Traits>
+typename basic_regex_cache<CharT, Traits>::pointer
+basic_regex_cache<CharT, Traits>::get(const string_type& pattern, flag_type f,
+                                      OnigEncoding enc, const std::locale& loc)
+{
+	if (!enc) enc = _get_default_encoding_from_char_type<CharT>();
+
+	key_type key;
+	key.pattern = pattern;
+	key.flags = f;
+	key.encoding = enc;
+	bool cacheable = true;
+	if (f & regex_constants::collate) {
+		key.locale_name = loc.name();
+		cacheable = (key.locale_name != "*");
+	}
+
+	if (cacheable) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto found = m_index.find(key);
+		if (found != m_index.end()) {
+			// Move to the front (most recently used)
+			m_entries.splice(m_entries.begin(), m_entries, found->second);
+			++m_hits;
+			return found->second->second;
+		}
+		++m_misses;
+	} else {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		++m_misses;
+	}
+
+	// Compile outside the lock so that misses do not serialize each other
+	pointer compiled = std::make_shared<const regex_type>(
+		_regex_access<CharT, Traits>::compile(pattern, f, enc, loc));
+	if (!cacheable)
+		return compiled;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_capacity == 0)
+		return compiled;
+	auto found = m_index.find(key);
+	if (found != m_index.end()) {
+		// Another thread inserted the same key meanwhile; share its entry
+		m_entries.splice(m_entries.begin(), m_entries, found->second);
+		return found->second->second;
+	}
+	m_entries.emplace_front(key, compiled);
+	m_index.emplace(std::move(key), m_entries.begin());
+	_evict_to(m_capacity);
+	return compiled;
+}
+
+template <class CharT, class Traits>
+void basic_regex_cache<CharT, Traits>::_evict_to(size_type count) {
+	// The caller holds m_mutex
+	while (m_entries.size() > count) {
+		m_index.erase(m_entries.back().first);
+		m_entries.pop_back();
+		++m_evictions;
+	}
+}
+
+template <class CharT, class Traits>
+size_type basic_regex_cache<CharT, Traits>::capacity() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_capacity;
+}
+
+template <class CharT, class Traits>
+void basic_regex_cache<CharT, Traits>::set_capacity(size_type capacity) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_capacity = capacity;
+	_evict_to(m_capacity);
+}
+
+template <class CharT, class Traits>
+void basic_regex_cache<CharT, Traits>::clear() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_index.clear();
+	m_entries.clear();
+}
+
+template <class CharT, class Traits>
+regex_cache_stats basic_regex_cache<CharT, Traits>::stats() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	regex_cache_stats result;
+	result.hits = m_hits;
+	result.misses = m_misses;
+	result.evictions = m_evictions;
+	result.size = m_entries.size();
+	result.capacity = m_capacity;
+	return result;
+}
+
+template <class CharT, class Traits>
+void basic_regex_cache<CharT, Traits>::reset_stats() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_hits = m_misses = m_evictions = 0;
+}
+
+template <class CharT, class Traits>
+basic_regex_cache<CharT, Traits>& basic_regex_cache<CharT, Traits>::global() {
+	static basic_regex_cache cache;
+	return cache;
+}
+
+////////////////////////////////////////////
+// Implementation of basic_regex_set
+
+template <class CharT, class Traits>
+basic_regex_set<CharT, Traits>::basic_regex_set(lead_type lead)
+	: m_set(nullptr), m_lead(lead), m_prefiltered(true)
+{
+}
+
+template <class CharT, class Traits>
+basic_regex_set<CharT, Traits>::basic_regex_set(std::initializer_list<regex_type> list, lead_type lead)
+	: m_set(nullptr), m_lead(lead), m_prefiltered(true)
+{
+	for (const regex_type& re : list)
+		add(re);
+}
+
+// Copies share the compiled programs but get their own OnigRegSet
+template <class CharT, class Traits>
+basic_regex_set<CharT, Traits>::basic_regex_set(const self_type& other)
+	: m_set(nullptr), m_lead(other.m_lead), m_prefiltered(true)
+{
+	for (const regex_type& re : other.m_regexes)
+		add(re);
+	m_prefilter = other.m_prefilter;
+}
+
+template <class CharT, class Traits>
+basic_regex_set<CharT, Traits>::basic_regex_set(self_type&& other) noexcept
+	: m_regexes(std::move(other.m_regexes)), m_set(other.m_set), m_lead(other.m_lead),
+	  m_prefiltered(other.m_prefiltered), m_prefilter(std::move(other.m_prefilter))
+{
+	other.m_regexes.clear();
+	other.m_set = nullptr;
+	other.m_prefiltered = true;
+}
+
+template <class CharT, class Traits>
+basic_regex_set<CharT, Traits>::~basic_regex_set() {
+	_release();
+}
+
+template <class CharT, class Traits>
+size_type basic_regex_set<CharT, Traits>::add(const regex_type& re) {
+	OnigRegex reg = _regex_access<CharT, Traits>::get(re);
+	int err = ONIGERR_INVALID_ARGUMENT;
+	if (reg) {
+		m_regexes.push_back(re); // Keeps the compiled program alive
+		if (!m_set)
+			err = onig_regset_new(&m_set, 1, &reg);
+		else
+			err = onig_regset_add(m_set, reg);
+		if (err != ONIG_NORMAL)
+			m_regexes.pop_back();
+	}
+	if (err != ONIG_NORMAL) {
+		OnigErrorInfo einfo;
+		std::memset(&einfo, 0, sizeof(einfo));
+		throw regex_error(regex_constants::map_oniguruma_error(err), einfo);
+	}
+
+	// The merged prefilter is rebuilt by the next search (see _prefilter)
+	if (!_prefilter_of(re))
+		m_prefiltered = false;
+	m_prefilter.reset();
+	return m_regexes.size() - 1;
+}
+
+template <class CharT, class Traits>
+void basic_regex_set<CharT, Traits>::clear() {
+	_release();
+	m_regexes.clear();
+	m_prefiltered = true;
+	m_prefilter.reset();
+}
+
+// The set has a prefilter for the literals of all regexes while every regex
+// has one. It is merged once here rather than on every add, which would copy
+// the literals added so far each time.
+template <class CharT, class Traits>
+const _literal_prefilter<CharT>* basic_regex_set<CharT, Traits>::_prefilter() const {
+	if (!prefilter_active())
+		return nullptr;
+	if (!m_prefilter) {
+		std::vector<std::basic_string<CharT>> literals;
+		for (const regex_type& re : m_regexes) {
+			const std::vector<std::basic_string<CharT>>& more = _prefilter_of(re)->literals;
+			literals.insert(literals.end(), more.begin(), more.end());
+		}
+		m_prefilter = std::make_shared<_literal_prefilter<CharT>>(std::move(literals));
+	}
+	return m_prefilter.get();
+}
+
+template <class CharT, class Traits>
+void basic_regex_set<CharT, Traits>::_release() {
+	if (!m_set) return;
+	// onig_regset_free() also frees the regexes it holds, but they belong to
+	// the shared programs; detach them first (replacing with NULL removes).
+	for (int n = onig_regset_number_of_regex(m_set); n > 0; --n)
+		onig_regset_replace(m_set, n - 1, nullptr);
+	onig_regset_free(m_set);
+	m_set = nullptr;
+}
+
+// Whether match_not_bow or match_not_eow matter to a regex of the set. The
+// OnigRegSet only holds the plain programs, not the word boundary variants
+// that _regex_for_flags picks for these flags.
+template <class CharT, class Traits>
+bool _regex_set_needs_edge_flags(const basic_regex_set<CharT, Traits>& s, regex_constants::match_flag_type flags) {
+	if (flags & regex_constants::match_prev_avail) flags &= ~regex_constants::match_not_bow;
+	if (!(flags & (regex_constants::match_not_bow | regex_constants::match_not_eow))) return false;
+	for (size_type i = 0; i < s.size(); ++i) {
+		const _regex_program<CharT, Traits>* program = _regex_access<CharT, Traits>::get_program(s[i]);
+		if (program && program->word_boundary) return true;
+	}
+	return false;
+}
+
+// A regex set search done regex by regex with the single regex search, for
+// the flags the OnigRegSet cannot handle. The winner is picked as the lead
+// mode of the set does.
+template <class BidirIt, class Alloc, class CharT, class Traits>
+int _regex_set_search_each(
+	BidirIt whole_first, BidirIt search_start, BidirIt last,
+	match_results<BidirIt, Alloc>& m,
+	const basic_regex_set<CharT, Traits>& s,
+	regex_constants::match_flag_type flags,
+	OnigOptionType extra_options)
+{
+	const size_type search_offset = std::distance(whole_first, search_start);
+	int index = -1;
+	size_type best = 0;
+	for (size_type i = 0; i < s.size(); ++i) {
+		match_results<BidirIt, Alloc> candidate;
+		if (!_regex_search_with_context(whole_first, search_start, last, candidate, s[i], flags, extra_options))
+			continue;
+		const size_type pos = std::distance(whole_first, candidate[0].first);
+		if (index < 0 || pos < best) {
+			index = static_cast<int>(i);
+			best = pos;
+			m = std::move(candidate);
+		}
+		// No later regex can start earlier; priority_lead takes the first one
+		if (pos == search_offset || s.lead() == basic_regex_set<CharT, Traits>::priority_lead)
+			break;
+	}
+	m.m_ready = true;
+	return index;
+}
+
+// Search with a regex set using whole_first as the string start (for context).
+// Returns the index of the regex that matched, or -1. match_not_null skips
+// the empty matches, and with match_prev_avail the character before
+// whole_first is read as context.
+template <class BidirIt, class Alloc, class CharT, class Traits>
+int _regex_set_search_with_context(
+	BidirIt whole_first, BidirIt search_start, BidirIt last,
+	match_results<BidirIt, Alloc>& m,
+	const basic_regex_set<CharT, Traits>& s,
+	regex_constants::match_flag_type flags)
+{
+	OnigRegSet* set = s.native_handle();
+	if (!set) {
+		m.m_ready = true;
+		return -1;
+	}
+
+	OnigOptionType onig_options = 0;
+	if (flags & regex_constants::match_not_bol) onig_options |= ONIG_OPTION_NOTBOL;
+	if (flags & regex_constants::match_not_eol) onig_options |= ONIG_OPTION_NOTEOL;
+
+	// Empty matches are skipped rather than ending the search
+	OnigOptionType extra_options = ONIG_OPTION_NONE;
+	if (flags & regex_constants::match_not_null) extra_options |= ONIG_OPTION_FIND_NOT_EMPTY;
+	onig_options |= extra_options;
+
+	if (_regex_set_needs_edge_flags(s, flags))
+		return _regex_set_search_each(whole_first, search_start, last, m, s, flags, extra_options);
+
+	size_type total_len = std::distance(whole_first, last);
+	size_type search_offset = std::distance(whole_first, search_start);
+
+	const bool prev_avail = (flags & regex_constants::match_prev_avail) != 0;
+	const size_type prefix_len = prev_avail ? 1 : 0;
+	_scratch_string<CharT> subject_buf;
+	const CharT* begin_ptr = _contiguous_subject<CharT>(whole_first, last, total_len, subject_buf, prev_avail);
+	const OnigUChar* u_start = reinterpret_cast<const OnigUChar*>(begin_ptr - prefix_len);
+	const OnigUChar* u_end = reinterpret_cast<const OnigUChar*>(begin_ptr + total_len);
+	const OnigUChar* u_search_start = reinterpret_cast<const OnigUChar*>(begin_ptr + search_offset);
+
+	if (flags & regex_constants::match_continuous) {
+		// Every candidate starts at the same position, so the first regex (in
+		// order) that matches there wins regardless of the lead mode.
+		_region_scratch scratch;
+		for (size_type i = 0; i < s.size(); ++i) {
+			OnigRegex reg = _regex_access<CharT, Traits>::get(s[i]);
+			int r = onig_match(reg, u_start, u_end, u_search_start, scratch.get(), onig_options);
+			if (r == ONIG_MISMATCH)
+				continue;
+			if (r >= 0) _adjust_region_offsets_prefix<CharT>(scratch.get(), prefix_len);
+			if (_process_onig_region_result<BidirIt, Alloc, CharT, Traits>(
+				r, scratch.get(), whole_first, last, m, s[i].flags(), flags, s[i].captures()))
+				return static_cast<int>(i);
+		}
+		m.m_ready = true;
+		return -1;
+	}
+
+	// No regex can match before the first candidate of the prefilter
+	if (const _literal_prefilter<CharT>* prefilter = _regex_set_access<CharT, Traits>::get_prefilter(s)) {
+		const size_type candidate = prefilter->next(begin_ptr, search_offset, total_len);
+		if (candidate == _literal_prefilter<CharT>::npos) {
+			m.m_ready = true;
+			return -1;
+		}
+		u_search_start = reinterpret_cast<const OnigUChar*>(begin_ptr + candidate);
+	}
+
+	int match_pos = 0;
+	int r = onig_regset_search(set, u_start, u_end, u_search_start, u_end,
+	                           static_cast<OnigRegSetLead>(s.lead()), onig_options, &match_pos);
+	if (r >= 0) {
+		OnigRegion* region = onig_regset_get_region(set, r);
+		_adjust_region_offsets_prefix<CharT>(region, prefix_len);
+		match_pos -= static_cast<int>(prefix_len * sizeof(CharT));
+		if (_process_onig_region_result<BidirIt, Alloc, CharT, Traits>(
+			match_pos, region, whole_first, last, m, s[r].flags(), flags, s[r].captures()))
+			return r;
+		return -1;
+	}
+
+	// No match or error (throws)
+	_process_onig_region_result<BidirIt, Alloc, CharT, Traits>(
+		r, nullptr, whole_first, last, m, regex_constants::normal, flags);
+	return -1;
+}
+
+template <class BidirIt, class Alloc, class CharT, class Traits>
+int regex_set_search(
+	BidirIt first, BidirIt last,
+	match_results<BidirIt, Alloc>& m,
+	const basic_regex_set<CharT, Traits>& s,
+	regex_constants::match_flag_type flags)
+{
+	return _regex_set_search_with_context(first, first, last, m, s, flags);
+}
+
+////////////////////////////////////////////
+// Implementation of regex_set_iterator
+
+template <class BidirIt, class CharT, class Traits>
+void regex_set_iterator<BidirIt, CharT, Traits>::do_search(BidirIt first, BidirIt last) {
+	m_index = _regex_set_search_with_context(m_begin, first, last, m_results, *m_set, m_flags);
+	if (m_index < 0) {
+		// Invalidate as end iterator
+		m_set = nullptr;
+		m_results.clear();
+	}
+}
+
+template <class BidirIt, class CharT, class Traits>
+regex_set_iterator<BidirIt, CharT, Traits>::regex_set_iterator(
+	BidirIt first, BidirIt last,
+	const regex_set_type& s,
+	match_flag_type flags)
+	: m_begin(first), m_end(last), m_set(&s), m_flags(flags), m_index(-1)
+{
+	do_search(first, last);
+}
+
+template <class BidirIt, class CharT, class Traits>
+bool regex_set_iterator<BidirIt, CharT, Traits>::operator==(const regex_set_iterator& other) const {
+	if (m_set == nullptr && other.m_set == nullptr) return true;
+	if (m_set == nullptr || other.m_set == nullptr) return false;
+	if (m_results.empty() || other.m_results.empty()) return false;
+	return m_index == other.m_index &&
+	       m_results[0].first == other.m_results[0].first &&
+	       m_results[0].second == other.m_results[0].second;
+}
+
+template <class BidirIt, class CharT, class Traits>
+regex_set_iterator<BidirIt, CharT, Traits>& regex_set_iterator<BidirIt, CharT, Traits>::operator++() {
+	if (m_set == nullptr || m_results.empty()) {
+		return *this;
+	}
+
+	BidirIt current_match_end = m_results[0].second;
+
+	// Zero-width match handling (same rules as regex_iterator)
+	if (m_results[0].first == current_match_end) {
+		if (current_match_end != m_end) {
+			std::advance(current_match_end, 1);
+		} else {
+			m_set = nullptr;
+			m_results.clear();
+			m_index = -1;
+			return *this;
+		}
+	}
+
+	do_search(current_match_end, m_end);
+	return *this;
+}
+
+template <class BidirIt, class CharT, class Traits>
+regex_set_iterator<BidirIt, CharT, Traits> regex_set_iterator<BidirIt, CharT, Traits>::operator++(int) {
+	regex_set_iterator tmp = *this;
+	++(*this);
+	return tmp;
+}
+
+////////////////////////////////////////////
+// Implementation of regex_search_all_parallel
+
+// Does the pattern use \G? Its meaning depends on where each search starts,
+// so such patterns cannot be searched chunk by chunk.
+template <class CharT>
+bool _pattern_has_search_anchor(const std::basic_string<CharT>& pattern) {
+	for (size_type i = 0; i + 1 < pattern.size(); ++i) {
+		if (pattern[i] == CharT('\\')) {
+			if (pattern[i + 1] == CharT('G')) return true;
+			++i; // skip the escaped character
+		}
+	}
+	return false;
+}
+
+// Position where regex_iterator::operator++ searches next after m
+// (npos after a zero-width match at the end of the subject)
+template <class CharT>
+size_type _next_search_offset(const CharT* first, const CharT* last, const match_results<const CharT*>& m) {
+	size_type match_end = m[0].second - first;
+	if (m[0].first != m[0].second) return match_end;
+	if (m[0].second == last) return static_cast<size_type>(-1);
+	return match_end + 1;
+}
+
+// Runs the regex_iterator loop over the start positions [begin, limit) of
+// [first, last); for the last chunk, up to and including the end. Only
+// [first, window_end) is searched, and matches are then re-done against the
+// whole subject so that they are exactly what a serial search reports.
+template <class CharT, class Traits>
+void _search_chunk(
+	const CharT* first, const CharT* last,
+	const basic_regex<CharT, Traits>& e,
+	regex_constants::match_flag_type flags,
+	size_type begin, size_type limit, bool is_last, size_type window_end,
+	std::vector<match_results<const CharT*>>& out)
+{
+	const size_type len = last - first;
+	const bool truncated = (window_end < len);
+
+	size_type pos = begin;
+	while (is_last || pos < limit) {
+		match_results<const CharT*> m;
+		if (!_regex_search_with_context(first, first + pos, first + window_end, m, e, flags))
+			break;
+
+		size_type match_pos = m[0].first - first;
+		if (!is_last && match_pos >= limit) break;
+
+		if (truncated) {
+			// The match may depend on characters past the window
+			if (!_regex_search_with_context(first, first + match_pos, last, m, e,
+			                                flags | regex_constants::match_continuous))
+			{
+				pos = match_pos + 1;
+				continue;
+			}
+		}
+
+		out.push_back(m);
+		pos = _next_search_offset(first, last, m);
+		if (pos == static_cast<size_type>(-1)) break;
+	}
+}
+
+template <class CharT, class Traits>
+std::vector<match_results<const CharT*>> regex_search_all_parallel(
+	const CharT* first, const CharT* last,
+	const basic_regex<CharT, Traits>& e,
+	const parallel_search_options<CharT>& options,
+	regex_constants::match_flag_type flags)
+{
+	typedef match_results<const CharT*> result_type;
+	const size_type npos = static_cast<size_type>(-1);
+	const size_type len = last - first;
+	const size_type min_chunk_size = 64 * 1024;
+	std::vector<result_type> results;
+
+	unsigned threads = options.threads;
+	if (threads == 0) threads = std::thread::hardware_concurrency();
+	if (threads == 0) threads = 1;
+
+	size_type chunk_size = options.chunk_size;
+	if (chunk_size == 0) {
+		chunk_size = len / (static_cast<size_type>(threads) * 4);
+		if (chunk_size < min_chunk_size) chunk_size = min_chunk_size;
+	}
+
+	// match_continuous and match_not_null make a search result depend on
+	// where the search started, as does \G; search those serially.
+	bool serial = threads <= 1 || len <= chunk_size ||
+		(flags & (regex_constants::match_continuous | regex_constants::match_not_null)) ||
+		_pattern_has_search_anchor(e.pattern());
+	if (serial) {
+		_search_chunk(first, last, e, flags, 0, len, true, len, results);
+		return results;
+	}
+
+	// Chunk boundaries (start positions of each chunk, then len)
+	std::vector<size_type> bounds;
+	bounds.push_back(0);
+	for (;;) {
+		size_type next = bounds.back() + chunk_size;
+		if (next >= len) break;
+		if (options.split_at_boundary) {
+			const CharT* p = std::find(first + next, last, options.boundary);
+			if (p == last || p + 1 == last) break;
+			next = (p + 1) - first;
+		}
+		bounds.push_back(next);
+	}
+	bounds.push_back(len);
+
+	const size_type chunk_count = bounds.size() - 1;
+	std::vector<std::vector<result_type>> chunk_results(chunk_count);
+
+	// Search the chunks on a small pool of threads
+	std::atomic<size_type> next_chunk(0);
+	std::exception_ptr error;
+	std::mutex error_mutex;
+	auto worker = [&]() {
+		for (;;) {
+			size_type i = next_chunk.fetch_add(1);
+			if (i >= chunk_count) break;
+			bool is_last = (i + 1 == chunk_count);
+			// Oniguruma's search range also bounds the match end, so the
+			// start positions are bounded by the window instead: a search
+			// past it would scan up to the next match, however far away
+			size_type overlap = options.overlap;
+			if (overlap == npos) overlap = bounds[i + 1] - bounds[i];
+			size_type window_end = len;
+			if (!is_last && len - bounds[i + 1] > overlap)
+				window_end = bounds[i + 1] + overlap;
+			try {
+				_search_chunk(first, last, e, flags, bounds[i], bounds[i + 1], is_last,
+				              window_end, chunk_results[i]);
+			} catch (...) {
+				std::lock_guard<std::mutex> lock(error_mutex);
+				if (!error) error = std::current_exception();
+				next_chunk = chunk_count;
+			}
+		}
+	};
+
+	size_type thread_count = std::min<size_type>(threads, chunk_count);
+	std::vector<std::thread> pool;
+	for (size_type i = 1; i < thread_count; ++i) {
+		pool.emplace_back(worker);
+	}
+	worker();
+	for (auto& t : pool) t.join();
+	if (error) std::rethrow_exception(error);
+
+	// Merge the chunks in order. Whether a match starts at a position does not
+	// depend on where the search started, so a chunk's matches are valid as
+	// long as the serial loop resumes at a position the chunk's own loop
+	// scanned without finding a match. Only when the previous match ends
+	// inside one of the chunk's matches are the few positions up to the end
+	// of that match tried one by one.
+	size_type pos = 0;
+	for (size_type i = 0; i < chunk_count && pos != npos; ++i) {
+		const std::vector<result_type>& chunk = chunk_results[i];
+		const bool is_last = (i + 1 == chunk_count);
+
+		while (pos != npos && (is_last || pos < bounds[i + 1])) {
+			// First match of the chunk starting at or after pos
+			size_type j = 0;
+			while (j < chunk.size() && static_cast<size_type>(chunk[j][0].first - first) < pos) ++j;
+
+			size_type scanned_from = (j == 0) ? bounds[i] : _next_search_offset(first, last, chunk[j - 1]);
+			if (pos <= bounds[i] || scanned_from <= pos) {
+				if (j < chunk.size()) {
+					results.insert(results.end(), chunk.begin() + j, chunk.end());
+					pos = _next_search_offset(first, last, chunk.back());
+				}
+				break;
+			}
+
+			// pos is inside chunk[j - 1]; try the positions up to its end
+			bool found = false;
+			for (; pos < scanned_from; ++pos) {
+				result_type m;
+				if (_regex_search_with_context(first, first + pos, last, m, e,
+				                               flags | regex_constants::match_continuous))
+				{
+					results.push_back(m);
+					pos = _next_search_offset(first, last, m);
+					found = true;
+					break;
+				}
+			}
+			if (!found) pos = scanned_from;
+		}
+	}
+
+	return results;
+}
+
+////////////////////////////////////////////
+// Implementation of regex_search_batch and regex_match_batch
+
+template <class CharT, class Traits>
+size_type _regex_batch(
+	const std::pair<const CharT*, size_type>* subjects, size_type count,
+	const basic_regex<CharT, Traits>& e,
+	regex_constants::match_flag_type flags,
+	bool match_mode,
+	const batch_options& options,
+	char* matched,
+	match_offsets* offsets,
+	match_results<const CharT*>* results,
+	size_type* counts)
+{
+	// Done once for the whole batch (the subjects have no characters before them)
+	flags &= ~regex_constants::match_prev_avail;
+	OnigRegex reg = _regex_for_flags(e, flags);
+	const regex_constants::syntax_option_type regex_flags = e.flags();
+	OnigOptionType onig_options = ONIG_OPTION_NONE;
+	if (flags & regex_constants::match_not_bol) onig_options |= ONIG_OPTION_NOTBOL;
+	if (flags & regex_constants::match_not_eol) onig_options |= ONIG_OPTION_NOTEOL;
+	regex_constants::match_flag_type run_flags = flags;
+	if (match_mode) run_flags |= regex_constants::match_continuous;
+
+	// Runs subjects [begin, end) with one OnigRegion
+	auto run = [&](size_type begin, size_type end) -> size_type {
+		_region_scratch scratch;
+		OnigRegion* region = scratch.get();
+		static const CharT empty_subject[1] = { CharT() };
+
+		size_type n = 0;
+		for (size_type i = begin; i < end; ++i) {
+			const CharT* p = subjects[i].first;
+			size_type len = subjects[i].second;
+			if (len == 0) p = empty_subject;
+
+			if (counts || (matched && !match_mode)) {
+				// Only the number of matches or whether there is one
+				if (counts) counts[i] = reg ? _regex_count_at(reg, p, len, e, run_flags, onig_options, region) : 0;
+				else matched[i] = reg && _regex_test_at(reg, p, len, e, run_flags, onig_options, region);
+				if (counts ? counts[i] > 0 : matched[i]) ++n;
+				continue;
+			}
+
+			_search_probe<CharT, Traits> probe(e, match_mode, len * sizeof(CharT));
+			int r = reg ? _onig_search_at(reg, p, len, 0, run_flags, onig_options, region, e.limits(), _prefilter_of(e))
+			            : ONIG_MISMATCH;
+			// regex_match: the match must cover the whole subject
+			if (r >= 0 && match_mode && region->end[0] != static_cast<int>(len * sizeof(CharT)))
+				r = ONIG_MISMATCH;
+
+			bool found;
+			if (results) {
+				found = _process_onig_region_result<const CharT*, std::allocator<sub_match<const CharT*>>, CharT, Traits>(
+					r, region, p, p + len, results[i], regex_flags, flags, e.captures());
+				if (!found) results[i].clear();
+			} else if (offsets) {
+				found = _process_onig_region_offsets<CharT>(r, region, offsets[i], regex_flags, flags, e.captures());
+			} else {
+				_check_search_result(r);
+				found = (r >= 0) && !((flags & regex_constants::match_not_null) && region->beg[0] == region->end[0]);
+				matched[i] = found;
+			}
+			probe.finish();
+			if (found) ++n;
+		}
+		return n;
+	};
+
+	unsigned threads = options.threads;
+	if (threads == 0) threads = std::thread::hardware_concurrency();
+	if (threads == 0) threads = 1;
+	const size_type grain = std::max<size_type>(options.grain, 1);
+	const size_type work_count = (count + grain - 1) / grain;
+	if (threads <= 1 || work_count <= 1)
+		return run(0, count);
+
+	// Hand out grain-sized slices of the batch to a small pool of threads
+	std::atomic<size_type> next_work(0);
+	std::atomic<size_type> total(0);
+	std::exception_ptr error;
+	std::mutex error_mutex;
+	auto worker = [&]() {
+		size_type n = 0;
+		for (;;) {
+			size_type i = next_work.fetch_add(1);
+			if (i >= work_count) break;
+			try {
+				n += run(i * grain, std::min(count, (i + 1) * grain));
+			} catch (...) {
+				std::lock_guard<std::mutex> lock(error_mutex);
+				if (!error) error = std::current_exception();
+				next_work = work_count;
+			}
+		}
+		total += n;
+	};
+
+	size_type thread_count = std::min<size_type>(threads, work_count);
+	std::vector<std::thread> pool;
+	for (size_type i = 1; i < thread_count; ++i) {
+		pool.emplace_back(worker);
+	}
+	worker();
+	for (auto& t : pool) t.join();
+	if (error) std::rethrow_exception(error);
+	return total;
+}
+
+////////////////////////////////////////////
+// Implementation of regex_compile_batch
+
+// Serializes onigpp::init() and uninit() with the setup and run of compile batches
+ONIGPP_INLINE std::mutex& _init_mutex() {
+	static std::mutex m;
+	return m;
+}
+
+template <class CharT, class Traits>
+size_type regex_compile_batch(
+	const regex_compile_entry<CharT>* entries, size_type count,
+	regex_compile_result<CharT, Traits>* results,
+	const compile_batch_options& options)
+{
+	std::lock_guard<std::mutex> init_lock(_init_mutex());
+
+	// Initialize every encoding of the batch up front: Oniguruma initializes the
+	// library and encodings lazily on first use, which is not thread-safe
+	std::vector<OnigEncoding> encodings;
+	for (size_type i = 0; i < count; ++i) {
+		OnigEncoding enc = entries[i].encoding ? entries[i].encoding : _get_default_encoding_from_char_type<CharT>();
+		if (std::find(encodings.begin(), encodings.end(), enc) == encodings.end())
+			encodings.push_back(enc);
+	}
+	if (!encodings.empty()) {
+		onig_initialize(encodings.data(), static_cast<int>(encodings.size()));
+		for (OnigEncoding enc : encodings)
+			onig_initialize_encoding(enc);
+	}
+
+	// Compiles entries [begin, end)
+	auto run = [&](size_type begin, size_type end) -> size_type {
+		size_type n = 0;
+		for (size_type i = begin; i < end; ++i) {
+			const regex_compile_entry<CharT>& entry = entries[i];
+			regex_compile_result<CharT, Traits>& result = results[i];
+			try {
+				basic_regex<CharT, Traits> re(entry.pattern, entry.flags, entry.encoding);
+				re.compile();
+				result.regex.swap(re);
+				result.ok = true;
+				result.onig_code = 0;
+				result.message.clear();
+				++n;
+			} catch (const regex_error& e) {
+				result.regex = basic_regex<CharT, Traits>();
+				result.ok = false;
+				result.code = e.code();
+				result.onig_code = e.onig_error_code();
+				result.message = e.what();
+			}
+		}
+		return n;
+	};
+
+	unsigned threads = options.threads;
+	if (threads == 0) threads = std::thread::hardware_concurrency();
+	if (threads == 0) threads = 1;
+	const size_type grain = std::max<size_type>(options.grain, 1);
+	const size_type work_count = (count + grain - 1) / grain;
+	if (threads <= 1 || work_count <= 1)
+		return run(0, count);
+
+	// Hand out grain-sized slices of the batch to a small pool of threads.
+	// Only errors other than regex_error (e.g. std::bad_alloc) stop the batch.
+	std::atomic<size_type> next_work(0);
+	std::atomic<size_type> total(0);
+	std::exception_ptr error;
+	std::mutex error_mutex;
+	auto worker = [&]() {
+		size_type n = 0;
+		for (;;) {
+			size_type i = next_work.fetch_add(1);
+			if (i >= work_count) break;
+			try {
+				n += run(i * grain, std::min(count, (i + 1) * grain));
+			} catch (...) {
+				std::lock_guard<std::mutex> lock(error_mutex);
+				if (!error) error = std::current_exception();
+				next_work = work_count;
+			}
+		}
+		total += n;
+	};
+
+	size_type thread_count = std::min<size_type>(threads, work_count);
+	std::vector<std::thread> pool;
+	for (size_type i = 1; i < thread_count; ++i) {
+		pool.emplace_back(worker);
+	}
+	worker();
+	for (auto& t : pool) t.join();
+	if (error) std::rethrow_exception(error);
+	return total;
+}
+
+////////////////////////////////////////////
+// Implementation of basic_regex_stream
+
+template <class CharT, class Traits>
+basic_regex_stream<CharT, Traits>::basic_regex_stream(
+	const regex_type& e, callback_type callback, match_flag_type flags, size_type window)
+	: m_regex(e)
+	, m_callback(std::move(callback))
+	, m_flags(flags)
+	, m_window(window ? window : size_type(default_window))
+	, m_base(0)
+	, m_pos(0)
+	, m_count(0)
+	, m_done(false)
+	, m_finished(false)
+{
+}
+
+template <class CharT, class Traits>
+void basic_regex_stream<CharT, Traits>::_search(bool at_end) {
+	// Until the end of the stream, the end of the buffer is no end of line or
+	// string; once data was dropped, neither is its beginning. (Passed as
+	// Oniguruma options: match_not_bol shares its bit with nosubs.)
+	const match_flag_type flags = m_flags;
+	OnigOptionType extra_options = ONIG_OPTION_NONE;
+	if (!at_end) {
+		extra_options |= ONIG_OPTION_NOTEOL | ONIG_OPTION_NOT_END_STRING;
+	}
+	if (m_base > 0) {
+		extra_options |= ONIG_OPTION_NOTBOL | ONIG_OPTION_NOT_BEGIN_STRING;
+	}
+
+	const size_type n = m_buffer.size();
+	const CharT* first = m_buffer.data();
+	const CharT* last = first + n;
+
+	while (!m_done) {
+		// A result at position p is final once window() characters follow p
+		if (!at_end && m_pos + m_window > n) break;
+
+		match_type m;
+		if (!_regex_search_with_context(first, first + m_pos, last, m, m_regex, flags, extra_options)) {
+			if (at_end || (m_flags & regex_constants::match_continuous)) {
+				m_done = true;
+			} else {
+				// Positions up to n - window() are settled
+				m_pos = n - m_window + 1;
+			}
+			break;
+		}
+
+		size_type match_pos = m[0].first - first;
+		if (!at_end && match_pos + m_window > n) {
+			// Not final yet; wait for more data
+			m_pos = std::min(match_pos, n - m_window + 1);
+			break;
+		}
+
+		m_callback(m, m_base);
+		++m_count;
+
+		// Advance like regex_iterator::operator++
+		size_type match_end = m[0].second - first;
+		if (m[0].first == m[0].second) {
+			if (match_end == n) {
+				m_done = true;
+				break;
+			}
+			m_pos = match_end + 1;
+		} else {
+			m_pos = match_end;
+		}
+	}
+}
+
+template <class CharT, class Traits>
+void basic_regex_stream<CharT, Traits>::feed(const CharT* data, size_type len) {
+	if (m_finished) throw std::logic_error("basic_regex_stream::feed() after finish()");
+
+	if (m_done) {
+		// Nothing can match any more; just count the input
+		m_base += m_buffer.size() + len;
+		m_buffer.clear();
+		m_pos = 0;
+		return;
+	}
+
+	m_buffer.append(data, len);
+	_search(false);
+
+	// Drop what is no longer needed as context, keeping window() characters
+	// before the search position. Only drop in large steps so that the cost
+	// of moving the buffer stays linear.
+	if (m_pos > m_window) {
+		size_type drop = m_pos - m_window;
+		if (drop >= m_buffer.size() / 2) {
+			m_buffer.erase(0, drop);
+			m_base += drop;
+			m_pos -= drop;
+		}
+	}
+}
+
+template <class CharT, class Traits>
+void basic_regex_stream<CharT, Traits>::finish() {
+	if (m_finished) return;
+	m_finished = true;
+	if (!m_done) _search(true);
+}
+
+template <class CharT, class Traits>
+void basic_regex_stream<CharT, Traits>::reset() {
+	m_buffer.clear();
+	m_base = 0;
+	m_pos = 0;
+	m_count = 0;
+	m_done = false;
+	m_finished = false;
+}
+
+////////////////////////////////////////////
+// Implementation of mapped_file
+
+ONIGPP_INLINE mapped_file::mapped_file() noexcept
+	: m_data(""), m_size(0), m_open(false), m_mapped(false), m_mapping(nullptr)
+{
+}
+
+ONIGPP_INLINE mapped_file::mapped_file(const std::string& path)
+	: m_data(""), m_size(0), m_open(false), m_mapped(false), m_mapping(nullptr)
+{
+	open(path);
+}
+
+ONIGPP_INLINE mapped_file::mapped_file(mapped_file&& other) noexcept
+	: m_data(""), m_size(0), m_open(false), m_mapped(false), m_mapping(nullptr)
+{
+	swap(other);
+}
+
+ONIGPP_INLINE mapped_file& mapped_file::operator=(mapped_file&& other) noexcept {
+	if (this != &other) {
+		close();
+		swap(other);
+	}
+	return *this;
+}
+
+ONIGPP_INLINE mapped_file::~mapped_file() {
+	close();
+}
+
+ONIGPP_INLINE void mapped_file::swap(mapped_file& other) noexcept {
+	// m_data may point into m_buffer; vector swap keeps the element addresses
+	std::swap(m_data, other.m_data);
+	std::swap(m_size, other.m_size);
+	std::swap(m_open, other.m_open);
+	std::swap(m_mapped, other.m_mapped);
+	m_buffer.swap(other.m_buffer);
+	std::swap(m_mapping, other.m_mapping);
+}
+
+ONIGPP_INLINE void mapped_file::open(const std::string& path) {
+	close();
+
+#if defined(_WIN32)
+	HANDLE file = ::CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+	                            OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		throw std::runtime_error("mapped_file: cannot open " + path);
+
+	LARGE_INTEGER file_size;
+	if (::GetFileType(file) == FILE_TYPE_DISK && ::GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0) {
+		HANDLE mapping = ::CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping) {
+			void* view = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			if (view) {
+				::CloseHandle(file);
+				m_data = static_cast<const char*>(view);
+				m_size = static_cast<size_type>(file_size.QuadPart);
+				m_mapping = mapping;
+				m_open = m_mapped = true;
+				return;
+			}
+			::CloseHandle(mapping);
+		}
+	}
+
+	// Not mappable: read it
+	char chunk[64 * 1024];
+	DWORD got;
+	while (::ReadFile(file, chunk, sizeof(chunk), &got, NULL) && got > 0) {
+		m_buffer.insert(m_buffer.end(), chunk, chunk + got);
+	}
+	::CloseHandle(file);
+#elif defined(ONIGPP_HAVE_MMAP)
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw std::runtime_error("mapped_file: cannot open " + path);
+
+	// Empty regular files are read too: files in /proc report a size of 0
+	struct stat st;
+	if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+		void* view = ::mmap(NULL, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		if (view != MAP_FAILED) {
+			::close(fd);
+#ifdef MADV_SEQUENTIAL
+			::madvise(view, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+#endif
+			m_data = static_cast<const char*>(view);
+			m_size = static_cast<size_type>(st.st_size);
+			m_open = m_mapped = true;
+			return;
+		}
+	}
+
+	// Not mappable (pipe, device, mmap failure): read it
+	char chunk[64 * 1024];
+	for (;;) {
+		ssize_t got = ::read(fd, chunk, sizeof(chunk));
+		if (got < 0 && errno == EINTR) continue;
+		if (got < 0) {
+			::close(fd);
+			m_buffer.clear();
+			throw std::runtime_error("mapped_file: cannot read " + path);
+		}
+		if (got == 0) break;
+		m_buffer.insert(m_buffer.end(), chunk, chunk + got);
+	}
+	::close(fd);
+#else
+	std::ifstream in(path.c_str(), std::ios::in | std::ios::binary);
+	if (!in)
+		throw std::runtime_error("mapped_file: cannot open " + path);
+	m_buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	if (in.bad()) {
+		m_buffer.clear();
+		throw std::runtime_error("mapped_file: cannot read " + path);
+	}
+#endif
+
+	if (!m_buffer.empty()) {
+		m_data = m_buffer.data();
+		m_size = m_buffer.size();
+	}
+	m_open = true;
+}
+
+ONIGPP_INLINE void mapped_file::close() noexcept {
+	if (m_mapped) {
+#if defined(_WIN32)
+		::UnmapViewOfFile(m_data);
+		::CloseHandle(static_cast<HANDLE>(m_mapping));
+#elif defined(ONIGPP_HAVE_MMAP)
+		::munmap(const_cast<char*>(m_data), m_size);
+#endif
+	}
+	std::vector<char>().swap(m_buffer);
+	m_data = "";
+	m_size = 0;
+	m_open = m_mapped = false;
+	m_mapping = nullptr;
+}
+
+////////////////////////////////////////////
+// Implementation of the windowed search for large subjects
+
+// Largest number of characters handed to Oniguruma in one call. OnigRegion
+// stores int byte offsets; leave room for the not_bow/not_eow sentinels.
+template <class CharT>
+size_type _max_search_window() {
+	return (static_cast<size_type>(std::numeric_limits<int>::max()) - 16) / sizeof(CharT);
+}
+
+// Like _regex_search_with_context on [first, last), but Oniguruma only ever
+// sees a window of at most window characters: window / 4 characters before
+// the search position as context, and the match must start at least
+// window / 4 characters before the end of a window that was cut short.
+// Otherwise the window moves forward. The results refer to [first, last).
+template <class CharT, class Traits>
+bool _regex_search_windowed(
+	const CharT* first, const CharT* search_start, const CharT* last,
+	match_results<const CharT*>& m,
+	const basic_regex<CharT, Traits>& e,
+	regex_constants::match_flag_type flags,
+	size_type window = _max_search_window<CharT>())
+{
+	if (static_cast<size_type>(last - first) <= window)
+		return _regex_search_with_context(first, search_start, last, m, e, flags);
+
+	const size_type context = window / 4;
+	const size_type margin = window / 4;
+
+	for (;;) {
+		const CharT* base = (static_cast<size_type>(search_start - first) > context) ? search_start - context : first;
+		const CharT* window_end = (static_cast<size_type>(last - base) > window) ? base + window : last;
+		const bool cut = (window_end != last);
+
+		// The window edges are no string or line boundaries
+		OnigOptionType extra_options = ONIG_OPTION_NONE;
+		if (base != first) extra_options |= ONIG_OPTION_NOTBOL | ONIG_OPTION_NOT_BEGIN_STRING;
+		if (cut) extra_options |= ONIG_OPTION_NOTEOL | ONIG_OPTION_NOT_END_STRING;
+
+		bool found = _regex_search_with_context(base, search_start, window_end, m, e, flags, extra_options);
+		const CharT* settled = window_end - margin;
+		if (!cut || (found && m[0].first < settled) || (!found && (flags & regex_constants::match_continuous))) {
+			if (!found) return false;
+
+			// Re-base the results on the whole subject
+			m.m_str_begin = first;
+			m.m_str_end = last;
+			for (size_type i = 0; i < m.size(); ++i) {
+				if (!m[i].matched) {
+					m[i].first = last;
+					m[i].second = last;
+				}
+			}
+			return true;
+		}
+
+		// Nothing final in this window: everything before settled (or before
+		// the candidate) has no match
+		search_start = found ? m[0].first : settled;
+	}
+}
+
+////////////////////////////////////////////
+// Implementation of mapped file search
+
+ONIGPP_INLINE bool regex_search(
+	const mapped_file& file,
+	cmatch& m,
+	const regex& e,
+	regex_constants::match_flag_type flags)
+{
+	return _regex_search_windowed(file.begin(), file.begin(), file.end(), m, e, flags);
+}
+
+ONIGPP_INLINE mapped_regex_iterator::mapped_regex_iterator(const mapped_file& file, const regex& re, match_flag_type flags)
+	: m_begin(file.begin()), m_end(file.end()), m_regex(&re), m_flags(flags)
+{
+	do_search(m_begin);
+}
+
+ONIGPP_INLINE void mapped_regex_iterator::do_search(const char* first) {
+	if (!_regex_search_windowed(m_begin, first, m_end, m_results, *m_regex, m_flags)) {
+		// Invalidate as end iterator
+		m_regex = nullptr;
+		m_results.clear();
+	}
+}
+
+ONIGPP_INLINE bool mapped_regex_iterator::operator==(const mapped_regex_iterator& other) const {
+	if (m_regex == nullptr && other.m_regex == nullptr) return true;
+	if (m_regex == nullptr || other.m_regex == nullptr) return false;
+	if (m_results.empty() || other.m_results.empty()) return false;
+
+	return m_results[0].first == other.m_results[0].first &&
+		   m_results[0].second == other.m_results[0].second;
+}
+
+ONIGPP_INLINE mapped_regex_iterator& mapped_regex_iterator::operator++() {
+	if (m_regex == nullptr || m_results.empty()) {
+		return *this;
+	}
+
+	const char* current_match_end = m_results[0].second;
+
+	// Zero-width match handling (as regex_iterator)
+	if (m_results[0].first == current_match_end) {
+		if (current_match_end == m_end) {
+			m_regex = nullptr;
+			m_results.clear();
+			return *this;
+		}
+		++current_match_end;
+	}
+
+	do_search(current_match_end);
+	return *this;
+}
+
+ONIGPP_INLINE mapped_regex_iterator mapped_regex_iterator::operator++(int) {
+	mapped_regex_iterator tmp = *this;
+	++(*this);
+	return tmp;
+}
+
+ONIGPP_INLINE size_type regex_replace_file(
+	std::ostream& out,
+	const mapped_file& file,
+	const regex& e,
+	const string& fmt,
+	regex_constants::match_flag_type flags)
+{
+	bool first_only = (flags & regex_constants::format_first_only) != 0;
+	bool no_copy = (flags & regex_constants::format_no_copy) != 0;
+	regex_format compiled(fmt, e, flags);
+
+	size_type count = 0;
+	const char* cur = file.begin();
+	std::ostreambuf_iterator<char> it_out(out);
+
+	for (mapped_regex_iterator it(file, e, flags), end; it != end; ++it) {
+		const cmatch& m = *it;
+		if (!no_copy) {
+			out.write(cur, m[0].first - cur);
+		}
+
+		it_out = compiled.apply(it_out, m);
+		++count;
+
+		cur = m[0].second;
+		if (first_only) break;
+	}
+
+	if (!no_copy) {
+		out.write(cur, file.end() - cur);
+	}
+	return count;
+}
+
+ONIGPP_INLINE size_type regex_replace_file(
+	const std::string& in_path,
+	const std::string& out_path,
+	const regex& e,
+	const string& fmt,
+	regex_constants::match_flag_type flags)
+{
+	mapped_file in(in_path);
+	std::ofstream out(out_path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!out)
+		throw std::runtime_error("regex_replace_file: cannot open " + out_path);
+
+	size_type count = regex_replace_file(out, in, e, fmt, flags);
+	out.flush();
+	if (!out)
+		throw std::runtime_error("regex_replace_file: cannot write " + out_path);
+	return count;
+}
+
+////////////////////////////////////////////
+// Implementation of basic_segmented_text
+
+template <class CharT>
+void basic_segmented_text<CharT>::append(const CharT* data, size_type length) {
+	if (length == 0) return;
+	_segment seg = { data, length, m_size };
+	m_segments.push_back(seg);
+	m_size += length;
+}
+
+template <class CharT>
+void basic_segmented_text<CharT>::clear() {
+	m_segments.clear();
+	m_size = 0;
+}
+
+// Index of the span containing offset (the last span for size())
+template <class CharT>
+size_type basic_segmented_text<CharT>::_find(size_type offset) const {
+	auto it = std::upper_bound(m_segments.begin(), m_segments.end(), offset,
+		[](size_type off, const _segment& seg) { return off < seg.start; });
+	return (it == m_segments.begin()) ? 0 : static_cast<size_type>(it - m_segments.begin()) - 1;
+}
+
+template <class CharT>
+typename basic_segmented_text<CharT>::position basic_segmented_text<CharT>::locate(size_type offset) const {
+	if (offset > m_size)
+		throw std::out_of_range("basic_segmented_text::locate");
+	position pos = { 0, 0 };
+	if (m_segments.empty()) return pos;
+	pos.segment = _find(offset);
+	pos.offset = offset - m_segments[pos.segment].start;
+	return pos;
+}
+
+template <class CharT>
+void basic_segmented_text<CharT>::copy(size_type first, size_type last, string_type& out) const {
+	if (first > last || last > m_size)
+		throw std::out_of_range("basic_segmented_text::copy");
+	if (first == last) return;
+	out.reserve(out.size() + (last - first));
+	for (size_type i = _find(first); first < last; ++i) {
+		const _segment& seg = m_segments[i];
+		size_type from = first - seg.start;
+		size_type count = std::min(seg.size - from, last - first);
+		out.append(seg.data + from, count);
+		first += count;
+	}
+}
+
+template <class CharT, class Traits>
+struct _segmented_search {
+	using text_type = basic_segmented_text<CharT>;
+
+	// Searches from start. Oniguruma sees either the rest of the span
+	// holding start (in place) or, near a span boundary, a copy of
+	// [start - margin, start + 3 * margin) in scratch; the window edges are
+	// no string or line boundaries. As in _regex_search_windowed, a match
+	// found in a window that ends before the text is final only if it starts
+	// margin characters before the window end; otherwise the search resumes
+	// further on. A match reaching the end of such a window is retried in a
+	// copied window twice as large.
+	static bool search(const text_type& text, size_type start,
+	                   basic_segmented_match<CharT>& result,
+	                   const basic_regex<CharT, Traits>& e,
+	                   regex_constants::match_flag_type flags,
+	                   size_type margin, basic_string<CharT>& scratch)
+	{
+		result.m_text = &text;
+		result.m_groups.clear();
+		if (start > text.m_size) return false;
+		if (margin == 0) margin = 1;
+
+		const size_type total = text.m_size;
+		match_results<const CharT*> m;
+		static const CharT empty_subject[1] = { CharT() };
+
+		size_type extent = 3 * margin; // characters after start in a copied window
+		bool grown = false;
+
+		for (;;) {
+			size_type window_begin = (start > margin) ? start - margin : 0;
+			size_type window_end;
+			const CharT* data;
+			if (text.m_segments.empty()) {
+				window_end = 0;
+				data = empty_subject;
+			} else {
+				const auto& seg = text.m_segments[text._find(start)];
+				size_type seg_end = seg.start + seg.size;
+				if (!grown && window_begin >= seg.start && (seg_end == total || seg_end > start + margin)) {
+					// In place
+					window_end = seg_end;
+					data = seg.data + (window_begin - seg.start);
+				} else {
+					window_end = std::min(total, start + extent);
+					scratch.clear();
+					text.copy(window_begin, window_end, scratch);
+					data = scratch.data();
+				}
+			}
+			const bool cut = (window_end != total);
+
+			OnigOptionType extra_options = ONIG_OPTION_NONE;
+			if (window_begin != 0) extra_options |= ONIG_OPTION_NOTBOL | ONIG_OPTION_NOT_BEGIN_STRING;
+			if (cut) extra_options |= ONIG_OPTION_NOTEOL | ONIG_OPTION_NOT_END_STRING;
+
+			const CharT* first = data;
+			const CharT* last = data + (window_end - window_begin);
+			bool found = _regex_search_with_context(first, first + (start - window_begin), last, m, e, flags, extra_options);
+			size_type settled = window_end - margin;
+			size_type match_pos = found ? window_begin + static_cast<size_type>(m[0].first - first) : 0;
+
+			if (found && cut && m[0].second == last) {
+				// The match may continue past the window: retry with a larger one
+				extent = std::max(2 * extent, 2 * (window_end - start));
+				grown = true;
+				continue;
+			}
 
-template <class BidirIt, class CharT, class Traits>
-regex_token_iterator<BidirIt, CharT, Traits>::regex_token_iterator(
-	BidirIt first, BidirIt last,
-	const regex_type& re,
-	const std::vector<int>& subs,
-	match_flag_type flags)
-	: m_itor(first, last, re, flags), m_end(), m_subs(subs), m_subs_idx(0), m_last(last)
-{
-	if (m_itor == m_end) {
-		// No matches
-		if (std::find(m_subs.begin(), m_subs.end(), -1) != m_subs.end()) {
-			// Entire string as single token
-			m_sub_match = sub_match<BidirIt>(first, last, first != last);
-			m_subs.clear(); // Will terminate on next increment
-		} else {
-			m_subs.clear();
-		}
-	} else {
-		// Match found
-		int sub_idx = m_subs[m_subs_idx];
+			if (!cut || (found && match_pos < settled) || (!found && (flags & regex_constants::match_continuous))) {
+				if (!found) return false;
+				result.m_groups.resize(m.size());
+				for (size_type i = 0; i < m.size(); ++i) {
+					if (m[i].matched) {
+						result.m_groups[i].first = window_begin + static_cast<size_type>(m[i].first - first);
+						result.m_groups[i].second = static_cast<size_type>(m[i].second - m[i].first);
+					} else {
+						result.m_groups[i].first = basic_segmented_match<CharT>::npos;
+						result.m_groups[i].second = 0;
+					}
+				}
+				return true;
+			}
 
-		if (sub_idx == -1) {
-			// Output prefix (text before first match)
-			m_sub_match = sub_match<BidirIt>(first, (*m_itor)[0].first, first != (*m_itor)[0].first);
-		} else if (sub_idx >= 0 && sub_idx < (int)(*m_itor).size()) {
-			m_sub_match = (*m_itor)[sub_idx];
-		} else {
-			m_sub_match = sub_match<BidirIt>();
-			m_sub_match.matched = false;
+			// Nothing final in this window: everything before settled (or
+			// before the candidate) has no match
+			start = found ? match_pos : settled;
 		}
 	}
-}
+};
 
-// Convenience constructor with std::initializer_list
-template <class BidirIt, class CharT, class Traits>
-regex_token_iterator<BidirIt, CharT, Traits>::regex_token_iterator(
-	BidirIt first, BidirIt last,
-	const regex_type& re,
-	std::initializer_list<int> subs,
-	match_flag_type flags)
-	: regex_token_iterator(first, last, re, std::vector<int>(subs), flags)
+template <class CharT, class Traits>
+bool regex_search(
+	const basic_segmented_text<CharT>& text,
+	basic_segmented_match<CharT>& m,
+	const basic_regex<CharT, Traits>& e,
+	regex_constants::match_flag_type flags,
+	size_type start,
+	size_type margin)
 {
-	// Delegate to vector constructor
+	basic_string<CharT> scratch;
+	return _segmented_search<CharT, Traits>::search(text, start, m, e, flags, margin, scratch);
 }
 
-// Convenience constructor with single int
-template <class BidirIt, class CharT, class Traits>
-regex_token_iterator<BidirIt, CharT, Traits>::regex_token_iterator(
-	BidirIt first, BidirIt last,
-	const regex_type& re,
-	int sub,
-	match_flag_type flags)
-	: regex_token_iterator(first, last, re, std::vector<int>{sub}, flags)
+template <class CharT, class Traits>
+basic_segmented_regex_iterator<CharT, Traits>::basic_segmented_regex_iterator(
+	const text_type& text, const regex_type& re, match_flag_type flags, size_type margin)
+	: m_text(&text), m_regex(&re), m_flags(flags), m_margin(margin)
 {
-	// Delegate to vector constructor
+	do_search(0);
 }
 
-template <class BidirIt, class CharT, class Traits>
-bool regex_token_iterator<BidirIt, CharT, Traits>::operator==(const regex_token_iterator& other) const {
-	// Check for termination
-	if (m_subs.empty() && other.m_subs.empty()) return true;
-	if (m_subs.empty() || other.m_subs.empty()) return false;
+template <class CharT, class Traits>
+void basic_segmented_regex_iterator<CharT, Traits>::do_search(size_type start) {
+	if (!_segmented_search<CharT, Traits>::search(*m_text, start, m_results, *m_regex, m_flags, m_margin, m_scratch)) {
+		// Invalidate as end iterator
+		m_regex = nullptr;
+		m_results.clear();
+	}
+}
 
-	// Normal comparison
-	return m_itor == other.m_itor &&
-		   m_sub_match.first == other.m_sub_match.first &&
-		   m_sub_match.second == other.m_sub_match.second;
+template <class CharT, class Traits>
+bool basic_segmented_regex_iterator<CharT, Traits>::operator==(const basic_segmented_regex_iterator& other) const {
+	if (m_regex == nullptr && other.m_regex == nullptr) return true;
+	if (m_regex == nullptr || other.m_regex == nullptr) return false;
+	if (m_results.empty() || other.m_results.empty()) return false;
+
+	return m_text == other.m_text &&
+		   m_results.position(0) == other.m_results.position(0) &&
+		   m_results.length(0) == other.m_results.length(0);
 }
 
-template <class BidirIt, class CharT, class Traits>
-regex_token_iterator<BidirIt, CharT, Traits>& regex_token_iterator<BidirIt, CharT, Traits>::operator++() {
-	_do_increment();
+template <class CharT, class Traits>
+basic_segmented_regex_iterator<CharT, Traits>& basic_segmented_regex_iterator<CharT, Traits>::operator++() {
+	if (m_regex == nullptr || m_results.empty()) {
+		return *this;
+	}
+
+	size_type current_match_end = m_results.position(0) + m_results.length(0);
+
+	// Zero-width match handling (as regex_iterator)
+	if (m_results.length(0) == 0) {
+		if (current_match_end == m_text->size()) {
+			m_regex = nullptr;
+			m_results.clear();
+			return *this;
+		}
+		++current_match_end;
+	}
+
+	do_search(current_match_end);
 	return *this;
 }
 
-template <class BidirIt, class CharT, class Traits>
-regex_token_iterator<BidirIt, CharT, Traits> regex_token_iterator<BidirIt, CharT, Traits>::operator++(int) {
-	regex_token_iterator tmp = *this;
+template <class CharT, class Traits>
+basic_segmented_regex_iterator<CharT, Traits> basic_segmented_regex_iterator<CharT, Traits>::operator++(int) {
+	basic_segmented_regex_iterator tmp = *this;
 	++(*this);
 	return tmp;
 }
@@ -1816,7 +4977,7 @@ regex_token_iterator<BidirIt, CharT, Traits> regex_token_iterator<BidirIt, CharT
 ////////////////////////////////////////////
 // onigpp::init
 
-int init(const OnigEncoding *encodings, size_type encodings_count) {
+ONIGPP_INLINE int init(const OnigEncoding *encodings, size_type encodings_count) {
 	static OnigEncoding use_encodings[] = {
 #define DEFINE_ENCODING(name) ONIG_ENCODING_##name,
 #include "../supported_encodings.h"
@@ -1826,6 +4987,7 @@ int init(const OnigEncoding *encodings, size_type encodings_count) {
 		encodings = use_encodings;
 		encodings_count = sizeof(use_encodings) / sizeof(use_encodings[0]);
 	}
+	std::lock_guard<std::mutex> lock(_init_mutex());
 	int err = onig_initialize((OnigEncoding *)encodings, (int)encodings_count);
 	if (err != ONIG_NORMAL) {
 		throw std::runtime_error("onig_initialize failed");
@@ -1836,12 +4998,173 @@ int init(const OnigEncoding *encodings, size_type encodings_count) {
 ////////////////////////////////////////////
 // onigpp::uninit
 
-void uninit() { onig_end(); }
+ONIGPP_INLINE void uninit() {
+	std::lock_guard<std::mutex> lock(_init_mutex());
+	onig_end();
+}
 
 ////////////////////////////////////////////
 // onigpp::version
 
-const char* version() { return onig_version(); }
+ONIGPP_INLINE const char* version() { return onig_version(); }
+
+////////////////////////////////////////////
+// onigpp::memory_resource
+
+class _new_delete_resource : public memory_resource {
+protected:
+	void* do_allocate(size_type bytes, size_type alignment) override {
+		// operator new aligns for std::max_align_t only
+		if (alignment > alignof(std::max_align_t)) throw std::bad_alloc();
+		return ::operator new(bytes);
+	}
+	void do_deallocate(void* p, size_type, size_type) override {
+		::operator delete(p);
+	}
+	bool do_is_equal(const memory_resource& other) const noexcept override {
+		return dynamic_cast<const _new_delete_resource*>(&other) != nullptr;
+	}
+};
+
+ONIGPP_INLINE memory_resource*& _thread_memory_resource() {
+	static thread_local memory_resource* resource = nullptr;
+	return resource;
+}
+
+ONIGPP_INLINE memory_resource* new_delete_resource() noexcept {
+	static _new_delete_resource resource;
+	return &resource;
+}
+
+ONIGPP_INLINE memory_resource* get_thread_memory_resource() noexcept {
+	memory_resource* r = _thread_memory_resource();
+	return r ? r : new_delete_resource();
+}
+
+ONIGPP_INLINE memory_resource* set_thread_memory_resource(memory_resource* r) noexcept {
+	memory_resource* previous = get_thread_memory_resource();
+	_thread_memory_resource() = r;
+	return previous;
+}
+
+ONIGPP_INLINE arena_resource::arena_resource(size_type block_size, memory_resource* upstream)
+	: m_upstream(upstream ? upstream : new_delete_resource()),
+	  m_block_size(std::max<size_type>(block_size, 2 * sizeof(_block))),
+	  m_blocks(nullptr), m_cur(nullptr), m_end(nullptr), m_allocated(0)
+{
+}
+
+ONIGPP_INLINE arena_resource::~arena_resource() {
+	while (m_blocks) {
+		_block* next = m_blocks->next;
+		m_upstream->deallocate(m_blocks, m_blocks->size, alignof(std::max_align_t));
+		m_blocks = next;
+	}
+}
+
+ONIGPP_INLINE void arena_resource::release() noexcept {
+	_block* largest = nullptr;
+	while (m_blocks) {
+		_block* next = m_blocks->next;
+		if (!largest || m_blocks->size > largest->size) {
+			if (largest) m_upstream->deallocate(largest, largest->size, alignof(std::max_align_t));
+			largest = m_blocks;
+		} else {
+			m_upstream->deallocate(m_blocks, m_blocks->size, alignof(std::max_align_t));
+		}
+		m_blocks = next;
+	}
+	m_blocks = largest;
+	if (largest) {
+		largest->next = nullptr;
+		m_cur = reinterpret_cast<char*>(largest + 1);
+		m_end = reinterpret_cast<char*>(largest) + largest->size;
+	} else {
+		m_cur = m_end = nullptr;
+	}
+	m_allocated = 0;
+}
+
+ONIGPP_INLINE size_type arena_resource::capacity() const noexcept {
+	size_type total = 0;
+	for (const _block* b = m_blocks; b; b = b->next) total += b->size;
+	return total;
+}
+
+ONIGPP_INLINE void* arena_resource::do_allocate(size_type bytes, size_type alignment) {
+	if (alignment == 0 || (alignment & (alignment - 1)))
+		throw std::bad_alloc();
+	if (bytes == 0) bytes = 1;
+
+	uintptr_t p = (reinterpret_cast<uintptr_t>(m_cur) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+	if (!m_cur || p > reinterpret_cast<uintptr_t>(m_end) || bytes > reinterpret_cast<uintptr_t>(m_end) - p) {
+		// A new block, at least twice as large as the previous one
+		const size_type header = sizeof(_block) + alignment;
+		if (bytes > std::numeric_limits<size_type>::max() - header) throw std::bad_alloc();
+		size_type size = m_block_size;
+		while (size < bytes + header) {
+			if (size > std::numeric_limits<size_type>::max() / 2) {
+				size = bytes + header;
+				break;
+			}
+			size *= 2;
+		}
+		_block* block = static_cast<_block*>(m_upstream->allocate(size, alignof(std::max_align_t)));
+		block->next = m_blocks;
+		block->size = size;
+		m_blocks = block;
+		m_end = reinterpret_cast<char*>(block) + size;
+		if (size <= std::numeric_limits<size_type>::max() / 2) m_block_size = size * 2;
+		p = (reinterpret_cast<uintptr_t>(block + 1) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+	}
+	m_cur = reinterpret_cast<char*>(p) + bytes;
+	m_allocated += bytes;
+	return reinterpret_cast<void*>(p);
+}
+
+////////////////////////////////////////////
+// onigpp::regex_stats instrumentation
+
+ONIGPP_INLINE void set_regex_stats_enabled(bool enabled) {
+	if (enabled)
+		_instrumentation::get().active.fetch_or(_instrumentation::stats_bit);
+	else
+		_instrumentation::get().active.fetch_and(~static_cast<unsigned>(_instrumentation::stats_bit));
+}
+
+ONIGPP_INLINE bool regex_stats_enabled() {
+	return (_instrumentation::get().active.load() & _instrumentation::stats_bit) != 0;
+}
+
+ONIGPP_INLINE void set_slow_search_hook(std::chrono::nanoseconds threshold, slow_search_hook hook) {
+	_instrumentation& inst = _instrumentation::get();
+	std::shared_ptr<const slow_search_hook> installed;
+	if (hook) installed = std::make_shared<const slow_search_hook>(std::move(hook));
+
+	std::lock_guard<std::mutex> lock(inst.mutex);
+	inst.hook = installed;
+	inst.threshold = threshold.count();
+	if (installed)
+		inst.active.fetch_or(_instrumentation::hook_bit);
+	else
+		inst.active.fetch_and(~static_cast<unsigned>(_instrumentation::hook_bit));
+}
+
+#ifdef ONIG_DEBUG_STATISTICS
+// Defined by Oniguruma (regexec.c) when built with ONIG_DEBUG_STATISTICS
+extern "C" {
+	void onig_statistics_init(void);
+	int onig_print_statistics(FILE* f);
+}
+
+ONIGPP_INLINE bool engine_statistics_available() { return true; }
+ONIGPP_INLINE void reset_engine_statistics() { onig_statistics_init(); }
+ONIGPP_INLINE void print_engine_statistics(FILE* fp) { onig_print_statistics(fp); }
+#else
+ONIGPP_INLINE bool engine_statistics_available() { return false; }
+ONIGPP_INLINE void reset_engine_statistics() { }
+ONIGPP_INLINE void print_engine_statistics(FILE*) { }
+#endif
 
 ////////////////////////////////////////////
 // onigpp::regex_escape
@@ -1882,15 +5205,275 @@ basic_string<CharT> regex_escape(const CharT* str) {
 }
 
 // Explicit template instantiations for regex_escape
-template basic_string<char> regex_escape<char>(const basic_string<char>&);
-template basic_string<wchar_t> regex_escape<wchar_t>(const basic_string<wchar_t>&);
-template basic_string<char16_t> regex_escape<char16_t>(const basic_string<char16_t>&);
-template basic_string<char32_t> regex_escape<char32_t>(const basic_string<char32_t>&);
+ONIGPP_INSTANTIATE basic_string<char> regex_escape<char>(const basic_string<char>&);
+ONIGPP_INSTANTIATE basic_string<wchar_t> regex_escape<wchar_t>(const basic_string<wchar_t>&);
+ONIGPP_INSTANTIATE basic_string<char16_t> regex_escape<char16_t>(const basic_string<char16_t>&);
+ONIGPP_INSTANTIATE basic_string<char32_t> regex_escape<char32_t>(const basic_string<char32_t>&);
+
+ONIGPP_INSTANTIATE basic_string<char> regex_escape<char>(const char*);
+ONIGPP_INSTANTIATE basic_string<wchar_t> regex_escape<wchar_t>(const wchar_t*);
+ONIGPP_INSTANTIATE basic_string<char16_t> regex_escape<char16_t>(const char16_t*);
+ONIGPP_INSTANTIATE basic_string<char32_t> regex_escape<char32_t>(const char32_t*);
+
+////////////////////////////////////////////
+// onigpp::regex_literal_union
+
+// Builds the merged trie of regex_literal_union and writes its pattern.
+// Nodes are numbered; identical subtries (same end flag, same edges to the
+// same nodes) get the same number, bottom-up, so the trie becomes a DAG.
+template <class CharT>
+class _literal_trie {
+public:
+	typedef basic_string<CharT> string_type;
+
+	explicit _literal_trie(bool icase) : m_icase(icase) { m_nodes.push_back(node()); }
+
+	void insert(const string_type& literal) {
+		size_type n = 0;
+		for (size_type i = 0; i < literal.size(); ) {
+			size_type len = _char_length(literal, i);
+			while (m_icase && i + len < literal.size() && _is_combining(literal, i + len))
+				len += _char_length(literal, i + len);
+			string_type ch = literal.substr(i, len);
+			if (m_icase) ch[0] = _fold(ch[0]);
+			i += len;
+
+			typename std::map<string_type, size_type>::iterator it = m_nodes[n].edges.find(ch);
+			if (it == m_nodes[n].edges.end()) {
+				m_nodes[n].edges.insert(std::make_pair(ch, m_nodes.size()));
+				n = m_nodes.size();
+				m_nodes.push_back(node());
+			} else {
+				n = it->second;
+			}
+		}
+		m_nodes[n].end = true;
+	}
+
+	bool empty() const { return m_nodes[0].edges.empty() && !m_nodes[0].end; }
+
+	string_type pattern() {
+		std::map<signature, size_type> canonical;
+		const size_type root = _merge(0, canonical);
+
+		if (empty()) {
+			static const CharT never[] = { CharT('('), CharT('?'), CharT('!'), CharT(')'), CharT(0) };
+			return never;
+		}
+		string_type result;
+		_write(root, result);
+		return result;
+	}
+
+private:
+	struct node {
+		bool end; // A literal ends here
+		std::map<string_type, size_type> edges; // Character -> node
+		node() : end(false) { }
+	};
+	typedef std::pair<bool, std::vector<std::pair<string_type, size_type>>> signature;
+
+	bool m_icase;
+	std::vector<node> m_nodes;  // The trie; m_nodes[0] is the root
+	std::vector<node> m_merged; // The DAG, numbered by _merge
+
+	// Code units of the character at s[i]: UTF-8 for char, UTF-16 for
+	// 16-bit code units
+	static size_type _char_length(const string_type& s, size_type i) {
+		const unsigned long u = static_cast<unsigned long>(static_cast<typename std::make_unsigned<CharT>::type>(s[i]));
+		size_type len = 1;
+		if (sizeof(CharT) == 1)
+			len = (u >= 0xF0) ? 4 : (u >= 0xE0) ? 3 : (u >= 0xC0) ? 2 : 1;
+		else if (sizeof(CharT) == 2 && u >= 0xD800 && u <= 0xDBFF)
+			len = 2;
+		return std::min(len, s.size() - i);
+	}
+
+	// Whether s[i] starts a combining diacritical mark (U+0300-U+036F). With
+	// icase a character keeps its marks, as a case fold may need them all
+	// (U+01F0 folds to j + U+030C).
+	static bool _is_combining(const string_type& s, size_type i) {
+		typedef typename std::make_unsigned<CharT>::type unit_type;
+		const unsigned long u = static_cast<unit_type>(s[i]);
+		if (sizeof(CharT) == 1)
+			return i + 1 < s.size() && (u == 0xCC || (u == 0xCD && static_cast<unit_type>(s[i + 1]) < 0xB0));
+		return u >= 0x300 && u <= 0x36F;
+	}
+
+	// Numbers the subtrie of n in m_merged and returns its number
+	size_type _merge(size_type n, std::map<signature, size_type>& canonical) {
+		signature sig;
+		sig.first = m_nodes[n].end;
+		for (const auto& edge : m_nodes[n].edges)
+			sig.second.push_back(std::make_pair(edge.first, _merge(edge.second, canonical)));
+
+		typename std::map<signature, size_type>::iterator it = canonical.find(sig);
+		if (it == canonical.end()) {
+			node merged;
+			merged.end = sig.first;
+			merged.edges.insert(sig.second.begin(), sig.second.end());
+			it = canonical.insert(std::make_pair(sig, m_merged.size())).first;
+			m_merged.push_back(merged);
+		}
+		return it->second;
+	}
+
+	static bool _is_meta(CharT c) {
+		switch (c) {
+		case CharT('.'): case CharT('^'): case CharT('$'): case CharT('*'):
+		case CharT('+'): case CharT('?'): case CharT('('): case CharT(')'):
+		case CharT('['): case CharT(']'): case CharT('{'): case CharT('}'):
+		case CharT('\\'): case CharT('|'):
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	static bool _is_class_meta(CharT c) {
+		return c == CharT('\\') || c == CharT(']') || c == CharT('[') || c == CharT('^') ||
+		       c == CharT('-') || c == CharT('&');
+	}
+
+	// One character, or a class of several. Runs of at least three
+	// consecutive one-unit characters become ranges.
+	static void _write_chars(const std::vector<string_type>& chars, string_type& out) {
+		if (chars.size() == 1) {
+			if (chars[0].size() == 1 && _is_meta(chars[0][0])) out += CharT('\\');
+			out += chars[0];
+			return;
+		}
+		out += CharT('[');
+		for (size_type i = 0; i < chars.size(); ) {
+			size_type j = i + 1;
+			if (chars[i].size() == 1) {
+				while (j < chars.size() && chars[j].size() == 1 && chars[j][0] == CharT(chars[j - 1][0] + 1)) ++j;
+			}
+			if (j - i >= 3) {
+				if (_is_class_meta(chars[i][0])) out += CharT('\\');
+				out += chars[i];
+				out += CharT('-');
+				if (_is_class_meta(chars[j - 1][0])) out += CharT('\\');
+				out += chars[j - 1];
+			} else {
+				j = i + 1;
+				if (chars[i].size() == 1 && _is_class_meta(chars[i][0])) out += CharT('\\');
+				out += chars[i];
+			}
+			i = j;
+		}
+		out += CharT(']');
+	}
+
+	// Whether ch may share a class with other characters
+	bool _classable(const string_type& ch) const {
+		return !m_icase || (ch.size() == 1 && static_cast<typename std::make_unsigned<CharT>::type>(ch[0]) < 0x80);
+	}
 
-template basic_string<char> regex_escape<char>(const char*);
-template basic_string<wchar_t> regex_escape<wchar_t>(const wchar_t*);
-template basic_string<char16_t> regex_escape<char16_t>(const char16_t*);
-template basic_string<char32_t> regex_escape<char32_t>(const char32_t*);
+	void _write(size_type n, string_type& out) const {
+		const node& nd = m_merged[n];
+		if (nd.edges.empty()) return;
+
+		// Characters leading to the same node share a class
+		std::vector<std::pair<size_type, std::vector<string_type>>> alternatives;
+		for (const auto& edge : nd.edges) {
+			bool merged = false;
+			if (_classable(edge.first)) {
+				for (auto& alt : alternatives) {
+					if (alt.first == edge.second && _classable(alt.second[0])) {
+						alt.second.push_back(edge.first);
+						merged = true;
+						break;
+					}
+				}
+			}
+			if (!merged)
+				alternatives.push_back(std::make_pair(edge.second, std::vector<string_type>(1, edge.first)));
+		}
+
+		// A single character or class takes the '?' without a group
+		const bool group = alternatives.size() > 1 || (nd.end && !m_merged[alternatives[0].first].edges.empty());
+		if (group) {
+			static const CharT open[] = { CharT('('), CharT('?'), CharT(':'), CharT(0) };
+			out += open;
+		}
+		for (size_type i = 0; i < alternatives.size(); ++i) {
+			if (i) out += CharT('|');
+			_write_chars(alternatives[i].second, out);
+			_write(alternatives[i].first, out);
+		}
+		if (group) out += CharT(')');
+		if (nd.end) out += CharT('?'); // Greedy: longer literals first
+	}
+
+	static CharT _fold(CharT c) {
+		return (c >= CharT('A') && c <= CharT('Z')) ? CharT(c - CharT('A') + CharT('a')) : c;
+	}
+
+public:
+	// Whether literal contains ss, st, ff, fi or fl, which with icase also
+	// match one character of the subject (U+00DF, U+FB06, U+FB01, ...).
+	// Oniguruma folds those only within one string, so such literals are
+	// not split into the trie.
+	static bool folds_across(const string_type& literal) {
+		for (size_type i = 0; i + 1 < literal.size(); ++i) {
+			const CharT a = _fold(literal[i]), b = _fold(literal[i + 1]);
+			if ((a == CharT('s') && (b == CharT('s') || b == CharT('t'))) ||
+			    (a == CharT('f') && (b == CharT('f') || b == CharT('i') || b == CharT('l'))))
+				return true;
+		}
+		return false;
+	}
+
+	// The literal with its ASCII letters folded and its metacharacters escaped
+	static string_type whole(const string_type& literal) {
+		string_type out;
+		for (CharT c : literal) {
+			if (_is_meta(c)) out += CharT('\\');
+			out += _fold(c);
+		}
+		return out;
+	}
+};
+
+template <class CharT>
+basic_string<CharT> regex_literal_union(const std::vector<basic_string<CharT>>& literals, bool icase) {
+	_literal_trie<CharT> trie(icase);
+	std::vector<basic_string<CharT>> wholes;
+	for (const basic_string<CharT>& literal : literals) {
+		if (icase && _literal_trie<CharT>::folds_across(literal))
+			wholes.push_back(_literal_trie<CharT>::whole(literal));
+		else
+			trie.insert(literal);
+	}
+	if (wholes.empty())
+		return trie.pattern();
+
+	// The whole literals come first, longest first; a literal of the trie
+	// matching at the same position can only be shorter
+	std::sort(wholes.begin(), wholes.end(), [](const basic_string<CharT>& a, const basic_string<CharT>& b) {
+		return a.size() != b.size() ? a.size() > b.size() : a < b;
+	});
+	wholes.erase(std::unique(wholes.begin(), wholes.end()), wholes.end());
+	if (!trie.empty())
+		wholes.push_back(trie.pattern());
+	if (wholes.size() == 1)
+		return wholes[0];
+
+	static const CharT open[] = { CharT('('), CharT('?'), CharT(':'), CharT(0) };
+	basic_string<CharT> result(open);
+	for (size_type i = 0; i < wholes.size(); ++i) {
+		if (i) result += CharT('|');
+		result += wholes[i];
+	}
+	result += CharT(')');
+	return result;
+}
+
+ONIGPP_INSTANTIATE basic_string<char> regex_literal_union<char>(const std::vector<basic_string<char>>&, bool);
+ONIGPP_INSTANTIATE basic_string<wchar_t> regex_literal_union<wchar_t>(const std::vector<basic_string<wchar_t>>&, bool);
+ONIGPP_INSTANTIATE basic_string<char16_t> regex_literal_union<char16_t>(const std::vector<basic_string<char16_t>>&, bool);
+ONIGPP_INSTANTIATE basic_string<char32_t> regex_literal_union<char32_t>(const std::vector<basic_string<char32_t>>&, bool);
 
 // -------------------- Explicit template instantiations --------------------
 // Instantiates for: char, wchar_t, char16_t, char32_t
@@ -1908,102 +5491,442 @@ using u16_sub_alloc = std::allocator< sub_match<u16_iter> >;
 using u32_sub_alloc = std::allocator< sub_match<u32_iter> >;
 
 // basic_regex instantiations
-template class basic_regex<char, regex_traits<char>>;
-template class basic_regex<wchar_t, regex_traits<wchar_t>>;
-template class basic_regex<char16_t, regex_traits<char16_t>>;
-template class basic_regex<char32_t, regex_traits<char32_t>>;
+ONIGPP_INSTANTIATE class basic_regex<char, regex_traits<char>>;
+ONIGPP_INSTANTIATE class basic_regex<wchar_t, regex_traits<wchar_t>>;
+ONIGPP_INSTANTIATE class basic_regex<char16_t, regex_traits<char16_t>>;
+ONIGPP_INSTANTIATE class basic_regex<char32_t, regex_traits<char32_t>>;
 
 // regex_iterator instantiations
-template class regex_iterator<s_iter, char, regex_traits<char>>;
-template class regex_iterator<ws_iter, wchar_t, regex_traits<wchar_t>>;
-template class regex_iterator<u16_iter, char16_t, regex_traits<char16_t>>;
-template class regex_iterator<u32_iter, char32_t, regex_traits<char32_t>>;
+ONIGPP_INSTANTIATE class regex_iterator<s_iter, char, regex_traits<char>>;
+ONIGPP_INSTANTIATE class regex_iterator<ws_iter, wchar_t, regex_traits<wchar_t>>;
+ONIGPP_INSTANTIATE class regex_iterator<u16_iter, char16_t, regex_traits<char16_t>>;
+ONIGPP_INSTANTIATE class regex_iterator<u32_iter, char32_t, regex_traits<char32_t>>;
 
 // regex_token_iterator instantiations
-template class regex_token_iterator<s_iter, char, regex_traits<char>>;
-template class regex_token_iterator<ws_iter, wchar_t, regex_traits<wchar_t>>;
-template class regex_token_iterator<u16_iter, char16_t, regex_traits<char16_t>>;
-template class regex_token_iterator<u32_iter, char32_t, regex_traits<char32_t>>;
+ONIGPP_INSTANTIATE class regex_token_iterator<s_iter, char, regex_traits<char>>;
+ONIGPP_INSTANTIATE class regex_token_iterator<ws_iter, wchar_t, regex_traits<wchar_t>>;
+ONIGPP_INSTANTIATE class regex_token_iterator<u16_iter, char16_t, regex_traits<char16_t>>;
+ONIGPP_INSTANTIATE class regex_token_iterator<u32_iter, char32_t, regex_traits<char32_t>>;
+
+// basic_regex_cache instantiations
+ONIGPP_INSTANTIATE class basic_regex_cache<char, regex_traits<char>>;
+ONIGPP_INSTANTIATE class basic_regex_cache<wchar_t, regex_traits<wchar_t>>;
+ONIGPP_INSTANTIATE class basic_regex_cache<char16_t, regex_traits<char16_t>>;
+ONIGPP_INSTANTIATE class basic_regex_cache<char32_t, regex_traits<char32_t>>;
+
+// basic_regex_set instantiations
+ONIGPP_INSTANTIATE class basic_regex_set<char, regex_traits<char>>;
+ONIGPP_INSTANTIATE class basic_regex_set<wchar_t, regex_traits<wchar_t>>;
+ONIGPP_INSTANTIATE class basic_regex_set<char16_t, regex_traits<char16_t>>;
+ONIGPP_INSTANTIATE class basic_regex_set<char32_t, regex_traits<char32_t>>;
+
+// regex_set_iterator instantiations
+ONIGPP_INSTANTIATE class regex_set_iterator<s_iter, char, regex_traits<char>>;
+ONIGPP_INSTANTIATE class regex_set_iterator<ws_iter, wchar_t, regex_traits<wchar_t>>;
+ONIGPP_INSTANTIATE class regex_set_iterator<u16_iter, char16_t, regex_traits<char16_t>>;
+ONIGPP_INSTANTIATE class regex_set_iterator<u32_iter, char32_t, regex_traits<char32_t>>;
+ONIGPP_INSTANTIATE class regex_set_iterator<const char*, char, regex_traits<char>>;
+ONIGPP_INSTANTIATE class regex_set_iterator<const wchar_t*, wchar_t, regex_traits<wchar_t>>;
+ONIGPP_INSTANTIATE class regex_set_iterator<const char16_t*, char16_t, regex_traits<char16_t>>;
+ONIGPP_INSTANTIATE class regex_set_iterator<const char32_t*, char32_t, regex_traits<char32_t>>;
+
+// regex_set_search instantiations
+ONIGPP_INSTANTIATE int regex_set_search<s_iter, s_sub_alloc, char, regex_traits<char>>(
+	s_iter, s_iter, match_results<s_iter, s_sub_alloc>&, const basic_regex_set<char, regex_traits<char>>&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE int regex_set_search<ws_iter, ws_sub_alloc, wchar_t, regex_traits<wchar_t>>(
+	ws_iter, ws_iter, match_results<ws_iter, ws_sub_alloc>&, const basic_regex_set<wchar_t, regex_traits<wchar_t>>&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE int regex_set_search<u16_iter, u16_sub_alloc, char16_t, regex_traits<char16_t>>(
+	u16_iter, u16_iter, match_results<u16_iter, u16_sub_alloc>&, const basic_regex_set<char16_t, regex_traits<char16_t>>&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE int regex_set_search<u32_iter, u32_sub_alloc, char32_t, regex_traits<char32_t>>(
+	u32_iter, u32_iter, match_results<u32_iter, u32_sub_alloc>&, const basic_regex_set<char32_t, regex_traits<char32_t>>&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE int regex_set_search<const char*, std::allocator<sub_match<const char*>>, char, regex_traits<char>>(
+	const char*, const char*, match_results<const char*>&, const basic_regex_set<char, regex_traits<char>>&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE int regex_set_search<const wchar_t*, std::allocator<sub_match<const wchar_t*>>, wchar_t, regex_traits<wchar_t>>(
+	const wchar_t*, const wchar_t*, match_results<const wchar_t*>&, const basic_regex_set<wchar_t, regex_traits<wchar_t>>&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE int regex_set_search<const char16_t*, std::allocator<sub_match<const char16_t*>>, char16_t, regex_traits<char16_t>>(
+	const char16_t*, const char16_t*, match_results<const char16_t*>&, const basic_regex_set<char16_t, regex_traits<char16_t>>&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE int regex_set_search<const char32_t*, std::allocator<sub_match<const char32_t*>>, char32_t, regex_traits<char32_t>>(
+	const char32_t*, const char32_t*, match_results<const char32_t*>&, const basic_regex_set<char32_t, regex_traits<char32_t>>&, regex_constants::match_flag_type);
+
+// _regex_batch instantiations
+ONIGPP_INSTANTIATE size_type _regex_batch<char, regex_traits<char>>(
+	const std::pair<const char*, size_type>*, size_type, const basic_regex<char, regex_traits<char>>&,
+	regex_constants::match_flag_type, bool, const batch_options&, char*, match_offsets*, match_results<const char*>*,
+	size_type*);
+ONIGPP_INSTANTIATE size_type _regex_batch<wchar_t, regex_traits<wchar_t>>(
+	const std::pair<const wchar_t*, size_type>*, size_type, const basic_regex<wchar_t, regex_traits<wchar_t>>&,
+	regex_constants::match_flag_type, bool, const batch_options&, char*, match_offsets*, match_results<const wchar_t*>*,
+	size_type*);
+ONIGPP_INSTANTIATE size_type _regex_batch<char16_t, regex_traits<char16_t>>(
+	const std::pair<const char16_t*, size_type>*, size_type, const basic_regex<char16_t, regex_traits<char16_t>>&,
+	regex_constants::match_flag_type, bool, const batch_options&, char*, match_offsets*, match_results<const char16_t*>*,
+	size_type*);
+ONIGPP_INSTANTIATE size_type _regex_batch<char32_t, regex_traits<char32_t>>(
+	const std::pair<const char32_t*, size_type>*, size_type, const basic_regex<char32_t, regex_traits<char32_t>>&,
+	regex_constants::match_flag_type, bool, const batch_options&, char*, match_offsets*, match_results<const char32_t*>*,
+	size_type*);
+
+// regex_compile_batch instantiations
+ONIGPP_INSTANTIATE size_type regex_compile_batch<char, regex_traits<char>>(
+	const regex_compile_entry<char>*, size_type, regex_compile_result<char, regex_traits<char>>*, const compile_batch_options&);
+ONIGPP_INSTANTIATE size_type regex_compile_batch<wchar_t, regex_traits<wchar_t>>(
+	const regex_compile_entry<wchar_t>*, size_type, regex_compile_result<wchar_t, regex_traits<wchar_t>>*, const compile_batch_options&);
+ONIGPP_INSTANTIATE size_type regex_compile_batch<char16_t, regex_traits<char16_t>>(
+	const regex_compile_entry<char16_t>*, size_type, regex_compile_result<char16_t, regex_traits<char16_t>>*, const compile_batch_options&);
+ONIGPP_INSTANTIATE size_type regex_compile_batch<char32_t, regex_traits<char32_t>>(
+	const regex_compile_entry<char32_t>*, size_type, regex_compile_result<char32_t, regex_traits<char32_t>>*, const compile_batch_options&);
+
+// basic_regex_stream instantiations
+ONIGPP_INSTANTIATE class basic_regex_stream<char, regex_traits<char>>;
+ONIGPP_INSTANTIATE class basic_regex_stream<wchar_t, regex_traits<wchar_t>>;
+ONIGPP_INSTANTIATE class basic_regex_stream<char16_t, regex_traits<char16_t>>;
+ONIGPP_INSTANTIATE class basic_regex_stream<char32_t, regex_traits<char32_t>>;
+
+// Segmented text instantiations
+ONIGPP_INSTANTIATE class basic_segmented_text<char>;
+ONIGPP_INSTANTIATE class basic_segmented_text<wchar_t>;
+ONIGPP_INSTANTIATE class basic_segmented_text<char16_t>;
+ONIGPP_INSTANTIATE class basic_segmented_text<char32_t>;
+
+ONIGPP_INSTANTIATE class basic_segmented_regex_iterator<char, regex_traits<char>>;
+ONIGPP_INSTANTIATE class basic_segmented_regex_iterator<wchar_t, regex_traits<wchar_t>>;
+ONIGPP_INSTANTIATE class basic_segmented_regex_iterator<char16_t, regex_traits<char16_t>>;
+ONIGPP_INSTANTIATE class basic_segmented_regex_iterator<char32_t, regex_traits<char32_t>>;
+
+ONIGPP_INSTANTIATE bool regex_search<char, regex_traits<char>>(
+	const basic_segmented_text<char>&, basic_segmented_match<char>&,
+	const basic_regex<char, regex_traits<char>>&, regex_constants::match_flag_type, size_type, size_type);
+ONIGPP_INSTANTIATE bool regex_search<wchar_t, regex_traits<wchar_t>>(
+	const basic_segmented_text<wchar_t>&, basic_segmented_match<wchar_t>&,
+	const basic_regex<wchar_t, regex_traits<wchar_t>>&, regex_constants::match_flag_type, size_type, size_type);
+ONIGPP_INSTANTIATE bool regex_search<char16_t, regex_traits<char16_t>>(
+	const basic_segmented_text<char16_t>&, basic_segmented_match<char16_t>&,
+	const basic_regex<char16_t, regex_traits<char16_t>>&, regex_constants::match_flag_type, size_type, size_type);
+ONIGPP_INSTANTIATE bool regex_search<char32_t, regex_traits<char32_t>>(
+	const basic_segmented_text<char32_t>&, basic_segmented_match<char32_t>&,
+	const basic_regex<char32_t, regex_traits<char32_t>>&, regex_constants::match_flag_type, size_type, size_type);
+
+// regex_search_all_parallel instantiations
+ONIGPP_INSTANTIATE std::vector<match_results<const char*>> regex_search_all_parallel<char, regex_traits<char>>(
+	const char*, const char*, const basic_regex<char, regex_traits<char>>&,
+	const parallel_search_options<char>&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE std::vector<match_results<const wchar_t*>> regex_search_all_parallel<wchar_t, regex_traits<wchar_t>>(
+	const wchar_t*, const wchar_t*, const basic_regex<wchar_t, regex_traits<wchar_t>>&,
+	const parallel_search_options<wchar_t>&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE std::vector<match_results<const char16_t*>> regex_search_all_parallel<char16_t, regex_traits<char16_t>>(
+	const char16_t*, const char16_t*, const basic_regex<char16_t, regex_traits<char16_t>>&,
+	const parallel_search_options<char16_t>&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE std::vector<match_results<const char32_t*>> regex_search_all_parallel<char32_t, regex_traits<char32_t>>(
+	const char32_t*, const char32_t*, const basic_regex<char32_t, regex_traits<char32_t>>&,
+	const parallel_search_options<char32_t>&, regex_constants::match_flag_type);
 
 // match_results is a template alias-like type used in function templates;
 // we explicitly instantiate function templates with allocator types used above.
 
 // regex_search instantiations
-template bool regex_search<s_iter, s_sub_alloc, char, regex_traits<char>>(
+ONIGPP_INSTANTIATE bool regex_search<s_iter, s_sub_alloc, char, regex_traits<char>>(
 	s_iter, s_iter, match_results<s_iter, s_sub_alloc>&, const basic_regex<char, regex_traits<char>>&, regex_constants::match_flag_type);
 
-template bool regex_search<ws_iter, ws_sub_alloc, wchar_t, regex_traits<wchar_t>>(
+ONIGPP_INSTANTIATE bool regex_search<ws_iter, ws_sub_alloc, wchar_t, regex_traits<wchar_t>>(
 	ws_iter, ws_iter, match_results<ws_iter, ws_sub_alloc>&, const basic_regex<wchar_t, regex_traits<wchar_t>>&, regex_constants::match_flag_type);
 
-template bool regex_search<u16_iter, u16_sub_alloc, char16_t, regex_traits<char16_t>>(
+ONIGPP_INSTANTIATE bool regex_search<u16_iter, u16_sub_alloc, char16_t, regex_traits<char16_t>>(
 	u16_iter, u16_iter, match_results<u16_iter, u16_sub_alloc>&, const basic_regex<char16_t, regex_traits<char16_t>>&, regex_constants::match_flag_type);
 
-template bool regex_search<u32_iter, u32_sub_alloc, char32_t, regex_traits<char32_t>>(
+ONIGPP_INSTANTIATE bool regex_search<u32_iter, u32_sub_alloc, char32_t, regex_traits<char32_t>>(
 	u32_iter, u32_iter, match_results<u32_iter, u32_sub_alloc>&, const basic_regex<char32_t, regex_traits<char32_t>>&, regex_constants::match_flag_type);
 
 // regex_match instantiations
-template bool regex_match<s_iter, s_sub_alloc, char, regex_traits<char>>(
+ONIGPP_INSTANTIATE bool regex_match<s_iter, s_sub_alloc, char, regex_traits<char>>(
 	s_iter, s_iter, match_results<s_iter, s_sub_alloc>&, const basic_regex<char, regex_traits<char>>&, regex_constants::match_flag_type);
 
-template bool regex_match<ws_iter, ws_sub_alloc, wchar_t, regex_traits<wchar_t>>(
+ONIGPP_INSTANTIATE bool regex_match<ws_iter, ws_sub_alloc, wchar_t, regex_traits<wchar_t>>(
 	ws_iter, ws_iter, match_results<ws_iter, ws_sub_alloc>&, const basic_regex<wchar_t, regex_traits<wchar_t>>&, regex_constants::match_flag_type);
 
-template bool regex_match<u16_iter, u16_sub_alloc, char16_t, regex_traits<char16_t>>(
+ONIGPP_INSTANTIATE bool regex_match<u16_iter, u16_sub_alloc, char16_t, regex_traits<char16_t>>(
 	u16_iter, u16_iter, match_results<u16_iter, u16_sub_alloc>&, const basic_regex<char16_t, regex_traits<char16_t>>&, regex_constants::match_flag_type);
 
-template bool regex_match<u32_iter, u32_sub_alloc, char32_t, regex_traits<char32_t>>(
+ONIGPP_INSTANTIATE bool regex_match<u32_iter, u32_sub_alloc, char32_t, regex_traits<char32_t>>(
 	u32_iter, u32_iter, match_results<u32_iter, u32_sub_alloc>&, const basic_regex<char32_t, regex_traits<char32_t>>&, regex_constants::match_flag_type);
 
+// _regex_search_backward instantiations (string iterators and const CharT*)
+ONIGPP_INSTANTIATE bool _regex_search_backward<s_iter, s_sub_alloc, char, regex_traits<char>>(
+	s_iter, s_iter, s_iter, s_iter, match_results<s_iter, s_sub_alloc>&, const basic_regex<char, regex_traits<char>>&,
+	regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE bool _regex_search_backward<ws_iter, ws_sub_alloc, wchar_t, regex_traits<wchar_t>>(
+	ws_iter, ws_iter, ws_iter, ws_iter, match_results<ws_iter, ws_sub_alloc>&, const basic_regex<wchar_t, regex_traits<wchar_t>>&,
+	regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE bool _regex_search_backward<u16_iter, u16_sub_alloc, char16_t, regex_traits<char16_t>>(
+	u16_iter, u16_iter, u16_iter, u16_iter, match_results<u16_iter, u16_sub_alloc>&, const basic_regex<char16_t, regex_traits<char16_t>>&,
+	regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE bool _regex_search_backward<u32_iter, u32_sub_alloc, char32_t, regex_traits<char32_t>>(
+	u32_iter, u32_iter, u32_iter, u32_iter, match_results<u32_iter, u32_sub_alloc>&, const basic_regex<char32_t, regex_traits<char32_t>>&,
+	regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE bool _regex_search_backward<const char*, std::allocator<sub_match<const char*>>, char, regex_traits<char>>(
+	const char*, const char*, const char*, const char*, match_results<const char*, std::allocator<sub_match<const char*>>>&, const basic_regex<char, regex_traits<char>>&,
+	regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE bool _regex_search_backward<const wchar_t*, std::allocator<sub_match<const wchar_t*>>, wchar_t, regex_traits<wchar_t>>(
+	const wchar_t*, const wchar_t*, const wchar_t*, const wchar_t*, match_results<const wchar_t*, std::allocator<sub_match<const wchar_t*>>>&, const basic_regex<wchar_t, regex_traits<wchar_t>>&,
+	regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE bool _regex_search_backward<const char16_t*, std::allocator<sub_match<const char16_t*>>, char16_t, regex_traits<char16_t>>(
+	const char16_t*, const char16_t*, const char16_t*, const char16_t*, match_results<const char16_t*, std::allocator<sub_match<const char16_t*>>>&, const basic_regex<char16_t, regex_traits<char16_t>>&,
+	regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE bool _regex_search_backward<const char32_t*, std::allocator<sub_match<const char32_t*>>, char32_t, regex_traits<char32_t>>(
+	const char32_t*, const char32_t*, const char32_t*, const char32_t*, match_results<const char32_t*, std::allocator<sub_match<const char32_t*>>>&, const basic_regex<char32_t, regex_traits<char32_t>>&,
+	regex_constants::match_flag_type);
+
+// regex_search_range instantiations (string iterators and const CharT*)
+ONIGPP_INSTANTIATE bool regex_search_range<s_iter, s_sub_alloc, char, regex_traits<char>>(
+	s_iter, s_iter, s_iter, s_iter, match_results<s_iter, s_sub_alloc>&, const basic_regex<char, regex_traits<char>>&,
+	regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE bool regex_search_range<ws_iter, ws_sub_alloc, wchar_t, regex_traits<wchar_t>>(
+	ws_iter, ws_iter, ws_iter, ws_iter, match_results<ws_iter, ws_sub_alloc>&, const basic_regex<wchar_t, regex_traits<wchar_t>>&,
+	regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE bool regex_search_range<u16_iter, u16_sub_alloc, char16_t, regex_traits<char16_t>>(
+	u16_iter, u16_iter, u16_iter, u16_iter, match_results<u16_iter, u16_sub_alloc>&, const basic_regex<char16_t, regex_traits<char16_t>>&,
+	regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE bool regex_search_range<u32_iter, u32_sub_alloc, char32_t, regex_traits<char32_t>>(
+	u32_iter, u32_iter, u32_iter, u32_iter, match_results<u32_iter, u32_sub_alloc>&, const basic_regex<char32_t, regex_traits<char32_t>>&,
+	regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE bool regex_search_range<const char*, std::allocator<sub_match<const char*>>, char, regex_traits<char>>(
+	const char*, const char*, const char*, const char*, match_results<const char*, std::allocator<sub_match<const char*>>>&, const basic_regex<char, regex_traits<char>>&,
+	regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE bool regex_search_range<const wchar_t*, std::allocator<sub_match<const wchar_t*>>, wchar_t, regex_traits<wchar_t>>(
+	const wchar_t*, const wchar_t*, const wchar_t*, const wchar_t*, match_results<const wchar_t*, std::allocator<sub_match<const wchar_t*>>>&, const basic_regex<wchar_t, regex_traits<wchar_t>>&,
+	regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE bool regex_search_range<const char16_t*, std::allocator<sub_match<const char16_t*>>, char16_t, regex_traits<char16_t>>(
+	const char16_t*, const char16_t*, const char16_t*, const char16_t*, match_results<const char16_t*, std::allocator<sub_match<const char16_t*>>>&, const basic_regex<char16_t, regex_traits<char16_t>>&,
+	regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE bool regex_search_range<const char32_t*, std::allocator<sub_match<const char32_t*>>, char32_t, regex_traits<char32_t>>(
+	const char32_t*, const char32_t*, const char32_t*, const char32_t*, match_results<const char32_t*, std::allocator<sub_match<const char32_t*>>>&, const basic_regex<char32_t, regex_traits<char32_t>>&,
+	regex_constants::match_flag_type);
+
+// regex_search and regex_match instantiations for match_results with resource_allocator
+using s_resource_alloc   = resource_allocator< sub_match<s_iter> >;
+using ws_resource_alloc  = resource_allocator< sub_match<ws_iter> >;
+using u16_resource_alloc = resource_allocator< sub_match<u16_iter> >;
+using u32_resource_alloc = resource_allocator< sub_match<u32_iter> >;
+
+ONIGPP_INSTANTIATE bool regex_search<s_iter, s_resource_alloc, char, regex_traits<char>>(
+	s_iter, s_iter, match_results<s_iter, s_resource_alloc>&, const basic_regex<char, regex_traits<char>>&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE bool regex_search<ws_iter, ws_resource_alloc, wchar_t, regex_traits<wchar_t>>(
+	ws_iter, ws_iter, match_results<ws_iter, ws_resource_alloc>&, const basic_regex<wchar_t, regex_traits<wchar_t>>&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE bool regex_search<u16_iter, u16_resource_alloc, char16_t, regex_traits<char16_t>>(
+	u16_iter, u16_iter, match_results<u16_iter, u16_resource_alloc>&, const basic_regex<char16_t, regex_traits<char16_t>>&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE bool regex_search<u32_iter, u32_resource_alloc, char32_t, regex_traits<char32_t>>(
+	u32_iter, u32_iter, match_results<u32_iter, u32_resource_alloc>&, const basic_regex<char32_t, regex_traits<char32_t>>&, regex_constants::match_flag_type);
+
+ONIGPP_INSTANTIATE bool regex_match<s_iter, s_resource_alloc, char, regex_traits<char>>(
+	s_iter, s_iter, match_results<s_iter, s_resource_alloc>&, const basic_regex<char, regex_traits<char>>&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE bool regex_match<ws_iter, ws_resource_alloc, wchar_t, regex_traits<wchar_t>>(
+	ws_iter, ws_iter, match_results<ws_iter, ws_resource_alloc>&, const basic_regex<wchar_t, regex_traits<wchar_t>>&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE bool regex_match<u16_iter, u16_resource_alloc, char16_t, regex_traits<char16_t>>(
+	u16_iter, u16_iter, match_results<u16_iter, u16_resource_alloc>&, const basic_regex<char16_t, regex_traits<char16_t>>&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE bool regex_match<u32_iter, u32_resource_alloc, char32_t, regex_traits<char32_t>>(
+	u32_iter, u32_iter, match_results<u32_iter, u32_resource_alloc>&, const basic_regex<char32_t, regex_traits<char32_t>>&, regex_constants::match_flag_type);
+
 // regex_replace instantiations (OutputIt = back_insert_iterator<std::basic_string<CharT>>)
-template std::back_insert_iterator<std::basic_string<char>> regex_replace<
+ONIGPP_INSTANTIATE std::back_insert_iterator<std::basic_string<char>> regex_replace<
 	std::back_insert_iterator<std::basic_string<char>>, s_iter, char, regex_traits<char>>(
 	std::back_insert_iterator<std::basic_string<char>>, s_iter, s_iter,
 	const basic_regex<char, regex_traits<char>>&,
 	const basic_string<char>&, regex_constants::match_flag_type);
 
-template std::back_insert_iterator<std::basic_string<wchar_t>> regex_replace<
+ONIGPP_INSTANTIATE std::back_insert_iterator<std::basic_string<wchar_t>> regex_replace<
 	std::back_insert_iterator<std::basic_string<wchar_t>>, ws_iter, wchar_t, regex_traits<wchar_t>>(
 	std::back_insert_iterator<std::basic_string<wchar_t>>, ws_iter, ws_iter,
 	const basic_regex<wchar_t, regex_traits<wchar_t>>&,
 	const basic_string<wchar_t>&, regex_constants::match_flag_type);
 
-template std::back_insert_iterator<std::basic_string<char16_t>> regex_replace<
+ONIGPP_INSTANTIATE std::back_insert_iterator<std::basic_string<char16_t>> regex_replace<
 	std::back_insert_iterator<std::basic_string<char16_t>>, u16_iter, char16_t, regex_traits<char16_t>>(
 	std::back_insert_iterator<std::basic_string<char16_t>>, u16_iter, u16_iter,
 	const basic_regex<char16_t, regex_traits<char16_t>>&,
 	const basic_string<char16_t>&, regex_constants::match_flag_type);
 
-template std::back_insert_iterator<std::basic_string<char32_t>> regex_replace<
+ONIGPP_INSTANTIATE std::back_insert_iterator<std::basic_string<char32_t>> regex_replace<
 	std::back_insert_iterator<std::basic_string<char32_t>>, u32_iter, char32_t, regex_traits<char32_t>>(
 	std::back_insert_iterator<std::basic_string<char32_t>>, u32_iter, u32_iter,
 	const basic_regex<char32_t, regex_traits<char32_t>>&,
 	const basic_string<char32_t>&, regex_constants::match_flag_type);
 
 // regex_replace instantiations with const CharT* format parameter
-template std::back_insert_iterator<std::basic_string<char>> regex_replace<
+ONIGPP_INSTANTIATE std::back_insert_iterator<std::basic_string<char>> regex_replace<
 	std::back_insert_iterator<std::basic_string<char>>, s_iter, char, regex_traits<char>>(
 	std::back_insert_iterator<std::basic_string<char>>, s_iter, s_iter,
 	const basic_regex<char, regex_traits<char>>&,
 	const char*, regex_constants::match_flag_type);
 
-template std::back_insert_iterator<std::basic_string<wchar_t>> regex_replace<
+ONIGPP_INSTANTIATE std::back_insert_iterator<std::basic_string<wchar_t>> regex_replace<
 	std::back_insert_iterator<std::basic_string<wchar_t>>, ws_iter, wchar_t, regex_traits<wchar_t>>(
 	std::back_insert_iterator<std::basic_string<wchar_t>>, ws_iter, ws_iter,
 	const basic_regex<wchar_t, regex_traits<wchar_t>>&,
 	const wchar_t*, regex_constants::match_flag_type);
 
-template std::back_insert_iterator<std::basic_string<char16_t>> regex_replace<
+ONIGPP_INSTANTIATE std::back_insert_iterator<std::basic_string<char16_t>> regex_replace<
 	std::back_insert_iterator<std::basic_string<char16_t>>, u16_iter, char16_t, regex_traits<char16_t>>(
 	std::back_insert_iterator<std::basic_string<char16_t>>, u16_iter, u16_iter,
 	const basic_regex<char16_t, regex_traits<char16_t>>&,
 	const char16_t*, regex_constants::match_flag_type);
 
-template std::back_insert_iterator<std::basic_string<char32_t>> regex_replace<
+ONIGPP_INSTANTIATE std::back_insert_iterator<std::basic_string<char32_t>> regex_replace<
 	std::back_insert_iterator<std::basic_string<char32_t>>, u32_iter, char32_t, regex_traits<char32_t>>(
 	std::back_insert_iterator<std::basic_string<char32_t>>, u32_iter, u32_iter,
 	const basic_regex<char32_t, regex_traits<char32_t>>&,
 	const char32_t*, regex_constants::match_flag_type);
 
+// basic_regex_format instantiations
+ONIGPP_INSTANTIATE class basic_regex_format<char, regex_traits<char>>;
+ONIGPP_INSTANTIATE class basic_regex_format<wchar_t, regex_traits<wchar_t>>;
+ONIGPP_INSTANTIATE class basic_regex_format<char16_t, regex_traits<char16_t>>;
+ONIGPP_INSTANTIATE class basic_regex_format<char32_t, regex_traits<char32_t>>;
+
+// regex_search (match_offsets) and regex_offset_iterator instantiations
+ONIGPP_INSTANTIATE bool regex_search<s_iter, char, regex_traits<char>>(
+	s_iter, s_iter, match_offsets&, const basic_regex<char, regex_traits<char>>&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE bool regex_search<ws_iter, wchar_t, regex_traits<wchar_t>>(
+	ws_iter, ws_iter, match_offsets&, const basic_regex<wchar_t, regex_traits<wchar_t>>&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE bool regex_search<u16_iter, char16_t, regex_traits<char16_t>>(
+	u16_iter, u16_iter, match_offsets&, const basic_regex<char16_t, regex_traits<char16_t>>&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE bool regex_search<u32_iter, char32_t, regex_traits<char32_t>>(
+	u32_iter, u32_iter, match_offsets&, const basic_regex<char32_t, regex_traits<char32_t>>&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE bool regex_search<const char*, char, regex_traits<char>>(
+	const char*, const char*, match_offsets&, const basic_regex<char, regex_traits<char>>&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE bool regex_search<const wchar_t*, wchar_t, regex_traits<wchar_t>>(
+	const wchar_t*, const wchar_t*, match_offsets&, const basic_regex<wchar_t, regex_traits<wchar_t>>&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE bool regex_search<const char16_t*, char16_t, regex_traits<char16_t>>(
+	const char16_t*, const char16_t*, match_offsets&, const basic_regex<char16_t, regex_traits<char16_t>>&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE bool regex_search<const char32_t*, char32_t, regex_traits<char32_t>>(
+	const char32_t*, const char32_t*, match_offsets&, const basic_regex<char32_t, regex_traits<char32_t>>&, regex_constants::match_flag_type);
+
+ONIGPP_INSTANTIATE class regex_offset_iterator<s_iter, char, regex_traits<char>>;
+ONIGPP_INSTANTIATE class regex_offset_iterator<ws_iter, wchar_t, regex_traits<wchar_t>>;
+ONIGPP_INSTANTIATE class regex_offset_iterator<u16_iter, char16_t, regex_traits<char16_t>>;
+ONIGPP_INSTANTIATE class regex_offset_iterator<u32_iter, char32_t, regex_traits<char32_t>>;
+ONIGPP_INSTANTIATE class regex_offset_iterator<const char*, char, regex_traits<char>>;
+ONIGPP_INSTANTIATE class regex_offset_iterator<const wchar_t*, wchar_t, regex_traits<wchar_t>>;
+ONIGPP_INSTANTIATE class regex_offset_iterator<const char16_t*, char16_t, regex_traits<char16_t>>;
+ONIGPP_INSTANTIATE class regex_offset_iterator<const char32_t*, char32_t, regex_traits<char32_t>>;
+
+// regex_replace_append instantiations
+ONIGPP_INSTANTIATE size_type regex_replace_append<char, regex_traits<char>>(
+	basic_string<char>&, const char*, const char*, const basic_regex<char, regex_traits<char>>&,
+	const basic_regex_format<char, regex_traits<char>>&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE size_type regex_replace_append<wchar_t, regex_traits<wchar_t>>(
+	basic_string<wchar_t>&, const wchar_t*, const wchar_t*, const basic_regex<wchar_t, regex_traits<wchar_t>>&,
+	const basic_regex_format<wchar_t, regex_traits<wchar_t>>&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE size_type regex_replace_append<char16_t, regex_traits<char16_t>>(
+	basic_string<char16_t>&, const char16_t*, const char16_t*, const basic_regex<char16_t, regex_traits<char16_t>>&,
+	const basic_regex_format<char16_t, regex_traits<char16_t>>&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE size_type regex_replace_append<char32_t, regex_traits<char32_t>>(
+	basic_string<char32_t>&, const char32_t*, const char32_t*, const basic_regex<char32_t, regex_traits<char32_t>>&,
+	const basic_regex_format<char32_t, regex_traits<char32_t>>&, regex_constants::match_flag_type);
+
+// regex_test, regex_count instantiations
+ONIGPP_INSTANTIATE bool regex_test<char, regex_traits<char>>(
+	const char*, const char*, const basic_regex<char, regex_traits<char>>&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE size_type regex_count<char, regex_traits<char>>(
+	const char*, const char*, const basic_regex<char, regex_traits<char>>&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE bool regex_test<wchar_t, regex_traits<wchar_t>>(
+	const wchar_t*, const wchar_t*, const basic_regex<wchar_t, regex_traits<wchar_t>>&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE size_type regex_count<wchar_t, regex_traits<wchar_t>>(
+	const wchar_t*, const wchar_t*, const basic_regex<wchar_t, regex_traits<wchar_t>>&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE bool regex_test<char16_t, regex_traits<char16_t>>(
+	const char16_t*, const char16_t*, const basic_regex<char16_t, regex_traits<char16_t>>&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE size_type regex_count<char16_t, regex_traits<char16_t>>(
+	const char16_t*, const char16_t*, const basic_regex<char16_t, regex_traits<char16_t>>&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE bool regex_test<char32_t, regex_traits<char32_t>>(
+	const char32_t*, const char32_t*, const basic_regex<char32_t, regex_traits<char32_t>>&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE size_type regex_count<char32_t, regex_traits<char32_t>>(
+	const char32_t*, const char32_t*, const basic_regex<char32_t, regex_traits<char32_t>>&, regex_constants::match_flag_type);
+
+// regex_for_each instantiations
+ONIGPP_INSTANTIATE size_type _regex_for_each<char, regex_traits<char>>(
+	const char*, const char*, const basic_regex<char, regex_traits<char>>&,
+	bool (*)(void*, const basic_match_view<char>&), void*, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE size_type _regex_for_each<wchar_t, regex_traits<wchar_t>>(
+	const wchar_t*, const wchar_t*, const basic_regex<wchar_t, regex_traits<wchar_t>>&,
+	bool (*)(void*, const basic_match_view<wchar_t>&), void*, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE size_type _regex_for_each<char16_t, regex_traits<char16_t>>(
+	const char16_t*, const char16_t*, const basic_regex<char16_t, regex_traits<char16_t>>&,
+	bool (*)(void*, const basic_match_view<char16_t>&), void*, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE size_type _regex_for_each<char32_t, regex_traits<char32_t>>(
+	const char32_t*, const char32_t*, const basic_regex<char32_t, regex_traits<char32_t>>&,
+	bool (*)(void*, const basic_match_view<char32_t>&), void*, regex_constants::match_flag_type);
+
+// regex_split instantiations
+ONIGPP_INSTANTIATE size_type regex_split<char, regex_traits<char>>(
+	std::vector<std::pair<size_type, size_type>>&, const char*, const char*, const basic_regex<char, regex_traits<char>>&,
+	const int*, size_type, const split_options&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE size_type regex_split<char, regex_traits<char>>(
+	std::vector<std::pair<const char*, const char*>>&, const char*, const char*, const basic_regex<char, regex_traits<char>>&,
+	const int*, size_type, const split_options&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE size_type regex_split<wchar_t, regex_traits<wchar_t>>(
+	std::vector<std::pair<size_type, size_type>>&, const wchar_t*, const wchar_t*, const basic_regex<wchar_t, regex_traits<wchar_t>>&,
+	const int*, size_type, const split_options&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE size_type regex_split<wchar_t, regex_traits<wchar_t>>(
+	std::vector<std::pair<const wchar_t*, const wchar_t*>>&, const wchar_t*, const wchar_t*, const basic_regex<wchar_t, regex_traits<wchar_t>>&,
+	const int*, size_type, const split_options&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE size_type regex_split<char16_t, regex_traits<char16_t>>(
+	std::vector<std::pair<size_type, size_type>>&, const char16_t*, const char16_t*, const basic_regex<char16_t, regex_traits<char16_t>>&,
+	const int*, size_type, const split_options&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE size_type regex_split<char16_t, regex_traits<char16_t>>(
+	std::vector<std::pair<const char16_t*, const char16_t*>>&, const char16_t*, const char16_t*, const basic_regex<char16_t, regex_traits<char16_t>>&,
+	const int*, size_type, const split_options&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE size_type regex_split<char32_t, regex_traits<char32_t>>(
+	std::vector<std::pair<size_type, size_type>>&, const char32_t*, const char32_t*, const basic_regex<char32_t, regex_traits<char32_t>>&,
+	const int*, size_type, const split_options&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE size_type regex_split<char32_t, regex_traits<char32_t>>(
+	std::vector<std::pair<const char32_t*, const char32_t*>>&, const char32_t*, const char32_t*, const basic_regex<char32_t, regex_traits<char32_t>>&,
+	const int*, size_type, const split_options&, regex_constants::match_flag_type);
+
+// regex_grep instantiations
+ONIGPP_INSTANTIATE size_type regex_grep<char, regex_traits<char>>(
+	std::vector<grep_line>&, const char*, const char*, const basic_regex<char, regex_traits<char>>&,
+	const grep_options&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE size_type regex_grep_count<char, regex_traits<char>>(
+	const char*, const char*, const basic_regex<char, regex_traits<char>>&, const grep_options&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE size_type regex_grep<wchar_t, regex_traits<wchar_t>>(
+	std::vector<grep_line>&, const wchar_t*, const wchar_t*, const basic_regex<wchar_t, regex_traits<wchar_t>>&,
+	const grep_options&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE size_type regex_grep_count<wchar_t, regex_traits<wchar_t>>(
+	const wchar_t*, const wchar_t*, const basic_regex<wchar_t, regex_traits<wchar_t>>&, const grep_options&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE size_type regex_grep<char16_t, regex_traits<char16_t>>(
+	std::vector<grep_line>&, const char16_t*, const char16_t*, const basic_regex<char16_t, regex_traits<char16_t>>&,
+	const grep_options&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE size_type regex_grep_count<char16_t, regex_traits<char16_t>>(
+	const char16_t*, const char16_t*, const basic_regex<char16_t, regex_traits<char16_t>>&, const grep_options&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE size_type regex_grep<char32_t, regex_traits<char32_t>>(
+	std::vector<grep_line>&, const char32_t*, const char32_t*, const basic_regex<char32_t, regex_traits<char32_t>>&,
+	const grep_options&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE size_type regex_grep_count<char32_t, regex_traits<char32_t>>(
+	const char32_t*, const char32_t*, const basic_regex<char32_t, regex_traits<char32_t>>&, const grep_options&, regex_constants::match_flag_type);
+
+// regex_replace instantiations with precompiled basic_regex_format
+ONIGPP_INSTANTIATE std::back_insert_iterator<std::basic_string<char>> regex_replace<
+	std::back_insert_iterator<std::basic_string<char>>, s_iter, char, regex_traits<char>>(
+	std::back_insert_iterator<std::basic_string<char>>, s_iter, s_iter,
+	const basic_regex<char, regex_traits<char>>&,
+	const basic_regex_format<char, regex_traits<char>>&, regex_constants::match_flag_type);
+
+ONIGPP_INSTANTIATE std::back_insert_iterator<std::basic_string<wchar_t>> regex_replace<
+	std::back_insert_iterator<std::basic_string<wchar_t>>, ws_iter, wchar_t, regex_traits<wchar_t>>(
+	std::back_insert_iterator<std::basic_string<wchar_t>>, ws_iter, ws_iter,
+	const basic_regex<wchar_t, regex_traits<wchar_t>>&,
+	const basic_regex_format<wchar_t, regex_traits<wchar_t>>&, regex_constants::match_flag_type);
+
+ONIGPP_INSTANTIATE std::back_insert_iterator<std::basic_string<char16_t>> regex_replace<
+	std::back_insert_iterator<std::basic_string<char16_t>>, u16_iter, char16_t, regex_traits<char16_t>>(
+	std::back_insert_iterator<std::basic_string<char16_t>>, u16_iter, u16_iter,
+	const basic_regex<char16_t, regex_traits<char16_t>>&,
+	const basic_regex_format<char16_t, regex_traits<char16_t>>&, regex_constants::match_flag_type);
+
+ONIGPP_INSTANTIATE std::back_insert_iterator<std::basic_string<char32_t>> regex_replace<
+	std::back_insert_iterator<std::basic_string<char32_t>>, u32_iter, char32_t, regex_traits<char32_t>>(
+	std::back_insert_iterator<std::basic_string<char32_t>>, u32_iter, u32_iter,
+	const basic_regex<char32_t, regex_traits<char32_t>>&,
+	const basic_regex_format<char32_t, regex_traits<char32_t>>&, regex_constants::match_flag_type);
+
 } // namespace onigpp
 
 // -------------------- Explicit instantiations for non-contiguous iterators --------------------
@@ -2012,7 +5935,6 @@ template std::back_insert_iterator<std::basic_string<char32_t>> regex_replace<
 
 #include <list>
 #include <deque>
-#include <vector>
 
 namespace onigpp {
 
@@ -2035,54 +5957,140 @@ using deque_char_sub_alloc = ::std::allocator<sub_match<deque_char_iter>>;
 using vector_char_iter = ::std::vector<char>::iterator;
 using vector_char_sub_alloc = ::std::allocator<sub_match<vector_char_iter>>;
 
+// Aliases for std::vector iterators (const)
+using vector_char_const_iter = ::std::vector<char>::const_iterator;
+using vector_char_const_sub_alloc = ::std::allocator<sub_match<vector_char_const_iter>>;
+
 // regex_search instantiations for const char* (pointer type - optimized)
-template bool regex_search<cchar_ptr, cchar_ptr_sub_alloc, char, regex_traits<char>>(
+ONIGPP_INSTANTIATE bool regex_search<cchar_ptr, cchar_ptr_sub_alloc, char, regex_traits<char>>(
 	cchar_ptr, cchar_ptr, match_results<cchar_ptr, cchar_ptr_sub_alloc>&,
 	const basic_regex<char, regex_traits<char>>&, regex_constants::match_flag_type);
 
 // regex_match instantiations for const char* (pointer type - optimized)
-template bool regex_match<cchar_ptr, cchar_ptr_sub_alloc, char, regex_traits<char>>(
+ONIGPP_INSTANTIATE bool regex_match<cchar_ptr, cchar_ptr_sub_alloc, char, regex_traits<char>>(
 	cchar_ptr, cchar_ptr, match_results<cchar_ptr, cchar_ptr_sub_alloc>&,
 	const basic_regex<char, regex_traits<char>>&, regex_constants::match_flag_type);
 
+// regex_search and regex_match instantiations for const char* with resource_allocator
+using cchar_ptr_resource_alloc = resource_allocator<sub_match<cchar_ptr>>;
+ONIGPP_INSTANTIATE bool regex_search<cchar_ptr, cchar_ptr_resource_alloc, char, regex_traits<char>>(
+	cchar_ptr, cchar_ptr, match_results<cchar_ptr, cchar_ptr_resource_alloc>&,
+	const basic_regex<char, regex_traits<char>>&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE bool regex_match<cchar_ptr, cchar_ptr_resource_alloc, char, regex_traits<char>>(
+	cchar_ptr, cchar_ptr, match_results<cchar_ptr, cchar_ptr_resource_alloc>&,
+	const basic_regex<char, regex_traits<char>>&, regex_constants::match_flag_type);
+
+// Same for the other character types (small_wcmatch, small_u16cmatch, small_u32cmatch)
+using cwchar_ptr_resource_alloc = resource_allocator<sub_match<const wchar_t*>>;
+using cchar16_ptr_resource_alloc = resource_allocator<sub_match<const char16_t*>>;
+using cchar32_ptr_resource_alloc = resource_allocator<sub_match<const char32_t*>>;
+ONIGPP_INSTANTIATE bool regex_search<const wchar_t*, cwchar_ptr_resource_alloc, wchar_t, regex_traits<wchar_t>>(
+	const wchar_t*, const wchar_t*, match_results<const wchar_t*, cwchar_ptr_resource_alloc>&,
+	const basic_regex<wchar_t, regex_traits<wchar_t>>&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE bool regex_match<const wchar_t*, cwchar_ptr_resource_alloc, wchar_t, regex_traits<wchar_t>>(
+	const wchar_t*, const wchar_t*, match_results<const wchar_t*, cwchar_ptr_resource_alloc>&,
+	const basic_regex<wchar_t, regex_traits<wchar_t>>&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE bool regex_search<const char16_t*, cchar16_ptr_resource_alloc, char16_t, regex_traits<char16_t>>(
+	const char16_t*, const char16_t*, match_results<const char16_t*, cchar16_ptr_resource_alloc>&,
+	const basic_regex<char16_t, regex_traits<char16_t>>&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE bool regex_match<const char16_t*, cchar16_ptr_resource_alloc, char16_t, regex_traits<char16_t>>(
+	const char16_t*, const char16_t*, match_results<const char16_t*, cchar16_ptr_resource_alloc>&,
+	const basic_regex<char16_t, regex_traits<char16_t>>&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE bool regex_search<const char32_t*, cchar32_ptr_resource_alloc, char32_t, regex_traits<char32_t>>(
+	const char32_t*, const char32_t*, match_results<const char32_t*, cchar32_ptr_resource_alloc>&,
+	const basic_regex<char32_t, regex_traits<char32_t>>&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE bool regex_match<const char32_t*, cchar32_ptr_resource_alloc, char32_t, regex_traits<char32_t>>(
+	const char32_t*, const char32_t*, match_results<const char32_t*, cchar32_ptr_resource_alloc>&,
+	const basic_regex<char32_t, regex_traits<char32_t>>&, regex_constants::match_flag_type);
+
 // regex_search instantiations for std::list<char>::iterator
-template bool regex_search<list_char_iter, list_char_sub_alloc, char, regex_traits<char>>(
+ONIGPP_INSTANTIATE bool regex_search<list_char_iter, list_char_sub_alloc, char, regex_traits<char>>(
+	list_char_iter, list_char_iter, match_results<list_char_iter, list_char_sub_alloc>&,
+	const basic_regex<char, regex_traits<char>>&, regex_constants::match_flag_type);
+
+// regex_match instantiations for std::list<char>::iterator
+ONIGPP_INSTANTIATE bool regex_match<list_char_iter, list_char_sub_alloc, char, regex_traits<char>>(
 	list_char_iter, list_char_iter, match_results<list_char_iter, list_char_sub_alloc>&,
 	const basic_regex<char, regex_traits<char>>&, regex_constants::match_flag_type);
 
 // regex_search instantiations for std::list<char>::const_iterator
-template bool regex_search<list_char_const_iter, list_char_const_sub_alloc, char, regex_traits<char>>(
+ONIGPP_INSTANTIATE bool regex_search<list_char_const_iter, list_char_const_sub_alloc, char, regex_traits<char>>(
 	list_char_const_iter, list_char_const_iter, match_results<list_char_const_iter, list_char_const_sub_alloc>&,
 	const basic_regex<char, regex_traits<char>>&, regex_constants::match_flag_type);
 
 // regex_match instantiations for std::deque<char>::iterator
-template bool regex_match<deque_char_iter, deque_char_sub_alloc, char, regex_traits<char>>(
+ONIGPP_INSTANTIATE bool regex_match<deque_char_iter, deque_char_sub_alloc, char, regex_traits<char>>(
 	deque_char_iter, deque_char_iter, match_results<deque_char_iter, deque_char_sub_alloc>&,
 	const basic_regex<char, regex_traits<char>>&, regex_constants::match_flag_type);
 
 // regex_search instantiations for std::deque<char>::iterator
-template bool regex_search<deque_char_iter, deque_char_sub_alloc, char, regex_traits<char>>(
+ONIGPP_INSTANTIATE bool regex_search<deque_char_iter, deque_char_sub_alloc, char, regex_traits<char>>(
 	deque_char_iter, deque_char_iter, match_results<deque_char_iter, deque_char_sub_alloc>&,
 	const basic_regex<char, regex_traits<char>>&, regex_constants::match_flag_type);
 
 // regex_search instantiations for std::vector<char>::iterator (non-const)
-template bool regex_search<vector_char_iter, vector_char_sub_alloc, char, regex_traits<char>>(
+ONIGPP_INSTANTIATE bool regex_search<vector_char_iter, vector_char_sub_alloc, char, regex_traits<char>>(
 	vector_char_iter, vector_char_iter, match_results<vector_char_iter, vector_char_sub_alloc>&,
 	const basic_regex<char, regex_traits<char>>&, regex_constants::match_flag_type);
 
+// regex_search instantiations for std::vector<char>::const_iterator
+ONIGPP_INSTANTIATE bool regex_search<vector_char_const_iter, vector_char_const_sub_alloc, char, regex_traits<char>>(
+	vector_char_const_iter, vector_char_const_iter, match_results<vector_char_const_iter, vector_char_const_sub_alloc>&,
+	const basic_regex<char, regex_traits<char>>&, regex_constants::match_flag_type);
+
+// regex_match instantiations for std::vector<char>::const_iterator
+ONIGPP_INSTANTIATE bool regex_match<vector_char_const_iter, vector_char_const_sub_alloc, char, regex_traits<char>>(
+	vector_char_const_iter, vector_char_const_iter, match_results<vector_char_const_iter, vector_char_const_sub_alloc>&,
+	const basic_regex<char, regex_traits<char>>&, regex_constants::match_flag_type);
+
 // regex_iterator instantiations for std::list<char>::iterator
-template class regex_iterator<list_char_iter, char, regex_traits<char>>;
+ONIGPP_INSTANTIATE class regex_iterator<list_char_iter, char, regex_traits<char>>;
+ONIGPP_INSTANTIATE class regex_token_iterator<list_char_iter, char, regex_traits<char>>;
+
+// regex_iterator instantiations for std::deque<char>::iterator
+ONIGPP_INSTANTIATE class regex_iterator<deque_char_iter, char, regex_traits<char>>;
+ONIGPP_INSTANTIATE class regex_token_iterator<deque_char_iter, char, regex_traits<char>>;
+
+// regex_replace instantiations for std::list<char>::iterator and std::deque<char>::iterator
+ONIGPP_INSTANTIATE std::back_insert_iterator<std::basic_string<char>> regex_replace<
+	std::back_insert_iterator<std::basic_string<char>>, list_char_iter, char, regex_traits<char>>(
+	std::back_insert_iterator<std::basic_string<char>>, list_char_iter, list_char_iter,
+	const basic_regex<char, regex_traits<char>>&,
+	const basic_string<char>&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE std::back_insert_iterator<std::basic_string<char>> regex_replace<
+	std::back_insert_iterator<std::basic_string<char>>, deque_char_iter, char, regex_traits<char>>(
+	std::back_insert_iterator<std::basic_string<char>>, deque_char_iter, deque_char_iter,
+	const basic_regex<char, regex_traits<char>>&,
+	const basic_string<char>&, regex_constants::match_flag_type);
+
+// match_offsets instantiations for the non-contiguous containers
+ONIGPP_INSTANTIATE bool regex_search<list_char_iter, char, regex_traits<char>>(
+	list_char_iter, list_char_iter, match_offsets&, const basic_regex<char, regex_traits<char>>&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE bool regex_search<list_char_const_iter, char, regex_traits<char>>(
+	list_char_const_iter, list_char_const_iter, match_offsets&, const basic_regex<char, regex_traits<char>>&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE bool regex_search<deque_char_iter, char, regex_traits<char>>(
+	deque_char_iter, deque_char_iter, match_offsets&, const basic_regex<char, regex_traits<char>>&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE bool regex_search<vector_char_iter, char, regex_traits<char>>(
+	vector_char_iter, vector_char_iter, match_offsets&, const basic_regex<char, regex_traits<char>>&, regex_constants::match_flag_type);
+ONIGPP_INSTANTIATE bool regex_search<vector_char_const_iter, char, regex_traits<char>>(
+	vector_char_const_iter, vector_char_const_iter, match_offsets&, const basic_regex<char, regex_traits<char>>&, regex_constants::match_flag_type);
+
+ONIGPP_INSTANTIATE class regex_offset_iterator<list_char_iter, char, regex_traits<char>>;
+ONIGPP_INSTANTIATE class regex_offset_iterator<list_char_const_iter, char, regex_traits<char>>;
+ONIGPP_INSTANTIATE class regex_offset_iterator<deque_char_iter, char, regex_traits<char>>;
 
 // _regex_search_with_context instantiation for std::list (needed by regex_iterator)
-template bool _regex_search_with_context<list_char_iter, list_char_sub_alloc, char, regex_traits<char>>(
+ONIGPP_INSTANTIATE bool _regex_search_with_context<list_char_iter, list_char_sub_alloc, char, regex_traits<char>>(
 	list_char_iter, list_char_iter, list_char_iter,
 	match_results<list_char_iter, list_char_sub_alloc>&,
-	const basic_regex<char, regex_traits<char>>&, regex_constants::match_flag_type);
+	const basic_regex<char, regex_traits<char>>&, regex_constants::match_flag_type, OnigOptionType);
 
 // _regex_search_with_context instantiation for const char* (optimized path)
-template bool _regex_search_with_context<cchar_ptr, cchar_ptr_sub_alloc, char, regex_traits<char>>(
+ONIGPP_INSTANTIATE bool _regex_search_with_context<cchar_ptr, cchar_ptr_sub_alloc, char, regex_traits<char>>(
 	cchar_ptr, cchar_ptr, cchar_ptr,
 	match_results<cchar_ptr, cchar_ptr_sub_alloc>&,
-	const basic_regex<char, regex_traits<char>>&, regex_constants::match_flag_type);
+	const basic_regex<char, regex_traits<char>>&, regex_constants::match_flag_type, OnigOptionType);
 
 } // namespace onigpp
+
+#endif // ONIGPP_CPP_
@@ -0,0 +1,32 @@
+// allocation_counter.cpp --- Replaces operator new and operator delete to count allocations
+// Author: katahiromz
+// License: BSD-2-Clause
+
+#include "allocation_counter.h"
+#include <cstdlib>
+#include <new>
+
+std::size_t g_allocations = 0;
+
+static void* counted_malloc(std::size_t size) noexcept {
+	++g_allocations;
+	return std::malloc(size ? size : 1);
+}
+
+void* operator new(std::size_t size) {
+	if (void* p = counted_malloc(size)) return p;
+	throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) {
+	if (void* p = counted_malloc(size)) return p;
+	throw std::bad_alloc();
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return counted_malloc(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return counted_malloc(size); }
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
@@ -0,0 +1,13 @@
+// allocation_counter.h --- Counts the allocations made through operator new
+// Author: katahiromz
+// License: BSD-2-Clause
+
+#pragma once
+
+#include <cstddef>
+
+// Incremented by every form of operator new, which allocation_counter.cpp
+// replaces. Link that file into the tests that include this header; being
+// a separate translation unit, the replaced operators are never inlined
+// into the code that allocates.
+extern std::size_t g_allocations;
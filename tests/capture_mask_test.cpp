@@ -0,0 +1,184 @@
+// capture_mask_test.cpp --- Tests for onigpp::capture_mask
+// Author: katahiromz
+// License: BSD-2-Clause
+
+#include "../onigpp.h"
+#include <iostream>
+#include <cassert>
+#include <iterator>
+#include <list>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Helper macro for test assertions
+#define TEST_ASSERT(cond) do { \
+	if (!(cond)) { \
+		std::cerr << "FAIL: " << #cond << " at line " << __LINE__ << std::endl; \
+		return 1; \
+	} \
+} while(0)
+
+namespace rex = onigpp;
+
+int main() {
+	rex::auto_init init;
+
+	std::cout << "Testing onigpp::capture_mask..." << std::endl;
+
+	const std::string s = "2024-06-15 12:34";
+	rex::regex re(std::string("(\\d+)-(\\d+)-(\\d+) (\\d+):(\\d+)"));
+
+	// Test 1: The mask itself
+	{
+		rex::capture_mask all;
+		TEST_ASSERT(all.is_all() && all.contains(0) && all.contains(5) && all.contains(63));
+		rex::capture_mask some{ 2, 4 };
+		TEST_ASSERT(!some.is_all() && some.contains(0) && some.contains(2) && some.contains(4));
+		TEST_ASSERT(!some.contains(1) && !some.contains(3) && !some.contains(63));
+		TEST_ASSERT(some.contains(64) && some.contains(1000));
+		rex::capture_mask none = rex::capture_mask::none();
+		TEST_ASSERT(none.contains(0) && !none.contains(1));
+		TEST_ASSERT(none.add(3).contains(3));
+
+		// A braced list does not convert to a mask implicitly
+		static_assert(!std::is_convertible<std::initializer_list<int>, rex::capture_mask>::value,
+		              "the group list constructor is explicit");
+		std::cout << "  Test 1 passed: the mask" << std::endl;
+	}
+
+	// Test 2: Per-call masks
+	{
+		rex::smatch m;
+		TEST_ASSERT(rex::regex_search(s, m, re, rex::capture_mask{ 1, 4 }));
+		TEST_ASSERT(m.size() == 6 && m.str() == s);
+		TEST_ASSERT(m[1].matched && m[1].str() == "2024" && m[4].matched && m[4].str() == "12");
+		TEST_ASSERT(!m[2].matched && !m[3].matched && !m[5].matched && m[2].str().empty());
+		TEST_ASSERT(m[3].first == s.end() && m.prefix().str().empty());
+
+		TEST_ASSERT(rex::regex_match(s, m, re, rex::capture_mask::none()));
+		TEST_ASSERT(m.size() == 6 && m[0].matched && !m[1].matched && !m[5].matched);
+		TEST_ASSERT(!rex::regex_match(std::string("x"), m, re, rex::capture_mask{ 1 }));
+
+		// The regex itself is unchanged
+		TEST_ASSERT(re.captures().is_all());
+		TEST_ASSERT(rex::regex_search(s, m, re) && m[2].str() == "06");
+
+		// Other iterator types
+		std::list<char> chars(s.begin(), s.end());
+		rex::match_results<std::list<char>::iterator> lm;
+		TEST_ASSERT(rex::regex_search(chars.begin(), chars.end(), lm, re, rex::capture_mask{ 5 }));
+		TEST_ASSERT(lm[5].str() == "34" && !lm[1].matched);
+		std::cout << "  Test 2 passed: per-call masks" << std::endl;
+	}
+
+	// Test 3: Per-regex masks
+	{
+		rex::regex masked(re);
+		masked.set_captures(rex::capture_mask{ 3 });
+		TEST_ASSERT(!masked.captures().is_all() && masked.captures().contains(3));
+
+		std::vector<std::string> days;
+		const std::string two = s + ", 1999-12-31 23:59";
+		for (rex::sregex_iterator it(two.begin(), two.end(), masked), end; it != end; ++it) {
+			TEST_ASSERT(!(*it)[1].matched);
+			days.push_back((*it)[3].str());
+		}
+		TEST_ASSERT(days == (std::vector<std::string>{ "15", "31" }));
+		// regex_replace sees every group
+		TEST_ASSERT(rex::regex_replace(s, masked, std::string("[$1/$3]")) == "[2024/15]");
+		std::string out;
+		rex::regex_replace(std::back_inserter(out), s.begin(), s.end(), masked, std::string("[$1/$3]"));
+		TEST_ASSERT(out == "[2024/15]");
+		// So does regex_split
+		std::vector<std::pair<size_t, size_t>> spans;
+		TEST_ASSERT(rex::regex_split(spans, s, masked, std::vector<int>{ 1 }) == 1);
+		TEST_ASSERT(spans[0] == std::make_pair(size_t(0), size_t(4)));
+
+		// Offsets, batches and the buffered iterator apply it too
+		rex::match_offsets mo;
+		TEST_ASSERT(rex::regex_search(s, mo, masked) && mo.matched(3) && !mo.matched(1));
+		std::vector<rex::match_offsets> batch;
+		std::vector<std::string> subjects(1, s);
+		TEST_ASSERT(rex::regex_search_batch(subjects.begin(), subjects.end(), batch, masked) == 1);
+		TEST_ASSERT(batch[0].matched(3) && batch[0].length(3) == 2 && !batch[0].matched(2));
+		std::list<char> chars(two.begin(), two.end());
+		size_t listed = 0;
+		for (rex::regex_iterator<std::list<char>::iterator> it(chars.begin(), chars.end(), masked), end; it != end; ++it, ++listed)
+			TEST_ASSERT(!(*it)[1].matched && (*it)[3].matched);
+		TEST_ASSERT(listed == 2);
+
+		rex::smatch m;
+		TEST_ASSERT(rex::regex_search_backward(two, m, masked) && m[3].str() == "31" && !m[2].matched);
+		TEST_ASSERT(rex::regex_search_range(two, 0, 16, m, masked) && m[3].str() == "15" && !m[4].matched);
+
+		// A per-call mask replaces the default
+		TEST_ASSERT(rex::regex_search(s, m, masked, rex::capture_mask()) && m[1].str() == "2024");
+
+		// Copies keep the mask; a new pattern resets it
+		rex::regex copy(masked);
+		TEST_ASSERT(copy.captures().bits == masked.captures().bits);
+		copy.assign(std::string("(a)"));
+		TEST_ASSERT(copy.captures().is_all());
+
+		// nosubs still stores only the whole match
+		rex::regex nosubs(std::string("(\\d+)-(\\d+)"), rex::regex_constants::ECMAScript | rex::regex_constants::nosubs);
+		TEST_ASSERT(rex::regex_search(s, m, nosubs, rex::capture_mask{ 1 }) && m.size() == 1);
+		std::cout << "  Test 3 passed: per-regex masks" << std::endl;
+	}
+
+	// Test 4: Named groups
+	{
+		rex::regex named(std::string("(?<year>\\d+)-(?<month>\\d+)-(?<day>\\d+)"), rex::regex_constants::oniguruma);
+		rex::capture_mask mask = named.named_captures({ "year", "day" });
+		TEST_ASSERT(mask.contains(1) && !mask.contains(2) && mask.contains(3));
+		rex::smatch m;
+		TEST_ASSERT(rex::regex_search(s, m, named, mask));
+		TEST_ASSERT(m[1].str() == "2024" && !m[2].matched && m[3].str() == "15");
+
+		// All the groups of a name
+		rex::regex twice(std::string("(?<n>a)|(?<n>b)|(c)"), rex::regex_constants::oniguruma);
+		mask = twice.named_captures({ "n" });
+		TEST_ASSERT(mask.contains(1) && mask.contains(2) && !mask.contains(3));
+
+		bool thrown = false;
+		try {
+			named.named_captures({ "hour" });
+		} catch (const rex::regex_error& e) {
+			thrown = (e.code() == rex::regex_constants::error_backref);
+		}
+		TEST_ASSERT(thrown);
+		std::cout << "  Test 4 passed: named groups" << std::endl;
+	}
+
+	// Test 5: Groups past max_group are always stored
+	{
+		std::string pattern;
+		for (int i = 0; i < 66; ++i) pattern += "(.)";
+		const std::string subject(66, 'x');
+		rex::regex many(pattern);
+		rex::smatch m;
+		TEST_ASSERT(rex::regex_match(subject, m, many, rex::capture_mask{ 10 }));
+		TEST_ASSERT(m.size() == 67 && m[10].matched && !m[11].matched && !m[63].matched);
+		TEST_ASSERT(m[64].matched && m[66].matched && m.position(66) == 65);
+		std::cout << "  Test 5 passed: groups past max_group" << std::endl;
+	}
+
+	// Test 6: Wide characters
+	{
+		const std::wstring ws = L"東京:京都";
+		rex::wsmatch wm;
+		TEST_ASSERT(rex::regex_search(ws, wm, rex::wregex(std::wstring(L"(.+):(.+)")), rex::capture_mask{ 2 }));
+		TEST_ASSERT(!wm[1].matched && wm[2].str() == L"京都");
+
+		const std::u32string s32 = U"a1";
+		rex::u32smatch m32;
+		TEST_ASSERT(rex::regex_match(s32, m32, rex::u32regex(std::u32string(U"(\\w)(\\d)")), rex::capture_mask{ 1 }));
+		TEST_ASSERT(m32[1].str() == U"a" && !m32[2].matched);
+		std::cout << "  Test 6 passed: wide characters" << std::endl;
+	}
+
+	std::cout << "All capture_mask tests passed." << std::endl;
+	return 0;
+}
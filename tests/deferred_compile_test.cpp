@@ -0,0 +1,149 @@
+// deferred_compile_test.cpp --- Tests for regex_constants::deferred
+// Author: katahiromz
+// License: BSD-2-Clause
+
+#include "../onigpp.h"
+#include <iostream>
+#include <cassert>
+#include <string>
+#include <thread>
+#include <vector>
+#include <atomic>
+
+// Helper macro for test assertions
+#define TEST_ASSERT(cond) do { \
+	if (!(cond)) { \
+		std::cerr << "FAIL: " << #cond << " at line " << __LINE__ << std::endl; \
+		return 1; \
+	} \
+} while(0)
+
+namespace rex = onigpp;
+namespace rc = rex::regex_constants;
+
+int main() {
+	rex::auto_init init;
+
+	std::cout << "Testing deferred compilation..." << std::endl;
+
+	const rc::syntax_option_type deferred = rc::ECMAScript | rc::deferred;
+
+	// Test 1: Compiled on first use, with the same results as eager compilation
+	{
+		std::vector<rex::regex> patterns;
+		for (int i = 0; i < 2000; ++i)
+			patterns.push_back(rex::regex("key" + std::to_string(i) + "=(\\w+)", deferred));
+		for (const rex::regex& re : patterns)
+			TEST_ASSERT(!re.is_compiled());
+
+		const std::string text = "key7=seven key1999=last";
+		rex::smatch m;
+		TEST_ASSERT(rex::regex_search(text, m, patterns[7]));
+		TEST_ASSERT(m[1] == "seven");
+		TEST_ASSERT(patterns[7].is_compiled());
+		TEST_ASSERT(!patterns[8].is_compiled());
+		TEST_ASSERT(rex::regex_search(text, m, patterns[1999]));
+		TEST_ASSERT(m[1] == "last");
+
+		rex::regex eager(std::string("(a)(b)?"));
+		rex::regex lazy(std::string("(a)(b)?"), deferred);
+		TEST_ASSERT(lazy.mark_count() == eager.mark_count());
+		TEST_ASSERT(lazy.is_compiled());
+		TEST_ASSERT(rex::regex_replace(std::string("ab a"), lazy, std::string("[$1$2]")) ==
+		            rex::regex_replace(std::string("ab a"), eager, std::string("[$1$2]")));
+		std::cout << "  Test 1 passed: compile on first use" << std::endl;
+	}
+
+	// Test 2: Errors are reported on first use, the same way as eager compilation
+	{
+		const std::string bad = "(unclosed[";
+		rc::error_type expected = rc::error_escape;
+		std::string message;
+		try {
+			rex::regex eager(bad);
+			TEST_ASSERT(false);
+		} catch (const rex::regex_error& e) {
+			expected = e.code();
+			message = e.what();
+		}
+
+		rex::regex lazy(bad, deferred);
+		TEST_ASSERT(!lazy.is_compiled());
+		for (int attempt = 0; attempt < 2; ++attempt) {
+			bool thrown = false;
+			try {
+				lazy.compile();
+			} catch (const rex::regex_error& e) {
+				thrown = true;
+				TEST_ASSERT(e.code() == expected);
+				TEST_ASSERT(message == e.what());
+			}
+			TEST_ASSERT(thrown);
+			TEST_ASSERT(!lazy.is_compiled());
+		}
+
+		bool thrown = false;
+		try {
+			rex::smatch m;
+			rex::regex_search(std::string("x"), m, lazy);
+		} catch (const rex::regex_error& e) {
+			thrown = e.code() == expected;
+		}
+		TEST_ASSERT(thrown);
+
+		thrown = false;
+		try {
+			lazy.mark_count();
+		} catch (const rex::regex_error& e) {
+			thrown = e.code() == expected;
+		}
+		TEST_ASSERT(thrown);
+
+		rex::regex good(std::string("ok"), deferred);
+		good.compile();
+		TEST_ASSERT(good.is_compiled());
+		std::cout << "  Test 2 passed: error reporting" << std::endl;
+	}
+
+	// Test 3: Copies share one compilation
+	{
+		rex::regex original(std::string("\\d+"), deferred);
+		rex::regex copy = original;
+		TEST_ASSERT(!copy.is_compiled());
+		rex::smatch m;
+		TEST_ASSERT(rex::regex_search(std::string("ab 42"), m, copy));
+		TEST_ASSERT(original.is_compiled());
+
+		// A new pattern or locale records a new deferred program
+		copy.imbue(std::locale::classic());
+		copy.assign(std::string("x+"), deferred);
+		TEST_ASSERT(!copy.is_compiled());
+		rex::regex collate(std::string("[[:digit:]]+"), deferred | rc::collate);
+		collate.imbue(std::locale::classic());
+		TEST_ASSERT(!collate.is_compiled());
+		TEST_ASSERT(rex::regex_search(std::string("ab 42"), m, collate));
+		TEST_ASSERT(m.str() == "42");
+		std::cout << "  Test 3 passed: copies and recompilation" << std::endl;
+	}
+
+	// Test 4: Concurrent first use compiles once and every thread sees the result
+	{
+		rex::regex re(std::string("(\\w+)@(\\w+)\\.com"), deferred);
+		std::atomic<int> found(0);
+		std::vector<std::thread> threads;
+		for (int t = 0; t < 8; ++t) {
+			threads.emplace_back([&re, &found]() {
+				rex::smatch m;
+				const std::string text = "mail me@example.com";
+				if (rex::regex_search(text, m, re) && m[2] == "example") ++found;
+			});
+		}
+		for (std::thread& t : threads) t.join();
+		TEST_ASSERT(found == 8);
+		TEST_ASSERT(re.is_compiled());
+		std::cout << "  Test 4 passed: concurrent first use" << std::endl;
+	}
+
+	std::cout << "All deferred compilation tests passed." << std::endl;
+	return 0;
+}
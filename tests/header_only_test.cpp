@@ -0,0 +1,101 @@
+// header_only_test.cpp --- Tests for the header-only mode (ONIGPP_HEADER_ONLY)
+// Author: katahiromz
+// License: BSD-2-Clause
+
+#include "../onigpp.h"
+#include <iostream>
+#include <cassert>
+#include <deque>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// Helper macro for test assertions
+#define TEST_ASSERT(cond) do { \
+	if (!(cond)) { \
+		std::cerr << "FAIL: " << #cond << " at line " << __LINE__ << std::endl; \
+		return 1; \
+	} \
+} while(0)
+
+namespace rex = onigpp;
+
+#ifndef ONIGPP_HEADER_ONLY
+	#error This test must be built with ONIGPP_HEADER_ONLY (the onigpp_header_only target)
+#endif
+
+// An allocator type that no explicit instantiation knows about
+static size_t g_allocations = 0;
+
+template <class T>
+struct counting_allocator {
+	using value_type = T;
+	counting_allocator() { }
+	template <class U> counting_allocator(const counting_allocator<U>&) { }
+	T* allocate(size_t n) {
+		++g_allocations;
+		return std::allocator<T>().allocate(n);
+	}
+	void deallocate(T* p, size_t n) { std::allocator<T>().deallocate(p, n); }
+	template <class U> bool operator==(const counting_allocator<U>&) const { return true; }
+	template <class U> bool operator!=(const counting_allocator<U>&) const { return false; }
+};
+
+int main() {
+	rex::auto_init init;
+
+	std::cout << "Testing the header-only mode..." << std::endl;
+
+	// Test 1: Iterator types without explicit instantiations
+	{
+		std::u16string text = u"id=42, name=x";
+		std::deque<char16_t> d(text.begin(), text.end());
+		rex::u16regex re(std::u16string(u"(\\w+)=(\\d+)"));
+		rex::match_results<std::deque<char16_t>::iterator> m;
+		TEST_ASSERT(rex::regex_search(d.begin(), d.end(), m, re));
+		TEST_ASSERT(m.position() == 0 && m[2].str() == u"42");
+		TEST_ASSERT(rex::regex_match(d.begin(), d.begin() + 5, m, re));
+
+		rex::u16regex word(std::u16string(u"\\w+"));
+		size_t count = 0;
+		for (rex::regex_iterator<std::deque<char16_t>::iterator> it(d.begin(), d.end(), word), end; it != end; ++it)
+			++count;
+		TEST_ASSERT(count == 4);
+
+		std::u16string out;
+		rex::regex_replace(std::back_inserter(out), d.begin(), d.end(), rex::u16regex(std::u16string(u"\\d")), std::u16string(u"#"));
+		TEST_ASSERT(out == u"id=##, name=x");
+		std::cout << "  Test 1 passed: other iterator types" << std::endl;
+	}
+
+	// Test 2: Allocator types without explicit instantiations
+	{
+		typedef std::string::const_iterator iterator;
+		const std::string s = "key: value";
+		rex::regex re(std::string("(\\w+): (\\w+)"));
+		rex::match_results<iterator, counting_allocator<rex::sub_match<iterator>>> m;
+		g_allocations = 0;
+		TEST_ASSERT(rex::regex_search(s.begin(), s.end(), m, re));
+		TEST_ASSERT(m.size() == 3 && m[1].str() == "key" && m[2].str() == "value");
+		TEST_ASSERT(g_allocations > 0);
+		TEST_ASSERT(rex::regex_match(s.begin(), s.end(), m, re));
+		std::cout << "  Test 2 passed: other allocator types" << std::endl;
+	}
+
+	// Test 3: The common types still work
+	{
+		rex::smatch m;
+		const std::string s = "abc 123";
+		TEST_ASSERT(rex::regex_search(s, m, rex::regex(std::string("\\d+"))));
+		TEST_ASSERT(m.str() == "123");
+		TEST_ASSERT(rex::regex_replace(s, rex::regex(std::string("[a-z]")), std::string("_")) == "___ 123");
+		std::wstring ws = L"東京";
+		rex::wsmatch wm;
+		TEST_ASSERT(rex::regex_match(ws, wm, rex::wregex(std::wstring(L"東."))));
+		TEST_ASSERT(rex::version() != nullptr);
+		std::cout << "  Test 3 passed: common types" << std::endl;
+	}
+
+	std::cout << "All header-only tests passed." << std::endl;
+	return 0;
+}
@@ -0,0 +1,123 @@
+// line_terminator_test.cpp --- Tests for ECMAScript multiline line terminators
+// Author: katahiromz
+// License: BSD-2-Clause
+
+#include "../onigpp.h"
+#include <iostream>
+#include <cassert>
+#include <string>
+#include <vector>
+
+// Helper macro for test assertions
+#define TEST_ASSERT(cond) do { \
+	if (!(cond)) { \
+		std::cerr << "FAIL: " << #cond << " at line " << __LINE__ << std::endl; \
+		return 1; \
+	} \
+} while(0)
+
+namespace rex = onigpp;
+namespace rc = rex::regex_constants;
+
+// All matches of re in text
+template <class CharT>
+static std::vector<std::basic_string<CharT>> find_all(const std::basic_string<CharT>& text,
+                                                      const rex::basic_regex<CharT>& re,
+                                                      rc::match_flag_type flags = rc::match_default) {
+	typedef typename std::basic_string<CharT>::const_iterator iter;
+	std::vector<std::basic_string<CharT>> result;
+	for (rex::regex_iterator<iter, CharT> it(text.begin(), text.end(), re, flags), end; it != end; ++it)
+		result.push_back(it->str());
+	return result;
+}
+
+// Positions of all matches of re in text
+static std::vector<size_t> positions(const std::string& text, const rex::regex& re) {
+	std::vector<size_t> result;
+	for (rex::sregex_iterator it(text.begin(), text.end(), re), end; it != end; ++it)
+		result.push_back(static_cast<size_t>(it->position()));
+	return result;
+}
+
+int main() {
+	rex::auto_init init;
+
+	std::cout << "Testing ECMAScript multiline line terminators..." << std::endl;
+
+	const rc::syntax_option_type ml = rc::ECMAScript | rc::multiline;
+	const std::string mixed = "a1\nb2\rc3\r\nd4";
+
+	// Test 1: Default set recognizes LF and CR, as before
+	{
+		rex::regex starts(std::string("^\\w"), ml);
+		rex::regex ends(std::string("\\d$"), ml);
+		TEST_ASSERT((find_all(mixed, starts) == std::vector<std::string>{ "a", "b", "c", "d" }));
+		TEST_ASSERT((find_all(mixed, ends) == std::vector<std::string>{ "1", "2", "3", "4" }));
+		std::cout << "  Test 1 passed: default terminators" << std::endl;
+	}
+
+	// Test 2: LF only
+	{
+		rex::regex starts(std::string("^\\w"), ml | rc::line_terminator_lf);
+		rex::regex ends(std::string("\\d$"), ml | rc::line_terminator_lf);
+		TEST_ASSERT((find_all(mixed, starts) == std::vector<std::string>{ "a", "b", "d" }));
+		TEST_ASSERT((find_all(mixed, ends) == std::vector<std::string>{ "1", "4" }));
+
+		std::string log;
+		for (int i = 0; i < 100; ++i) log += (i % 10 ? "INFO x\n" : "ERROR " + std::to_string(i) + "\n");
+		rex::regex lf(std::string("^ERROR \\d+$"), ml | rc::line_terminator_lf);
+		rex::regex all(std::string("^ERROR \\d+$"), ml);
+		TEST_ASSERT(find_all(log, lf).size() == 10);
+		TEST_ASSERT(find_all(log, lf) == find_all(log, all));
+		std::cout << "  Test 2 passed: LF only" << std::endl;
+	}
+
+	// Test 3: Other subsets
+	{
+		rex::regex cr(std::string("^\\w"), ml | rc::line_terminator_cr);
+		TEST_ASSERT((find_all(mixed, cr) == std::vector<std::string>{ "a", "c" }));
+		rex::regex cr_end(std::string("\\d$"), ml | rc::line_terminator_cr);
+		TEST_ASSERT((find_all(mixed, cr_end) == std::vector<std::string>{ "2", "3", "4" }));
+
+		const std::wstring text = L"p q r\ns";
+		rex::wregex uni(std::wstring(L"^\\w"), ml | rc::line_terminator_unicode);
+		TEST_ASSERT((find_all(text, uni) == std::vector<std::wstring>{ L"p", L"q", L"r" }));
+		rex::wregex all(std::wstring(L"^\\w$"), ml);
+		TEST_ASSERT(find_all(text, all).size() == 4);
+		std::cout << "  Test 3 passed: terminator subsets" << std::endl;
+	}
+
+	// Test 4: Terminators only matter with multiline; match_not_bol and match_not_eol still apply
+	{
+		rex::regex single(std::string("^b"), rc::ECMAScript | rc::line_terminator_lf);
+		TEST_ASSERT(find_all(std::string("a\nb"), single).empty());
+
+		rex::regex lf(std::string("^a"), ml | rc::line_terminator_lf);
+		TEST_ASSERT(find_all(std::string("a\na"), lf).size() == 2);
+		TEST_ASSERT(find_all(std::string("a\na"), lf, rc::match_not_bol).size() == 1);
+		rex::regex lf_end(std::string("a$"), ml | rc::line_terminator_lf);
+		TEST_ASSERT(find_all(std::string("a\na"), lf_end, rc::match_not_eol).size() == 1);
+
+		rex::regex escaped(std::string("\\^[$^]\\$"), ml | rc::line_terminator_lf);
+		TEST_ASSERT(find_all(std::string("^$$ ^^$"), escaped).size() == 2);
+		std::cout << "  Test 4 passed: flags and escapes" << std::endl;
+	}
+
+	// Test 5: ^ matches at the end of the subject after a final LF
+	{
+		const rc::syntax_option_type sets[] = { ml, ml | rc::line_terminator_lf, ml | rc::line_terminator_cr };
+		for (rc::syntax_option_type f : sets) {
+			const bool lf = (f & rc::line_terminator_cr) == 0;
+			rex::regex caret(std::string("^"), f);
+			TEST_ASSERT(positions("a\nb\n", caret) == (lf ? std::vector<size_t>{ 0, 2, 4 } : std::vector<size_t>{ 0 }));
+			TEST_ASSERT(positions("a\n", rex::regex(std::string("^$"), f)) == (lf ? std::vector<size_t>{ 2 } : std::vector<size_t>()));
+			TEST_ASSERT(positions("a\n", rex::regex(std::string("$\n^"), f)) == (lf ? std::vector<size_t>{ 1 } : std::vector<size_t>()));
+		}
+		rex::regex cr(std::string("^"), ml | rc::line_terminator_cr);
+		TEST_ASSERT((positions("a\rb\r", cr) == std::vector<size_t>{ 0, 2, 4 }));
+		std::cout << "  Test 5 passed: end of the subject" << std::endl;
+	}
+
+	std::cout << "All line terminator tests passed." << std::endl;
+	return 0;
+}
@@ -0,0 +1,159 @@
+// literal_union_test.cpp --- Tests for onigpp::regex_literal_union and onigpp::make_literal_regex
+// Author: katahiromz
+// License: BSD-2-Clause
+
+#include "../onigpp.h"
+#include <iostream>
+#include <cassert>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// Helper macro for test assertions
+#define TEST_ASSERT(cond) do { \
+	if (!(cond)) { \
+		std::cerr << "FAIL: " << #cond << " at line " << __LINE__ << std::endl; \
+		return 1; \
+	} \
+} while(0)
+
+namespace rex = onigpp;
+
+// The flat alternation of the escaped literals, longest first
+template <class CharT>
+static std::basic_string<CharT> flat_alternation(std::vector<std::basic_string<CharT>> literals) {
+	std::stable_sort(literals.begin(), literals.end(),
+		[](const std::basic_string<CharT>& a, const std::basic_string<CharT>& b) { return a.size() > b.size(); });
+	std::basic_string<CharT> pattern;
+	for (size_t i = 0; i < literals.size(); ++i) {
+		if (i) pattern += CharT('|');
+		pattern += rex::regex_escape(literals[i]);
+	}
+	return std::basic_string<CharT>(1, CharT('(')) + CharT('?') + CharT(':') + pattern + CharT(')');
+}
+
+// All matches as (position, length) pairs
+template <class CharT>
+static std::vector<std::pair<size_t, size_t>> matches(const std::basic_string<CharT>& s, const rex::basic_regex<CharT>& re) {
+	typedef typename std::basic_string<CharT>::const_iterator iterator;
+	std::vector<std::pair<size_t, size_t>> result;
+	for (rex::regex_iterator<iterator, CharT> it(s.begin(), s.end(), re), end; it != end; ++it)
+		result.push_back(std::make_pair(static_cast<size_t>(it->position()), static_cast<size_t>(it->length())));
+	return result;
+}
+
+int main() {
+	rex::auto_init init;
+
+	std::cout << "Testing onigpp::regex_literal_union..." << std::endl;
+
+	// Test 1: Factored patterns
+	{
+		typedef std::vector<std::string> list;
+		TEST_ASSERT(rex::regex_literal_union(list{ "cat", "bat", "rat" }) == "[bcr]at");
+		TEST_ASSERT(rex::regex_literal_union(list{ "walk", "walked", "talked", "talks" }) == "(?:talk(?:ed|s)|walk(?:ed)?)");
+		TEST_ASSERT(rex::regex_literal_union(list{ "a", "ab", "abc" }) == "a(?:bc?)?");
+		TEST_ASSERT(rex::regex_literal_union(list{ "abc", "abd", "abe", "abf" }) == "ab[c-f]");
+		TEST_ASSERT(rex::regex_literal_union(list{ "a.b", "a-b", "a]b" }) == "a[\\-.\\]]b");
+		TEST_ASSERT(rex::regex_literal_union(list{ "x+", "x" }) == "x\\+?");
+		TEST_ASSERT(rex::regex_literal_union(list{ "dup", "dup" }) == "dup");
+		TEST_ASSERT(rex::regex_literal_union(list{ "", "x" }) == "x?");
+		TEST_ASSERT(rex::regex_literal_union(list{}) == "(?!)");
+		TEST_ASSERT(rex::regex_literal_union(list{ "é", "è", "ê" }) == "[èéê]");
+
+		// icase folds ASCII letters only
+		TEST_ASSERT(rex::regex_literal_union(list{ "foo", "Foo", "FOO" }, true) == "foo");
+		TEST_ASSERT(rex::regex_literal_union(list{ "é", "è" }, true) == "(?:è|é)");
+		std::cout << "  Test 1 passed: factored patterns" << std::endl;
+	}
+
+	// Test 2: Same matches as the flat alternation
+	{
+		const std::vector<std::string> words = {
+			"in", "int", "integer", "interface", "internal", "into", "is", "it", "item", "items",
+			"a+b", "(x)", "[y]", "car", "cart", "carts", "bar", "bars", "far", "star", "stars", "",
+		};
+		const std::string text = "an integer item in its interface: a+b (x) [y]; the carts of the stars into bars";
+		for (int icase = 0; icase < 2; ++icase) {
+			for (int whole = 0; whole < 2; ++whole) {
+				rex::regex_constants::syntax_option_type f = rex::regex_constants::ECMAScript;
+				if (icase) f |= rex::regex_constants::icase;
+				std::string flat = flat_alternation(words);
+				if (whole) flat = "\\b" + flat + "\\b";
+				rex::regex expected(flat, f);
+				rex::regex trie = rex::make_literal_regex(words, f, whole != 0);
+				TEST_ASSERT(matches(text, trie) == matches(text, expected));
+
+				std::string upper = text;
+				std::transform(upper.begin(), upper.end(), upper.begin(), ::toupper);
+				TEST_ASSERT(matches(upper, trie) == matches(upper, expected));
+				const std::vector<std::pair<size_t, size_t>> found = matches(upper, trie);
+				const bool integer = std::find(found.begin(), found.end(), std::make_pair(size_t(3), size_t(7))) != found.end();
+				TEST_ASSERT(integer == (icase != 0));
+			}
+		}
+		std::cout << "  Test 2 passed: same matches as the flat alternation" << std::endl;
+	}
+
+	// Test 3: Many words
+	{
+		std::vector<std::string> words;
+		for (int i = 0; i < 5000; ++i) words.push_back("w" + std::to_string(i * 7919 % 100000));
+		std::string flat = "\\b" + flat_alternation(words) + "\\b";
+		std::string union_pattern = rex::regex_literal_union(words);
+		TEST_ASSERT(union_pattern.size() < flat.size());
+
+		rex::regex trie = rex::make_literal_regex(words, rex::regex::ECMAScript, true);
+		rex::regex expected(flat);
+		std::string text;
+		for (int i = 0; i < 300; ++i) text += "w" + std::to_string(i * 131) + " ";
+		TEST_ASSERT(matches(text, trie) == matches(text, expected));
+		TEST_ASSERT(!matches(text, trie).empty());
+		std::cout << "  Test 3 passed: many words" << std::endl;
+	}
+
+	// Test 4: Wide characters
+	{
+		std::vector<std::wstring> w = { L"東京", L"東北", L"京都", L"北京" };
+		TEST_ASSERT(rex::regex_literal_union(w) == L"(?:京都|北京|東[京北])");
+		rex::wregex wre = rex::make_literal_regex(w);
+		std::wstring ws = L"東京と京都と北京";
+		TEST_ASSERT(matches(ws, wre).size() == 3);
+
+		std::vector<std::u16string> u16 = { u"𝄞a", u"𝄞b", u"x" };
+		rex::u16regex u16re = rex::make_literal_regex(u16);
+		std::u16string s16 = u"x𝄞b𝄞c";
+		TEST_ASSERT(matches(s16, u16re) == (std::vector<std::pair<size_t, size_t>>{ { 0, 1 }, { 1, 3 } }));
+
+		std::vector<std::u32string> u32 = { U"ab", U"cb", U"abc" };
+		TEST_ASSERT(rex::regex_literal_union(u32) == U"(?:abc?|cb)");
+		rex::u32regex u32re = rex::make_literal_regex(u32, rex::u32regex::ECMAScript | rex::u32regex::icase);
+		TEST_ASSERT(matches(std::u32string(U"xABCx cB"), u32re).size() == 2);
+		std::cout << "  Test 4 passed: wide characters" << std::endl;
+	}
+
+	// Test 5: Case folds that change the length
+	{
+		typedef std::vector<std::string> list;
+		TEST_ASSERT(rex::regex_literal_union(list{ "ss", "st" }, true) == "(?:ss|st)");
+		TEST_ASSERT(rex::regex_literal_union(list{ "Office", "Ox", "Oz" }, true) == "(?:office|o[xz])");
+		TEST_ASSERT(rex::regex_literal_union(list{ "ss", "st" }) == "s[st]");
+		TEST_ASSERT(rex::regex_literal_union(list{ "Ss" }, true) == "ss");
+
+		const std::vector<std::string> words = { "ss", "st", "sa", "office", "often", "strasse", "stop", "j\u030C", "ja", "" };
+		const std::string text = "\u00DF \uFB06 sa o\uFB03ce STRA\u00DFE Stop \u01F0 JA";
+		rex::regex_constants::syntax_option_type f = rex::regex_constants::ECMAScript | rex::regex_constants::icase;
+		rex::regex expected(flat_alternation(words), f);
+		rex::regex trie = rex::make_literal_regex(words, f);
+		TEST_ASSERT(matches(text, trie) == matches(text, expected));
+
+		std::vector<std::pair<size_t, size_t>> found = matches(text, trie);
+		found.erase(std::remove_if(found.begin(), found.end(),
+			[](const std::pair<size_t, size_t>& m) { return m.second == 0; }), found.end());
+		TEST_ASSERT(found.size() == 8);
+		std::cout << "  Test 5 passed: case folds that change the length" << std::endl;
+	}
+
+	std::cout << "All regex_literal_union tests passed." << std::endl;
+	return 0;
+}
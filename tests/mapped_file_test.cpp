@@ -0,0 +1,133 @@
+// mapped_file_test.cpp --- Tests for onigpp::mapped_file and mapped file search
+// Author: katahiromz
+// License: BSD-2-Clause
+
+#include "../onigpp.h"
+#include <iostream>
+#include <cassert>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+
+// Helper macro for test assertions
+#define TEST_ASSERT(cond) do { \
+	if (!(cond)) { \
+		std::cerr << "FAIL: " << #cond << " at line " << __LINE__ << std::endl; \
+		return 1; \
+	} \
+} while(0)
+
+static void write_file(const char* path, const std::string& contents) {
+	std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+	out.write(contents.data(), contents.size());
+}
+
+static std::string read_file(const char* path) {
+	std::ifstream in(path, std::ios::in | std::ios::binary);
+	std::ostringstream ss;
+	ss << in.rdbuf();
+	return ss.str();
+}
+
+int main() {
+	onigpp::auto_init init;
+
+	std::cout << "Testing onigpp::mapped_file..." << std::endl;
+
+	const char* in_path = "mapped_file_test_in.txt";
+	const char* out_path = "mapped_file_test_out.txt";
+	const char* empty_path = "mapped_file_test_empty.txt";
+
+	std::string text;
+	for (int i = 0; i < 1000; ++i) {
+		text += "user" + std::to_string(i) + "@example.com,\n";
+	}
+	write_file(in_path, text);
+	write_file(empty_path, std::string());
+
+	onigpp::regex re(std::string("(\\w+)@(\\w+)\\.com"));
+
+	// Test 1: Opening and viewing the file
+	{
+		onigpp::mapped_file file(in_path);
+		TEST_ASSERT(file.is_open());
+		TEST_ASSERT(file.size() == text.size());
+		TEST_ASSERT(std::string(file.begin(), file.end()) == text);
+		std::cout << "  [PASS] Open (" << (file.is_mapped() ? "mapped" : "buffered") << ")" << std::endl;
+	}
+
+	// Test 2: regex_search and mapped_regex_iterator
+	{
+		onigpp::mapped_file file(in_path);
+		onigpp::cmatch m;
+		TEST_ASSERT(onigpp::regex_search(file, m, re));
+		TEST_ASSERT(m.position(0) == 0);
+		TEST_ASSERT(m[1].str() == "user0");
+		TEST_ASSERT(m.prefix().first == file.begin());
+		TEST_ASSERT(m.suffix().second == file.end());
+
+		size_t count = 0;
+		onigpp::sregex_iterator sit(text.begin(), text.end(), re);
+		for (onigpp::mapped_regex_iterator it(file, re), end; it != end; ++it, ++sit, ++count) {
+			TEST_ASSERT(it->position(0) == sit->position(0));
+			TEST_ASSERT((*it)[2].str() == (*sit)[2].str());
+		}
+		TEST_ASSERT(count == 1000);
+		std::cout << "  [PASS] Search and iterate" << std::endl;
+	}
+
+	// Test 3: Replacing into a stream and into a file
+	{
+		std::string fmt = "$2:$1";
+		std::string expected = onigpp::regex_replace(text, re, fmt);
+
+		onigpp::mapped_file file(in_path);
+		std::ostringstream out;
+		TEST_ASSERT(onigpp::regex_replace_file(out, file, re, fmt) == 1000);
+		TEST_ASSERT(out.str() == expected);
+
+		TEST_ASSERT(onigpp::regex_replace_file(in_path, out_path, re, fmt) == 1000);
+		TEST_ASSERT(read_file(out_path) == expected);
+
+		std::ostringstream first_only;
+		TEST_ASSERT(onigpp::regex_replace_file(first_only, file, re, fmt, onigpp::regex_constants::format_first_only) == 1);
+		TEST_ASSERT(first_only.str() == onigpp::regex_replace(text, re, fmt, onigpp::regex_constants::format_first_only));
+		std::cout << "  [PASS] Replace" << std::endl;
+	}
+
+	// Test 4: Empty and missing files, move
+	{
+		onigpp::mapped_file empty(empty_path);
+		TEST_ASSERT(empty.is_open());
+		TEST_ASSERT(empty.size() == 0);
+		onigpp::cmatch m;
+		TEST_ASSERT(!onigpp::regex_search(empty, m, re));
+		TEST_ASSERT(onigpp::regex_search(empty, m, onigpp::regex(std::string("^$"))));
+
+		bool thrown = false;
+		try {
+			onigpp::mapped_file missing("mapped_file_test_missing.txt");
+		} catch (const std::runtime_error&) {
+			thrown = true;
+		}
+		TEST_ASSERT(thrown);
+
+		onigpp::mapped_file a(in_path);
+		onigpp::mapped_file b(std::move(a));
+		TEST_ASSERT(!a.is_open());
+		TEST_ASSERT(b.size() == text.size());
+		a = std::move(b);
+		TEST_ASSERT(a.size() == text.size());
+		TEST_ASSERT(std::string(a.begin(), a.end()) == text);
+		a.close();
+		TEST_ASSERT(!a.is_open());
+		std::cout << "  [PASS] Empty, missing and moved files" << std::endl;
+	}
+
+	std::remove(in_path);
+	std::remove(out_path);
+	std::remove(empty_path);
+
+	std::cout << "All mapped file tests passed." << std::endl;
+	return 0;
+}
@@ -0,0 +1,132 @@
+// match_limits_test.cpp --- Tests for onigpp::match_limits
+// Author: katahiromz
+// License: BSD-2-Clause
+
+#include "../onigpp.h"
+#include <iostream>
+#include <cassert>
+#include <chrono>
+#include <string>
+
+// Helper macro for test assertions
+#define TEST_ASSERT(cond) do { \
+	if (!(cond)) { \
+		std::cerr << "FAIL: " << #cond << " at line " << __LINE__ << std::endl; \
+		return 1; \
+	} \
+} while(0)
+
+namespace rex = onigpp;
+
+// Returns the error_type thrown by regex_search, or -1 if it returned
+template <class Search>
+static int error_of(Search search) {
+	try {
+		search();
+	} catch (const rex::regex_error& e) {
+		return e.code();
+	}
+	return -1;
+}
+
+int main() {
+	rex::auto_init init;
+
+	std::cout << "Testing onigpp::match_limits..." << std::endl;
+
+	// Catastrophic backtracking: every split of the a's is tried
+	rex::regex bad(std::string("^(\\w+\\s?)*$"));
+	const std::string subject = std::string(30, 'a') + "!";
+
+	// Test 1: Per-call retry limits
+	{
+		rex::smatch m;
+		rex::match_limits in_match;
+		in_match.retry_limit_in_match = 1000;
+		TEST_ASSERT(error_of([&] { rex::regex_search(subject, m, bad, in_match); }) == rex::regex_constants::error_retry_limit);
+
+		rex::match_limits in_search;
+		in_search.retry_limit_in_search = 5000;
+		TEST_ASSERT(error_of([&] { rex::regex_search(subject, m, bad, in_search); }) == rex::regex_constants::error_retry_limit);
+		TEST_ASSERT(error_of([&] { rex::regex_match(subject, m, bad, in_search); }) == rex::regex_constants::error_retry_limit);
+
+		// Limits do not get in the way of ordinary searches
+		TEST_ASSERT(rex::regex_search(std::string("aa bb"), m, bad, in_search));
+		TEST_ASSERT(m.length(0) == 5);
+		std::cout << "  Test 1 passed: per-call retry limits" << std::endl;
+	}
+
+	// Test 2: Regex default limits apply to every search, and per-call limits replace them
+	{
+		rex::regex limited(bad);
+		rex::match_limits defaults;
+		defaults.retry_limit_in_search = 5000;
+		limited.set_limits(defaults);
+		TEST_ASSERT(limited.limits().retry_limit_in_search == 5000);
+		TEST_ASSERT(bad.limits().empty());
+
+		rex::smatch m;
+		TEST_ASSERT(error_of([&] { rex::regex_search(subject, m, limited); }) == rex::regex_constants::error_retry_limit);
+		TEST_ASSERT(error_of([&] { rex::regex_match(subject, m, limited); }) == rex::regex_constants::error_retry_limit);
+		TEST_ASSERT(error_of([&] { rex::sregex_iterator it(subject.begin(), subject.end(), limited); }) ==
+		            rex::regex_constants::error_retry_limit);
+		TEST_ASSERT(error_of([&] { rex::regex_replace(subject, limited, std::string("x")); }) ==
+		            rex::regex_constants::error_retry_limit);
+
+		std::string short_subject = std::string(8, 'a') + "!";
+		rex::match_limits generous;
+		generous.retry_limit_in_search = 100000000;
+		TEST_ASSERT(error_of([&] { rex::regex_search(short_subject, m, limited, generous); }) == -1);
+
+		// Copies keep the limits; a new pattern resets them
+		rex::regex copy(limited);
+		TEST_ASSERT(copy.limits().retry_limit_in_search == 5000);
+		copy.assign(std::string("a+"));
+		TEST_ASSERT(copy.limits().empty());
+		std::cout << "  Test 2 passed: regex default limits" << std::endl;
+	}
+
+	// Test 3: A deadline stops a search that would run far longer
+	{
+		rex::match_limits limits;
+		limits.retry_limit_in_match = ~0UL; // No retry limit, only the deadline
+		limits.timeout = std::chrono::milliseconds(20);
+		rex::smatch m;
+		std::string huge = std::string(40, 'a') + "!";
+		auto start = std::chrono::steady_clock::now();
+		TEST_ASSERT(error_of([&] { rex::regex_search(huge, m, bad, limits); }) == rex::regex_constants::error_deadline);
+		auto elapsed = std::chrono::steady_clock::now() - start;
+		TEST_ASSERT(elapsed < std::chrono::seconds(2));
+
+		rex::match_limits past;
+		past.deadline = rex::match_limits::clock::now() - std::chrono::seconds(1);
+		TEST_ASSERT(error_of([&] { rex::regex_search(huge, m, bad, past); }) == rex::regex_constants::error_deadline);
+		std::cout << "  Test 3 passed: deadline" << std::endl;
+	}
+
+	// Test 4: Results are unchanged under limits
+	{
+		std::string text;
+		for (int i = 0; i < 2000; ++i) text += "w" + std::to_string(i) + " ";
+		rex::regex words(std::string("w(\\d+)"));
+		rex::regex timed(words);
+		rex::match_limits limits;
+		limits.retry_limit_in_match = 1000;
+		limits.timeout = std::chrono::seconds(10);
+		timed.set_limits(limits);
+
+		rex::sregex_iterator a(text.begin(), text.end(), words), b(text.begin(), text.end(), timed), end;
+		size_t count = 0;
+		for (; a != end && b != end; ++a, ++b, ++count) {
+			TEST_ASSERT(a->position(0) == b->position(0));
+			TEST_ASSERT(a->str(1) == b->str(1));
+		}
+		TEST_ASSERT(a == end && b == end);
+		TEST_ASSERT(count == 2000);
+		TEST_ASSERT(rex::regex_replace(text, timed, std::string("$1")) == rex::regex_replace(text, words, std::string("$1")));
+		std::cout << "  Test 4 passed: results under limits" << std::endl;
+	}
+
+	std::cout << "All match_limits tests passed." << std::endl;
+	return 0;
+}
@@ -0,0 +1,148 @@
+// match_offsets_test.cpp --- Tests for onigpp::match_offsets and regex_offset_iterator
+// Author: katahiromz
+// License: BSD-2-Clause
+
+#include "../onigpp.h"
+#include <iostream>
+#include <cassert>
+#include <list>
+#include <string>
+
+// Helper macro for test assertions
+#define TEST_ASSERT(cond) do { \
+	if (!(cond)) { \
+		std::cerr << "FAIL: " << #cond << " at line " << __LINE__ << std::endl; \
+		return 1; \
+	} \
+} while(0)
+
+namespace rex = onigpp;
+
+int main() {
+	rex::auto_init init;
+
+	std::cout << "Testing onigpp::match_offsets..." << std::endl;
+
+	const std::string text = "2024-01-15 ok; 2024-02-x bad; 1999-12-31 ok";
+	rex::regex re(std::string("(\\d{4})-(\\d{2})-(?:(\\d{2})|x)"));
+
+	// Test 1: regex_search with offsets agrees with match_results
+	{
+		rex::match_offsets mo;
+		TEST_ASSERT(!mo.ready());
+		TEST_ASSERT(rex::regex_search(text, mo, re));
+		TEST_ASSERT(mo.ready());
+
+		rex::smatch m;
+		TEST_ASSERT(rex::regex_search(text, m, re));
+		TEST_ASSERT(mo.size() == m.size());
+		for (size_t i = 0; i < m.size(); ++i) {
+			TEST_ASSERT(mo.matched(i) == m[i].matched);
+			TEST_ASSERT(mo.position(i) == size_t(m.position(i)));
+			TEST_ASSERT(mo.length(i) == size_t(m.length(i)));
+			TEST_ASSERT(mo.byte_position(i) == mo.position(i));
+		}
+		TEST_ASSERT(!mo.matched(9) && mo.position(9) == rex::match_offsets::npos && mo.length(9) == 0);
+
+		TEST_ASSERT(!rex::regex_search(std::string("none"), mo, re));
+		TEST_ASSERT(mo.ready() && mo.empty());
+		std::cout << "  Test 1 passed: regex_search" << std::endl;
+	}
+
+	// Test 2: regex_offset_iterator yields the same matches as regex_iterator
+	{
+		const char* patterns[] = { "\\d+", "(\\d{4})-(\\d{2})-(?:(\\d{2})|x)", "\\b", "o?", "$" };
+		for (const char* pattern : patterns) {
+			rex::regex r{std::string(pattern)};
+			rex::sregex_iterator it(text.begin(), text.end(), r), end;
+			rex::sregex_offset_iterator oit(text.begin(), text.end(), r), oend;
+			for (; it != end && oit != oend; ++it, ++oit) {
+				TEST_ASSERT(oit->size() == it->size());
+				for (size_t i = 0; i < it->size(); ++i) {
+					TEST_ASSERT(oit->matched(i) == (*it)[i].matched);
+					if ((*it)[i].matched) {
+						TEST_ASSERT(oit->position(i) == size_t(it->position(i)));
+						TEST_ASSERT(oit->length(i) == size_t(it->length(i)));
+					}
+				}
+			}
+			TEST_ASSERT(it == end && oit == oend);
+		}
+		std::cout << "  Test 2 passed: regex_offset_iterator" << std::endl;
+	}
+
+	// Test 3: Non-contiguous subjects and building iterators on demand
+	{
+		std::list<char> lst(text.begin(), text.end());
+		rex::match_offsets mo;
+		TEST_ASSERT(rex::regex_search(lst.begin(), lst.end(), mo, re));
+
+		rex::match_results<std::list<char>::iterator> m;
+		TEST_ASSERT(rex::regex_search(lst.begin(), lst.end(), m, re));
+
+		rex::match_results<std::list<char>::iterator> built;
+		mo.to_match_results(lst.begin(), lst.end(), built);
+		TEST_ASSERT(built == m);
+		TEST_ASSERT(built.ready() && built.prefix().length() == 0);
+		TEST_ASSERT(built.str(1) == "2024" && built.str(3) == "15");
+
+		rex::sub_match<std::list<char>::iterator> year = mo.sub(1, lst.begin(), lst.end());
+		TEST_ASSERT(year.matched && year.str() == "2024");
+
+		size_t count = 0;
+		typedef rex::regex_offset_iterator<std::list<char>::iterator> list_offset_iterator;
+		list_offset_iterator copy;
+		for (list_offset_iterator it(lst.begin(), lst.end(), re), end; it != end; ++it) {
+			if (count == 1) {
+				copy = it;
+				TEST_ASSERT(!it->matched(3));
+			}
+			++count;
+		}
+		TEST_ASSERT(count == 3);
+		TEST_ASSERT(copy->position(0) == text.find("2024-02"));
+		++copy;
+		TEST_ASSERT(copy->position(0) == text.find("1999"));
+		std::cout << "  Test 3 passed: non-contiguous subjects" << std::endl;
+	}
+
+	// Test 4: Match flags and nosubs
+	{
+		rex::match_offsets mo;
+		rex::regex nosubs(std::string("(\\d+)-(\\d+)"), rex::regex_constants::ECMAScript | rex::regex_constants::nosubs);
+		TEST_ASSERT(rex::regex_search(text, mo, nosubs));
+		TEST_ASSERT(mo.size() == 1 && mo.length(0) == 7);
+
+		rex::regex optional(std::string("z*"));
+		TEST_ASSERT(rex::regex_search(text, mo, optional));
+		TEST_ASSERT(mo.length(0) == 0);
+		TEST_ASSERT(!rex::regex_search(text, mo, optional, rex::regex_constants::match_not_null));
+
+		rex::regex word(std::string("\\b\\d"));
+		TEST_ASSERT(rex::regex_search(text, mo, word, rex::regex_constants::match_not_bow));
+		TEST_ASSERT(mo.position(0) == 5);
+		std::cout << "  Test 4 passed: flags" << std::endl;
+	}
+
+	// Test 5: Wide characters report bytes and characters
+	{
+		std::wstring ws = L"key: value";
+		rex::wregex wre(std::wstring(L"(\\w+)$"));
+		rex::match_offsets mo;
+		TEST_ASSERT(rex::regex_search(ws, mo, wre));
+		TEST_ASSERT(mo.position(1) == 5 && mo.length(1) == 5);
+		TEST_ASSERT(mo.byte_position(1) == 5 * sizeof(wchar_t) && mo.byte_length(1) == 5 * sizeof(wchar_t));
+
+		std::u16string us = u"a1b22";
+		size_t total = 0;
+		rex::u16regex ure(std::u16string(u"\\d+"));
+		for (rex::u16sregex_offset_iterator it(us.begin(), us.end(), ure), end; it != end; ++it) {
+			total += it->length(0);
+		}
+		TEST_ASSERT(total == 3);
+		std::cout << "  Test 5 passed: wide characters" << std::endl;
+	}
+
+	std::cout << "All match_offsets tests passed." << std::endl;
+	return 0;
+}
@@ -0,0 +1,189 @@
+// memory_resource_test.cpp --- Tests for onigpp::memory_resource and onigpp::arena_resource
+// Author: katahiromz
+// License: BSD-2-Clause
+
+#include "../onigpp.h"
+#include <iostream>
+#include <cassert>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <thread>
+
+// Helper macro for test assertions
+#define TEST_ASSERT(cond) do { \
+	if (!(cond)) { \
+		std::cerr << "FAIL: " << #cond << " at line " << __LINE__ << std::endl; \
+		return 1; \
+	} \
+} while(0)
+
+namespace rex = onigpp;
+
+// Counts the allocations it passes on to new_delete_resource()
+class counting_resource : public rex::memory_resource {
+public:
+	size_t allocations = 0;
+	size_t live = 0;
+
+protected:
+	void* do_allocate(size_t bytes, size_t alignment) override {
+		++allocations;
+		++live;
+		return rex::new_delete_resource()->allocate(bytes, alignment);
+	}
+	void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+		--live;
+		rex::new_delete_resource()->deallocate(p, bytes, alignment);
+	}
+};
+
+int main() {
+	rex::auto_init init;
+
+	std::cout << "Testing onigpp::memory_resource..." << std::endl;
+
+	// Test 1: Thread resource and scopes
+	{
+		TEST_ASSERT(rex::get_thread_memory_resource() == rex::new_delete_resource());
+		counting_resource outer, inner;
+		{
+			rex::memory_resource_scope scope(&outer);
+			TEST_ASSERT(rex::get_thread_memory_resource() == &outer);
+			{
+				rex::memory_resource_scope nested(&inner);
+				TEST_ASSERT(rex::get_thread_memory_resource() == &inner);
+			}
+			TEST_ASSERT(rex::get_thread_memory_resource() == &outer);
+
+			// Other threads keep the default resource
+			rex::memory_resource* seen = nullptr;
+			std::thread t([&seen] { seen = rex::get_thread_memory_resource(); });
+			t.join();
+			TEST_ASSERT(seen == rex::new_delete_resource());
+		}
+		TEST_ASSERT(rex::get_thread_memory_resource() == rex::new_delete_resource());
+		TEST_ASSERT(rex::set_thread_memory_resource(nullptr) == rex::new_delete_resource());
+		std::cout << "  Test 1 passed: thread resource" << std::endl;
+	}
+
+	// Test 2: Temporary allocations go to the thread resource
+	{
+		rex::regex re(std::string("b{2,}"));
+		std::string s = "a long subject: aabbbcc";
+		std::list<char> l(s.begin(), s.end());
+		rex::match_results<std::list<char>::iterator> m;
+
+		counting_resource counter;
+		{
+			rex::memory_resource_scope scope(&counter);
+			TEST_ASSERT(rex::regex_search(l.begin(), l.end(), m, re));
+		}
+		TEST_ASSERT(m.str() == "bbb");
+		TEST_ASSERT(counter.allocations > 0); // The copy of the list
+		TEST_ASSERT(counter.live == 0);
+
+		// Contiguous subjects are searched in place
+		counting_resource none;
+		{
+			rex::memory_resource_scope scope(&none);
+			rex::smatch sm;
+			TEST_ASSERT(rex::regex_search(s, sm, re));
+		}
+		TEST_ASSERT(none.allocations == 0);
+
+		// Pattern preprocessing; the compiled program outlives the scope
+		counting_resource patterns;
+		rex::regex* ml = nullptr;
+		{
+			rex::memory_resource_scope scope(&patterns);
+			ml = new rex::regex(std::string("^\\x62+$"), rex::regex::ECMAScript | rex::regex::multiline);
+		}
+		TEST_ASSERT(patterns.allocations > 0);
+		TEST_ASSERT(patterns.live == 0);
+		rex::smatch sm;
+		std::string lines = "a\nbb\nc";
+		TEST_ASSERT(rex::regex_search(lines, sm, *ml));
+		TEST_ASSERT(sm.str() == "bb");
+		delete ml;
+		std::cout << "  Test 2 passed: temporary allocations" << std::endl;
+	}
+
+	// Test 3: Arena
+	{
+		rex::arena_resource arena(256);
+		TEST_ASSERT(arena.capacity() == 0);
+		void* a = arena.allocate(10, 1);
+		void* b = arena.allocate(8, 8);
+		TEST_ASSERT(a != b);
+		TEST_ASSERT(reinterpret_cast<std::uintptr_t>(b) % 8 == 0);
+		void* c = arena.allocate(64, 64);
+		TEST_ASSERT(reinterpret_cast<std::uintptr_t>(c) % 64 == 0);
+		TEST_ASSERT(arena.bytes_allocated() == 82);
+
+		// Larger than a block
+		char* big = static_cast<char*>(arena.allocate(10000, 1));
+		big[0] = big[9999] = 'x';
+		const size_t capacity = arena.capacity();
+		TEST_ASSERT(capacity > 10000);
+
+		arena.release();
+		TEST_ASSERT(arena.bytes_allocated() == 0);
+		TEST_ASSERT(arena.capacity() > 10000 && arena.capacity() <= capacity);
+		const size_t kept = arena.capacity();
+		for (int i = 0; i < 100; ++i) arena.allocate(100);
+		TEST_ASSERT(arena.capacity() == kept); // The kept block is reused
+
+		// Searches within an arena scope, released between requests
+		std::string s = "one two three (longer than a small string)";
+		std::list<char> l(s.begin(), s.end());
+		rex::regex word(std::string("\\w+"));
+		for (int request = 0; request < 5; ++request) {
+			arena.release();
+			rex::memory_resource_scope scope(&arena);
+			size_t count = 0;
+			typedef rex::regex_iterator<std::list<char>::iterator> list_iterator;
+			for (list_iterator it(l.begin(), l.end(), word), end; it != end; ++it) ++count;
+			TEST_ASSERT(count == 8);
+			rex::match_results<std::list<char>::iterator> m;
+			TEST_ASSERT(rex::regex_search(l.begin(), l.end(), m, word));
+			TEST_ASSERT(arena.bytes_allocated() > 0);
+		}
+		TEST_ASSERT(arena.capacity() == kept);
+		std::cout << "  Test 3 passed: arena" << std::endl;
+	}
+
+	// Test 4: match_results with resource_allocator
+	{
+		typedef rex::resource_allocator<rex::sub_match<std::string::const_iterator>> allocator;
+		rex::arena_resource arena;
+		rex::match_results<std::string::const_iterator, allocator> m{allocator(&arena)};
+		TEST_ASSERT(m.get_allocator().resource() == &arena);
+
+		rex::regex re(std::string("(\\d+)-(\\d+)"));
+		std::string s = "tel 03-1234";
+		TEST_ASSERT(rex::regex_search(s, m, re));
+		TEST_ASSERT(m.str(1) == "03" && m.str(2) == "1234");
+		TEST_ASSERT(arena.bytes_allocated() >= 3 * sizeof(rex::ssub_match));
+		TEST_ASSERT(rex::regex_match(std::string("1-2"), m, re));
+
+		typedef rex::resource_allocator<rex::sub_match<const char*>> pointer_allocator;
+		rex::match_results<const char*, pointer_allocator> pm{pointer_allocator(&arena)};
+		TEST_ASSERT(rex::regex_search("x 5-6", pm, re));
+		TEST_ASSERT(pm.str(0) == "5-6");
+
+		// Default construction takes the thread resource
+		counting_resource counter;
+		{
+			rex::memory_resource_scope scope(&counter);
+			TEST_ASSERT(allocator().resource() == &counter);
+			TEST_ASSERT(allocator() == allocator(&counter));
+		}
+		TEST_ASSERT(allocator() != allocator(&counter));
+		TEST_ASSERT(allocator() == allocator(nullptr));
+		std::cout << "  Test 4 passed: resource_allocator" << std::endl;
+	}
+
+	std::cout << "All memory_resource tests passed." << std::endl;
+	return 0;
+}
@@ -240,6 +240,57 @@ void TestVectorStillWorks() {
 	TEST_CASE_END("TestVectorStillWorks")
 }
 
+// -----------------------------------------------------------------
+// 7. Test enumerating many matches in a long std::list
+// -----------------------------------------------------------------
+
+void TestListRegexIteratorManyMatches() {
+	TEST_CASE("TestListRegexIteratorManyMatches")
+
+	std::string subject_str;
+	for (int i = 0; i < 20000; ++i) {
+		if (i > 0) subject_str += ";";
+		subject_str += "k" + std::to_string(i % 97) + "=v" + std::to_string(i);
+	}
+	std::list<char> subject_list(subject_str.begin(), subject_str.end());
+
+#ifdef USE_STD_FOR_TESTS
+	rex::regex re("(\\d)=v(\\d+)"); // std::regex has no lookbehind
+#else
+	// The lookbehind group lies before the position the search starts from
+	rex::regex re("(?<=(\\d)=)v(\\d+)");
+#endif
+
+	using list_iter = std::list<char>::iterator;
+	rex::sregex_iterator sit(subject_str.begin(), subject_str.end(), re), send;
+	rex::regex_iterator<list_iter, char> it(subject_list.begin(), subject_list.end(), re), end;
+	rex::regex_iterator<list_iter, char> copy;
+
+	size_t count = 0;
+	for (; it != end && sit != send; ++it, ++sit) {
+		assert(it->size() == sit->size());
+		assert(std::string((*it)[0].first, (*it)[0].second) == sit->str(0));
+		assert(std::string((*it)[1].first, (*it)[1].second) == sit->str(1));
+		assert(std::string((*it)[2].first, (*it)[2].second) == sit->str(2));
+		if (++count == 100) copy = it;
+	}
+	assert(count == 20000);
+	assert(it == end && sit == send);
+
+	// A copy continues on its own
+	++copy;
+	assert(std::string((*copy)[2].first, (*copy)[2].second) == "100");
+
+	// regex_token_iterator walks the list the same way
+	rex::regex sep(";");
+	rex::regex_token_iterator<list_iter> tit(subject_list.begin(), subject_list.end(), sep, -1), tend;
+	size_t tokens = 0;
+	for (; tit != tend; ++tit) ++tokens;
+	assert(tokens == 20000);
+
+	TEST_CASE_END("TestListRegexIteratorManyMatches")
+}
+
 // =================================================================
 // Main function
 // =================================================================
@@ -261,6 +312,7 @@ int main() {
 	TestEmptyListRegexSearch();
 	TestDequeCaptureGroups();
 	TestVectorStillWorks();
+	TestListRegexIteratorManyMatches();
 
 	std::cout << "\n========================================\n";
 	std::cout << "All tests PASSED!\n";
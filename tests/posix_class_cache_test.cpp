@@ -0,0 +1,123 @@
+// posix_class_cache_test.cpp --- Tests for cached POSIX class expansion in collate mode
+// Author: katahiromz
+// License: BSD-2-Clause
+
+#include "../onigpp.h"
+#include <iostream>
+#include <cassert>
+#include <locale>
+#include <string>
+
+// Helper macro for test assertions
+#define TEST_ASSERT(cond) do { \
+	if (!(cond)) { \
+		std::cerr << "FAIL: " << #cond << " at line " << __LINE__ << std::endl; \
+		return 1; \
+	} \
+} while(0)
+
+namespace rex = onigpp;
+
+static const char* const class_names[] = {
+	"digit", "alpha", "alnum", "space", "upper", "lower",
+	"punct", "xdigit", "cntrl", "print", "graph",
+};
+static const std::ctype_base::mask class_masks[] = {
+	std::ctype_base::digit, std::ctype_base::alpha, std::ctype_base::alnum,
+	std::ctype_base::space, std::ctype_base::upper, std::ctype_base::lower,
+	std::ctype_base::punct, std::ctype_base::xdigit, std::ctype_base::cntrl,
+	std::ctype_base::print, std::ctype_base::graph,
+};
+
+// Build the pattern "[[:name:]]" (or "[^[:name:]]") for any character type
+template <class CharT>
+static std::basic_string<CharT> class_pattern(const char* name, bool negate = false) {
+	std::string s = std::string(negate ? "[^" : "[") + "[:" + name + ":]]";
+	return std::basic_string<CharT>(s.begin(), s.end());
+}
+
+// Whole-string match for any character type
+template <class CharT>
+static bool full_match(const std::basic_string<CharT>& s, const rex::basic_regex<CharT>& re) {
+	rex::match_results<typename std::basic_string<CharT>::const_iterator> m;
+	return rex::regex_match(s, m, re);
+}
+
+int main() {
+	rex::auto_init init;
+
+	std::cout << "Testing cached POSIX class expansion..." << std::endl;
+
+	// Test 1: Every class agrees with std::ctype<char> on ASCII, including bracket syntax characters
+	{
+		const std::ctype<char>& ct = std::use_facet<std::ctype<char>>(std::locale::classic());
+		for (int k = 0; k < 11; ++k) {
+			rex::regex re(class_pattern<char>(class_names[k]), rex::regex_constants::collate);
+			rex::regex neg(class_pattern<char>(class_names[k], true), rex::regex_constants::collate);
+			for (int c = 1; c < 0x80; ++c) {
+				const std::string s(1, char(c));
+				bool expected = ct.is(class_masks[k], char(c));
+				TEST_ASSERT(full_match(s, re) == expected);
+				TEST_ASSERT(full_match(s, neg) == !expected);
+			}
+		}
+		rex::regex punct(std::string("[[:punct:]]+"), rex::regex_constants::collate);
+		TEST_ASSERT(full_match(std::string("]\\[-^{}"), punct));
+		std::cout << "  Test 1 passed: char classes match std::ctype" << std::endl;
+	}
+
+	// Test 2: Classes combine with other bracket members and repeated compiles stay consistent
+	{
+		for (int i = 0; i < 100; ++i) {
+			rex::regex re(std::string("^[_[:alpha:]][_[:alnum:]]*$"), rex::regex_constants::collate);
+			TEST_ASSERT(full_match(std::string("_name42"), re));
+			TEST_ASSERT(!full_match(std::string("4name"), re));
+			TEST_ASSERT(!full_match(std::string("na-me"), re));
+		}
+		std::cout << "  Test 2 passed: combined members" << std::endl;
+	}
+
+	// Test 3: Wide characters beyond Latin, classified by the imbued locale
+	{
+		std::locale loc;
+		bool have_utf8 = true;
+		try {
+			loc = std::locale("C.UTF-8");
+		} catch (const std::runtime_error&) {
+			have_utf8 = false;
+		}
+		if (have_utf8) {
+			const std::ctype<wchar_t>& ct = std::use_facet<std::ctype<wchar_t>>(loc);
+			const wchar_t samples[] = { L'a', L'Z', L'7', L' ', L'-', 0x00E9, 0x0416, 0x3042, 0x4E00, 0xFF21, 0x3000 };
+			for (int k = 0; k < 11; ++k) {
+				rex::wregex re(class_pattern<wchar_t>(class_names[k]), rex::regex_constants::collate);
+				re.imbue(loc);
+				for (wchar_t ch : samples) {
+					TEST_ASSERT(full_match(std::wstring(1, ch), re) == ct.is(class_masks[k], ch));
+				}
+			}
+			std::cout << "  Test 3 passed: wide classes follow the locale" << std::endl;
+		} else {
+			std::cout << "  Test 3 skipped: C.UTF-8 locale not available" << std::endl;
+		}
+	}
+
+	// Test 4: char16_t and char32_t use the wide classification
+	{
+		rex::u16regex digits16(class_pattern<char16_t>("digit") + u"+", rex::regex_constants::collate);
+		TEST_ASSERT(full_match(std::u16string(u"2024"), digits16));
+		TEST_ASSERT(!full_match(std::u16string(u"20x4"), digits16));
+
+		rex::u32regex upper32(class_pattern<char32_t>("upper"), rex::regex_constants::collate);
+		TEST_ASSERT(full_match(std::u32string(U"Q"), upper32));
+		TEST_ASSERT(!full_match(std::u32string(U"q"), upper32));
+
+		rex::u32regex notspace32(class_pattern<char32_t>("space", true) + U"+", rex::regex_constants::collate);
+		TEST_ASSERT(full_match(std::u32string(U"a-b"), notspace32));
+		TEST_ASSERT(!full_match(std::u32string(U"a b"), notspace32));
+		std::cout << "  Test 4 passed: char16_t and char32_t" << std::endl;
+	}
+
+	std::cout << "All POSIX class cache tests passed." << std::endl;
+	return 0;
+}
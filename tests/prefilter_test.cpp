@@ -0,0 +1,182 @@
+// prefilter_test.cpp --- Tests for the literal prefilter (regex_constants::optimize)
+// Author: katahiromz
+// License: BSD-2-Clause
+
+#include "../onigpp.h"
+#include <iostream>
+#include <cassert>
+#include <string>
+#include <vector>
+
+// Helper macro for test assertions
+#define TEST_ASSERT(cond) do { \
+	if (!(cond)) { \
+		std::cerr << "FAIL: " << #cond << " at line " << __LINE__ << std::endl; \
+		return 1; \
+	} \
+} while(0)
+
+namespace rex = onigpp;
+
+// All matches as "position:text" strings
+static std::vector<std::string> matches(const std::string& s, const rex::regex& re,
+                                        rex::regex_constants::match_flag_type flags = rex::regex_constants::match_default)
+{
+	std::vector<std::string> result;
+	for (rex::sregex_iterator it(s.begin(), s.end(), re, flags), end; it != end; ++it)
+		result.push_back(std::to_string(it->position()) + ":" + it->str());
+	return result;
+}
+
+int main() {
+	rex::auto_init init;
+
+	std::cout << "Testing the literal prefilter..." << std::endl;
+
+	// Test 1: Same results as without optimize
+	{
+		const char* patterns[] = {
+			"if|else|while", "return", "(?:int|long) \\w+", "(struct|union)\\s+(\\w+)",
+			"\\bfor\\b", "^#include", "x\\+\\+|y--", "ab?c|abd", "ca+t|dog", "\\.\\.\\.",
+			"(?<kw>do|done)\\b", "é|ü",
+		};
+		const char* subjects[] = {
+			"", "if (x) return y; else while (1) {}", "int main; long count; short s",
+			"struct  point p; union u", "for(;;) fork forfor for", "#include <x>\n#include <y>",
+			"x++ + y-- - z", "ac abc abd abbc", "caat dog ct", "wait... ok..", "do it, done, doer",
+			"naïve café über",
+		};
+		const rex::regex_constants::match_flag_type flag_sets[] = {
+			rex::regex_constants::match_default,
+			rex::regex_constants::match_not_bol,
+			rex::regex_constants::match_not_bow | rex::regex_constants::match_not_eow,
+			rex::regex_constants::match_not_null,
+		};
+		for (const char* p : patterns) {
+			rex::regex plain{std::string(p)};
+			rex::regex fast{std::string(p), rex::regex::ECMAScript | rex::regex::optimize};
+			TEST_ASSERT(fast.prefilter_active());
+			TEST_ASSERT(!plain.prefilter_active());
+			for (const char* s : subjects) {
+				for (auto flags : flag_sets) {
+					TEST_ASSERT(matches(s, fast, flags) == matches(s, plain, flags));
+					TEST_ASSERT(rex::regex_test(std::string(s), fast, flags) == rex::regex_test(std::string(s), plain, flags));
+					TEST_ASSERT(rex::regex_count(std::string(s), fast, flags) == rex::regex_count(std::string(s), plain, flags));
+				}
+			}
+		}
+
+		// Searches starting inside the subject
+		rex::regex fast(std::string("(?:cat|car)s?"), rex::regex::optimize);
+		std::string s = "a cat, two cars";
+		rex::smatch m;
+		TEST_ASSERT(rex::regex_search(s.cbegin() + 3, s.cend(), m, fast));
+		TEST_ASSERT(m.str() == "cars" && m.position() == 8);
+		TEST_ASSERT(rex::regex_match(std::string("cats"), m, fast));
+		TEST_ASSERT(!rex::regex_match(std::string("dogs"), m, fast));
+		std::cout << "  Test 1 passed: same results as without optimize" << std::endl;
+	}
+
+	// Test 2: Patterns without a prefilter
+	{
+		const char* patterns[] = {
+			"\\d+", "[ab]c", "(?:x)?y", "a*b", "(?i)abc", "(?=ab)a", "abc|", ".x", "(?<=a)b", "\\x41",
+		};
+		for (const char* p : patterns) {
+			rex::regex re{std::string(p), rex::regex::optimize};
+			TEST_ASSERT(!re.prefilter_active());
+		}
+		TEST_ASSERT(!rex::regex(std::string("abc"), rex::regex::optimize | rex::regex::icase).prefilter_active());
+		TEST_ASSERT(!rex::regex(std::string("abc"), rex::regex::optimize | rex::regex::extended).prefilter_active());
+
+		// Matches found past many failed candidates
+		rex::regex re(std::string("aaa+b"), rex::regex::optimize);
+		TEST_ASSERT(re.prefilter_active());
+		std::string s = std::string(1000, 'a') + "b";
+		rex::smatch m;
+		TEST_ASSERT(rex::regex_search(s, m, re) && m.position() == 0 && m.length() == 1001);
+		std::string sparse;
+		for (int i = 0; i < 100; ++i) sparse += "aa ";
+		sparse += "aaab";
+		TEST_ASSERT(rex::regex_search(sparse, m, re) && m.position() == 300);
+
+		// Stacked quantifiers make the literal optional
+		const char* stacked[] = { "x+*", "c+??", "a+?*\\d", "(?:ab)+*", "ab+*c", "ab+?c", "(?:ab)+?c", "xy+{0,2}z" };
+		const char* stacked_subjects[] = { "", "cxc", "A1", "a1 aa2", "ac abc abbc", "abab c ababc", "xz xyyz" };
+		for (const char* p : stacked) {
+			rex::regex plain{std::string(p)};
+			rex::regex fast{std::string(p), rex::regex::optimize};
+			for (const char* subject : stacked_subjects)
+				TEST_ASSERT(matches(subject, fast) == matches(subject, plain));
+		}
+		TEST_ASSERT(!rex::regex(std::string("x+*"), rex::regex::optimize).prefilter_active());
+		TEST_ASSERT(!rex::regex(std::string("(?:ab)+*"), rex::regex::optimize).prefilter_active());
+		TEST_ASSERT(matches("cxc", rex::regex(std::string("x+*"), rex::regex::optimize)) ==
+			(std::vector<std::string>{ "0:", "1:x", "2:", "3:" }));
+		TEST_ASSERT(matches("A1", rex::regex(std::string("a+*\\d"), rex::regex::optimize)) ==
+			(std::vector<std::string>{ "1:1" }));
+		std::cout << "  Test 2 passed: patterns without a prefilter" << std::endl;
+	}
+
+	// Test 3: Rejections are counted
+	{
+		rex::set_regex_stats_enabled(true);
+		rex::regex re(std::string("ERROR|FATAL"), rex::regex::optimize);
+		TEST_ASSERT(!rex::regex_test(std::string("all is well"), re));
+		TEST_ASSERT(rex::regex_test(std::string("FATAL: disk"), re));
+		TEST_ASSERT(!rex::regex_test(std::string("ERRORS are FATALITIES"), rex::regex(std::string("ERROR$|FATAL$"), rex::regex::optimize)));
+		rex::regex_stats st = re.stats();
+		TEST_ASSERT(st.searches == 2);
+		TEST_ASSERT(st.prefilter_rejections == 1);
+		re.reset_stats();
+		TEST_ASSERT(re.stats().prefilter_rejections == 0);
+		rex::set_regex_stats_enabled(false);
+		std::cout << "  Test 3 passed: rejections" << std::endl;
+	}
+
+	// Test 4: Regex sets
+	{
+		rex::regex_set set;
+		set.add(std::string("GET|POST"), rex::regex::optimize);
+		set.add(std::string("HTTP/\\d"), rex::regex::optimize);
+		TEST_ASSERT(set.prefilter_active());
+
+		rex::smatch m;
+		std::string line = "  POST /index HTTP/1.1";
+		TEST_ASSERT(rex::regex_set_search(line, m, set) == 0);
+		TEST_ASSERT(m.str() == "POST" && m.position() == 2);
+		TEST_ASSERT(rex::regex_set_search(std::string("x HTTP/2"), m, set) == 1);
+		TEST_ASSERT(rex::regex_set_search(std::string("nothing here"), m, set) == -1);
+		TEST_ASSERT(m.ready());
+
+		rex::regex_set copy(set);
+		TEST_ASSERT(copy.prefilter_active());
+		set.add(std::string("\\d+"));
+		TEST_ASSERT(!set.prefilter_active());
+		TEST_ASSERT(rex::regex_set_search(std::string("nothing 42"), m, set) == 2);
+		set.clear();
+		TEST_ASSERT(!set.prefilter_active());
+		std::cout << "  Test 4 passed: regex sets" << std::endl;
+	}
+
+	// Test 5: Wide characters
+	{
+		rex::wregex fast(std::wstring(L"東京|大阪"), rex::wregex::optimize);
+		rex::wregex plain(std::wstring(L"東京|大阪"));
+		TEST_ASSERT(fast.prefilter_active());
+		std::wstring s = L"から東京へ、大阪まで";
+		rex::wsmatch a, b;
+		TEST_ASSERT(rex::regex_search(s, a, fast) && rex::regex_search(s, b, plain));
+		TEST_ASSERT(a.position() == b.position() && a.str() == L"東京");
+		TEST_ASSERT(rex::regex_count(s, fast) == 2);
+		TEST_ASSERT(!rex::regex_test(std::wstring(L"名古屋"), fast));
+
+		rex::u16regex u16(std::u16string(u"ab|cd"), rex::u16regex::optimize);
+		TEST_ASSERT(u16.prefilter_active());
+		TEST_ASSERT(rex::regex_count(std::u16string(u"xxcdab"), u16) == 2);
+		std::cout << "  Test 5 passed: wide characters" << std::endl;
+	}
+
+	std::cout << "All prefilter tests passed." << std::endl;
+	return 0;
+}
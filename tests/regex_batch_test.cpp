@@ -0,0 +1,138 @@
+// regex_batch_test.cpp --- Tests for onigpp::regex_search_batch and regex_match_batch
+// Author: katahiromz
+// License: BSD-2-Clause
+
+#include "../onigpp.h"
+#include <iostream>
+#include <cassert>
+#include <string>
+#include <vector>
+
+// Helper macro for test assertions
+#define TEST_ASSERT(cond) do { \
+	if (!(cond)) { \
+		std::cerr << "FAIL: " << #cond << " at line " << __LINE__ << std::endl; \
+		return 1; \
+	} \
+} while(0)
+
+namespace rex = onigpp;
+
+int main() {
+	rex::auto_init init;
+
+	std::cout << "Testing onigpp::regex_search_batch..." << std::endl;
+
+	std::vector<std::string> subjects;
+	for (int i = 0; i < 5000; ++i) {
+		switch (i % 4) {
+		case 0: subjects.push_back("Mozilla/5.0 (X11; Linux x86_64) Firefox/" + std::to_string(i)); break;
+		case 1: subjects.push_back("/api/v" + std::to_string(i % 3) + "/items/" + std::to_string(i)); break;
+		case 2: subjects.push_back(""); break;
+		default: subjects.push_back("curl/" + std::to_string(i)); break;
+		}
+	}
+	rex::regex re(std::string("(\\w+)/(\\d+)(\\.\\d+)?"));
+
+	rex::batch_options parallel;
+	parallel.threads = 4;
+	parallel.grain = 37;
+
+	// Test 1: bool results agree with regex_search, serially and in parallel
+	{
+		std::vector<bool> matched;
+		size_t n = rex::regex_search_batch(subjects.begin(), subjects.end(), matched, re);
+		TEST_ASSERT(matched.size() == subjects.size());
+		size_t expected = 0;
+		for (size_t i = 0; i < subjects.size(); ++i) {
+			rex::smatch m;
+			bool found = rex::regex_search(subjects[i], m, re);
+			TEST_ASSERT(matched[i] == found);
+			expected += found;
+		}
+		TEST_ASSERT(n == expected && n > 0 && n < subjects.size());
+
+		std::vector<bool> matched_parallel;
+		TEST_ASSERT(rex::regex_search_batch(subjects.begin(), subjects.end(), matched_parallel, re,
+		                                    rex::regex_constants::match_default, parallel) == n);
+		TEST_ASSERT(matched_parallel == matched);
+		std::cout << "  Test 1 passed: bool results" << std::endl;
+	}
+
+	// Test 2: offsets and match_results
+	{
+		std::vector<rex::match_offsets> offsets;
+		std::vector<rex::cmatch> results;
+		size_t n1 = rex::regex_search_batch(subjects.begin(), subjects.end(), offsets, re,
+		                                    rex::regex_constants::match_default, parallel);
+		size_t n2 = rex::regex_search_batch(subjects.begin(), subjects.end(), results, re);
+		TEST_ASSERT(n1 == n2);
+		for (size_t i = 0; i < subjects.size(); ++i) {
+			rex::smatch m;
+			bool found = rex::regex_search(subjects[i], m, re);
+			TEST_ASSERT(offsets[i].ready() && results[i].ready());
+			TEST_ASSERT(offsets[i].matched() == found);
+			TEST_ASSERT(!results[i].empty() == found);
+			if (!found) continue;
+			TEST_ASSERT(results[i].size() == m.size());
+			for (size_t k = 0; k < m.size(); ++k) {
+				TEST_ASSERT(results[i][k].matched == m[k].matched);
+				TEST_ASSERT(results[i].str(k) == m.str(k));
+				TEST_ASSERT(offsets[i].matched(k) == m[k].matched);
+				if (m[k].matched) {
+					TEST_ASSERT(offsets[i].position(k) == size_t(m.position(k)));
+					TEST_ASSERT(results[i][k].first == subjects[i].data() + m.position(k));
+				}
+			}
+		}
+
+		// Reusing the result vectors: failed subjects do not keep old groups
+		std::vector<std::string> others = { "none", "wget/2" };
+		TEST_ASSERT(rex::regex_search_batch(others.begin(), others.end(), results, re) == 1);
+		TEST_ASSERT(results.size() == 2 && results[0].empty() && results[1].str(2) == "2");
+		std::cout << "  Test 2 passed: offsets and match_results" << std::endl;
+	}
+
+	// Test 3: regex_match_batch and C strings
+	{
+		const char* paths[] = { "/api/v1/items/7", "/api/v1/items/7/extra", "/api/v22/items/x", "/api/v0/items/0" };
+		rex::regex route(std::string("/api/v(\\d)/items/(\\d+)"));
+		std::vector<bool> matched;
+		TEST_ASSERT(rex::regex_match_batch(paths, paths + 4, matched, route) == 2);
+		for (size_t i = 0; i < 4; ++i) {
+			std::string path(paths[i]);
+			rex::smatch m;
+			TEST_ASSERT(matched[i] == rex::regex_match(path, m, route));
+		}
+
+		std::vector<rex::match_offsets> offsets;
+		TEST_ASSERT(rex::regex_match_batch(paths, paths + 4, offsets, route) == 2);
+		TEST_ASSERT(offsets[0].position(2) == 14 && !offsets[1].matched());
+
+		std::vector<rex::cmatch> results;
+		TEST_ASSERT(rex::regex_match_batch(paths, paths + 4, results, route, rex::regex_constants::match_default, parallel) == 2);
+		TEST_ASSERT(results[3].str(1) == "0" && results[2].empty());
+		std::cout << "  Test 3 passed: regex_match_batch" << std::endl;
+	}
+
+	// Test 4: Match flags and wide strings
+	{
+		std::vector<std::string> words = { "", "a", "b" };
+		rex::regex optional(std::string("a*"));
+		std::vector<bool> matched;
+		TEST_ASSERT(rex::regex_search_batch(words.begin(), words.end(), matched, optional) == 3);
+		TEST_ASSERT(rex::regex_search_batch(words.begin(), words.end(), matched, optional,
+		                                    rex::regex_constants::match_not_null) == 1);
+		TEST_ASSERT(!matched[0] && matched[1] && !matched[2]);
+
+		std::vector<std::wstring> wide = { L"alpha", L"42", L"beta7" };
+		rex::wregex digits(std::wstring(L"\\d+"));
+		std::vector<rex::wcmatch> wresults;
+		TEST_ASSERT(rex::regex_search_batch(wide.begin(), wide.end(), wresults, digits) == 2);
+		TEST_ASSERT(wresults[1].str() == L"42" && wresults[2].str() == L"7");
+		std::cout << "  Test 4 passed: flags and wide strings" << std::endl;
+	}
+
+	std::cout << "All batch tests passed." << std::endl;
+	return 0;
+}
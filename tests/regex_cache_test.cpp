@@ -0,0 +1,131 @@
+// regex_cache_test.cpp --- Tests for onigpp::basic_regex_cache
+// Author: katahiromz
+// License: BSD-2-Clause
+
+#include "../onigpp.h"
+#include <iostream>
+#include <cassert>
+#include <thread>
+
+// Helper macro for test assertions
+#define TEST_ASSERT(cond) do { \
+	if (!(cond)) { \
+		std::cerr << "FAIL: " << #cond << " at line " << __LINE__ << std::endl; \
+		return 1; \
+	} \
+} while(0)
+
+int main() {
+	onigpp::auto_init init;
+
+	std::cout << "Testing onigpp::basic_regex_cache..." << std::endl;
+
+	// Test 1: Hits share the same compiled regex
+	{
+		onigpp::regex_cache cache(4);
+		onigpp::regex_cache::pointer a = cache.get("(\\d+)-(\\d+)");
+		onigpp::regex_cache::pointer b = cache.get("(\\d+)-(\\d+)");
+		TEST_ASSERT(a.get() == b.get());
+		TEST_ASSERT(a->mark_count() == 2);
+		onigpp::regex_cache_stats st = cache.stats();
+		TEST_ASSERT(st.hits == 1 && st.misses == 1 && st.size == 1 && st.capacity == 4);
+
+		onigpp::cmatch m;
+		TEST_ASSERT(onigpp::regex_search("10-20", m, *a));
+		TEST_ASSERT(m[2].str() == "20");
+		std::cout << "  [PASS] Hits share the compiled regex" << std::endl;
+	}
+
+	// Test 2: Flags and encoding are part of the key
+	{
+		onigpp::regex_cache cache(8);
+		onigpp::regex_cache::pointer a = cache.get("abc", onigpp::regex_constants::ECMAScript);
+		onigpp::regex_cache::pointer b = cache.get("abc", onigpp::regex_constants::ECMAScript | onigpp::regex_constants::icase);
+		onigpp::regex_cache::pointer c = cache.get("abc", onigpp::regex_constants::ECMAScript, ONIG_ENCODING_ASCII);
+		onigpp::regex_cache::pointer d = cache.get("abc", onigpp::regex_constants::ECMAScript, ONIG_ENCODING_UTF8);
+		TEST_ASSERT(a.get() != b.get());
+		TEST_ASSERT(a.get() != c.get());
+		TEST_ASSERT(a.get() == d.get()); // UTF-8 is the default encoding for char
+		onigpp::cmatch m;
+		TEST_ASSERT(onigpp::regex_search("ABC", m, *b));
+		TEST_ASSERT(!onigpp::regex_search("ABC", m, *a));
+		std::cout << "  [PASS] Flags and encoding are part of the key" << std::endl;
+	}
+
+	// Test 3: Least recently used entries are evicted
+	{
+		onigpp::regex_cache cache(2);
+		onigpp::regex_cache::pointer a = cache.get("a");
+		cache.get("b");
+		cache.get("a"); // "b" is now the least recently used
+		cache.get("c"); // evicts "b"
+		onigpp::regex_cache_stats st = cache.stats();
+		TEST_ASSERT(st.evictions == 1 && st.size == 2);
+		TEST_ASSERT(cache.get("a").get() == a.get());
+		cache.get("b");
+		st = cache.stats();
+		TEST_ASSERT(st.misses == 4 && st.hits == 2 && st.evictions == 2);
+
+		cache.set_capacity(1);
+		TEST_ASSERT(cache.stats().size == 1);
+		cache.reset_stats();
+		cache.clear();
+		st = cache.stats();
+		TEST_ASSERT(st.hits == 0 && st.misses == 0 && st.evictions == 0 && st.size == 0);
+
+		// The evicted regex stays valid while someone holds it
+		onigpp::cmatch m;
+		TEST_ASSERT(onigpp::regex_search("xa", m, *a));
+		std::cout << "  [PASS] LRU eviction" << std::endl;
+	}
+
+	// Test 4: Invalid patterns throw and are not cached
+	{
+		onigpp::regex_cache cache(4);
+		bool thrown = false;
+		try {
+			cache.get("(unclosed");
+		} catch (const onigpp::regex_error&) {
+			thrown = true;
+		}
+		TEST_ASSERT(thrown);
+		TEST_ASSERT(cache.stats().size == 0);
+		std::cout << "  [PASS] Invalid patterns are not cached" << std::endl;
+	}
+
+	// Test 5: Wide characters and the process-wide instance
+	{
+		onigpp::wregex_cache::pointer w = onigpp::wregex_cache::global().get(L"\\w+");
+		onigpp::wsmatch m;
+		std::wstring subject = L"  word";
+		TEST_ASSERT(onigpp::regex_search(subject, m, *w));
+		TEST_ASSERT(m.str() == L"word");
+		TEST_ASSERT(onigpp::wregex_cache::global().get(L"\\w+").get() == w.get());
+		std::cout << "  [PASS] Process-wide wide-character cache" << std::endl;
+	}
+
+	// Test 6: Concurrent lookups
+	{
+		onigpp::regex_cache cache(16);
+		std::vector<std::thread> threads;
+		for (int t = 0; t < 4; ++t) {
+			threads.emplace_back([&cache]() {
+				for (int i = 0; i < 200; ++i) {
+					std::string pattern = "p" + std::to_string(i % 8);
+					onigpp::regex_cache::pointer re = cache.get(pattern);
+					onigpp::smatch m;
+					std::string subject = "x" + pattern;
+					onigpp::regex_search(subject, m, *re);
+				}
+			});
+		}
+		for (auto& th : threads) th.join();
+		onigpp::regex_cache_stats st = cache.stats();
+		TEST_ASSERT(st.hits + st.misses == 800);
+		TEST_ASSERT(st.size == 8);
+		std::cout << "  [PASS] Concurrent lookups" << std::endl;
+	}
+
+	std::cout << "All regex cache tests passed." << std::endl;
+	return 0;
+}
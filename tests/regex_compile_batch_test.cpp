@@ -0,0 +1,120 @@
+// regex_compile_batch_test.cpp --- Tests for onigpp::regex_compile_batch
+// Author: katahiromz
+// License: BSD-2-Clause
+
+#include "../onigpp.h"
+#include <iostream>
+#include <cassert>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Helper macro for test assertions
+#define TEST_ASSERT(cond) do { \
+	if (!(cond)) { \
+		std::cerr << "FAIL: " << #cond << " at line " << __LINE__ << std::endl; \
+		return 1; \
+	} \
+} while(0)
+
+namespace rex = onigpp;
+namespace rc = rex::regex_constants;
+
+int main() {
+	rex::auto_init init;
+
+	std::cout << "Testing onigpp::regex_compile_batch..." << std::endl;
+
+	// Test 1: Each entry gets its own result; bad patterns do not stop the batch
+	{
+		std::vector<rex::regex_compile_entry<char>> entries;
+		for (int i = 0; i < 3000; ++i) {
+			if (i % 100 == 99)
+				entries.emplace_back("rule" + std::to_string(i) + "(");
+			else
+				entries.emplace_back("rule" + std::to_string(i) + "=(\\d+)");
+		}
+		rex::compile_batch_options options;
+		options.threads = 4;
+		auto results = rex::regex_compile_batch(entries, options);
+		TEST_ASSERT(results.size() == entries.size());
+
+		std::string expected_message;
+		rc::error_type expected_code = rc::error_escape;
+		try {
+			rex::regex bad(entries[99].pattern);
+		} catch (const rex::regex_error& e) {
+			expected_code = e.code();
+			expected_message = e.what();
+		}
+
+		size_t ok = 0;
+		for (size_t i = 0; i < results.size(); ++i) {
+			if (i % 100 == 99) {
+				TEST_ASSERT(!results[i].ok);
+				TEST_ASSERT(results[i].code == expected_code);
+				TEST_ASSERT(results[i].message == expected_message);
+				TEST_ASSERT(results[i].onig_code < 0);
+				TEST_ASSERT(results[i].regex.mark_count() == 0);
+			} else {
+				TEST_ASSERT(results[i].ok);
+				++ok;
+			}
+		}
+		TEST_ASSERT(ok == 2970);
+
+		rex::smatch m;
+		TEST_ASSERT(rex::regex_search(std::string("x rule1234=56"), m, results[1234].regex));
+		TEST_ASSERT(m[1] == "56");
+
+		std::vector<rex::regex_compile_result<char>> serial(entries.size());
+		options.threads = 1;
+		TEST_ASSERT(rex::regex_compile_batch(entries.data(), entries.size(), serial.data(), options) == 2970);
+		std::cout << "  Test 1 passed: per-entry results" << std::endl;
+	}
+
+	// Test 2: Error details from OnigErrorInfo, flags, encodings and deferred entries
+	{
+		std::vector<rex::regex_compile_entry<char>> entries;
+		entries.emplace_back("(?<x>a)\\k<nosuchgroup>", rc::oniguruma);
+		entries.emplace_back("ABC", rc::ECMAScript | rc::icase, rex::encoding_constants::ASCII);
+		entries.emplace_back("(late)", rc::ECMAScript | rc::deferred);
+		auto results = rex::regex_compile_batch(entries);
+
+		TEST_ASSERT(!results[0].ok);
+		TEST_ASSERT(results[0].onig_code == ONIGERR_UNDEFINED_NAME_REFERENCE);
+		TEST_ASSERT(results[0].message.find("nosuchgroup") != std::string::npos);
+
+		TEST_ASSERT(results[1].ok);
+		rex::smatch m;
+		TEST_ASSERT(rex::regex_search(std::string("xabc"), m, results[1].regex));
+
+		TEST_ASSERT(results[2].ok);
+		TEST_ASSERT(results[2].regex.is_compiled());
+		TEST_ASSERT(results[2].regex.mark_count() == 1);
+		std::cout << "  Test 2 passed: details, flags and encodings" << std::endl;
+	}
+
+	// Test 3: Wide characters, alongside concurrent onigpp::init()
+	{
+		std::vector<rex::regex_compile_entry<char32_t>> entries;
+		for (int i = 0; i < 500; ++i)
+			entries.emplace_back(i % 2 ? U"[\\p{Han}]+" : U"\\p{NoSuchProperty}");
+		std::thread other([]() {
+			for (int i = 0; i < 50; ++i) rex::init();
+		});
+		auto results = rex::regex_compile_batch(entries);
+		other.join();
+		for (size_t i = 0; i < results.size(); ++i) {
+			TEST_ASSERT(results[i].ok == (i % 2 == 1));
+		}
+		rex::match_results<std::u32string::const_iterator> m;
+		const std::u32string text = U"abc漢字def";
+		TEST_ASSERT(rex::regex_search(text, m, results[1].regex));
+		TEST_ASSERT(m.length(0) == 2);
+		std::cout << "  Test 3 passed: wide characters and init" << std::endl;
+	}
+
+	std::cout << "All regex_compile_batch tests passed." << std::endl;
+	return 0;
+}
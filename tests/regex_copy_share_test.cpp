@@ -0,0 +1,96 @@
+// regex_copy_share_test.cpp --- Tests for sharing compiled programs between basic_regex copies
+// Author: katahiromz
+// License: BSD-2-Clause
+
+#include "../onigpp.h"
+#include <iostream>
+#include <cassert>
+#include <thread>
+#include <atomic>
+
+// Helper macro for test assertions
+#define TEST_ASSERT(cond) do { \
+	if (!(cond)) { \
+		std::cerr << "FAIL: " << #cond << " at line " << __LINE__ << std::endl; \
+		return 1; \
+	} \
+} while(0)
+
+int main() {
+	onigpp::auto_init init;
+	onigpp::cmatch cm;
+
+	std::cout << "Testing compiled program sharing..." << std::endl;
+
+	// Test 1: Copies keep pattern, flags and results
+	{
+		onigpp::regex re(std::string("(\\w+)@(\\w+)"), onigpp::regex_constants::ECMAScript | onigpp::regex_constants::icase);
+		onigpp::regex copy(re);
+		onigpp::regex assigned;
+		assigned = re;
+		TEST_ASSERT(copy.pattern() == re.pattern());
+		TEST_ASSERT(copy.flags() == re.flags());
+		TEST_ASSERT(assigned.mark_count() == 2);
+
+		onigpp::smatch m;
+		std::string s = "mail: USER@host";
+		TEST_ASSERT(onigpp::regex_search(s, m, copy));
+		TEST_ASSERT(m[2].str() == "host");
+		std::cout << "  [PASS] Copies behave like the original" << std::endl;
+	}
+
+	// Test 2: Copies outlive the original
+	{
+		onigpp::regex* re = new onigpp::regex("a+b");
+		onigpp::regex copy(*re);
+		delete re;
+		TEST_ASSERT(onigpp::regex_search("xaab", cm, copy));
+		std::cout << "  [PASS] Copy outlives the original" << std::endl;
+	}
+
+	// Test 3: Assignment on one copy does not affect the others
+	{
+		onigpp::regex re("cat");
+		onigpp::regex copy(re);
+		copy = onigpp::regex("dog");
+		TEST_ASSERT(re.pattern() == "cat");
+		TEST_ASSERT(onigpp::regex_search("a cat", cm, re));
+		TEST_ASSERT(!onigpp::regex_search("a cat", cm, copy));
+		std::cout << "  [PASS] Assignment makes a new program" << std::endl;
+	}
+
+	// Test 4: imbue on a copy keeps the original usable
+	{
+		onigpp::regex re(std::string("[[:alpha:]]+"), onigpp::regex_constants::ECMAScript | onigpp::regex_constants::collate);
+		onigpp::regex copy(re);
+		copy.imbue(std::locale::classic());
+		TEST_ASSERT(onigpp::regex_search("123abc", cm, re));
+		TEST_ASSERT(onigpp::regex_search("123abc", cm, copy));
+		std::cout << "  [PASS] imbue on a copy" << std::endl;
+	}
+
+	// Test 5: Copies searched concurrently from several threads
+	{
+		onigpp::regex re("(\\d+)-(\\d+)");
+		std::atomic<int> found(0);
+		std::vector<std::thread> threads;
+		for (int t = 0; t < 4; ++t) {
+			onigpp::regex copy(re);
+			threads.emplace_back([copy, &found]() {
+				onigpp::smatch m;
+				std::string s = "range 10-20 and 30-40";
+				for (int i = 0; i < 1000; ++i) {
+					onigpp::regex local(copy);
+					if (onigpp::regex_search(s, m, local) && m[2].str() == "20")
+						++found;
+				}
+			});
+		}
+		for (auto& th : threads) th.join();
+		TEST_ASSERT(found == 4000);
+		std::cout << "  [PASS] Concurrent use of copies" << std::endl;
+	}
+
+	std::cout << "All program sharing tests passed." << std::endl;
+	return 0;
+}
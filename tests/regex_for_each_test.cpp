@@ -0,0 +1,165 @@
+// regex_for_each_test.cpp --- Tests for onigpp::regex_for_each
+// Author: katahiromz
+// License: BSD-2-Clause
+
+#include "../onigpp.h"
+#include "allocation_counter.h"
+#include <iostream>
+#include <cassert>
+#include <string>
+#include <vector>
+
+// Helper macro for test assertions
+#define TEST_ASSERT(cond) do { \
+	if (!(cond)) { \
+		std::cerr << "FAIL: " << #cond << " at line " << __LINE__ << std::endl; \
+		return 1; \
+	} \
+} while(0)
+
+namespace rex = onigpp;
+
+// All matches of regex_iterator as "position:text" strings
+static std::vector<std::string> iterator_matches(const std::string& s, const rex::regex& re,
+                                                 rex::regex_constants::match_flag_type flags = rex::regex_constants::match_default)
+{
+	std::vector<std::string> result;
+	for (rex::sregex_iterator it(s.begin(), s.end(), re, flags), end; it != end; ++it)
+		result.push_back(std::to_string(it->position()) + ":" + it->str());
+	return result;
+}
+
+// The same with regex_for_each
+static std::vector<std::string> visited_matches(const std::string& s, const rex::regex& re,
+                                                rex::regex_constants::match_flag_type flags = rex::regex_constants::match_default)
+{
+	std::vector<std::string> result;
+	size_t count = rex::regex_for_each(s, re, [&](const rex::match_view& m) {
+		result.push_back(std::to_string(m.position()) + ":" + m.str());
+	}, flags);
+	if (count != result.size()) result.push_back("count mismatch");
+	return result;
+}
+
+int main() {
+	rex::auto_init init;
+
+	std::cout << "Testing onigpp::regex_for_each..." << std::endl;
+
+	// Test 1: Same matches as regex_iterator
+	{
+		const char* patterns[] = { "\\w+", "a*", "x*", "\\b", "(?=a)", "^", "$", "ab|b", "é+" };
+		const char* subjects[] = { "", "abc", "aaa baa", "xaxxa", "héé é", "a\nb" };
+		const rex::regex_constants::match_flag_type flag_sets[] = {
+			rex::regex_constants::match_default,
+			rex::regex_constants::match_not_null,
+			rex::regex_constants::match_not_bol | rex::regex_constants::match_not_eol,
+			rex::regex_constants::match_not_bow,
+		};
+		for (const char* p : patterns) {
+			rex::regex re{std::string(p)};
+			for (const char* s : subjects)
+				for (auto flags : flag_sets)
+					TEST_ASSERT(visited_matches(s, re, flags) == iterator_matches(s, re, flags));
+		}
+		std::cout << "  Test 1 passed: same matches as regex_iterator" << std::endl;
+	}
+
+	// Test 2: Groups
+	{
+		const std::string s = "a=1, bc=, d=42";
+		rex::regex re(std::string("(\\w+)=(\\d+)?"));
+		std::vector<std::string> found;
+		bool ok = true;
+		rex::regex_for_each(s, re, [&](const rex::match_view& m) {
+			ok = ok && m.size() == 3 && m.data(1) == s.data() + m.position(1);
+			found.push_back(m.str(1) + "|" + (m.matched(2) ? m.str(2) : "-"));
+		});
+		TEST_ASSERT(ok);
+		TEST_ASSERT(found == (std::vector<std::string>{ "a|1", "bc|-", "d|42" }));
+
+		// Unmatched and out-of-range groups
+		rex::regex_for_each(s, re, [&](const rex::match_view& m) {
+			if (m.position() == 5) {
+				ok = ok && m.position(2) == rex::match_view::npos && m.length(2) == 0 && m.data(2) == nullptr;
+				ok = ok && !m.matched(3) && m.str(3).empty();
+			}
+		});
+		TEST_ASSERT(ok);
+
+		// nosubs reports the whole match only
+		rex::regex nosubs(std::string("(\\w+)=(\\d+)?"), rex::regex_constants::ECMAScript | rex::regex_constants::nosubs);
+		rex::regex_for_each(s, nosubs, [&](const rex::match_view& m) { ok = ok && m.size() == 1; });
+		TEST_ASSERT(ok);
+		std::cout << "  Test 2 passed: groups" << std::endl;
+	}
+
+	// Test 3: Stopping early
+	{
+		const std::string s = "1 2 3 4 5";
+		rex::regex re(std::string("\\d"));
+		std::string seen;
+		size_t count = rex::regex_for_each(s, re, [&](const rex::match_view& m) -> bool {
+			seen += m.str();
+			return seen.size() < 3;
+		});
+		TEST_ASSERT(count == 3 && seen == "123");
+
+		// A function object that is not copied
+		struct last_match {
+			size_t position = rex::match_view::npos;
+			void operator()(const rex::match_view& m) { position = m.position(); }
+		} visitor;
+		TEST_ASSERT(rex::regex_for_each(s, re, visitor) == 5);
+		TEST_ASSERT(visitor.position == 8);
+
+		// Nested searches in the visitor
+		rex::regex digit(std::string("\\d"));
+		size_t nested = 0;
+		rex::regex_for_each(s, rex::regex(std::string("\\d \\d")), [&](const rex::match_view& m) {
+			nested += rex::regex_count(m.data(), m.data() + m.length(), digit);
+		});
+		TEST_ASSERT(nested == 4);
+		std::cout << "  Test 3 passed: stopping early" << std::endl;
+	}
+
+	// Test 4: No allocation per match
+	{
+		std::string s;
+		for (int i = 0; i < 1000; ++i) s += "key" + std::to_string(i) + "=value; ";
+		rex::regex re(std::string("(\\w+)=(\\w+)"));
+		size_t total = 0;
+		auto visitor = [&](const rex::match_view& m) { total += m.length(1) + m.length(2); };
+		rex::regex_for_each(s, re, visitor); // warms up the per-thread region
+		total = 0;
+		g_allocations = 0;
+		TEST_ASSERT(rex::regex_for_each(s, re, visitor) == 1000);
+		TEST_ASSERT(g_allocations == 0);
+		TEST_ASSERT(total > 0);
+		std::cout << "  Test 4 passed: no allocation per match" << std::endl;
+	}
+
+	// Test 5: Wide characters
+	{
+		std::wstring ws = L"東京と京都";
+		std::vector<size_t> positions;
+		rex::regex_for_each(ws, rex::wregex(std::wstring(L"京")), [&](const rex::wmatch_view& m) { positions.push_back(m.position()); });
+		TEST_ASSERT(positions == (std::vector<size_t>{ 1, 3 }));
+
+		std::u16string s16 = u"𝄞a𝄞b";
+		std::u16string joined;
+		rex::regex_for_each(s16, rex::u16regex(std::u16string(u"𝄞.")), [&](const rex::u16match_view& m) {
+			if (m.length() == 3) joined += m.str();
+		});
+		TEST_ASSERT(joined == s16);
+
+		std::u32string s32 = U"x1y22";
+		size_t count = rex::regex_for_each(s32.data(), s32.data() + s32.size(), rex::u32regex(std::u32string(U"\\d+")),
+			[](const rex::u32match_view&) { });
+		TEST_ASSERT(count == 2);
+		std::cout << "  Test 5 passed: wide characters" << std::endl;
+	}
+
+	std::cout << "All regex_for_each tests passed." << std::endl;
+	return 0;
+}
@@ -0,0 +1,110 @@
+// regex_format_test.cpp --- Tests for onigpp::basic_regex_format
+// Author: katahiromz
+// License: BSD-2-Clause
+
+#include "../onigpp.h"
+#include <iostream>
+#include <cassert>
+#include <string>
+
+// Helper macro for test assertions
+#define TEST_ASSERT(cond) do { \
+	if (!(cond)) { \
+		std::cerr << "FAIL: " << #cond << " at line " << __LINE__ << std::endl; \
+		return 1; \
+	} \
+} while(0)
+
+namespace rex = onigpp;
+
+int main() {
+	rex::auto_init init;
+
+	std::cout << "Testing onigpp::basic_regex_format..." << std::endl;
+
+	const std::string text = "alpha=1, beta=22, gamma=333";
+	rex::regex re(std::string("(\\w+)=(\\d+)"));
+
+	// Test 1: Same output as regex_replace with the format string
+	{
+		const char* formats[] = {
+			"$2:$1", "[$&]", "$$", "<$`>", "<$'>", "${1}-${2}", "$9", "$", "${", "${}", "a\\nb\\tc\\\\", "\\q$x",
+		};
+		for (const char* f : formats) {
+			std::string fmt(f);
+			rex::regex_format compiled(fmt, re);
+			TEST_ASSERT(rex::regex_replace(text, re, compiled) == rex::regex_replace(text, re, fmt));
+		}
+		TEST_ASSERT(rex::regex_replace(text, re, rex::regex_format(std::string("$2:$1"), re)) ==
+		            "1:alpha, 22:beta, 333:gamma");
+		std::cout << "  Test 1 passed: matches regex_replace with a format string" << std::endl;
+	}
+
+	// Test 2: Named groups are resolved when the format is built
+	{
+		rex::regex named(std::string("(?<key>\\w+)=(?<value>\\d+)"));
+		rex::regex_format compiled(std::string("${value}<-${key}${missing}"), named);
+		TEST_ASSERT(rex::regex_replace(text, named, compiled) == "1<-alpha, 22<-beta, 333<-gamma");
+
+		// Without a regex, names cannot be resolved and produce nothing
+		rex::regex_format unresolved(std::string("${key}!"));
+		TEST_ASSERT(rex::regex_replace(std::string("a=1"), named, unresolved) == "!");
+		std::cout << "  Test 2 passed: named groups" << std::endl;
+	}
+
+	// Test 3: Oniguruma mode backreferences
+	{
+		rex::regex onig(std::string("(?<key>\\w+)=(\\d+)"), rex::regex::oniguruma);
+		rex::regex_format compiled(std::string("\\k<key>/\\k'key'/\\1\\\\"), onig);
+		TEST_ASSERT(rex::regex_replace(std::string("x=5"), onig, compiled) == "x/x/x\\");
+		TEST_ASSERT(rex::regex_replace(std::string("x=5"), onig, compiled) ==
+		            rex::regex_replace(std::string("x=5"), onig, std::string("\\k<key>/\\k'key'/\\1\\\\")));
+		std::cout << "  Test 3 passed: oniguruma mode" << std::endl;
+	}
+
+	// Test 4: Format flags
+	{
+		std::string fmt("[$1]");
+		rex::regex_format literal(fmt, re, rex::regex_constants::format_literal);
+		TEST_ASSERT(literal.is_literal());
+		TEST_ASSERT(rex::regex_replace(std::string("a=1 b=2"), re, literal, rex::regex_constants::format_literal) ==
+		            "[$1] [$1]");
+
+		rex::regex_format compiled(fmt, re);
+		TEST_ASSERT(!compiled.is_literal());
+		TEST_ASSERT(rex::regex_replace(std::string("a=1 b=2"), re, compiled, rex::regex_constants::format_first_only) ==
+		            "[a] b=2");
+		TEST_ASSERT(rex::regex_replace(std::string("a=1 b=2"), re, compiled, rex::regex_constants::format_no_copy) ==
+		            "[a][b]");
+		std::cout << "  Test 4 passed: format flags" << std::endl;
+	}
+
+	// Test 5: match_results::format and reuse across subjects
+	{
+		rex::regex_format compiled(std::string("$2/$1"), re);
+		rex::smatch m;
+		std::string s1 = "k=7", s2 = "zz=42";
+		TEST_ASSERT(rex::regex_search(s1, m, re));
+		TEST_ASSERT(m.format(compiled) == "7/k");
+		TEST_ASSERT(rex::regex_search(s2, m, re));
+		TEST_ASSERT(m.format(compiled) == "42/zz");
+		TEST_ASSERT(m.format(compiled) == m.format(std::string("$2/$1")));
+
+		rex::regex_format empty;
+		TEST_ASSERT(empty.is_literal());
+		TEST_ASSERT(m.format(empty).empty());
+		std::cout << "  Test 5 passed: match_results::format" << std::endl;
+	}
+
+	// Test 6: Wide characters
+	{
+		rex::wregex wre(std::wstring(L"(\\w+)@(\\w+)"));
+		rex::wregex_format compiled(std::wstring(L"$2 at $1"), wre);
+		TEST_ASSERT(rex::regex_replace(std::wstring(L"me@host, you@there"), wre, compiled) ==
+		            L"host at me, there at you");
+		std::cout << "  Test 6 passed: wide characters" << std::endl;
+	}
+
+	std::cout << "All basic_regex_format tests passed." << std::endl;
+	return 0;
+}
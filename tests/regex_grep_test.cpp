@@ -0,0 +1,153 @@
+// regex_grep_test.cpp --- Tests for onigpp::regex_grep
+// Author: katahiromz
+// License: BSD-2-Clause
+
+#include "../onigpp.h"
+#include <iostream>
+#include <cassert>
+#include <string>
+#include <vector>
+
+// Helper macro for test assertions
+#define TEST_ASSERT(cond) do { \
+	if (!(cond)) { \
+		std::cerr << "FAIL: " << #cond << " at line " << __LINE__ << std::endl; \
+		return 1; \
+	} \
+} while(0)
+
+namespace rex = onigpp;
+
+// The lines as "number:text", with '-' instead of ':' for context lines
+static std::vector<std::string> lines(const std::string& s, const std::vector<rex::grep_line>& found) {
+	std::vector<std::string> result;
+	for (const rex::grep_line& line : found)
+		result.push_back(std::to_string(line.number) + (line.selected ? ":" : "-") + s.substr(line.offset, line.length));
+	return result;
+}
+
+int main() {
+	rex::auto_init init;
+
+	std::cout << "Testing onigpp::regex_grep..." << std::endl;
+
+	const std::string text =
+		"alpha\n"
+		"beta error\n"
+		"gamma\n"
+		"delta\n"
+		"error: epsilon\n"
+		"zeta\n"
+		"eta\n"
+		"theta error";
+
+	// Test 1: Selected lines
+	{
+		rex::regex re(std::string("error"));
+		std::vector<rex::grep_line> found;
+		TEST_ASSERT(rex::regex_grep(found, text, re) == 3);
+		TEST_ASSERT(lines(text, found) == (std::vector<std::string>{ "2:beta error", "5:error: epsilon", "8:theta error" }));
+		TEST_ASSERT(rex::regex_grep_count(text, re) == 3);
+
+		// Anchors apply to each line; no match spans two lines
+		found.clear();
+		TEST_ASSERT(rex::regex_grep(found, text, rex::regex(std::string("^\\w+a$"))) == 5);
+		TEST_ASSERT(rex::regex_grep_count(text, rex::regex(std::string("\\Aerror"))) == 1);
+		TEST_ASSERT(rex::regex_grep_count(text, rex::regex(std::string("error\\s+\\w"))) == 0);
+		TEST_ASSERT(rex::regex_grep_count(text, rex::regex(std::string("^$"))) == 0);
+
+		// Empty lines and the last newline
+		std::string blank = "a\n\nb\n";
+		TEST_ASSERT(rex::regex_grep_count(blank, rex::regex(std::string("^$"))) == 1);
+		TEST_ASSERT(rex::regex_grep_count(blank, rex::regex(std::string(""))) == 3);
+		TEST_ASSERT(rex::regex_grep_count(std::string(), rex::regex(std::string(""))) == 0);
+		std::cout << "  Test 1 passed: selected lines" << std::endl;
+	}
+
+	// Test 2: Invert and max count
+	{
+		rex::regex re(std::string("error"));
+		rex::grep_options options;
+		options.invert = true;
+		std::vector<rex::grep_line> found;
+		TEST_ASSERT(rex::regex_grep(found, text, re, options) == 5);
+		TEST_ASSERT(found[0].number == 1 && found[4].number == 7);
+
+		options.invert = false;
+		options.max_count = 2;
+		found.clear();
+		TEST_ASSERT(rex::regex_grep(found, text, re, options) == 2);
+		TEST_ASSERT(found.back().number == 5);
+		TEST_ASSERT(rex::regex_grep_count(text, re, options) == 2);
+		std::cout << "  Test 2 passed: invert and max count" << std::endl;
+	}
+
+	// Test 3: Context lines
+	{
+		rex::regex re(std::string("error"));
+		rex::grep_options options;
+		options.before_context = 1;
+		options.after_context = 1;
+		std::vector<rex::grep_line> found;
+		TEST_ASSERT(rex::regex_grep(found, text, re, options) == 3);
+		TEST_ASSERT(lines(text, found) == (std::vector<std::string>{
+			"1-alpha", "2:beta error", "3-gamma", "4-delta", "5:error: epsilon", "6-zeta", "7-eta", "8:theta error" }));
+
+		options.before_context = 2;
+		options.after_context = 0;
+		found.clear();
+		rex::regex_grep(found, text, rex::regex(std::string("^(gamma|eta)$")), options);
+		TEST_ASSERT(lines(text, found) == (std::vector<std::string>{
+			"1-alpha", "2-beta error", "3:gamma", "5-error: epsilon", "6-zeta", "7:eta" }));
+
+		// After context of the last selected line with max count
+		options.before_context = 0;
+		options.after_context = 2;
+		options.max_count = 1;
+		found.clear();
+		TEST_ASSERT(rex::regex_grep(found, text, re, options) == 1);
+		TEST_ASSERT(lines(text, found) == (std::vector<std::string>{ "2:beta error", "3-gamma", "4-delta" }));
+		std::cout << "  Test 3 passed: context lines" << std::endl;
+	}
+
+	// Test 4: Throughput and buffers
+	{
+		std::string big;
+		for (int i = 0; i < 1000; ++i) big += (i % 10 == 0) ? "WARN disk\n" : "INFO ok\n";
+		rex::regex re(std::string("WARN|ERROR"), rex::regex::ECMAScript | rex::regex::optimize);
+		rex::grep_stats st;
+		rex::grep_options options;
+		options.stats = &st;
+		TEST_ASSERT(rex::regex_grep_count(big.data(), big.data() + big.size(), re, options) == 100);
+		TEST_ASSERT(st.lines == 1000 && st.selected == 100);
+		TEST_ASSERT(st.bytes == big.size());
+		TEST_ASSERT(st.lines_per_second() >= 0.0 && st.bytes_per_second() >= 0.0);
+
+		// Stops reading at max count
+		options.max_count = 1;
+		TEST_ASSERT(rex::regex_grep_count(big, re, options) == 1);
+		TEST_ASSERT(st.lines == 1 && st.bytes == 10);
+
+		std::vector<rex::grep_line> found;
+		found.reserve(200);
+		const void* data = found.data();
+		rex::regex_grep(found, big, re);
+		TEST_ASSERT(found.size() == 100 && found.data() == data);
+		TEST_ASSERT(found[1].number == 11 && found[1].offset == 10 + 9 * 8);
+		std::cout << "  Test 4 passed: throughput" << std::endl;
+	}
+
+	// Test 5: Wide characters
+	{
+		std::wstring s = L"一行目\n二行目 エラー\n三行目";
+		rex::wregex re(std::wstring(L"エラー$"));
+		std::vector<rex::grep_line> found;
+		TEST_ASSERT(rex::regex_grep(found, s, re) == 1);
+		TEST_ASSERT(found[0].number == 2 && s.substr(found[0].offset, found[0].length) == L"二行目 エラー");
+		TEST_ASSERT(rex::regex_grep_count(std::u16string(u"a\nb\na"), rex::u16regex(std::u16string(u"a"))) == 2);
+		std::cout << "  Test 5 passed: wide characters" << std::endl;
+	}
+
+	std::cout << "All regex_grep tests passed." << std::endl;
+	return 0;
+}
@@ -0,0 +1,167 @@
+// regex_parallel_search_test.cpp --- Tests for onigpp::regex_search_all_parallel
+// Author: katahiromz
+// License: BSD-2-Clause
+
+#include "../onigpp.h"
+#include <iostream>
+#include <cassert>
+#include <vector>
+
+// Helper macro for test assertions
+#define TEST_ASSERT(cond) do { \
+	if (!(cond)) { \
+		std::cerr << "FAIL: " << #cond << " at line " << __LINE__ << std::endl; \
+		return 1; \
+	} \
+} while(0)
+
+// Compare the parallel result with the serial regex_iterator loop
+template <class CharT>
+static bool same_as_serial(const std::basic_string<CharT>& s,
+                           const onigpp::basic_regex<CharT>& re,
+                           const onigpp::parallel_search_options<CharT>& options)
+{
+	typedef typename std::basic_string<CharT>::const_iterator string_iterator;
+	typedef onigpp::regex_iterator<string_iterator, CharT> iterator;
+	const CharT* first = s.data();
+	const CharT* last = s.data() + s.size();
+
+	std::vector<onigpp::match_results<const CharT*>> matches =
+		onigpp::regex_search_all_parallel(first, last, re, options);
+
+	size_t i = 0;
+	for (iterator it(s.begin(), s.end(), re), end; it != end; ++it, ++i) {
+		if (i >= matches.size()) return false;
+		if (matches[i].size() != it->size()) return false;
+		for (size_t k = 0; k < it->size(); ++k) {
+			if (matches[i][k].matched != (*it)[k].matched) return false;
+			if (!(*it)[k].matched) continue;
+			if (matches[i][k].first - first != (*it)[k].first - s.begin()) return false;
+			if (matches[i][k].second - first != (*it)[k].second - s.begin()) return false;
+		}
+	}
+	return i == matches.size();
+}
+
+int main() {
+	onigpp::auto_init init;
+
+	std::cout << "Testing onigpp::regex_search_all_parallel..." << std::endl;
+
+	std::string text;
+	for (int i = 0; i < 200; ++i) {
+		text += "line " + std::to_string(i) + ": foo=bar aaaaaaaaaaaa x-y-z;\n";
+	}
+
+	const char* patterns[] = {
+		"\\w+",
+		"a*",
+		"a{7,}",
+		"(\\w+)=(\\w+)",
+		"x.*?z",
+		"(?<=-)y",
+		"\\bfoo\\b",
+		"\\d+(?=:)",
+		"^line",
+		"",
+		"\\Gline",
+	};
+
+	// Test 1: Tiny chunks and several threads give the serial matches
+	{
+		onigpp::parallel_search_options<char> options;
+		options.chunk_size = 7;
+		options.threads = 4;
+		for (const char* pattern : patterns) {
+			onigpp::regex re{std::string(pattern)};
+			TEST_ASSERT(same_as_serial(text, re, options));
+		}
+		std::cout << "  [PASS] Fixed-size chunks" << std::endl;
+	}
+
+	// Test 2: Chunks split after newlines
+	{
+		onigpp::parallel_search_options<char> options;
+		options.chunk_size = 100;
+		options.threads = 3;
+		options.split_at_boundary = true;
+		for (const char* pattern : patterns) {
+			onigpp::regex re{std::string(pattern)};
+			TEST_ASSERT(same_as_serial(text, re, options));
+		}
+		std::cout << "  [PASS] Boundary-aligned chunks" << std::endl;
+	}
+
+	// Test 3: Limited right context
+	{
+		onigpp::parallel_search_options<char> options;
+		options.chunk_size = 64;
+		options.threads = 4;
+		options.overlap = 64;
+		for (const char* pattern : patterns) {
+			onigpp::regex re{std::string(pattern)};
+			TEST_ASSERT(same_as_serial(text, re, options));
+		}
+		std::cout << "  [PASS] Overlapping windows" << std::endl;
+	}
+
+	// Test 4: Default options and the std::string overload
+	{
+		onigpp::regex re(std::string("\\d+"));
+		std::vector<onigpp::cmatch> matches = onigpp::regex_search_all_parallel(text, re);
+		TEST_ASSERT(matches.size() == 200);
+		TEST_ASSERT(matches[0].str() == "0");
+		TEST_ASSERT(matches[199].str() == "199");
+		std::cout << "  [PASS] Default options" << std::endl;
+	}
+
+	// Test 5: Empty buffer and no matches
+	{
+		onigpp::parallel_search_options<char> options;
+		options.chunk_size = 4;
+		options.threads = 2;
+		onigpp::regex re(std::string("q"));
+		TEST_ASSERT(onigpp::regex_search_all_parallel(text, re, options).empty());
+		std::string empty;
+		onigpp::regex any(std::string("x*"));
+		TEST_ASSERT(onigpp::regex_search_all_parallel(empty, any, options).size() == 1);
+		std::cout << "  [PASS] Empty input" << std::endl;
+	}
+
+	// Test 6: Wide characters
+	{
+		std::wstring wtext;
+		for (int i = 0; i < 50; ++i) wtext += L"あいう 123 えお\n";
+		onigpp::parallel_search_options<wchar_t> options;
+		options.chunk_size = 5;
+		options.threads = 4;
+		onigpp::wregex re(std::wstring(L"[あ-お]+"));
+		TEST_ASSERT(same_as_serial(wtext, re, options));
+		std::cout << "  [PASS] Wide characters" << std::endl;
+	}
+
+	// Test 7: Chunks without matches do not scan the rest of the buffer
+	{
+		std::string sparse(1000000, 'b');
+		sparse += "q";
+		onigpp::parallel_search_options<char> options;
+		options.chunk_size = 1000;
+		options.threads = 4;
+		onigpp::regex re(std::string("q"));
+		onigpp::set_regex_stats_enabled(true);
+		std::vector<onigpp::cmatch> matches = onigpp::regex_search_all_parallel(sparse, re, options);
+		onigpp::set_regex_stats_enabled(false);
+		TEST_ASSERT(matches.size() == 1);
+		TEST_ASSERT(matches[0].position() == 1000000);
+		TEST_ASSERT(re.stats().bytes_scanned < 3 * sparse.size());
+
+		// A match may still extend past the window of its chunk
+		onigpp::regex quoted(std::string("\"b+"));
+		std::string text2 = "xx\"" + std::string(5000, 'b') + "\" yy";
+		TEST_ASSERT(same_as_serial(text2, quoted, options));
+		std::cout << "  [PASS] Bounded chunk searches" << std::endl;
+	}
+
+	std::cout << "All parallel search tests passed." << std::endl;
+	return 0;
+}
@@ -0,0 +1,134 @@
+// regex_replace_append_test.cpp --- Tests for onigpp::regex_replace_append
+// Author: katahiromz
+// License: BSD-2-Clause
+
+#include "../onigpp.h"
+#include <iostream>
+#include <cassert>
+#include <iterator>
+#include <string>
+
+// Helper macro for test assertions
+#define TEST_ASSERT(cond) do { \
+	if (!(cond)) { \
+		std::cerr << "FAIL: " << #cond << " at line " << __LINE__ << std::endl; \
+		return 1; \
+	} \
+} while(0)
+
+namespace rex = onigpp;
+
+// regex_replace through an output iterator, for comparison
+static std::string replace_by_iterator(const std::string& s, const rex::regex& re, const std::string& fmt,
+                                       rex::regex_constants::match_flag_type flags = rex::regex_constants::match_default)
+{
+	std::string result;
+	rex::regex_replace(std::back_inserter(result), s.begin(), s.end(), re, fmt, flags);
+	return result;
+}
+
+int main() {
+	rex::auto_init init;
+
+	std::cout << "Testing onigpp::regex_replace_append..." << std::endl;
+
+	// Test 1: Same output as regex_replace, with the replacement count
+	{
+		std::string text = "<a href=\"x\">one</a> & <b>two</b>";
+		rex::regex re(std::string("<[^>]*>|&"));
+		const char* formats[] = { "", "[$&]", "&lt;", "$`|$'" };
+		for (const char* f : formats) {
+			std::string dest;
+			TEST_ASSERT(rex::regex_replace_append(dest, text, re, f) == 5);
+			TEST_ASSERT(dest == replace_by_iterator(text, re, f));
+		}
+
+		std::string dest;
+		rex::regex empty(std::string(""));
+		TEST_ASSERT(rex::regex_replace_append(dest, std::string("abc"), empty, std::string("-")) == 4);
+		TEST_ASSERT(dest == "-a-b-c-");
+
+		dest.clear();
+		TEST_ASSERT(rex::regex_replace_append(dest, std::string("no tags"), re, std::string("!")) == 0);
+		TEST_ASSERT(dest == "no tags");
+		std::cout << "  Test 1 passed: output and count" << std::endl;
+	}
+
+	// Test 2: Appends to existing contents and reuses the destination
+	{
+		rex::regex re(std::string("\\s+"));
+		rex::regex_format fmt(std::string(" "), re);
+		std::string dest = "> ";
+		TEST_ASSERT(rex::regex_replace_append(dest, std::string("a  b\t\tc"), re, fmt) == 2);
+		TEST_ASSERT(dest == "> a b c");
+
+		dest.clear();
+		rex::regex_replace_append(dest, std::string("x    y"), re, fmt);
+		size_t capacity = dest.capacity();
+		const char* data = dest.data();
+		for (int i = 0; i < 10; ++i) {
+			dest.clear();
+			rex::regex_replace_append(dest, std::string("p  q    r"), re, fmt);
+			TEST_ASSERT(dest == "p q r");
+		}
+		TEST_ASSERT(dest.capacity() == capacity);
+		TEST_ASSERT(dest.data() == data);
+		std::cout << "  Test 2 passed: destination reuse" << std::endl;
+	}
+
+	// Test 3: Growing replacements
+	{
+		std::string text;
+		for (int i = 0; i < 1000; ++i) text += "k" + std::to_string(i) + ",";
+		rex::regex re(std::string("k(\\d+)"));
+		std::string dest;
+		TEST_ASSERT(rex::regex_replace_append(dest, text, re, std::string("<key id=\"$1\">$&</key>")) == 1000);
+		TEST_ASSERT(dest == replace_by_iterator(text, re, "<key id=\"$1\">$&</key>"));
+		std::cout << "  Test 3 passed: growing replacements" << std::endl;
+	}
+
+	// Test 4: Format flags
+	{
+		std::string text = "a1 b2 c3";
+		rex::regex re(std::string("(\\w)(\\d)"));
+		const rex::regex_constants::match_flag_type flag_sets[] = {
+			rex::regex_constants::format_first_only,
+			rex::regex_constants::format_no_copy,
+			rex::regex_constants::format_literal,
+		};
+		for (auto flags : flag_sets) {
+			std::string dest;
+			rex::regex_replace_append(dest, text, re, std::string("$2$1"), flags);
+			TEST_ASSERT(dest == replace_by_iterator(text, re, "$2$1", flags));
+		}
+		std::string dest;
+		TEST_ASSERT(rex::regex_replace_append(dest, text, re, "$2$1", rex::regex_constants::format_first_only) == 1);
+		TEST_ASSERT(dest == "1a b2 c3");
+		std::cout << "  Test 4 passed: format flags" << std::endl;
+	}
+
+	// Test 5: Pointer range and wide characters
+	{
+		const wchar_t* text = L"x=1;y=2";
+		rex::wregex re(std::wstring(L"(\\w)=(\\d)"));
+		std::wstring dest;
+		TEST_ASSERT(rex::regex_replace_append(dest, text, text + 7, re, std::wstring(L"$2=$1")) == 2);
+		TEST_ASSERT(dest == L"1=x;2=y");
+		std::cout << "  Test 5 passed: wide characters" << std::endl;
+	}
+
+	// Test 6: One early match on a large subject
+	{
+		const std::string text = "a" + std::string(20000000, 'b');
+		const std::string fmt(1000, 'x');
+		rex::regex re(std::string("a"));
+		std::string dest;
+		TEST_ASSERT(rex::regex_replace_append(dest, text, re, fmt) == 1);
+		TEST_ASSERT(dest.size() == 20001000 && dest.compare(0, 1000, fmt) == 0);
+		TEST_ASSERT(rex::regex_replace(text, re, fmt).size() == 20001000);
+		std::cout << "  Test 6 passed: one early match" << std::endl;
+	}
+
+	std::cout << "All regex_replace_append tests passed." << std::endl;
+	return 0;
+}
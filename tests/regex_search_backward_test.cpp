@@ -0,0 +1,178 @@
+// regex_search_backward_test.cpp --- Tests for onigpp::regex_search_backward and onigpp::regex_reverse_iterator
+// Author: katahiromz
+// License: BSD-2-Clause
+
+#include "../onigpp.h"
+#include <iostream>
+#include <cassert>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// Helper macro for test assertions
+#define TEST_ASSERT(cond) do { \
+	if (!(cond)) { \
+		std::cerr << "FAIL: " << #cond << " at line " << __LINE__ << std::endl; \
+		return 1; \
+	} \
+} while(0)
+
+namespace rex = onigpp;
+
+// All matches as "position:text" strings, from the end
+static std::vector<std::string> reverse_matches(const std::string& s, const rex::regex& re,
+                                                rex::regex_constants::match_flag_type flags = rex::regex_constants::match_default)
+{
+	std::vector<std::string> result;
+	for (rex::sregex_reverse_iterator it(s.begin(), s.end(), re, flags), end; it != end; ++it)
+		result.push_back(std::to_string(it->position()) + ":" + it->str());
+	return result;
+}
+
+// All matches of regex_iterator, reversed
+static std::vector<std::string> forward_matches(const std::string& s, const rex::regex& re) {
+	std::vector<std::string> result;
+	for (rex::sregex_iterator it(s.begin(), s.end(), re), end; it != end; ++it)
+		result.push_back(std::to_string(it->position()) + ":" + it->str());
+	std::reverse(result.begin(), result.end());
+	return result;
+}
+
+int main() {
+	rex::auto_init init;
+
+	std::cout << "Testing onigpp::regex_search_backward..." << std::endl;
+
+	// Test 1: The last match
+	{
+		const std::string s = "one 12, two 345, three 6";
+		rex::regex re(std::string("\\b(\\w+) (\\d+)"));
+		rex::smatch m;
+		TEST_ASSERT(rex::regex_search_backward(s, m, re));
+		TEST_ASSERT(m.position() == 17 && m.str() == "three 6");
+		TEST_ASSERT(m[1].str() == "three" && m[2].str() == "6");
+		TEST_ASSERT(m.prefix().str() == "one 12, two 345, " && m.suffix().str() == "");
+
+		TEST_ASSERT(!rex::regex_search_backward(s, m, rex::regex(std::string("four"))));
+		TEST_ASSERT(m.ready());
+		const std::string empty, aaa = "aaa";
+		TEST_ASSERT(!rex::regex_search_backward(empty, m, re));
+
+		// The match at a position is the forward match there
+		TEST_ASSERT(rex::regex_search_backward(aaa, m, rex::regex(std::string("a+"))));
+		TEST_ASSERT(m.position() == 2 && m.length() == 1);
+
+		// match_continuous is ignored
+		TEST_ASSERT(rex::regex_search_backward(s, m, re, rex::regex_constants::match_continuous));
+		TEST_ASSERT(m.position() == 17);
+		std::cout << "  Test 1 passed: the last match" << std::endl;
+	}
+
+	// Test 2: Searching before a position
+	{
+		const std::string s = "cat catalog cat";
+		rex::regex re(std::string("cat\\w*"));
+		rex::smatch m;
+		TEST_ASSERT(rex::regex_search_backward(s, 12, m, re));
+		TEST_ASSERT(m.position() == 4 && m.str() == "catalog");
+		TEST_ASSERT(m.suffix().str() == " cat");
+
+		// A match running past before is skipped; the context stays
+		TEST_ASSERT(rex::regex_search_backward(s, 10, m, re));
+		TEST_ASSERT(m.position() == 0 && m.str() == "cat");
+		TEST_ASSERT(rex::regex_search_backward(s, 10, m, rex::regex(std::string("\\bcat\\b"))));
+		TEST_ASSERT(m.position() == 0);
+		TEST_ASSERT(rex::regex_search_backward(s, 7, m, rex::regex(std::string("cat(?=alog)"))));
+		TEST_ASSERT(m.position() == 4);
+		TEST_ASSERT(!rex::regex_search_backward(s, 2, m, re));
+
+		// Positions past the end are clamped
+		TEST_ASSERT(rex::regex_search_backward(s, 100, m, re) && m.position() == 12);
+
+		// Iterator form
+		TEST_ASSERT(rex::regex_search_backward(s.begin(), s.begin() + 11, s.end(), m, re));
+		TEST_ASSERT(m.str() == "catalog");
+		std::cout << "  Test 2 passed: searching before a position" << std::endl;
+	}
+
+	// Test 3: Flags
+	{
+		rex::regex re(std::string("x*"));
+		const std::string axxb = "axxb", ab = "ab", words = "ab cd";
+		rex::smatch m;
+		TEST_ASSERT(rex::regex_search_backward(axxb, m, re));
+		TEST_ASSERT(m.position() == 4 && m.length() == 0);
+		TEST_ASSERT(rex::regex_search_backward(axxb, m, re, rex::regex_constants::match_not_null));
+		TEST_ASSERT(m.position() == 2 && m.str() == "x");
+		TEST_ASSERT(!rex::regex_search_backward(ab, m, re, rex::regex_constants::match_not_null));
+
+		rex::regex anchored(std::string("^\\w"));
+		TEST_ASSERT(rex::regex_search_backward(ab, m, anchored) && m.position() == 0);
+		TEST_ASSERT(!rex::regex_search_backward(ab, m, anchored, rex::regex_constants::match_not_bol));
+		rex::regex word(std::string("\\w+\\b"));
+		TEST_ASSERT(rex::regex_search_backward(words, m, word, rex::regex_constants::match_not_eow));
+		TEST_ASSERT(m.position() == 1 && m.str() == "b");
+		std::cout << "  Test 3 passed: flags" << std::endl;
+	}
+
+	// Test 4: Reverse iterator
+	{
+		const std::string words = "alpha beta gamma";
+		// With \b, the matches are those of regex_iterator
+		rex::regex word(std::string("\\b\\w+"));
+		TEST_ASSERT(reverse_matches(words, word) == (std::vector<std::string>{ "11:gamma", "6:beta", "0:alpha" }));
+		TEST_ASSERT(reverse_matches(words, word) == forward_matches(words, word));
+
+		TEST_ASSERT(reverse_matches("axxb", rex::regex(std::string("x*"))) ==
+			(std::vector<std::string>{ "4:", "3:", "2:x", "0:" }));
+		TEST_ASSERT(reverse_matches("aaa", rex::regex(std::string("a*"))) ==
+			(std::vector<std::string>{ "3:", "2:a" }));
+		TEST_ASSERT(reverse_matches("", rex::regex(std::string("a*"))) == (std::vector<std::string>{ "0:" }));
+		TEST_ASSERT(reverse_matches("ab cd", rex::regex(std::string("\\w+"))) ==
+			(std::vector<std::string>{ "4:d", "1:b" }));
+		TEST_ASSERT(reverse_matches("xyz", rex::regex(std::string("q"))).empty());
+
+		const std::string csv = "1,22,,333";
+		rex::regex field(std::string("\\b\\d+"));
+		TEST_ASSERT(reverse_matches(csv, field) == forward_matches(csv, field));
+
+		rex::sregex_reverse_iterator it(csv.begin(), csv.end(), field), end;
+		TEST_ASSERT(it->str() == "333" && it->prefix().str() == "1,22,,");
+		rex::sregex_reverse_iterator copy = it++;
+		TEST_ASSERT(copy->str() == "333" && it->str() == "22" && copy != it);
+
+		const char* p = "a1b2";
+		rex::regex digit(std::string("\\d"));
+		std::vector<std::string> digits;
+		for (rex::cregex_reverse_iterator i(p, p + 4, digit), e; i != e; ++i)
+			digits.push_back(i->str());
+		TEST_ASSERT(digits == (std::vector<std::string>{ "2", "1" }));
+		std::cout << "  Test 4 passed: reverse iterator" << std::endl;
+	}
+
+	// Test 5: Wide characters
+	{
+		std::wstring s = L"東京と京都と東北";
+		rex::wregex re(std::wstring(L"東."));
+		rex::wsmatch m;
+		TEST_ASSERT(rex::regex_search_backward(s, m, re));
+		TEST_ASSERT(m.position() == 6 && m.str() == L"東北");
+		TEST_ASSERT(rex::regex_search_backward(s, 6, m, re) && m.position() == 0);
+
+		std::u16string s16 = u"𝄞a𝄞b";
+		rex::u16smatch m16;
+		TEST_ASSERT(rex::regex_search_backward(s16, m16, rex::u16regex(std::u16string(u"𝄞."))));
+		TEST_ASSERT(m16.position() == 3 && m16.str() == u"𝄞b");
+
+		std::u32string s32 = U"x1y2z3";
+		rex::u32regex digit(std::u32string(U"\\d"));
+		size_t count = 0;
+		for (rex::u32sregex_reverse_iterator it(s32.begin(), s32.end(), digit), end; it != end; ++it)
+			++count;
+		TEST_ASSERT(count == 3);
+		std::cout << "  Test 5 passed: wide characters" << std::endl;
+	}
+
+	std::cout << "All regex_search_backward tests passed." << std::endl;
+	return 0;
+}
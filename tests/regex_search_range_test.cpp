@@ -0,0 +1,155 @@
+// regex_search_range_test.cpp --- Tests for onigpp::regex_search_range
+// Author: katahiromz
+// License: BSD-2-Clause
+
+#include "../onigpp.h"
+#include <iostream>
+#include <cassert>
+#include <string>
+#include <vector>
+
+// Helper macro for test assertions
+#define TEST_ASSERT(cond) do { \
+	if (!(cond)) { \
+		std::cerr << "FAIL: " << #cond << " at line " << __LINE__ << std::endl; \
+		return 1; \
+	} \
+} while(0)
+
+namespace rex = onigpp;
+
+// The match in [start, range] of s as "position:text", or "-"
+static std::string range_match(const std::string& s, size_t start, size_t range, const rex::regex& re,
+                               rex::regex_constants::match_flag_type flags = rex::regex_constants::match_default)
+{
+	rex::smatch m;
+	if (!rex::regex_search_range(s, start, range, m, re, flags)) return "-";
+	return std::to_string(m.position()) + ":" + m.str();
+}
+
+int main() {
+	rex::auto_init init;
+
+	std::cout << "Testing onigpp::regex_search_range..." << std::endl;
+
+	// Test 1: The whole subject as the range is regex_search
+	{
+		const char* patterns[] = { "\\w+", "a*", "\\b", "^", "$", "(?<=a)b", "b(?=c)", "é+", "\\d{2,}" };
+		const char* subjects[] = { "", "abc", "ab bc", "x12 345", "héé é", "a\nbc" };
+		for (const char* p : patterns) {
+			rex::regex re{std::string(p)};
+			for (const char* subject : subjects) {
+				const std::string s = subject;
+				rex::smatch m1, m2;
+				const bool found = rex::regex_search(s, m1, re);
+				TEST_ASSERT(rex::regex_search_range(s, 0, s.size(), m2, re) == found);
+				if (found) TEST_ASSERT(m1.position() == m2.position() && m1.str() == m2.str());
+			}
+		}
+		std::cout << "  Test 1 passed: the whole subject" << std::endl;
+	}
+
+	// Test 2: The context outside the range
+	{
+		// Look-behind, ^ and \b see the characters before start
+		TEST_ASSERT(range_match("xa", 1, 2, rex::regex(std::string("(?<=x)a"))) == "1:a");
+		TEST_ASSERT(range_match("ab", 1, 2, rex::regex(std::string("^b"))) == "-");
+		const rex::regex_constants::syntax_option_type multiline = rex::regex_constants::ECMAScript | rex::regex_constants::multiline;
+		TEST_ASSERT(range_match("a\nb", 2, 3, rex::regex(std::string("^b"), multiline)) == "2:b");
+		TEST_ASSERT(range_match("ab cd", 1, 5, rex::regex(std::string("\\b\\w"))) == "3:c");
+
+		// $, \z and \b see the characters after range
+		TEST_ASSERT(range_match("ab", 0, 1, rex::regex(std::string("a$"))) == "-");
+		TEST_ASSERT(range_match("ab", 0, 1, rex::regex(std::string("a\\z"))) == "-");
+		TEST_ASSERT(range_match("a\nb", 0, 1, rex::regex(std::string("a$"), multiline)) == "0:a");
+		TEST_ASSERT(range_match("ab", 0, 1, rex::regex(std::string("a\\b"))) == "-");
+		TEST_ASSERT(range_match("a b", 0, 1, rex::regex(std::string("a\\b"))) == "0:a");
+
+		// \G matches at start
+		rex::regex anchored(std::string("\\Ga"));
+		TEST_ASSERT(range_match("baa", 1, 3, anchored) == "1:a");
+		TEST_ASSERT(range_match("bba", 1, 3, anchored) == "-");
+		std::cout << "  Test 2 passed: context" << std::endl;
+	}
+
+	// Test 3: The match lies within the range
+	{
+		const std::string s = "abc abc abc";
+		rex::regex re(std::string("abc"));
+		TEST_ASSERT(range_match(s, 0, 2, re) == "-");
+		TEST_ASSERT(range_match(s, 0, 3, re) == "0:abc");
+		TEST_ASSERT(range_match(s, 1, 7, re) == "4:abc");
+		TEST_ASSERT(range_match(s, 5, 10, re) == "-");
+		TEST_ASSERT(range_match(s, 5, 100, re) == "8:abc");
+
+		// Nothing past range is consumed
+		TEST_ASSERT(range_match("aaaa", 0, 2, rex::regex(std::string("a+"))) == "0:aa");
+		TEST_ASSERT(range_match("record1;record2", 0, 7, rex::regex(std::string("[^;]+"))) == "0:record1");
+		TEST_ASSERT(range_match("record1;record2", 8, 11, rex::regex(std::string("\\w+"))) == "8:rec");
+
+		// An empty range only has room for an empty match
+		TEST_ASSERT(range_match("ab", 1, 1, rex::regex(std::string("x*"))) == "1:");
+		TEST_ASSERT(range_match("ab", 1, 1, rex::regex(std::string("b"))) == "-");
+		TEST_ASSERT(range_match("ab", 2, 2, rex::regex(std::string("$"))) == "2:");
+
+		// Positions are clamped
+		TEST_ASSERT(range_match("ab", 5, 1, rex::regex(std::string("$"))) == "2:");
+		std::cout << "  Test 3 passed: the match lies within the range" << std::endl;
+	}
+
+	// Test 4: Flags and results
+	{
+		const std::string s = "key=1; id=22; name=x";
+		rex::regex re(std::string("(\\w+)=(\\d+)"));
+		rex::smatch m;
+		TEST_ASSERT(rex::regex_search_range(s, 3, 13, m, re));
+		TEST_ASSERT(m.position() == 7 && m[1].str() == "id" && m[2].str() == "22");
+		TEST_ASSERT(m.prefix().str() == "key=1; " && m.suffix().str() == "; name=x");
+
+		TEST_ASSERT(range_match(s, 6, 13, re, rex::regex_constants::match_continuous) == "-");
+		TEST_ASSERT(range_match(s, 7, 13, re, rex::regex_constants::match_continuous) == "7:id=22");
+		TEST_ASSERT(range_match("ab", 0, 2, rex::regex(std::string("x*")), rex::regex_constants::match_not_null) == "-");
+
+		rex::regex nosubs(std::string("(\\w+)=(\\d+)"), rex::regex_constants::ECMAScript | rex::regex_constants::nosubs);
+		TEST_ASSERT(rex::regex_search_range(s, 0, s.size(), m, nosubs) && m.size() == 1);
+
+		// A literal prefilter only looks at the range
+		rex::regex optimized(std::string("needle\\d"), rex::regex_constants::ECMAScript | rex::regex_constants::optimize);
+		const std::string hay = "needle1 hay needle2 hay";
+		TEST_ASSERT(range_match(hay, 1, 18, optimized) == "-");
+		TEST_ASSERT(range_match(hay, 1, 19, optimized) == "12:needle2");
+		TEST_ASSERT(range_match(hay, 12, 23, optimized, rex::regex_constants::match_continuous) == "12:needle2");
+		TEST_ASSERT(range_match(hay, 11, 23, optimized, rex::regex_constants::match_continuous) == "-");
+
+		// Iterator form
+		const char* p = "one two three";
+		rex::cmatch cm;
+		TEST_ASSERT(rex::regex_search_range(p, p + 4, p + 9, p + 13, cm, rex::regex(std::string("t\\w+"))));
+		TEST_ASSERT(cm.position() == 4 && cm.str() == "two");
+		TEST_ASSERT(!rex::regex_search_range(p, p + 5, p + 9, p + 13, cm, rex::regex(std::string("\\bt\\w+"))));
+		std::cout << "  Test 4 passed: flags and results" << std::endl;
+	}
+
+	// Test 5: Wide characters
+	{
+		const std::wstring ws = L"東京と京都と東北";
+		rex::wsmatch wm;
+		TEST_ASSERT(rex::regex_search_range(ws, 1, 5, wm, rex::wregex(std::wstring(L"(?<=と)京."))));
+		TEST_ASSERT(wm.position() == 3 && wm.str() == L"京都");
+
+		const std::u16string s16 = u"𝄞a𝄞b";
+		rex::u16smatch m16;
+		TEST_ASSERT(rex::regex_search_range(s16, 2, 6, m16, rex::u16regex(std::u16string(u"𝄞."))));
+		TEST_ASSERT(m16.position() == 3 && m16.str() == u"𝄞b");
+		TEST_ASSERT(!rex::regex_search_range(s16, 2, 5, m16, rex::u16regex(std::u16string(u"𝄞."))));
+
+		const std::u32string s32 = U"x1y22z333";
+		rex::u32smatch m32;
+		TEST_ASSERT(rex::regex_search_range(s32, 2, 9, m32, rex::u32regex(std::u32string(U"\\d{2}"))));
+		TEST_ASSERT(m32.position() == 3);
+		std::cout << "  Test 5 passed: wide characters" << std::endl;
+	}
+
+	std::cout << "All regex_search_range tests passed." << std::endl;
+	return 0;
+}
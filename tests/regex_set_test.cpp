@@ -0,0 +1,189 @@
+// regex_set_test.cpp --- Tests for onigpp::basic_regex_set
+// Author: katahiromz
+// License: BSD-2-Clause
+
+#include "../onigpp.h"
+#include <iostream>
+#include <cassert>
+#include <list>
+
+// Helper macro for test assertions
+#define TEST_ASSERT(cond) do { \
+	if (!(cond)) { \
+		std::cerr << "FAIL: " << #cond << " at line " << __LINE__ << std::endl; \
+		return 1; \
+	} \
+} while(0)
+
+int main() {
+	onigpp::auto_init init;
+
+	std::cout << "Testing onigpp::basic_regex_set..." << std::endl;
+
+	// Test 1: Position lead reports the leftmost match and its regex
+	{
+		onigpp::regex_set set;
+		TEST_ASSERT(set.add(std::string("(\\d+)")) == 0);
+		TEST_ASSERT(set.add(std::string("([a-z]+)@([a-z]+)")) == 1);
+		TEST_ASSERT(set.size() == 2);
+
+		std::string s = "mail bob@host 42";
+		onigpp::smatch m;
+		int index = onigpp::regex_set_search(s, m, set);
+		TEST_ASSERT(index == 1);
+		TEST_ASSERT(m.size() == 3);
+		TEST_ASSERT(m[0].str() == "bob@host");
+		TEST_ASSERT(m[2].str() == "host");
+		TEST_ASSERT(m.position(0) == 5);
+		std::cout << "  [PASS] Position lead" << std::endl;
+	}
+
+	// Test 2: Priority lead prefers the earlier regex
+	{
+		onigpp::regex_set set({onigpp::regex(std::string("\\d+")), onigpp::regex(std::string("[a-z]+"))},
+		                      onigpp::regex_set::priority_lead);
+		std::string s = "abc 123";
+		onigpp::smatch m;
+		TEST_ASSERT(onigpp::regex_set_search(s, m, set) == 0);
+		TEST_ASSERT(m.str() == "123");
+
+		set.set_lead(onigpp::regex_set::regex_lead);
+		TEST_ASSERT(onigpp::regex_set_search(s, m, set) == 1);
+		TEST_ASSERT(m.str() == "abc");
+		std::cout << "  [PASS] Priority and regex lead" << std::endl;
+	}
+
+	// Test 3: No match and empty sets
+	{
+		onigpp::regex_set set;
+		onigpp::cmatch m;
+		TEST_ASSERT(onigpp::regex_set_search("abc", m, set) == -1);
+		set.add(std::string("x"));
+		TEST_ASSERT(onigpp::regex_set_search("abc", m, set) == -1);
+		TEST_ASSERT(m.ready());
+		std::cout << "  [PASS] No match" << std::endl;
+	}
+
+	// Test 4: Iterating over all matches
+	{
+		onigpp::regex_set set;
+		set.add(std::string("\\d+"));
+		set.add(std::string("[A-Z]\\w*"));
+		std::string s = "Alice 12 Bob 7";
+		std::string out;
+		for (onigpp::sregex_set_iterator it(s.begin(), s.end(), set), end; it != end; ++it) {
+			out += std::to_string(it.regex_index()) + ":" + it->str() + " ";
+		}
+		TEST_ASSERT(out == "1:Alice 0:12 1:Bob 0:7 ");
+		std::cout << "  [PASS] Iterator" << std::endl;
+	}
+
+	// Test 5: Copies are independent and the originals stay valid
+	{
+		onigpp::regex digits(std::string("\\d"));
+		onigpp::regex_set set;
+		set.add(digits);
+		onigpp::regex_set copy(set);
+		copy.add(std::string("z"));
+		set.clear();
+		TEST_ASSERT(set.empty());
+		onigpp::cmatch m;
+		TEST_ASSERT(onigpp::regex_set_search("az", m, copy) == 1);
+		TEST_ASSERT(onigpp::regex_search("a1", m, digits));
+		onigpp::regex_set moved(std::move(copy));
+		TEST_ASSERT(moved.size() == 2);
+		TEST_ASSERT(onigpp::regex_set_search("9", m, moved) == 0);
+		std::cout << "  [PASS] Copy, move and clear" << std::endl;
+	}
+
+	// Test 6: match_continuous and nosubs
+	{
+		onigpp::regex_set set;
+		set.add(std::string("b(c)"), onigpp::regex_constants::ECMAScript | onigpp::regex_constants::nosubs);
+		set.add(std::string("a"));
+		onigpp::cmatch m;
+		TEST_ASSERT(onigpp::regex_set_search("xbc", m, set, onigpp::regex_constants::match_continuous) == -1);
+		TEST_ASSERT(onigpp::regex_set_search("bca", m, set, onigpp::regex_constants::match_continuous) == 0);
+		TEST_ASSERT(m.size() == 1);
+		std::cout << "  [PASS] match_continuous and nosubs" << std::endl;
+	}
+
+	// Test 7: Mixed encodings are rejected
+	{
+		onigpp::regex_set set;
+		set.add(std::string("a"));
+		bool thrown = false;
+		try {
+			set.add(std::string("b"), onigpp::regex_constants::ECMAScript, ONIG_ENCODING_ASCII);
+		} catch (const onigpp::regex_error&) {
+			thrown = true;
+		}
+		TEST_ASSERT(thrown);
+		TEST_ASSERT(set.size() == 1);
+		std::cout << "  [PASS] Mixed encodings" << std::endl;
+	}
+
+	// Test 8: Wide characters
+	{
+		onigpp::wregex_set set;
+		set.add(std::wstring(L"あ+"));
+		set.add(std::wstring(L"[0-9]+"));
+		std::wstring s = L"x 12 ああ";
+		onigpp::wsmatch m;
+		TEST_ASSERT(onigpp::regex_set_search(s, m, set) == 1);
+		TEST_ASSERT(m.str() == L"12");
+		std::cout << "  [PASS] Wide characters" << std::endl;
+	}
+
+	// Test 9: Match flags
+	{
+		namespace rc = onigpp::regex_constants;
+		onigpp::regex_set words;
+		words.add(std::string("\\bfoo"));
+		words.add(std::string("bar\\b"));
+		onigpp::cmatch m;
+		TEST_ASSERT(onigpp::regex_set_search("foo bar", m, words) == 0);
+		TEST_ASSERT(onigpp::regex_set_search("foo bar", m, words, rc::match_not_bow) == 1);
+		TEST_ASSERT(m.position() == 4);
+		TEST_ASSERT(onigpp::regex_set_search("foo bar", m, words, rc::match_not_eow) == 0);
+		TEST_ASSERT(onigpp::regex_set_search("foo bar", m, words, rc::match_not_bow | rc::match_not_eow) == -1);
+		words.set_lead(onigpp::regex_set::priority_lead);
+		TEST_ASSERT(onigpp::regex_set_search("foo bar", m, words, rc::match_not_bow) == 1);
+
+		// match_prev_avail reads the character before the subject
+		const std::string text = "xfoo";
+		onigpp::smatch sm;
+		onigpp::regex_set after_x;
+		after_x.add(std::string("(?<=x)foo"));
+		after_x.add(std::string("\\d"));
+		TEST_ASSERT(onigpp::regex_set_search(text.begin() + 1, text.end(), sm, after_x) == -1);
+		TEST_ASSERT(onigpp::regex_set_search(text.begin() + 1, text.end(), sm, after_x, rc::match_prev_avail) == 0);
+		TEST_ASSERT(sm.position() == 0);
+		TEST_ASSERT(sm.str() == "foo");
+		TEST_ASSERT(onigpp::regex_set_search(text.begin() + 1, text.end(), sm, words,
+		                                     rc::match_prev_avail | rc::match_not_bow) == -1);
+		TEST_ASSERT(onigpp::regex_set_search(text.begin() + 1, text.end(), sm, after_x,
+		                                     rc::match_prev_avail | rc::match_continuous) == 0);
+
+		// match_not_null skips the empty matches
+		onigpp::regex_set runs;
+		runs.add(std::string("a*"));
+		runs.add(std::string("b"));
+		TEST_ASSERT(onigpp::regex_set_search("baa", m, runs) == 0);
+		TEST_ASSERT(m.length() == 0);
+		TEST_ASSERT(onigpp::regex_set_search("baa", m, runs, rc::match_not_null) == 1);
+		TEST_ASSERT(m.position() == 0);
+		TEST_ASSERT(onigpp::regex_set_search("xaa", m, runs, rc::match_not_null) == 0);
+		TEST_ASSERT(m.str() == "aa");
+		TEST_ASSERT(onigpp::regex_set_search("x", m, runs, rc::match_not_null | rc::match_continuous) == -1);
+		onigpp::regex_set edge_runs;
+		edge_runs.add(std::string("\\bfoo"));
+		edge_runs.add(std::string("o*"));
+		TEST_ASSERT(onigpp::regex_set_search("foo", m, edge_runs, rc::match_not_bow | rc::match_not_null) == 1);
+		TEST_ASSERT(m.str() == "oo");
+		std::cout << "  [PASS] Match flags" << std::endl;
+	}
+
+	std::cout << "All regex set tests passed." << std::endl;
+	return 0;
+}
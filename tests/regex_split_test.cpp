@@ -0,0 +1,162 @@
+// regex_split_test.cpp --- Tests for onigpp::regex_split
+// Author: katahiromz
+// License: BSD-2-Clause
+
+#include "../onigpp.h"
+#include <iostream>
+#include <cassert>
+#include <string>
+#include <vector>
+
+// Helper macro for test assertions
+#define TEST_ASSERT(cond) do { \
+	if (!(cond)) { \
+		std::cerr << "FAIL: " << #cond << " at line " << __LINE__ << std::endl; \
+		return 1; \
+	} \
+} while(0)
+
+namespace rex = onigpp;
+
+typedef std::vector<std::pair<size_t, size_t>> offset_spans;
+typedef std::vector<std::pair<const char*, const char*>> pointer_spans;
+
+// The tokens of s given as offset spans
+static std::vector<std::string> tokens(const std::string& s, const offset_spans& spans) {
+	std::vector<std::string> result;
+	for (const auto& span : spans) result.push_back(s.substr(span.first, span.second));
+	return result;
+}
+
+// The tokens regex_token_iterator produces
+static std::vector<std::string> token_iterator(const std::string& s, const rex::regex& re, const std::vector<int>& subs) {
+	std::vector<std::string> result;
+	for (rex::sregex_token_iterator it(s.begin(), s.end(), re, subs), end; it != end; ++it)
+		result.push_back(it->str());
+	return result;
+}
+
+int main() {
+	rex::auto_init init;
+
+	std::cout << "Testing onigpp::regex_split..." << std::endl;
+
+	// Test 1: Fields between the matches
+	{
+		rex::regex comma(std::string(","));
+		std::string s = "a,b,,c";
+		offset_spans spans;
+		TEST_ASSERT(rex::regex_split(spans, s, comma) == 4);
+		TEST_ASSERT(tokens(s, spans) == (std::vector<std::string>{ "a", "b", "", "c" }));
+		TEST_ASSERT(spans[3] == std::make_pair(size_t(5), size_t(1)));
+
+		// The field after the last separator is kept even when empty
+		spans.clear();
+		std::string trailing = "a,b,";
+		TEST_ASSERT(rex::regex_split(spans, trailing, comma) == 3);
+		TEST_ASSERT(tokens(trailing, spans) == (std::vector<std::string>{ "a", "b", "" }));
+
+		spans.clear();
+		TEST_ASSERT(rex::regex_split(spans, std::string("none"), comma) == 1);
+		TEST_ASSERT(spans[0] == std::make_pair(size_t(0), size_t(4)));
+
+		spans.clear();
+		TEST_ASSERT(rex::regex_split(spans, std::string(), comma) == 1);
+		TEST_ASSERT(spans[0].second == 0);
+
+		// Same as regex_token_iterator otherwise
+		rex::regex ws(std::string("\\s*;\\s*|\\s+"));
+		std::string text = "alpha ; beta  gamma;delta";
+		spans.clear();
+		rex::regex_split(spans, text, ws);
+		TEST_ASSERT(tokens(text, spans) == token_iterator(text, ws, { -1 }));
+		std::cout << "  Test 1 passed: fields" << std::endl;
+	}
+
+	// Test 2: Field count limit and empty tokens
+	{
+		rex::regex comma(std::string(","));
+		std::string s = "a,,b,c,d";
+		offset_spans spans;
+		rex::split_options options;
+		options.max_fields = 3;
+		TEST_ASSERT(rex::regex_split(spans, s, comma, options) == 3);
+		TEST_ASSERT(tokens(s, spans) == (std::vector<std::string>{ "a", "", "b,c,d" }));
+
+		spans.clear();
+		options.max_fields = 1;
+		TEST_ASSERT(rex::regex_split(spans, s, comma, options) == 1);
+		TEST_ASSERT(tokens(s, spans)[0] == s);
+
+		spans.clear();
+		options.max_fields = 0;
+		options.keep_empty = false;
+		TEST_ASSERT(rex::regex_split(spans, std::string(",a,,b,"), comma, options) == 2);
+		TEST_ASSERT(tokens(",a,,b,", spans) == (std::vector<std::string>{ "a", "b" }));
+
+		spans.clear();
+		TEST_ASSERT(rex::regex_split(spans, std::string(",,"), comma, options) == 0);
+		TEST_ASSERT(spans.empty());
+		std::cout << "  Test 2 passed: limits and empty tokens" << std::endl;
+	}
+
+	// Test 3: Selected groups
+	{
+		rex::regex kv(std::string("(\\w+)=(\\w+)?;?"));
+		std::string s = "a=1;b=;c=3";
+		offset_spans spans;
+		TEST_ASSERT(rex::regex_split(spans, s, kv, std::vector<int>{ 2, 1 }) == 6);
+		TEST_ASSERT(tokens(s, spans) == (std::vector<std::string>{ "1", "a", "", "b", "3", "c" }));
+		TEST_ASSERT(tokens(s, spans) == token_iterator(s, kv, { 2, 1 }));
+
+		rex::regex sep(std::string("\\s*([,;])\\s*"));
+		std::string list = "x , y;z";
+		spans.clear();
+		TEST_ASSERT(rex::regex_split(spans, list, sep, std::vector<int>{ -1, 1 }) == 5);
+		TEST_ASSERT(tokens(list, spans) == (std::vector<std::string>{ "x", ",", "y", ";", "z" }));
+		TEST_ASSERT(tokens(list, spans) == token_iterator(list, sep, { -1, 1 }));
+
+		spans.clear();
+		TEST_ASSERT(rex::regex_split(spans, list, sep, std::vector<int>{ 0 }) == 2);
+		TEST_ASSERT(tokens(list, spans) == (std::vector<std::string>{ " , ", ";" }));
+		std::cout << "  Test 3 passed: selected groups" << std::endl;
+	}
+
+	// Test 4: Pointer spans and container reuse
+	{
+		rex::regex tab(std::string("\\t"));
+		std::string line = "2024-01-02\tINFO\tstarted\tok";
+		pointer_spans spans;
+		TEST_ASSERT(rex::regex_split(spans, line, tab) == 4);
+		TEST_ASSERT(spans[0].first == line.data());
+		TEST_ASSERT(std::string(spans[2].first, spans[2].second) == "started");
+		TEST_ASSERT(spans[3].second == line.data() + line.size());
+
+		const size_t capacity = spans.capacity();
+		const void* data = spans.data();
+		for (int i = 0; i < 10; ++i) {
+			spans.clear();
+			TEST_ASSERT(rex::regex_split(spans, line.data(), line.data() + line.size(), tab) == 4);
+		}
+		TEST_ASSERT(spans.capacity() == capacity);
+		TEST_ASSERT(spans.data() == data);
+
+		// Appends to existing spans
+		TEST_ASSERT(rex::regex_split(spans, line, tab) == 4);
+		TEST_ASSERT(spans.size() == 8);
+		std::cout << "  Test 4 passed: pointer spans" << std::endl;
+	}
+
+	// Test 5: Wide characters
+	{
+		rex::wregex sep(std::wstring(L"、"));
+		std::wstring s = L"一、二、三";
+		std::vector<std::pair<size_t, size_t>> spans;
+		TEST_ASSERT(rex::regex_split(spans, s, sep) == 3);
+		TEST_ASSERT(s.substr(spans[2].first, spans[2].second) == L"三");
+		std::cout << "  Test 5 passed: wide characters" << std::endl;
+	}
+
+	std::cout << "All regex_split tests passed." << std::endl;
+	return 0;
+}
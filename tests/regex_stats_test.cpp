@@ -0,0 +1,149 @@
+// regex_stats_test.cpp --- Tests for onigpp::regex_stats and the slow search hook
+// Author: katahiromz
+// License: BSD-2-Clause
+
+#include "../onigpp.h"
+#include <iostream>
+#include <cassert>
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Helper macro for test assertions
+#define TEST_ASSERT(cond) do { \
+	if (!(cond)) { \
+		std::cerr << "FAIL: " << #cond << " at line " << __LINE__ << std::endl; \
+		return 1; \
+	} \
+} while(0)
+
+namespace rex = onigpp;
+
+int main() {
+	rex::auto_init init;
+
+	std::cout << "Testing onigpp::regex_stats..." << std::endl;
+
+	const std::string text = "one two three four five";
+
+	// Test 1: Nothing is collected while disabled
+	{
+		TEST_ASSERT(!rex::regex_stats_enabled());
+		rex::regex re(std::string("\\w+"));
+		rex::smatch m;
+		TEST_ASSERT(rex::regex_search(text, m, re));
+		rex::regex_stats st = re.stats();
+		TEST_ASSERT(st.compiles == 0 && st.searches == 0 && st.matches == 0 && st.bytes_scanned == 0);
+		std::cout << "  Test 1 passed: disabled by default" << std::endl;
+	}
+
+	rex::set_regex_stats_enabled(true);
+	TEST_ASSERT(rex::regex_stats_enabled());
+
+	// Test 2: Searches, matches and bytes scanned
+	{
+		rex::regex re(std::string("\\w+"));
+		TEST_ASSERT(re.stats().compiles == 1);
+
+		rex::smatch m;
+		TEST_ASSERT(rex::regex_search(text, m, re));
+		TEST_ASSERT(rex::regex_match(std::string("word"), m, re));
+		TEST_ASSERT(!rex::regex_match(text, m, re));
+
+		rex::regex_stats st = re.stats();
+		TEST_ASSERT(st.searches == 1);
+		TEST_ASSERT(st.matches == 2);
+		TEST_ASSERT(st.bytes_scanned == text.size() + 4 + text.size());
+		TEST_ASSERT(st.max_time <= st.total_time);
+
+		// Iterator steps count as searches, each from its own start
+		rex::regex words(std::string("\\w+"));
+		size_t n = 0;
+		for (rex::sregex_iterator it(text.begin(), text.end(), words), end; it != end; ++it) ++n;
+		TEST_ASSERT(n == 5);
+		TEST_ASSERT(words.stats().searches == 6); // Five matches and the final failed search
+		TEST_ASSERT(words.stats().bytes_scanned < 6 * text.size());
+
+		// Wide characters count bytes
+		rex::wregex wre(std::wstring(L"b"));
+		rex::wsmatch wm;
+		std::wstring wtext(L"abc");
+		TEST_ASSERT(rex::regex_search(wtext, wm, wre));
+		TEST_ASSERT(wre.stats().bytes_scanned == 3 * sizeof(wchar_t));
+		std::cout << "  Test 2 passed: counters" << std::endl;
+	}
+
+	// Test 3: Copies share counters; reset clears them
+	{
+		rex::regex re(std::string("o"));
+		rex::regex copy(re);
+		rex::smatch m;
+		rex::regex_search(text, m, re);
+		rex::regex_search(text, m, copy);
+		TEST_ASSERT(re.stats().searches == 2);
+		TEST_ASSERT(copy.stats().searches == 2);
+
+		copy.reset_stats();
+		TEST_ASSERT(re.stats().searches == 0);
+		TEST_ASSERT(re.stats().compiles == 0);
+
+		// A new pattern starts new counters
+		copy.assign(std::string("t"));
+		TEST_ASSERT(copy.stats().compiles == 1);
+		TEST_ASSERT(copy.stats().searches == 0);
+		std::cout << "  Test 3 passed: sharing and reset" << std::endl;
+	}
+
+	// Test 4: Slow search hook
+	{
+		std::vector<rex::slow_search_event> events;
+		rex::set_slow_search_hook(std::chrono::nanoseconds::zero(), [&](const rex::slow_search_event& ev) {
+			events.push_back(ev);
+		});
+
+		rex::regex re(std::string("t(h)ree"));
+		rex::smatch m;
+		TEST_ASSERT(rex::regex_search(text, m, re));
+		TEST_ASSERT(events.size() == 1);
+		TEST_ASSERT(events[0].regex == &re);
+		TEST_ASSERT(!events[0].match);
+		TEST_ASSERT(events[0].char_size == 1);
+		TEST_ASSERT(std::string(static_cast<const char*>(events[0].pattern), events[0].pattern_length) == "t(h)ree");
+		TEST_ASSERT(events[0].bytes_scanned == text.size());
+
+		TEST_ASSERT(rex::regex_match(std::string("three"), m, re));
+		TEST_ASSERT(events.size() == 2 && events[1].match);
+
+		// Searches faster than the threshold are not reported
+		rex::set_slow_search_hook(std::chrono::hours(1), [&](const rex::slow_search_event& ev) {
+			events.push_back(ev);
+		});
+		rex::regex_search(text, m, re);
+		TEST_ASSERT(events.size() == 2);
+
+		// The hook works without regex_stats
+		rex::set_regex_stats_enabled(false);
+		rex::set_slow_search_hook(std::chrono::nanoseconds::zero(), [&](const rex::slow_search_event& ev) {
+			events.push_back(ev);
+		});
+		rex::regex_search(text, m, re);
+		TEST_ASSERT(events.size() == 3);
+
+		rex::set_slow_search_hook(std::chrono::nanoseconds::zero(), rex::slow_search_hook());
+		rex::regex_search(text, m, re);
+		TEST_ASSERT(events.size() == 3);
+		std::cout << "  Test 4 passed: slow search hook" << std::endl;
+	}
+
+	// Test 5: Engine statistics are optional
+	{
+		// Both are no-ops unless Oniguruma is built with ONIG_DEBUG_STATISTICS
+		rex::reset_engine_statistics();
+		if (rex::engine_statistics_available())
+			rex::print_engine_statistics(stdout);
+		std::cout << "  Test 5 passed: engine statistics" << std::endl;
+	}
+
+	std::cout << "All regex_stats tests passed." << std::endl;
+	return 0;
+}
@@ -0,0 +1,156 @@
+// regex_stream_test.cpp --- Tests for onigpp::basic_regex_stream
+// Author: katahiromz
+// License: BSD-2-Clause
+
+#include "../onigpp.h"
+#include <iostream>
+#include <cassert>
+#include <vector>
+#include <utility>
+
+// Helper macro for test assertions
+#define TEST_ASSERT(cond) do { \
+	if (!(cond)) { \
+		std::cerr << "FAIL: " << #cond << " at line " << __LINE__ << std::endl; \
+		return 1; \
+	} \
+} while(0)
+
+typedef std::vector<std::pair<size_t, size_t>> spans;
+
+// Feed s in chunks of chunk_size characters and collect (position, length)
+static spans stream_matches(const std::string& s, const onigpp::regex& re, size_t chunk_size,
+                            onigpp::regex_constants::match_flag_type flags = onigpp::regex_constants::match_default,
+                            size_t window = onigpp::regex_stream::default_window)
+{
+	spans result;
+	onigpp::regex_stream stream(re, [&](const onigpp::cmatch& m, size_t offset) {
+		result.push_back(std::make_pair(offset + m.position(0), size_t(m.length(0))));
+	}, flags, window);
+	for (size_t i = 0; i < s.size(); i += chunk_size) {
+		stream.feed(s.data() + i, std::min(chunk_size, s.size() - i));
+	}
+	stream.finish();
+	return result;
+}
+
+static spans serial_matches(const std::string& s, const onigpp::regex& re,
+                            onigpp::regex_constants::match_flag_type flags = onigpp::regex_constants::match_default)
+{
+	spans result;
+	for (onigpp::sregex_iterator it(s.begin(), s.end(), re, flags), end; it != end; ++it) {
+		result.push_back(std::make_pair(size_t(it->position(0)), size_t(it->length(0))));
+	}
+	return result;
+}
+
+int main() {
+	onigpp::auto_init init;
+
+	std::cout << "Testing onigpp::basic_regex_stream..." << std::endl;
+
+	std::string text;
+	for (int i = 0; i < 100; ++i) {
+		text += "id=" + std::to_string(i * 37) + " name=item" + std::to_string(i) + ";\n";
+	}
+
+	// Test 1: Same matches as regex_iterator for any chunk size
+	{
+		const char* patterns[] = { "\\d+", "(\\w+)=(\\w+)", "(?<=m)\\d+", "\\bitem\\b", "\\d*", "" };
+		for (const char* pattern : patterns) {
+			onigpp::regex re{std::string(pattern)};
+			spans expected = serial_matches(text, re);
+			TEST_ASSERT(stream_matches(text, re, 1, onigpp::regex_constants::match_default, 64) == expected);
+			TEST_ASSERT(stream_matches(text, re, 7, onigpp::regex_constants::match_default, 64) == expected);
+			TEST_ASSERT(stream_matches(text, re, 1000) == expected);
+		}
+		std::cout << "  [PASS] Matches across chunk edges" << std::endl;
+	}
+
+	// Test 2: Chunk edges are not line or string boundaries
+	{
+		onigpp::regex re(std::string("^\\w+$"), onigpp::regex_constants::ECMAScript | onigpp::regex_constants::multiline);
+		std::string s = "abc\ndef\nghi";
+		spans expected = serial_matches(s, re);
+		TEST_ASSERT(expected.size() == 3);
+		TEST_ASSERT(stream_matches(s, re, 2, onigpp::regex_constants::match_default, 8) == expected);
+
+		onigpp::regex tail(std::string("\\w+$"));
+		spans last = stream_matches(s, tail, 1, onigpp::regex_constants::match_default, 8);
+		TEST_ASSERT(last.size() == 1);
+		TEST_ASSERT(last[0] == std::make_pair(size_t(8), size_t(3)));
+		std::cout << "  [PASS] Line anchors" << std::endl;
+	}
+
+	// Test 3: BOL/EOL flags apply to the whole stream
+	{
+		onigpp::regex re(std::string("^a|b$"), onigpp::regex_constants::ECMAScript);
+		std::string s = "acb";
+		TEST_ASSERT(stream_matches(s, re, 1).size() == 2);
+		TEST_ASSERT(stream_matches(s, re, 1, onigpp::regex_constants::match_not_bol) ==
+		            serial_matches(s, re, onigpp::regex_constants::match_not_bol));
+		TEST_ASSERT(stream_matches(s, re, 1, onigpp::regex_constants::match_not_eol) ==
+		            serial_matches(s, re, onigpp::regex_constants::match_not_eol));
+		std::cout << "  [PASS] match_not_bol and match_not_eol" << std::endl;
+	}
+
+	// Test 4: match_continuous chains matches from the stream start
+	{
+		onigpp::regex re(std::string("\\w{2}"));
+		std::string s = "aabbcc dd";
+		spans got = stream_matches(s, re, 3, onigpp::regex_constants::match_continuous, 4);
+		TEST_ASSERT(got.size() == 3);
+		TEST_ASSERT(got == serial_matches(s, re, onigpp::regex_constants::match_continuous));
+		std::cout << "  [PASS] match_continuous" << std::endl;
+	}
+
+	// Test 5: Submatches are kept after the start of the stream was dropped
+	{
+		onigpp::regex re(std::string("(\\w+)=(\\d+)"));
+		std::string s;
+		for (int i = 0; i < 50; ++i) s += "key" + std::to_string(i) + "=" + std::to_string(i) + " ";
+		std::vector<std::string> values;
+		onigpp::regex_stream stream(re, [&](const onigpp::cmatch& m, size_t) {
+			values.push_back(m.size() == 3 ? m[2].str() : std::string());
+		}, onigpp::regex_constants::match_default, 16);
+		for (size_t i = 0; i < s.size(); i += 5) stream.feed(s.substr(i, 5));
+		stream.finish();
+		TEST_ASSERT(values.size() == 50);
+		TEST_ASSERT(values[49] == "49");
+		std::cout << "  [PASS] Submatches mid-stream" << std::endl;
+	}
+
+	// Test 6: Bounded retention and counters
+	{
+		onigpp::regex re(std::string("x"));
+		size_t found = 0;
+		onigpp::regex_stream stream(re, [&](const onigpp::cmatch& m, size_t) {
+			if (m.str() == "x") ++found;
+		}, onigpp::regex_constants::match_default, 16);
+		std::string chunk(100, '.');
+		chunk[50] = 'x';
+		for (int i = 0; i < 1000; ++i) stream.feed(chunk);
+		stream.finish();
+		TEST_ASSERT(found == 1000);
+		TEST_ASSERT(stream.count() == 1000);
+		TEST_ASSERT(stream.position() == 100000);
+		TEST_ASSERT(stream.finished());
+
+		bool thrown = false;
+		try {
+			stream.feed(chunk);
+		} catch (const std::logic_error&) {
+			thrown = true;
+		}
+		TEST_ASSERT(thrown);
+
+		stream.reset();
+		stream.feed("x");
+		stream.finish();
+		TEST_ASSERT(stream.count() == 1);
+		std::cout << "  [PASS] Counters and reset" << std::endl;
+	}
+
+	std::cout << "All regex stream tests passed." << std::endl;
+	return 0;
+}
@@ -0,0 +1,127 @@
+// regex_test_count_test.cpp --- Tests for onigpp::regex_test and onigpp::regex_count
+// Author: katahiromz
+// License: BSD-2-Clause
+
+#include "../onigpp.h"
+#include <iostream>
+#include <cassert>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// Helper macro for test assertions
+#define TEST_ASSERT(cond) do { \
+	if (!(cond)) { \
+		std::cerr << "FAIL: " << #cond << " at line " << __LINE__ << std::endl; \
+		return 1; \
+	} \
+} while(0)
+
+namespace rex = onigpp;
+
+// The number of matches regex_iterator enumerates
+static size_t iterator_count(const std::string& s, const rex::regex& re,
+                             rex::regex_constants::match_flag_type flags = rex::regex_constants::match_default)
+{
+	return static_cast<size_t>(std::distance(rex::sregex_iterator(s.begin(), s.end(), re, flags), rex::sregex_iterator()));
+}
+
+static bool search(const std::string& s, const rex::regex& re,
+                   rex::regex_constants::match_flag_type flags = rex::regex_constants::match_default)
+{
+	rex::smatch m;
+	return rex::regex_search(s, m, re, flags);
+}
+
+int main() {
+	rex::auto_init init;
+
+	std::cout << "Testing onigpp::regex_test and onigpp::regex_count..." << std::endl;
+
+	const char* patterns[] = { "a", "a*", "\\b", "$", "^", "(?=a)", "x|", "\\w+", "[ab]{2}", "(?<=a)b?", "" };
+	const char* subjects[] = { "", "a", "banana", "aa ab", "xyz", "a\nb\na" };
+	const rex::regex_constants::match_flag_type flag_sets[] = {
+		rex::regex_constants::match_default,
+		rex::regex_constants::match_not_null,
+		rex::regex_constants::match_continuous,
+		rex::regex_constants::match_not_bol | rex::regex_constants::match_not_eol,
+		rex::regex_constants::match_not_bow | rex::regex_constants::match_not_eow,
+	};
+
+	// Test 1: Same as regex_search and regex_iterator
+	{
+		for (const char* p : patterns) {
+			rex::regex re{std::string(p)};
+			for (const char* s : subjects) {
+				for (auto flags : flag_sets) {
+					TEST_ASSERT(rex::regex_test(std::string(s), re, flags) == search(s, re, flags));
+					TEST_ASSERT(rex::regex_count(std::string(s), re, flags) == iterator_count(s, re, flags));
+				}
+			}
+		}
+		std::cout << "  Test 1 passed: regex_search and regex_iterator" << std::endl;
+	}
+
+	// Test 2: Zero-width advancement and overloads
+	{
+		rex::regex empty(std::string(""));
+		TEST_ASSERT(rex::regex_count(std::string("abc"), empty) == 4);
+		TEST_ASSERT(rex::regex_count(std::string(""), empty) == 1);
+
+		rex::regex star(std::string("a*"));
+		TEST_ASSERT(rex::regex_count(std::string("baaac"), star) == 4); // "", "aaa", "", ""
+		TEST_ASSERT(rex::regex_count("aXa", rex::regex(std::string("a"))) == 2);
+		TEST_ASSERT(rex::regex_test("abc", rex::regex(std::string("c$"))));
+		TEST_ASSERT(!rex::regex_test("abc", rex::regex(std::string("^c"))));
+
+		const std::string s = "xyaz";
+		rex::regex a(std::string("a"));
+		TEST_ASSERT(rex::regex_test(s.data() + 1, s.data() + 3, a));
+		TEST_ASSERT(!rex::regex_test(s.data(), s.data() + 2, a));
+
+		// The character before the subject with match_prev_avail
+		rex::regex boundary(std::string("\\bz"));
+		TEST_ASSERT(rex::regex_test(s.data() + 3, s.data() + 4, boundary));
+		TEST_ASSERT(!rex::regex_test(s.data() + 3, s.data() + 4, boundary, rex::regex_constants::match_prev_avail));
+		TEST_ASSERT(rex::regex_count(s.data() + 3, s.data() + 4, boundary, rex::regex_constants::match_prev_avail) == 0);
+		std::cout << "  Test 2 passed: zero-width matches and overloads" << std::endl;
+	}
+
+	// Test 3: Count batch
+	{
+		std::vector<std::string> lines = { "a,b,c", "", "no commas", ",,", "x,y" };
+		rex::regex comma(std::string(","));
+		std::vector<size_t> counts;
+		TEST_ASSERT(rex::regex_count_batch(lines.begin(), lines.end(), counts, comma) == 3);
+		TEST_ASSERT((counts == std::vector<size_t>{ 2, 0, 0, 2, 1 }));
+
+		rex::batch_options options;
+		options.threads = 3;
+		options.grain = 1;
+		std::vector<std::string> many;
+		for (int i = 0; i < 100; ++i) many.push_back(std::string(i % 7, ','));
+		TEST_ASSERT(rex::regex_count_batch(many.begin(), many.end(), counts, comma, rex::regex_constants::match_default, options) == 85);
+		for (int i = 0; i < 100; ++i) TEST_ASSERT(counts[i] == static_cast<size_t>(i % 7));
+
+		// Search batch results are still those of regex_search
+		std::vector<bool> matched;
+		TEST_ASSERT(rex::regex_search_batch(lines.begin(), lines.end(), matched, comma) == 3);
+		TEST_ASSERT((matched == std::vector<bool>{ true, false, false, true, true }));
+		rex::regex star(std::string("x*"));
+		TEST_ASSERT(rex::regex_search_batch(lines.begin(), lines.end(), matched, star, rex::regex_constants::match_not_null) == 1);
+		TEST_ASSERT(matched[4] && !matched[0]);
+		std::cout << "  Test 3 passed: count batch" << std::endl;
+	}
+
+	// Test 4: Wide characters
+	{
+		rex::wregex re(std::wstring(L"\\w+"));
+		TEST_ASSERT(rex::regex_count(std::wstring(L"één twee drie"), re) == 3);
+		TEST_ASSERT(rex::regex_test(std::wstring(L"..é.."), re));
+		TEST_ASSERT(!rex::regex_test(std::wstring(L"..."), re));
+		std::cout << "  Test 4 passed: wide characters" << std::endl;
+	}
+
+	std::cout << "All regex_test and regex_count tests passed." << std::endl;
+	return 0;
+}
@@ -0,0 +1,86 @@
+// region_reuse_test.cpp --- Tests for reusing OnigRegion storage across searches
+// Author: katahiromz
+// License: BSD-2-Clause
+
+#include "../onigpp.h"
+#include <iostream>
+#include <cassert>
+#include <list>
+
+// Helper macro for test assertions
+#define TEST_ASSERT(cond) do { \
+	if (!(cond)) { \
+		std::cerr << "FAIL: " << #cond << " at line " << __LINE__ << std::endl; \
+		return 1; \
+	} \
+} while(0)
+
+int main() {
+	onigpp::auto_init init;
+
+	std::cout << "Testing OnigRegion reuse..." << std::endl;
+
+	// Test 1: Group counts that grow and shrink between searches
+	{
+		std::string s = "ab12cd";
+		onigpp::smatch m;
+		onigpp::regex many("(a)(b)(\\d)(\\d)(x)?");
+		onigpp::regex one("c(d)");
+		onigpp::regex none("\\d+");
+
+		TEST_ASSERT(onigpp::regex_search(s, m, many));
+		TEST_ASSERT(m.size() == 6);
+		TEST_ASSERT(!m[5].matched);
+
+		TEST_ASSERT(onigpp::regex_search(s, m, one));
+		TEST_ASSERT(m.size() == 2);
+		TEST_ASSERT(m[1].str() == "d");
+
+		TEST_ASSERT(onigpp::regex_search(s, m, none));
+		TEST_ASSERT(m.size() == 1);
+		TEST_ASSERT(m[0].str() == "12");
+
+		// Growing again must not expose stale offsets
+		TEST_ASSERT(onigpp::regex_search(s, m, many));
+		TEST_ASSERT(m.size() == 6);
+		TEST_ASSERT(m[3].str() == "1");
+		TEST_ASSERT(!m[5].matched);
+		std::cout << "  [PASS] Growing and shrinking group counts" << std::endl;
+	}
+
+	// Test 2: Interleaved iterators share the per-thread scratch safely
+	{
+		std::string s = "a1 b2 c3";
+		onigpp::regex word("([a-z])");
+		onigpp::regex digit("(\\d)");
+		onigpp::sregex_iterator it1(s.begin(), s.end(), word), it2(s.begin(), s.end(), digit), end;
+		std::string out;
+		for (; it1 != end && it2 != end; ++it1, ++it2) {
+			out += (*it1)[1].str();
+			out += (*it2)[1].str();
+		}
+		TEST_ASSERT(out == "a1b2c3");
+		std::cout << "  [PASS] Interleaved iterators" << std::endl;
+	}
+
+	// Test 3: Errors and mismatches leave the scratch usable
+	{
+		std::list<char> l = {'x', 'y', 'z'};
+		onigpp::match_results<std::list<char>::iterator> lm;
+		onigpp::regex re("q");
+		TEST_ASSERT(!onigpp::regex_search(l.begin(), l.end(), lm, re));
+		onigpp::regex re2("(y)");
+		TEST_ASSERT(onigpp::regex_search(l.begin(), l.end(), lm, re2));
+		TEST_ASSERT(lm.size() == 2 && lm.position(1) == 1);
+
+		onigpp::smatch m;
+		std::string s = "abc";
+		TEST_ASSERT(onigpp::regex_match(s, m, onigpp::regex("a(b)c")));
+		TEST_ASSERT(m[1].str() == "b");
+		TEST_ASSERT(!onigpp::regex_match(s, m, onigpp::regex("a(b)")));
+		std::cout << "  [PASS] Mismatch followed by match" << std::endl;
+	}
+
+	std::cout << "All region reuse tests passed." << std::endl;
+	return 0;
+}
@@ -0,0 +1,173 @@
+// segmented_search_test.cpp --- Tests for onigpp::basic_segmented_text searches
+// Author: katahiromz
+// License: BSD-2-Clause
+
+#include "../onigpp.h"
+#include <iostream>
+#include <cassert>
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Helper macro for test assertions
+#define TEST_ASSERT(cond) do { \
+	if (!(cond)) { \
+		std::cerr << "FAIL: " << #cond << " at line " << __LINE__ << std::endl; \
+		return 1; \
+	} \
+} while(0)
+
+namespace rex = onigpp;
+
+typedef std::vector<std::pair<size_t, size_t>> spans;
+
+// Splits s into spans of the given sizes (cycling through them)
+static void split(const std::string& s, const std::vector<size_t>& sizes, rex::segmented_text& text) {
+	text.clear();
+	size_t pos = 0;
+	for (size_t i = 0; pos < s.size(); ++i) {
+		size_t len = std::min(sizes[i % sizes.size()], s.size() - pos);
+		text.append(s.data() + pos, len);
+		pos += len;
+	}
+}
+
+static spans segmented_matches(const rex::segmented_text& text, const rex::regex& re, size_t margin) {
+	spans result;
+	for (rex::segmented_regex_iterator it(text, re, rex::regex_constants::match_default, margin), end; it != end; ++it) {
+		result.push_back(std::make_pair(it->position(0), it->length(0)));
+	}
+	return result;
+}
+
+static spans serial_matches(const std::string& s, const rex::regex& re) {
+	spans result;
+	for (rex::sregex_iterator it(s.begin(), s.end(), re), end; it != end; ++it) {
+		result.push_back(std::make_pair(size_t(it->position(0)), size_t(it->length(0))));
+	}
+	return result;
+}
+
+int main() {
+	rex::auto_init init;
+
+	std::cout << "Testing onigpp::basic_segmented_text..." << std::endl;
+
+	std::string s;
+	for (int i = 0; i < 200; ++i) {
+		s += "line " + std::to_string(i) + ": key=value" + std::to_string(i * 7) + "\n";
+	}
+
+	// Test 1: locate and copy
+	{
+		rex::segmented_text text;
+		text.append("abc", 3);
+		text.append("", 0);
+		text.append("de", 2);
+		TEST_ASSERT(text.size() == 5);
+		TEST_ASSERT(text.segment_count() == 2);
+		TEST_ASSERT(text.locate(2).segment == 0 && text.locate(2).offset == 2);
+		TEST_ASSERT(text.locate(3).segment == 1 && text.locate(3).offset == 0);
+		TEST_ASSERT(text.locate(5).segment == 1 && text.locate(5).offset == 2);
+		TEST_ASSERT(text.str(1, 4) == "bcd");
+
+		bool caught = false;
+		try {
+			text.locate(6);
+		} catch (const std::out_of_range&) {
+			caught = true;
+		}
+		TEST_ASSERT(caught);
+		std::cout << "  Test 1 passed: locate and copy" << std::endl;
+	}
+
+	// Test 2: Same matches as regex_iterator over the flattened text
+	{
+		const char* patterns[] = { "\\d+", "(\\w+)=(\\w+)", "^line", "\\d$", "(?<=e)\\d", "\\bkey\\b", "x*", "\\Aline|\\n\\z" };
+		const std::vector<size_t> layouts[] = { { 1 }, { 3, 1, 7 }, { 64 }, { 5000 }, { 100, 2 } };
+		for (const char* pattern : patterns) {
+			rex::regex re{std::string(pattern)};
+			spans expected = serial_matches(s, re);
+			for (const auto& layout : layouts) {
+				rex::segmented_text text;
+				split(s, layout, text);
+				TEST_ASSERT(segmented_matches(text, re, 16) == expected);
+				TEST_ASSERT(segmented_matches(text, re, rex::segmented_search_margin) == expected);
+			}
+		}
+		std::cout << "  Test 2 passed: matches regex_iterator" << std::endl;
+	}
+
+	// Test 3: Groups and positions map back to spans
+	{
+		rex::segmented_text text;
+		split(s, { 5 }, text);
+		rex::regex re{std::string("(key)=(value)(\\d+)(x)?")};
+		rex::segmented_match m;
+		TEST_ASSERT(rex::regex_search(text, m, re));
+		TEST_ASSERT(m.size() == 5);
+		TEST_ASSERT(m.position(0) == s.find("key"));
+		TEST_ASSERT(m.str(0) == "key=value0");
+		TEST_ASSERT(m.str(3) == "0");
+		TEST_ASSERT(!m.matched(4) && m.position(4) == rex::segmented_match::npos && m.str(4).empty());
+		TEST_ASSERT(m.begin(0).segment == m.position(0) / 5 && m.begin(0).offset == m.position(0) % 5);
+		TEST_ASSERT(m.end(2).segment == (m.position(2) + 5) / 5);
+
+		// Search from an offset
+		TEST_ASSERT(rex::regex_search(text, m, re, rex::regex_constants::match_default, m.position(0) + 1));
+		TEST_ASSERT(m.str(0) == "key=value7");
+		std::cout << "  Test 3 passed: groups and positions" << std::endl;
+	}
+
+	// Test 4: Long matches across many small spans
+	{
+		std::string long_run(5000, 'a');
+		std::string subject = "x" + long_run + "y";
+		rex::segmented_text text;
+		split(subject, { 7 }, text);
+		rex::segmented_match m;
+		TEST_ASSERT(rex::regex_search(text, m, rex::regex(std::string("a+y?")), rex::regex_constants::match_default, 0, 8));
+		TEST_ASSERT(m.position(0) == 1 && m.length(0) == 5001);
+
+		// A match that must see its end to match at all needs a larger margin
+		TEST_ASSERT(rex::regex_search(text, m, rex::regex(std::string("a+y")), rex::regex_constants::match_default, 0, 8192));
+		TEST_ASSERT(m.position(0) == 1 && m.length(0) == 5001);
+		std::cout << "  Test 4 passed: long matches" << std::endl;
+	}
+
+	// Test 5: std::deque storage
+	{
+		std::deque<char> dq(s.begin(), s.end());
+		rex::segmented_text text;
+		text.append_range(dq.begin(), dq.end());
+		TEST_ASSERT(text.size() == s.size());
+		TEST_ASSERT(text.segment_count() < s.size() / 8);
+		rex::regex re{std::string("value(\\d+)")};
+		TEST_ASSERT(segmented_matches(text, re, rex::segmented_search_margin) == serial_matches(s, re));
+		std::cout << "  Test 5 passed: std::deque" << std::endl;
+	}
+
+	// Test 6: Empty text and wide characters
+	{
+		rex::segmented_text empty;
+		rex::segmented_match m;
+		TEST_ASSERT(rex::regex_search(empty, m, rex::regex(std::string("^$"))));
+		TEST_ASSERT(m.position(0) == 0 && m.length(0) == 0);
+		TEST_ASSERT(!rex::regex_search(empty, m, rex::regex(std::string("a"))));
+
+		std::wstring ws = L"alpha beta gamma";
+		rex::wsegmented_text wtext;
+		wtext.append(ws.data(), 7);
+		wtext.append(ws.data() + 7, ws.size() - 7);
+		rex::wsegmented_match wm;
+		TEST_ASSERT(rex::regex_search(wtext, wm, rex::wregex(std::wstring(L"t\\w+"))));
+		TEST_ASSERT(wm.str(0) == L"ta");
+		TEST_ASSERT(rex::regex_search(wtext, wm, rex::wregex(std::wstring(L"be\\w+"))));
+		TEST_ASSERT(wm.str(0) == L"beta" && wm.begin(0).segment == 0 && wm.end(0).segment == 1);
+		std::cout << "  Test 6 passed: empty and wide" << std::endl;
+	}
+
+	std::cout << "All segmented search tests passed." << std::endl;
+	return 0;
+}
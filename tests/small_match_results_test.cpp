@@ -0,0 +1,162 @@
+// small_match_results_test.cpp --- Tests for onigpp::small_match_results
+// Author: katahiromz
+// License: BSD-2-Clause
+
+#include "../onigpp.h"
+#include <iostream>
+#include <cassert>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+// Helper macro for test assertions
+#define TEST_ASSERT(cond) do { \
+	if (!(cond)) { \
+		std::cerr << "FAIL: " << #cond << " at line " << __LINE__ << std::endl; \
+		return 1; \
+	} \
+} while(0)
+
+namespace rex = onigpp;
+
+// Count the calls of the global operator new
+static size_t s_allocations = 0;
+
+void* operator new(std::size_t size) {
+	++s_allocations;
+	if (void* p = std::malloc(size ? size : 1)) return p;
+	throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+int main() {
+	rex::auto_init init;
+
+	std::cout << "Testing onigpp::small_match_results..." << std::endl;
+
+	// Test 1: Same results as match_results
+	{
+		rex::regex re(std::string("(\\d+)-(\\d+)(x)?"));
+		std::string s = "tel 03-1234 end";
+		rex::smatch m;
+		rex::small_smatch sm;
+		TEST_ASSERT(!sm.ready());
+		TEST_ASSERT(sm.empty());
+		TEST_ASSERT(rex::regex_search(s, m, re));
+		TEST_ASSERT(rex::regex_search(s, sm, re));
+		TEST_ASSERT(sm.ready());
+		TEST_ASSERT(sm.size() == m.size() && sm.size() == 4);
+		for (size_t i = 0; i < m.size(); ++i) {
+			TEST_ASSERT(sm[i].matched == m[i].matched);
+			TEST_ASSERT(sm.str(i) == m.str(i));
+			TEST_ASSERT(sm.position(i) == m.position(i));
+			TEST_ASSERT(sm.length(i) == m.length(i));
+		}
+		TEST_ASSERT(sm.prefix().str() == "tel " && sm.suffix().str() == " end");
+		TEST_ASSERT(sm.format("[$2/$1]$'") == "[1234/03] end");
+		TEST_ASSERT(sm.format(std::string("$`")) == m.format(std::string("$`")));
+		TEST_ASSERT(sm.is_inline());
+
+		TEST_ASSERT(!rex::regex_search(std::string("none"), sm, re));
+		TEST_ASSERT(sm.ready());
+
+		rex::regex whole(std::string("(\\w+)@(\\w+)"));
+		TEST_ASSERT(rex::regex_match(std::string("me@host"), sm, whole));
+		TEST_ASSERT(sm.str(2) == "host");
+
+		rex::small_cmatch cm;
+		TEST_ASSERT(rex::regex_search("a 1-2", cm, re));
+		TEST_ASSERT(cm.str(0) == "1-2" && cm.position(0) == 2);
+		std::cout << "  Test 1 passed: same results as match_results" << std::endl;
+	}
+
+	// Test 2: No allocation for small patterns
+	{
+		rex::regex re(std::string("(a)(b)(c)?"));
+		std::string s = "xxabyy";
+		{
+			rex::small_smatch warm;
+			TEST_ASSERT(rex::regex_search(s, warm, re));
+		}
+
+		size_t before = s_allocations;
+		for (int i = 0; i < 100; ++i) {
+			rex::small_smatch sm;
+			TEST_ASSERT(rex::regex_search(s, sm, re));
+			TEST_ASSERT(sm.size() == 4 && sm.is_inline());
+		}
+		TEST_ASSERT(s_allocations == before);
+
+		before = s_allocations;
+		for (int i = 0; i < 10; ++i) {
+			rex::smatch m;
+			TEST_ASSERT(rex::regex_search(s, m, re));
+		}
+		TEST_ASSERT(s_allocations >= before + 10);
+		std::cout << "  Test 2 passed: inline storage" << std::endl;
+	}
+
+	// Test 3: Overflow to the heap
+	{
+		rex::regex many(std::string("(a)(b)(c)(d)(e)(f)(g)(h)(i)(j)"));
+		std::string s = "-abcdefghij-";
+		rex::small_smatch sm;
+		TEST_ASSERT(rex::regex_search(s, sm, many));
+		TEST_ASSERT(sm.size() == 11 && !sm.is_inline());
+		TEST_ASSERT(sm.str(10) == "j" && sm.suffix().str() == "-");
+
+		rex::regex one(std::string("b"));
+		TEST_ASSERT(rex::regex_search(s, sm, one));
+		TEST_ASSERT(sm.size() == 1 && sm.str() == "b");
+
+		rex::small_match_results<std::string::const_iterator, 2> tiny;
+		TEST_ASSERT(rex::regex_search(s, tiny, one) && tiny.is_inline());
+		TEST_ASSERT(rex::regex_search(s, tiny, many) && !tiny.is_inline());
+		TEST_ASSERT(tiny.str(1) == "a");
+		std::cout << "  Test 3 passed: overflow" << std::endl;
+	}
+
+	// Test 4: Copy, assignment and swap
+	{
+		rex::regex re(std::string("(\\w)(\\w)"));
+		std::string s = "ab cd";
+		rex::small_smatch a, b;
+		TEST_ASSERT(rex::regex_search(s, a, re));
+		TEST_ASSERT(rex::regex_search(s.cbegin() + 2, s.cend(), b, re));
+
+		rex::small_smatch copy(a);
+		TEST_ASSERT(copy == a && copy.is_inline());
+		TEST_ASSERT(copy.get_allocator() != a.get_allocator());
+		copy = b;
+		TEST_ASSERT(copy.str() == "cd" && copy.prefix().str() == " ");
+
+		swap(a, b);
+		TEST_ASSERT(a.str() == "cd" && b.str() == "ab");
+		TEST_ASSERT(b.suffix().str() == " cd");
+
+		{
+			rex::small_smatch moved(std::move(a));
+			TEST_ASSERT(moved.str(2) == "d");
+		}
+		TEST_ASSERT(a.str(1) == "c");
+		std::cout << "  Test 4 passed: copy and swap" << std::endl;
+	}
+
+	// Test 5: Wide characters
+	{
+		rex::wregex re(std::wstring(L"(\\w+)=(\\w+)"));
+		std::wstring s = L"clé=valeur";
+		rex::small_wsmatch m;
+		TEST_ASSERT(rex::regex_search(s, m, re));
+		TEST_ASSERT(m.str(1) == L"clé" && m.format(std::wstring(L"$2")) == L"valeur");
+
+		rex::small_wcmatch cm;
+		TEST_ASSERT(rex::regex_search(L"k=v", cm, re));
+		TEST_ASSERT(cm.length(0) == 3);
+		std::cout << "  Test 5 passed: wide characters" << std::endl;
+	}
+
+	std::cout << "All small_match_results tests passed." << std::endl;
+	return 0;
+}
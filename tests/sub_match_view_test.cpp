@@ -0,0 +1,156 @@
+// sub_match_view_test.cpp --- Tests for allocation-free sub_match comparisons and views
+// Author: katahiromz
+// License: BSD-2-Clause
+
+#include "../onigpp.h"
+#include "allocation_counter.h"
+#include <iostream>
+#include <cassert>
+#include <functional>
+#include <list>
+#include <string>
+#include <vector>
+
+// Helper macro for test assertions
+#define TEST_ASSERT(cond) do { \
+	if (!(cond)) { \
+		std::cerr << "FAIL: " << #cond << " at line " << __LINE__ << std::endl; \
+		return 1; \
+	} \
+} while(0)
+
+namespace rex = onigpp;
+
+static int sign(int value) {
+	return (value > 0) - (value < 0);
+}
+
+int main() {
+	rex::auto_init init;
+
+	std::cout << "Testing allocation-free sub_match comparisons..." << std::endl;
+
+	const char* words[] = { "", "a", "ab", "abc", "abd", "b", "\xC3\xA9", "\x7F", "\x80" };
+
+	// Test 1: Same results as comparing str()
+	{
+		std::string subject;
+		std::vector<size_t> offsets;
+		for (const char* w : words) {
+			offsets.push_back(subject.size());
+			subject += w;
+		}
+		offsets.push_back(subject.size());
+		std::list<char> chars(subject.begin(), subject.end());
+
+		const size_t count = sizeof(words) / sizeof(words[0]);
+		for (size_t i = 0; i < count; ++i) {
+			rex::ssub_match si(subject.begin() + offsets[i], subject.begin() + offsets[i + 1]);
+			rex::sub_match<std::list<char>::const_iterator> li(
+				std::next(chars.cbegin(), offsets[i]), std::next(chars.cbegin(), offsets[i + 1]));
+			for (size_t j = 0; j < count; ++j) {
+				rex::ssub_match sj(subject.begin() + offsets[j], subject.begin() + offsets[j + 1]);
+				rex::sub_match<std::list<char>::const_iterator> lj(
+					std::next(chars.cbegin(), offsets[j]), std::next(chars.cbegin(), offsets[j + 1]));
+				const std::string w = words[j];
+				const int expected = sign(si.str().compare(w));
+				TEST_ASSERT(sign(si.compare(sj)) == expected);
+				TEST_ASSERT(sign(si.compare(w)) == expected);
+				TEST_ASSERT(sign(si.compare(words[j])) == expected);
+				TEST_ASSERT(sign(li.compare(lj)) == expected);
+				TEST_ASSERT(sign(li.compare(w)) == expected);
+				TEST_ASSERT(sign(li.compare(words[j])) == expected);
+				TEST_ASSERT((si < sj) == (si.str() < w) && (si == w) == (si.str() == w));
+				TEST_ASSERT((w < li) == (w < li.str()) && (words[j] >= si) == (words[j] >= si.str()));
+			}
+		}
+		std::cout << "  Test 1 passed: same results as str()" << std::endl;
+	}
+
+	// Test 2: Unmatched sub-matches compare as empty
+	{
+		const std::string s = "xy";
+		rex::ssub_match unmatched(s.begin(), s.end(), false), empty(s.begin(), s.begin()), xy(s.begin(), s.end());
+		TEST_ASSERT(unmatched.compare(empty) == 0 && empty.compare(unmatched) == 0);
+		TEST_ASSERT(unmatched.compare("") == 0 && unmatched.compare(std::string()) == 0);
+		TEST_ASSERT(unmatched < xy && xy > unmatched && unmatched.compare("x") < 0);
+		TEST_ASSERT(unmatched.data() == nullptr && empty.data() == nullptr && xy.data() == s.data());
+
+		std::list<char> chars(s.begin(), s.end());
+		rex::sub_match<std::list<char>::iterator> lunmatched(chars.begin(), chars.end(), false);
+		rex::sub_match<std::list<char>::iterator> lxy(chars.begin(), chars.end());
+		TEST_ASSERT(lunmatched == "" && lunmatched < lxy && lxy.compare(lunmatched) > 0);
+		std::cout << "  Test 2 passed: unmatched sub-matches" << std::endl;
+	}
+
+	// Test 3: No allocation
+	{
+		const std::string s = "key=value; key=other";
+		const std::string key = "key";
+		rex::regex re(std::string("(\\w+)=(\\w+)"));
+		rex::smatch m1, m2;
+		TEST_ASSERT(rex::regex_search(s, m1, re));
+		TEST_ASSERT(rex::regex_search(m1.suffix().first, s.cend(), m2, re));
+		std::list<char> chars(s.begin(), s.end());
+		rex::sub_match<std::list<char>::const_iterator> lkey(chars.cbegin(), std::next(chars.cbegin(), 3));
+
+		g_allocations = 0;
+		bool ok = m1[1] == m2[1] && m1[2] != m2[2] && m1[2] > m2[2];
+		ok = ok && m1[1] == key && key == m2[1] && m1[1] == "key" && "value" == m1[2];
+		ok = ok && lkey == key && lkey == "key" && lkey < "kez";
+		ok = ok && m1[1].data() == s.data() && m1[1].length() == 3;
+		TEST_ASSERT(g_allocations == 0);
+		TEST_ASSERT(ok);
+		std::cout << "  Test 3 passed: no allocation" << std::endl;
+	}
+
+	// Test 4: Hashing and views
+	{
+		const std::string s = "abc abc";
+		rex::regex re(std::string("\\w+"));
+		std::vector<size_t> hashes;
+		for (rex::sregex_iterator it(s.begin(), s.end(), re), end; it != end; ++it) {
+			const rex::ssub_match& sub = (*it)[0];
+			size_t h = 0;
+			for (const char *p = sub.data(), *e = p + sub.length(); p != e; ++p)
+				h = h * 31 + static_cast<unsigned char>(*p);
+			hashes.push_back(h);
+		}
+		TEST_ASSERT(hashes.size() == 2 && hashes[0] == hashes[1]);
+
+		const char* p = "one two";
+		rex::cmatch cm;
+		TEST_ASSERT(rex::regex_search(p, cm, rex::regex(std::string("t\\w+"))));
+		TEST_ASSERT(cm[0].data() == p + 4 && cm[0].length() == 3);
+
+#ifdef ONIGPP_HAS_STRING_VIEW
+		std::string_view v = cm[0].view();
+		TEST_ASSERT(v == "two" && v.data() == p + 4);
+		TEST_ASSERT(cm[0].compare(std::string_view("two")) == 0 && cm[0].compare(std::string_view("tw")) > 0);
+		TEST_ASSERT(std::hash<std::string_view>()(cm[0].view()) == std::hash<std::string_view>()("two"));
+		rex::csub_match none(p, p + 3, false);
+		TEST_ASSERT(none.view().empty() && none.view().data() == nullptr);
+#endif
+		std::cout << "  Test 4 passed: hashing and views" << std::endl;
+	}
+
+	// Test 5: Wide characters
+	{
+		const std::wstring ws = L"東京 東京";
+		rex::wsmatch m;
+		TEST_ASSERT(rex::regex_search(ws, m, rex::wregex(std::wstring(L"(東.) (東.)"))));
+		TEST_ASSERT(m[1] == m[2] && m[1] == L"東京" && m[1] < L"東北" && m[1].data() == ws.data());
+
+		const std::u16string s16 = u"𝄞x";
+		rex::u16ssub_match sub16(s16.begin(), s16.end());
+		TEST_ASSERT(sub16 == u"𝄞x" && sub16 > u"𝄞" && sub16.compare(std::u16string(u"𝄞y")) < 0);
+
+		const std::u32string s32 = U"\U0010FFFF";
+		rex::u32ssub_match sub32(s32.begin(), s32.end());
+		TEST_ASSERT(sub32 > U"a" && sub32 == s32 && sub32.data() == s32.data());
+		std::cout << "  Test 5 passed: wide characters" << std::endl;
+	}
+
+	std::cout << "All sub_match view tests passed." << std::endl;
+	return 0;
+}
@@ -0,0 +1,150 @@
+// word_boundary_flags_test.cpp --- Tests for match_not_bow, match_not_eow and match_prev_avail
+// Author: katahiromz
+// License: BSD-2-Clause
+
+#include "../onigpp.h"
+#include <iostream>
+#include <cassert>
+#include <list>
+#include <string>
+
+// Helper macro for test assertions
+#define TEST_ASSERT(cond) do { \
+	if (!(cond)) { \
+		std::cerr << "FAIL: " << #cond << " at line " << __LINE__ << std::endl; \
+		return 1; \
+	} \
+} while(0)
+
+namespace rex = onigpp;
+
+static const rex::regex_constants::match_flag_type not_bow = rex::regex_constants::match_not_bow;
+static const rex::regex_constants::match_flag_type not_eow = rex::regex_constants::match_not_eow;
+static const rex::regex_constants::match_flag_type prev_avail = rex::regex_constants::match_prev_avail;
+
+// Position and length of the first match, or -1 when there is none
+static std::pair<int, int> find(const std::string& s, const std::string& pattern,
+                                rex::regex_constants::match_flag_type flags,
+                                rex::regex::flag_type syntax = rex::regex::ECMAScript)
+{
+	rex::regex re(pattern, syntax);
+	rex::smatch m;
+	if (!rex::regex_search(s, m, re, flags)) return std::make_pair(-1, -1);
+	return std::make_pair(static_cast<int>(m.position(0)), static_cast<int>(m.length(0)));
+}
+
+int main() {
+	rex::auto_init init;
+
+	std::cout << "Testing word boundary match flags..." << std::endl;
+
+	// Test 1: The string edges are no word boundary
+	{
+		TEST_ASSERT(find("ab cd", "\\bcd", not_bow) == std::make_pair(3, 2));
+		TEST_ASSERT(find("ab cd", "\\bab", not_bow).first == -1);
+		TEST_ASSERT(find("ab cd", "ab\\b", not_eow) == std::make_pair(0, 2));
+		TEST_ASSERT(find("ab cd", "cd\\b", not_eow).first == -1);
+		TEST_ASSERT(find("ab", "\\Ba", not_bow) == std::make_pair(0, 1));
+		TEST_ASSERT(find("ab", "b\\B", not_eow) == std::make_pair(1, 1));
+		TEST_ASSERT(find("ab", "\\b", not_bow | not_eow).first == -1);
+		TEST_ASSERT(find("", "\\B", not_bow | not_eow) == std::make_pair(0, 0));
+		TEST_ASSERT(find("x", "[\\b]|\\bx", not_bow).first == -1);
+		TEST_ASSERT(find("x", "(?#\\b)x", not_bow) == std::make_pair(0, 1));
+
+		// Grammars and look-behinds without a rewritten program
+		TEST_ASSERT(find("a", "(?<=\\b)a", not_bow).first == -1);
+		TEST_ASSERT(find("ba", "a\\>", not_eow, rex::regex::grep).first == -1);
+		TEST_ASSERT(find("ba", "a\\>", rex::regex_constants::match_default, rex::regex::grep) == std::make_pair(1, 1));
+		std::cout << "  Test 1 passed: string edges" << std::endl;
+	}
+
+	// Test 2: Matches stay inside the subject
+	{
+		TEST_ASSERT(find("ab", "\\w+", not_eow) == std::make_pair(0, 2));
+		TEST_ASSERT(find("b", "a", not_bow | not_eow).first == -1);
+		TEST_ASSERT(find("ab", "(?<=\\b)b|a", not_eow) == std::make_pair(0, 1));
+
+		rex::regex anchored(std::string("^x$"));
+		rex::smatch m;
+		std::string x = "x";
+		TEST_ASSERT(rex::regex_match(x, m, anchored, not_bow | not_eow));
+		TEST_ASSERT(rex::regex_search(x, m, anchored, not_eow));
+
+		rex::regex word(std::string("\\w+\\b"));
+		std::string ab = "ab";
+		TEST_ASSERT(!rex::regex_match(ab, m, word, not_eow));
+		TEST_ASSERT(rex::regex_match(ab, m, word, not_bow));
+		std::cout << "  Test 2 passed: matches within the subject" << std::endl;
+	}
+
+	// Test 3: match_prev_avail sees the character before first
+	{
+		std::string s = "xab cd";
+		rex::regex boundary(std::string("\\b\\w+"));
+		rex::smatch m;
+		TEST_ASSERT(rex::regex_search(s.cbegin() + 1, s.cend(), m, boundary, prev_avail));
+		TEST_ASSERT(m.position(0) == 3 && m.str() == "cd");
+		TEST_ASSERT(rex::regex_search(s.cbegin() + 1, s.cend(), m, boundary));
+		TEST_ASSERT(m.position(0) == 0 && m.str() == "ab");
+
+		// match_not_bow is ignored with match_prev_avail
+		std::string t = " ab";
+		TEST_ASSERT(rex::regex_search(t.cbegin() + 1, t.cend(), m, boundary, prev_avail | not_bow));
+		TEST_ASSERT(m.position(0) == 0);
+
+		rex::regex behind(std::string("(?<=x)a"));
+		TEST_ASSERT(rex::regex_match(s.cbegin() + 1, s.cbegin() + 2, m, behind, prev_avail));
+		TEST_ASSERT(!rex::regex_match(s.cbegin() + 1, s.cbegin() + 2, m, behind));
+
+		rex::regex caret(std::string("^a"));
+		rex::regex caret_ml(std::string("^a"), rex::regex::ECMAScript | rex::regex::multiline);
+		std::string lines = "\nab";
+		TEST_ASSERT(!rex::regex_search(s.cbegin() + 1, s.cend(), m, caret, prev_avail));
+		TEST_ASSERT(rex::regex_search(lines.cbegin() + 1, lines.cend(), m, caret_ml, prev_avail));
+		TEST_ASSERT(!rex::regex_search(s.cbegin() + 1, s.cend(), m, caret_ml, prev_avail));
+
+		// Non-contiguous iterators and iterators
+		std::list<char> l(s.begin(), s.end());
+		rex::match_results<std::list<char>::const_iterator> lm;
+		TEST_ASSERT(rex::regex_search(std::next(l.cbegin()), l.cend(), lm, boundary, prev_avail));
+		TEST_ASSERT(lm.position(0) == 3);
+
+		int count = 0;
+		for (rex::sregex_iterator it(s.cbegin() + 1, s.cend(), boundary, prev_avail), end; it != end; ++it) {
+			TEST_ASSERT(it->str() == "cd");
+			++count;
+		}
+		TEST_ASSERT(count == 1);
+
+		count = 0;
+		typedef rex::regex_iterator<std::list<char>::iterator> list_iterator;
+		for (list_iterator it(std::next(l.begin()), l.end(), boundary, prev_avail), end; it != end; ++it) {
+			TEST_ASSERT(it->str() == "cd");
+			++count;
+		}
+		TEST_ASSERT(count == 1);
+		std::cout << "  Test 3 passed: match_prev_avail" << std::endl;
+	}
+
+	// Test 4: Copies of a regex share the variant; wide characters
+	{
+		rex::regex re(std::string("\\bb"));
+		rex::regex copy = re;
+		rex::smatch m;
+		std::string s = "b b";
+		for (int i = 0; i < 3; ++i) {
+			TEST_ASSERT(rex::regex_search(s, m, (i % 2) ? copy : re, not_bow));
+			TEST_ASSERT(m.position(0) == 2);
+		}
+
+		rex::wregex wre(std::wstring(L"\\w+\\b"));
+		rex::wsmatch wm;
+		std::wstring ws = L"été x";
+		TEST_ASSERT(rex::regex_search(ws, wm, wre, not_eow));
+		TEST_ASSERT(wm.str() == L"été");
+		std::cout << "  Test 4 passed: shared variants and wide characters" << std::endl;
+	}
+
+	std::cout << "All word boundary match flag tests passed." << std::endl;
+	return 0;
+}